@@ -0,0 +1,69 @@
+/**
+ * 外部驱动示例
+ *
+ * 生成的代码以 -DCAPL_NO_MAIN 编译时不含 main，由驱动调用 capl_rt.h 中声明的入口：
+ * 运行 on start，按命令行参数的顺序分派报文、推进仿真时间和按键，再运行 on stop。
+ * 报文写作 ID:字节,字节,...（十六进制），如 0C0:12,34；t毫秒推进仿真时间，如 t1000；
+ * k字符分派按键，如 kr
+ *
+ * g++ -std=c++17 -Iruntime -DCAPL_NO_MAIN -x c++ output.cbf -x none examples/node_driver.cpp -Llib -lcapl_rt
+ */
+
+#include "capl_rt.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+/**
+ * 解析命令行中的一帧报文
+ * @param text 报文文本 ID:字节,字节,...
+ * @param msg 输出的报文
+ * @return 是否成功
+ */
+bool parseFrame(const char* text, capl_message& msg) {
+    std::memset(&msg, 0, sizeof(msg));
+    char* end = nullptr;
+    msg.id = static_cast<unsigned int>(std::strtoul(text, &end, 16));
+    if (end == text) {
+        return false;
+    }
+    if (*end == ':') {
+        do {
+            const char* start = end + 1;
+            unsigned long value = std::strtoul(start, &end, 16);
+            if (end == start || value > 0xFF || msg.dlc >= sizeof(msg.data)) {
+                return false;
+            }
+            msg.data[msg.dlc++] = static_cast<unsigned char>(value);
+        } while (*end == ',');
+    }
+    return *end == '\0';
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    capl_start();
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == 't') {
+            capl_advance_time(std::atoll(argv[i] + 1));
+            continue;
+        }
+        if (argv[i][0] == 'k' && argv[i][1] != '\0' && argv[i][2] == '\0') {
+            capl_dispatch_key(static_cast<unsigned char>(argv[i][1]));
+            continue;
+        }
+        capl_message msg;
+        if (!parseFrame(argv[i], msg)) {
+            std::fprintf(stderr, "无法解析报文: %s\n", argv[i]);
+            return 1;
+        }
+        if (!capl_dispatch(&msg)) {
+            std::printf("未处理的报文: 0x%x\n", msg.id);
+        }
+    }
+    capl_stop();
+    return 0;
+}
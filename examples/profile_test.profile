@@ -0,0 +1,10 @@
+# profile_test.capl 的剖析数据（--profile-generate 生成的程序退出时写入的格式）
+# 分支的键为 if 语句在源码中所在的函数或处理器和序号，内联到各处理器的 smooth 共用一组计数
+handler on message 0x100 800000
+branch smooth #1 taken 2000
+branch smooth #1 not_taken 848000
+branch on message 0x100 #1 taken 799000
+branch on message 0x100 #1 not_taken 1000
+handler on message 0x101 150000
+handler on message 0x200 50000
+handler on message 0x7FF 0
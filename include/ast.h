@@ -7,6 +7,7 @@
 #ifndef CAPL_AST_H
 #define CAPL_AST_H
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
@@ -69,6 +70,16 @@ enum class ASTNodeType {
 
 /**
  * AST 节点基类
+ * 
+ * 语句节点的子节点约定:
+ *   IF_STMT:     [条件, then 代码块, (else 代码块)]
+ *   WHILE_STMT:  [条件, 循环体代码块]
+ *   FOR_STMT:    [初始化, 条件, 更新, 循环体代码块]，缺省部分为空的 EXPRESSION_STMT
+ *   SWITCH_STMT: [判别表达式, CASE_STMT...]
+ *   CASE_STMT:   [标签表达式, 语句代码块]，default 只有 [语句代码块]；没有 break 时落入下一个 CASE_STMT
+ *   RETURN_STMT: [(返回值)]
+ *   INDEX_EXPR:  [数组, 下标]
+ *   CONDITIONAL_EXPR: [条件, 真值, 假值]
  */
 class ASTNode {
 public:
@@ -114,6 +125,28 @@ public:
      */
     ASTNode* getChild(size_t index) const;
     
+    /**
+     * 替换指定索引的子节点（供优化遍改写 AST）
+     * @param index 索引
+     * @param child 新子节点
+     * @return 被替换的旧子节点
+     */
+    std::unique_ptr<ASTNode> replaceChild(size_t index, std::unique_ptr<ASTNode> child);
+    
+    /**
+     * 移除指定索引的子节点
+     * @param index 索引
+     * @return 被移除的子节点
+     */
+    std::unique_ptr<ASTNode> removeChild(size_t index);
+    
+    /**
+     * 在指定位置插入子节点
+     * @param index 插入位置
+     * @param child 子节点
+     */
+    void insertChild(size_t index, std::unique_ptr<ASTNode> child);
+    
     /**
      * 设置行号
      * @param line 行号
@@ -159,7 +192,18 @@ protected:
 class ProgramNode : public ASTNode {
 public:
     ProgramNode();
+    
+    /**
+     * 添加 candb 声明的 CAN 数据库
+     * @param path 数据库文件路径（相对路径相对于源文件所在目录）
+     */
+    void addDatabase(const std::string& path) { databases_.push_back(path); }
+    const std::vector<std::string>& getDatabases() const { return databases_; }
+    
     std::string toString(int indent = 0) const override;
+
+private:
+    std::vector<std::string> databases_;    // candb 声明的数据库
 };
 
 /**
@@ -178,11 +222,35 @@ public:
     const std::string& getName() const { return name_; }
     const std::string& getReturnType() const { return return_type_; }
     
+    /**
+     * 添加形参（VariableDeclNode），形参不计入子节点，子节点仅为函数体语句
+     * @param param 形参节点
+     */
+    void addParameter(std::unique_ptr<ASTNode> param);
+    
+    const std::vector<std::unique_ptr<ASTNode>>& getParameters() const { return parameters_; }
+    
     std::string toString(int indent = 0) const override;
 
 private:
     std::string name_;          // 函数名
     std::string return_type_;   // 返回类型
+    std::vector<std::unique_ptr<ASTNode>> parameters_;  // 形参列表
+};
+
+/**
+ * 信号在报文中的位置和换算，由数据库解析得到
+ */
+struct SignalInfo {
+    std::string message;        // 所属报文名
+    uint32_t message_id = 0;    // 所属报文 ID
+    int message_dlc = 0;        // 所属报文的数据长度
+    int start_bit = 0;          // 起始位（DBC 中的位置）
+    int length = 0;             // 位长度
+    bool little_endian = true;  // Intel 字节序
+    bool is_signed = false;     // 是否有符号
+    double factor = 1.0;        // 物理值 = 原始值 * factor + offset
+    double offset = 0.0;
 };
 
 /**
@@ -200,11 +268,42 @@ public:
     const std::string& getName() const { return name_; }
     const std::string& getVarType() const { return var_type_; }
     
+    /**
+     * 数组长度，0 表示标量
+     */
+    void setArraySize(int size) { array_size_ = size; }
+    int getArraySize() const { return array_size_; }
+    bool isArray() const { return array_size_ > 0; }
+    
+    /**
+     * message 变量引用的报文（ID 如 "0x100" 或数据库报文名），其他类型为空
+     */
+    void setMessageRef(const std::string& ref) { message_ref_ = ref; }
+    const std::string& getMessageRef() const { return message_ref_; }
+    
+    /**
+     * 数据库解析出的报文 ID 和数据长度，用于初始化 message 变量
+     */
+    void setMessageId(uint32_t id, int dlc) { message_id_ = id; message_dlc_ = dlc; has_message_id_ = true; }
+    bool hasMessageId() const { return has_message_id_; }
+    uint32_t getMessageId() const { return message_id_; }
+    int getMessageDlc() const { return message_dlc_; }
+    
+    /**
+     * 初始化表达式（第一个子节点），没有初始化时返回 nullptr
+     */
+    ASTNode* getInitializer() const { return getChild(0); }
+    
     std::string toString(int indent = 0) const override;
 
 private:
     std::string name_;      // 变量名
     std::string var_type_;  // 变量类型
+    int array_size_ = 0;    // 数组长度
+    std::string message_ref_;   // 报文引用
+    bool has_message_id_ = false;   // 报文引用是否已由数据库解析
+    uint32_t message_id_ = 0;       // 解析出的报文 ID
+    int message_dlc_ = 0;           // 解析出的数据长度
 };
 
 /**
@@ -235,14 +334,67 @@ public:
      * 构造函数
      * @param op 操作符
      */
-    explicit UnaryExprNode(const std::string& op);
+    explicit UnaryExprNode(const std::string& op, bool postfix = false);
     
     const std::string& getOperator() const { return operator_; }
+    bool isPostfix() const { return postfix_; }
     
     std::string toString(int indent = 0) const override;
 
 private:
     std::string operator_;  // 操作符
+    bool postfix_;          // 是否为后置操作符 (x++, x--)
+};
+
+/**
+ * 赋值表达式节点
+ * 子节点: [赋值目标, 值]
+ */
+class AssignmentExprNode : public ASTNode {
+public:
+    /**
+     * 构造函数
+     * @param op 赋值操作符 (=, +=, -=)
+     */
+    explicit AssignmentExprNode(const std::string& op);
+    
+    const std::string& getOperator() const { return operator_; }
+    
+    std::string toString(int indent = 0) const override;
+
+private:
+    std::string operator_;  // 操作符
+};
+
+/**
+ * 成员访问节点 (this.id, msg.byte(0))
+ * 子节点: [对象, 调用参数...]
+ */
+class MemberExprNode : public ASTNode {
+public:
+    /**
+     * 构造函数
+     * @param member 成员名
+     * @param is_call 是否为成员函数调用
+     */
+    MemberExprNode(const std::string& member, bool is_call);
+    
+    const std::string& getMember() const { return member_; }
+    bool isCall() const { return is_call_; }
+    
+    /**
+     * 数据库报文的信号成员 (msg.EngineSpeed)，由数据库解析得到；其他成员返回 nullptr
+     */
+    void setSignal(const SignalInfo& info) { signal_ = info; is_signal_ = true; }
+    const SignalInfo* getSignal() const { return is_signal_ ? &signal_ : nullptr; }
+    
+    std::string toString(int indent = 0) const override;
+
+private:
+    std::string member_;    // 成员名
+    bool is_call_;          // 是否为调用
+    SignalInfo signal_;     // 信号信息
+    bool is_signal_ = false;    // 是否为信号成员
 };
 
 /**
@@ -298,10 +450,71 @@ public:
     
     const std::string& getEventName() const { return event_name_; }
     
+    /**
+     * 数据库报文名解析出的报文 ID（on message EngineData）
+     */
+    void setMessageId(uint32_t id) { message_id_ = id; has_message_id_ = true; }
+    bool hasMessageId() const { return has_message_id_; }
+    uint32_t getMessageId() const { return message_id_; }
+    
+    /**
+     * 获取用于报告的事件描述，如 "on message 0x200"
+     * @return 事件描述
+     */
+    std::string getDisplayName() const;
+    
     std::string toString(int indent = 0) const override;
 
 private:
     std::string event_name_;    // 事件名称
+    bool has_message_id_ = false;   // 报文名是否已由数据库解析
+    uint32_t message_id_ = 0;       // 解析出的报文 ID
+};
+
+/**
+ * 信号访问节点 ($EngineSpeed 或 $EngineData::EngineSpeed)，读取最近收到的报文中的信号值
+ */
+class SignalAccessNode : public ASTNode {
+public:
+    /**
+     * 构造函数
+     * @param name 信号名，可带报文名限定 (Message::Signal)
+     */
+    explicit SignalAccessNode(const std::string& name);
+    
+    const std::string& getName() const { return name_; }
+    
+    /**
+     * 数据库解析得到的信号信息
+     */
+    void setInfo(const SignalInfo& info) { info_ = info; resolved_ = true; }
+    const SignalInfo& getInfo() const { return info_; }
+    bool isResolved() const { return resolved_; }
+    
+    std::string toString(int indent = 0) const override;
+
+private:
+    std::string name_;          // 信号名
+    SignalInfo info_;           // 信号信息
+    bool resolved_ = false;     // 是否已解析
+};
+
+/**
+ * if 语句节点
+ */
+class IfStmtNode : public ASTNode {
+public:
+    IfStmtNode();
+    
+    /**
+     * 剖析使用的分支名称：源码中所在的处理器或函数和在其中按先序的序号，如 "on message 0x100 #2"。
+     * 优化前命名一次，内联产生的副本沿用源 if 语句的名称
+     */
+    void setBranchName(const std::string& name) { branch_name_ = name; }
+    const std::string& getBranchName() const { return branch_name_; }
+
+private:
+    std::string branch_name_;   // 分支名称，未命名时为空
 };
 
 /**
@@ -323,6 +536,41 @@ private:
     std::string function_name_; // 函数名
 };
 
+/**
+ * 赋值目标的根变量名 (a, a[i], a.byte(0), a[i].id 均为 a)
+ * @param node 赋值目标
+ * @return 根变量名，不是变量时返回空串
+ */
+std::string getRootVariable(const ASTNode* node);
+
+/**
+ * 是否为自增/自减表达式 (++/--)
+ * @param node 节点
+ * @return 是否为自增/自减
+ */
+bool isIncrementExpr(const ASTNode* node);
+
+/**
+ * 表达式是否有副作用（调用、赋值、自增减）。报文的 byte() 等选择器视为读取
+ * @param node 表达式，为空时没有副作用
+ * @return 是否有副作用
+ */
+bool hasSideEffects(const ASTNode* node);
+
+/**
+ * 节点的子节点是否为语句列表（代码块、函数体、事件处理器体）
+ * @param node 节点
+ * @return 是否为语句列表
+ */
+bool isStatementList(const ASTNode* node);
+
+/**
+ * 深拷贝子树（供优化遍复制函数体）
+ * @param node 子树根节点
+ * @return 拷贝，node 为空时返回 nullptr
+ */
+std::unique_ptr<ASTNode> cloneTree(const ASTNode* node);
+
 /**
  * AST 访问者接口
  * 用于遍历和处理 AST
@@ -0,0 +1,130 @@
+/**
+ * CAPL 数组下标检查与下标范围分析
+ *
+ * 代码生成为每个下标长度已知的数组访问插入越界检查。范围分析对下标表达式
+ * 求取值区间：常量、计数循环 for (i = A; i < B; i++) 中未被循环体修改的
+ * 循环变量、if 条件限定的局部变量，以及它们的加减乘、% 常量、& 常量组合。
+ * 区间落在 [0, 长度) 内的访问证明安全，优化时可省略检查
+ */
+
+#ifndef CAPL_BOUNDS_CHECK_H
+#define CAPL_BOUNDS_CHECK_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 下标的取值区间
+ */
+struct IndexRange {
+    bool known = false;     // 区间是否已知
+    long long lo = 0;       // 下界（含）
+    long long hi = 0;       // 上界（含）
+    
+    static IndexRange make(long long lo, long long hi);
+    
+    /**
+     * 区间为空（所在代码不会执行）
+     */
+    bool isEmpty() const { return known && lo > hi; }
+};
+
+/**
+ * 一处数组下标访问
+ */
+struct IndexCheck {
+    const ASTNode* node = nullptr;  // INDEX_EXPR 节点
+    std::string array;              // 数组名
+    int size = 0;                   // 数组长度
+    std::string unit;               // 所在的处理器或函数
+    IndexRange range;               // 下标的取值区间
+    bool proven = false;            // 是否证明不会越界
+};
+
+/**
+ * 数组下标范围分析
+ */
+class BoundsCheckAnalysis {
+public:
+    /**
+     * 构造函数
+     */
+    BoundsCheckAnalysis();
+    
+    /**
+     * 分析程序中的数组下标访问
+     * @param program AST 根节点
+     */
+    void analyze(const ASTNode* program);
+    
+    /**
+     * 清空分析结果
+     */
+    void clear();
+    
+    /**
+     * 获取所有下标访问（按源码顺序）
+     * @return 下标访问列表
+     */
+    const std::vector<IndexCheck>& getChecks() const { return checks_; }
+    
+    /**
+     * 查找下标表达式对应的访问
+     * @param index_expr INDEX_EXPR 节点
+     * @return 访问信息，数组长度未知时返回 nullptr
+     */
+    const IndexCheck* findCheck(const ASTNode* index_expr) const;
+    
+    /**
+     * 获取证明安全的访问数量
+     * @return 访问数量
+     */
+    int getProvenCount() const;
+
+private:
+    /**
+     * 作用域中的名称：数组记录长度，整数标量可带取值区间
+     */
+    struct Binding {
+        int array_size = 0;     // 数组长度，0 为标量，-1 为长度未知的数组参数
+        bool integer = false;   // 是否为整数标量
+        IndexRange range;       // 标量的取值区间
+    };
+    
+    /**
+     * 条件限定的单侧边界
+     */
+    struct Bound {
+        bool has_lo = false;
+        bool has_hi = false;
+        long long lo = 0;
+        long long hi = 0;
+    };
+    
+    void analyzeUnit(const ASTNode* unit, const std::string& unit_name);
+    void visit(const ASTNode* node);
+    void visitChildren(const ASTNode* node);
+    void visitFor(const ASTNode* node);
+    void visitIf(const ASTNode* node);
+    void declare(const ASTNode* decl);
+    void recordIndex(const ASTNode* node);
+    const Binding* lookup(const std::string& name) const;
+    bool isLocal(const std::string& name) const;
+    IndexRange rangeOf(const ASTNode* expr) const;
+    bool matchCountedLoop(const ASTNode* for_node, std::string& var, IndexRange& range) const;
+    void collectGuards(const ASTNode* cond, std::map<std::string, Bound>& guards) const;
+    
+    std::vector<std::map<std::string, Binding>> scopes_;   // scopes_[0] 为全局变量
+    std::string unit_;                                      // 当前处理器或函数
+    std::vector<IndexCheck> checks_;                        // 分析结果
+    std::map<const ASTNode*, size_t> index_;                // 下标节点到结果下标
+};
+
+} // namespace capl
+
+#endif // CAPL_BOUNDS_CHECK_H
@@ -0,0 +1,209 @@
+/**
+ * CAN 数据库 (DBC) 加载
+ *
+ * candb "xxx.dbc"; 声明的数据库在编译时加载，用于解析 on message 报文名和 $信号：
+ * - DBC 文件以 mmap 映射后直接在内存中扫描，只提取 BO_（报文）和 SG_（信号）记录，
+ *   解析为紧凑的报文表、信号表和一个名称字符串池
+ * - 解析结果连同按名称排序的索引写入输出目录中的二进制索引缓存 (xxx.dbc.idx)，
+ *   缓存头记录 DBC 内容的散列和长度；之后的编译散列一遍 DBC，相同时直接把缓存中的表
+ *   拷贝进内存，不再解析文本
+ * 缓存按本机的字节序和结构体布局写出，只用于本机，版本或布局不符时重新解析
+ */
+
+#ifndef CAPL_CAN_DATABASE_H
+#define CAPL_CAN_DATABASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 数据库中的报文
+ */
+struct DbcMessage {
+    uint32_t id;                // 报文 ID（扩展帧不含 DBC 中的标志位）
+    uint32_t name;              // 名称在字符串池中的偏移
+    uint32_t name_length;       // 名称长度
+    uint32_t first_signal;      // 第一个信号在信号表中的下标
+    uint32_t signal_count;      // 信号数
+    uint8_t dlc;                // 数据长度
+    uint8_t extended;           // 是否为扩展帧
+    uint8_t reserved[2];
+};
+
+/**
+ * 数据库中的信号
+ */
+struct DbcSignal {
+    uint32_t name;              // 名称在字符串池中的偏移
+    uint32_t name_length;       // 名称长度
+    uint32_t message;           // 所属报文在报文表中的下标
+    uint16_t start_bit;         // 起始位：Intel 字节序为最低位，Motorola 字节序为最高位
+    uint8_t length;             // 位长度
+    uint8_t flags;              // kLittleEndian、kSigned、kMultiplexed 的组合
+    double factor;              // 物理值 = 原始值 * factor + offset
+    double offset;
+};
+
+/**
+ * CAN 数据库
+ */
+class CanDatabase {
+public:
+    /**
+     * 信号标志：Intel 字节序 (@1)
+     */
+    static constexpr uint8_t kLittleEndian = 1;
+    
+    /**
+     * 信号标志：有符号 (-)
+     */
+    static constexpr uint8_t kSigned = 2;
+    
+    /**
+     * 信号标志：多路复用信号或多路复用器 (M、mN)
+     */
+    static constexpr uint8_t kMultiplexed = 4;
+    
+    /**
+     * 索引缓存格式的版本，格式变化时递增
+     */
+    static constexpr uint32_t kCacheVersion = 1;
+    
+    /**
+     * 构造函数
+     */
+    CanDatabase();
+    
+    /**
+     * 加载 DBC 文件：索引缓存与文件内容一致时从缓存加载，否则解析文件并重写缓存
+     * @param path DBC 文件路径
+     * @param cache_path 索引缓存路径，空表示不使用缓存
+     * @param error 失败原因
+     * @return 是否成功
+     */
+    bool load(const std::string& path, const std::string& cache_path, std::string& error);
+    
+    /**
+     * 解析内存中的 DBC 文本
+     * @param data 文本
+     * @param size 字节数
+     * @param error 失败原因（带行号）
+     * @return 是否成功
+     */
+    bool parse(const char* data, size_t size, std::string& error);
+    
+    /**
+     * 清空数据库
+     */
+    void clear();
+    
+    /**
+     * 按名称查找报文
+     * @param name 报文名
+     * @return 报文，不存在时返回 nullptr
+     */
+    const DbcMessage* findMessage(const std::string& name) const;
+    
+    /**
+     * 按名称查找信号
+     * @param name 信号名
+     * @param matches 输出同名信号的个数（不同报文中可以有同名信号）
+     * @return 第一个同名信号，不存在时返回 nullptr
+     */
+    const DbcSignal* findSignal(const std::string& name, size_t& matches) const;
+    
+    /**
+     * 在指定报文中查找信号
+     * @param message 报文
+     * @param name 信号名
+     * @return 信号，不存在时返回 nullptr
+     */
+    const DbcSignal* findSignal(const DbcMessage& message, const std::string& name) const;
+    
+    /**
+     * 获取报文名
+     */
+    std::string getName(const DbcMessage& message) const { return names_.substr(message.name, message.name_length); }
+    
+    /**
+     * 获取信号名
+     */
+    std::string getName(const DbcSignal& signal) const { return names_.substr(signal.name, signal.name_length); }
+    
+    /**
+     * 获取信号所属的报文
+     */
+    const DbcMessage& getMessage(const DbcSignal& signal) const { return messages_[signal.message]; }
+    
+    const std::vector<DbcMessage>& getMessages() const { return messages_; }
+    const std::vector<DbcSignal>& getSignals() const { return signals_; }
+    
+    /**
+     * 获取 DBC 文件路径
+     */
+    const std::string& getPath() const { return path_; }
+    
+    /**
+     * 获取索引缓存路径，不使用缓存时为空
+     */
+    const std::string& getCachePath() const { return cache_path_; }
+    
+    /**
+     * 本次加载是否来自索引缓存
+     */
+    bool isFromCache() const { return from_cache_; }
+    
+    /**
+     * 解析后写入索引缓存失败的原因，写入成功或从缓存加载时为空
+     */
+    const std::string& getCacheError() const { return cache_error_; }
+    
+    /**
+     * DBC 内容的 64 位散列，作为索引缓存的键
+     * @param data 内容
+     * @param size 字节数
+     * @return 散列值
+     */
+    static uint64_t hashContent(const char* data, size_t size);
+
+private:
+    bool loadCache(const char* data, size_t size, uint64_t hash, uint64_t source_size);
+    bool writeCache(uint64_t hash, uint64_t source_size, std::string& error) const;
+    void buildIndex();
+    
+    template <typename Record>
+    const Record* findByName(const std::vector<uint32_t>& index, const std::vector<Record>& records,
+                             const std::string& name, size_t* matches) const;
+    
+    std::vector<DbcMessage> messages_;      // 报文表（按 DBC 中的顺序）
+    std::vector<DbcSignal> signals_;        // 信号表（同一报文的信号相邻）
+    std::vector<uint32_t> message_index_;   // 按名称排序的报文下标
+    std::vector<uint32_t> signal_index_;    // 按名称排序的信号下标
+    std::string names_;                     // 名称字符串池
+    std::string path_;                      // DBC 文件路径
+    std::string cache_path_;                // 索引缓存路径
+    bool from_cache_;                       // 是否从缓存加载
+    std::string cache_error_;               // 写入缓存失败的原因
+};
+
+/**
+ * 用数据库解析程序中的 on message 报文名、message 变量和信号：报文处理器和 message 变量记录报文 ID，
+ * $信号 以及数据库报文变量和处理器中 this 的信号成员 (msg.EngineSpeed) 记录信号的位置和换算。
+ * 报文名为数值 ID 或 * 的处理器和变量不受影响；数据库中没有的处理器报文名可以是变量块中
+ * 以数值 ID 声明的同名 message 变量。同一报文 ID 或 * 有多个处理器时报错
+ * @param program AST 根节点
+ * @param databases 已加载的数据库，按 candb 声明的顺序查找
+ * @param errors 输出的错误（未知的报文或信号、有歧义的信号名、对 $信号 赋值、重复的报文处理器等）
+ */
+void resolveDatabaseSymbols(ASTNode* program, const std::vector<CanDatabase>& databases,
+                            std::vector<std::string>& errors);
+
+} // namespace capl
+
+#endif // CAPL_CAN_DATABASE_H
@@ -7,17 +7,39 @@
 #ifndef CAPL_COMPILER_H
 #define CAPL_COMPILER_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
 #include <map>
+#include <functional>
+#include <set>
+#include <fstream>
 #include "token.h"
 #include "symbol_table.h"
+#include "state_layout.h"
+#include "gateway_routes.h"
+#include "handler_folding.h"
+#include "loop_vectorizer.h"
+#include "bounds_check.h"
+#include "can_database.h"
+#include "event_tables.h"
+#include "integer_narrowing.h"
+#include "integer_wrap.h"
+#include "message_dispatch.h"
+#include "output_buffer.h"
+#include "profile_data.h"
+#include "switch_lowering.h"
+#include "write_format.h"
 
 namespace capl {
 
 // 前向声明
 class ASTNode;
+class FunctionNode;
+class VariableDeclNode;
+class SignalAccessNode;
+struct SignalInfo;
 class CodeGenerator;
 
 /**
@@ -77,8 +99,114 @@ public:
      * @return 警告信息列表
      */
     const std::vector<std::string>& getWarnings() const;
+    
+    /**
+     * 设置是否输出事件处理器开销报告
+     * @param enable 是否输出
+     */
+    void setCostReport(bool enable) { cost_report_ = enable; }
+    
+    /**
+     * 设置每个事件处理器的操作数预算，超出时产生警告
+     * @param budget 预算，0 表示不检查
+     */
+    void setCostBudget(uint64_t budget) { cost_budget_ = budget; }
+    
+    /**
+     * 设置是否输出全局状态内存布局报告
+     * @param enable 是否输出
+     */
+    void setLayoutReport(bool enable) { layout_report_ = enable; }
+    
+    /**
+     * 设置优化级别，决定代码生成前运行哪些优化遍
+     * @param level 优化级别 (0-3)
+     */
+    void setOptimizeLevel(int level) { optimize_level_ = level; }
+    
+    /**
+     * 设置是否输出优化遍统计
+     * @param enable 是否输出
+     */
+    void setPassStats(bool enable) { pass_stats_ = enable; }
+    
+    /**
+     * 设置是否输出 SSA 中间表示
+     * @param enable 是否输出
+     */
+    void setIRDump(bool enable) { ir_dump_ = enable; }
+    
+    /**
+     * 设置是否构造并验证 SSA 中间表示（--ir-dump 时总是验证）
+     * @param enable 是否验证
+     */
+    void setVerifyIR(bool enable) { verify_ir_ = enable; }
+    
+    /**
+     * 设置是否为调试构建：调试构建保留所有数组下标检查
+     * @param enable 是否为调试构建
+     */
+    void setDebug(bool enable) { debug_ = enable; }
+    
+    /**
+     * 设置插桩模式：生成的程序为处理器和分支计数，退出时写入剖析文件
+     * @param path 剖析文件路径，空表示不插桩
+     */
+    void setProfileGenerate(const std::string& path) { profile_generate_ = path; }
+    
+    /**
+     * 设置编译时使用的剖析文件
+     * @param path 剖析文件路径，空表示不使用
+     */
+    void setProfileUse(const std::string& path) { profile_use_ = path; }
+    
+    /**
+     * 设置代码生成的线程数
+     * @param jobs 线程数，0 表示使用 CPU 核数
+     */
+    void setJobs(unsigned jobs) { jobs_ = jobs; }
+    
+    /**
+     * 设置分片数：输出共用头文件和多个 .cpp 文件，供下游编译器并行编译
+     * @param shards 分片数，0 表示输出单个文件
+     */
+    void setShards(unsigned shards) { shards_ = shards; }
 
 private:
+    /**
+     * 运行静态开销模型，输出报告并检查预算
+     * @param ast AST 根节点
+     */
+    void runCostModel(const std::unique_ptr<ASTNode>& ast);
+    
+    /**
+     * 输出全局状态布局报告（含定时器和报文缓存）
+     * @param ast AST 根节点
+     */
+    void printLayoutReport(const std::unique_ptr<ASTNode>& ast);
+    
+    /**
+     * 构造并验证 SSA 中间表示，需要时输出
+     * @param ast AST 根节点
+     * @return 是否通过验证
+     */
+    bool buildIR(const std::unique_ptr<ASTNode>& ast);
+    
+    /**
+     * 加载 candb 声明的 CAN 数据库，解析报文名和信号
+     * @param ast AST 根节点
+     * @param output_file 输出文件路径，索引缓存写在其所在目录；为空（语法检查）时不使用缓存
+     * @return 是否成功
+     */
+    bool loadDatabases(const std::unique_ptr<ASTNode>& ast, const std::string& output_file);
+    
+    /**
+     * 检查 write 调用的格式字符串与实参是否相符
+     * @param ast AST 根节点
+     * @return 是否通过检查
+     */
+    bool checkWriteFormats(const std::unique_ptr<ASTNode>& ast);
+    
     std::unique_ptr<class Lexer> lexer_;           // 词法分析器
     std::unique_ptr<class Parser> parser_;         // 语法分析器
     std::unique_ptr<class SemanticAnalyzer> semantic_analyzer_; // 语义分析器
@@ -86,6 +214,22 @@ private:
     
     std::vector<std::string> errors_;              // 错误信息
     std::vector<std::string> warnings_;            // 警告信息
+    
+    bool cost_report_;                             // 输出开销报告
+    uint64_t cost_budget_;                         // 每事件操作数预算
+    bool layout_report_;                           // 输出状态布局报告
+    int optimize_level_;                           // 优化级别
+    bool pass_stats_;                              // 输出优化遍统计
+    bool ir_dump_;                                 // 输出 SSA 中间表示
+    bool verify_ir_;                               // 验证 SSA 中间表示
+    bool debug_;                                   // 调试构建
+    std::string profile_generate_;                 // 插桩时写入的剖析文件
+    std::string profile_use_;                      // 编译时使用的剖析文件
+    ProfileData profile_;                          // 读入的剖析数据
+    unsigned jobs_;                                // 代码生成的线程数，0 表示使用 CPU 核数
+    unsigned shards_;                              // 分片数，0 表示输出单个文件
+    std::string source_dir_;                       // 源文件所在目录，candb 的相对路径相对于此目录
+    std::vector<CanDatabase> databases_;           // 加载的 CAN 数据库
 };
 
 /**
@@ -157,17 +301,33 @@ private:
     
     // 各种语法规则的解析方法
     std::unique_ptr<ASTNode> parseProgram();
+    void parseDatabaseDecl(class ProgramNode* program);
     std::unique_ptr<ASTNode> parseTopLevelDeclaration();
     std::unique_ptr<ASTNode> parseVariablesBlock();
     std::unique_ptr<ASTNode> parseVariableDeclaration();
     std::unique_ptr<ASTNode> parseEventHandler();
     std::unique_ptr<ASTNode> parseFunction();
+    std::unique_ptr<ASTNode> parseBlock();
+    std::unique_ptr<ASTNode> parseBody();
     std::unique_ptr<ASTNode> parseStatement();
-    std::unique_ptr<ASTNode> parseAssignmentOrCall();
+    std::unique_ptr<ASTNode> parseExpressionStatement();
     std::unique_ptr<ASTNode> parseIfStatement();
     std::unique_ptr<ASTNode> parseWhileStatement();
     std::unique_ptr<ASTNode> parseForStatement();
+    std::unique_ptr<ASTNode> parseSwitchStatement();
+    std::unique_ptr<ASTNode> parseReturnStatement();
+    
+    // 表达式解析（按优先级从低到高）
     std::unique_ptr<ASTNode> parseExpression();
+    std::unique_ptr<ASTNode> parseConditional();
+    std::unique_ptr<ASTNode> parseBinary(int min_precedence);
+    std::unique_ptr<ASTNode> parseUnary();
+    std::unique_ptr<ASTNode> parsePostfix(std::unique_ptr<ASTNode> expr);
+    std::unique_ptr<ASTNode> parsePrimary();
+    
+    // 辅助方法
+    bool isTypeKeyword(TokenType type) const;
+    static int binaryPrecedence(TokenType type);
 };
 
 /**
@@ -198,6 +358,15 @@ private:
     std::unique_ptr<SymbolTable> symbol_table_;
 };
 
+/**
+ * 分片输出中的一个 .cpp 文件
+ */
+struct OutputShard {
+    std::string path;       // 文件路径
+    size_t units = 0;       // 包含的处理器和用户函数数
+    size_t bytes = 0;       // 生成代码的字节数
+};
+
 /**
  * CAPL 代码生成器
  * 将 AST 转换为目标代码
@@ -219,9 +388,211 @@ public:
     bool generate(const std::unique_ptr<ASTNode>& ast, 
                   const SymbolTable& symbol_table,
                   const std::string& output_file);
+    
+    /**
+     * 获取最近一次生成所用的全局状态布局
+     * @return 状态布局
+     */
+    const StateLayout& getStateLayout() const { return state_layout_; }
+    
+    /**
+     * 设置是否合并函数体相同的事件处理器
+     * @param enable 是否合并
+     */
+    void setFoldHandlers(bool enable) { fold_handlers_ = enable; }
+    
+    /**
+     * 获取最近一次生成所用的处理器等价类
+     * @return 处理器合并结果
+     */
+    const HandlerFolding& getHandlerFolding() const { return handler_folding_; }
+    
+    /**
+     * 设置是否把纯转发的报文处理器编译为网关路由表
+     * @param enable 是否编译为路由
+     */
+    void setCompileRoutes(bool enable) { compile_routes_ = enable; }
+    
+    /**
+     * 获取最近一次生成时的网关路由
+     * @return 路由识别结果
+     */
+    const GatewayRoutes& getGatewayRoutes() const { return gateway_routes_; }
+    
+    /**
+     * 设置是否把可向量化的循环提取为内核函数
+     * @param enable 是否提取
+     */
+    void setVectorizeLoops(bool enable) { vectorize_loops_ = enable; }
+    
+    /**
+     * 获取最近一次生成时识别出的可向量化循环
+     * @return 循环识别结果
+     */
+    const LoopVectorizer& getLoopVectorizer() const { return loop_vectorizer_; }
+    
+    /**
+     * 设置是否省略范围分析证明安全的数组下标检查
+     * @param enable 是否省略
+     */
+    void setEliminateBoundsChecks(bool enable) { eliminate_bounds_checks_ = enable; }
+    
+    /**
+     * 获取最近一次生成时的数组下标范围分析结果
+     * @return 范围分析结果
+     */
+    const BoundsCheckAnalysis& getBoundsCheckAnalysis() const { return bounds_check_; }
+    
+    /**
+     * 设置是否按值域收窄全局整数变量的存储类型
+     * @param enable 是否收窄
+     */
+    void setNarrowIntegers(bool enable) { narrow_integers_ = enable; }
+    
+    /**
+     * 获取最近一次生成时的整数存储宽度收窄结果
+     * @return 收窄结果
+     */
+    const IntegerNarrowing& getIntegerNarrowing() const { return integer_narrowing_; }
+    
+    /**
+     * 设置插桩模式：为每个处理器和 if 分支计数，程序退出时写入剖析文件。
+     * 插桩时不合并处理器、不编译网关路由，使每个处理器单独计数
+     * @param path 剖析文件路径，空表示不插桩
+     */
+    void setProfileGenerate(const std::string& path) { profile_generate_ = path; }
+    
+    /**
+     * 获取最近一次生成的剖析计数器数量
+     */
+    size_t getProfileCounterCount() const { return profile_keys_.size(); }
+    
+    /**
+     * 设置剖析数据：热点处理器标记 [[gnu::hot]]、冷处理器标记 [[gnu::cold]]，
+     * 偏向一侧的 if 生成分支预测提示，热点路由排在路由表查找之前
+     * @param profile 剖析数据，nullptr 表示不使用
+     */
+    void setProfile(const ProfileData* profile) { profile_ = profile; }
+    
+    /**
+     * 获取最近一次生成的报文分派表
+     * @return 分派表
+     */
+    const MessageDispatch& getMessageDispatch() const { return message_dispatch_; }
+    
+    /**
+     * 获取最近一次生成的定时器 ID 和按键处理器数组
+     * @return 编号结果
+     */
+    const EventTables& getEventTables() const { return event_tables_; }
+    
+    /**
+     * 获取最近一次生成的 switch 语句分派方式
+     * @return 分派方式
+     */
+    const SwitchLowering& getSwitchLowering() const { return switch_lowering_; }
+    
+    /**
+     * 获取最近一次生成的 write 格式化方式
+     * @return 格式化方式
+     */
+    const WriteFormats& getWriteFormats() const { return write_formats_; }
+    
+    /**
+     * 设置代码生成的线程数：各处理器和用户函数并行生成后按源码顺序拼接
+     * @param threads 线程数，0 表示使用 CPU 核数
+     */
+    void setThreads(unsigned threads) { threads_ = threads; }
+    
+    /**
+     * 设置分片数：输出共用的头文件（全局状态、运行时和声明）和 shards 个 .cpp 文件，
+     * 处理器和用户函数按生成代码的大小均衡分配，下游编译器可以并行编译各分片；
+     * 实际分片数不超过生成了代码的处理器和用户函数数
+     * @param shards 分片数，0 表示输出单个文件
+     */
+    void setShards(unsigned shards) { shards_ = shards; }
+    
+    /**
+     * 获取最近一次生成的分片，未分片时为空
+     */
+    const std::vector<OutputShard>& getOutputShards() const { return output_shards_; }
 
 private:
+    /**
+     * break 的目标：循环为空（生成 break;），switch 为结束标签
+     */
+    struct BreakTarget {
+        std::string label;
+        bool used;
+    };
+    
+    /**
+     * 一个顶层单元（处理器、用户函数或循环内核）的生成状态，用于区分同名的全局变量。
+     * 顶层单元在多个线程上并行生成，每个单元使用自己的上下文
+     */
+    struct UnitContext {
+        std::set<std::string> locals;               // 整个单元可见的名称（形参、内核的操作数）
+        std::vector<std::set<std::string>> scopes;  // 各层代码块中已声明的局部变量，随代码块进出
+        std::vector<BreakTarget> break_targets;     // 所在循环和 switch 的 break 目标
+        
+        bool isLocal(const std::string& name) const;
+    };
+    
     // 代码生成的具体实现
+    std::vector<OutputBuffer> generateProgram(const ASTNode* program, OutputBuffer& out,
+                                              const std::string& output_file);
+    void generateUnit(ASTNode* node, OutputBuffer& out);
+    void generateLoopKernels(OutputBuffer& out);
+    void generateHandler(ASTNode* handler, OutputBuffer& out, int indent, const char* comment, UnitContext& unit);
+    void generateFunction(FunctionNode* func, OutputBuffer& out, int indent, UnitContext& unit);
+    void generateNode(ASTNode* node, OutputBuffer& out, int indent, UnitContext& unit);
+    void generateBody(ASTNode* body, OutputBuffer& out, int indent, UnitContext& unit);
+    void generateSwitch(ASTNode* node, OutputBuffer& out, int indent, UnitContext& unit);
+    std::string generateExpr(ASTNode* node, const UnitContext& unit) const;
+    std::string generateCond(ASTNode* node, const UnitContext& unit) const;
+    std::string generateDecl(VariableDeclNode* var, const UnitContext& unit) const;
+    void generateStateStruct(OutputBuffer& out);
+    void generateGatewayRoutes(OutputBuffer& out);
+    void generateProfileCounters(OutputBuffer& out);
+    void generateMessageDispatch(OutputBuffer& out);
+    void generateTimerIds(OutputBuffer& out);
+    void generateEventDispatch(OutputBuffer& out);
+    void generateTimerFunctions(OutputBuffer& out);
+    void generateStateSnapshot(OutputBuffer& out);
+    std::string generateSignalRead(const SignalInfo& info, const std::string& frame) const;
+    std::string generateSignalWrite(const SignalInfo& info, const std::string& frame, const std::string& value) const;
+    std::string generateWrite(const FormatPlan& plan, const UnitContext& unit) const;
+    std::vector<OutputBuffer> generateShards(const std::vector<OutputBuffer>& units,
+                                             const OutputBuffer& main_part,
+                                             const std::string& output_file);
+    const char* sharedLinkage() const { return shards_ > 0 ? "inline " : "static "; }
+    Heat handlerHeat(const ASTNode* handler) const;
+    
+    StateLayout state_layout_;          // 全局状态布局
+    HandlerFolding handler_folding_;    // 相同事件处理器的等价类
+    bool fold_handlers_;                // 是否合并相同的事件处理器
+    GatewayRoutes gateway_routes_;      // 纯转发处理器的网关路由
+    bool compile_routes_;               // 是否编译网关路由
+    LoopVectorizer loop_vectorizer_;    // 可向量化的循环
+    bool vectorize_loops_;              // 是否提取可向量化的循环
+    BoundsCheckAnalysis bounds_check_;  // 数组下标范围分析
+    bool eliminate_bounds_checks_;      // 是否省略证明安全的下标检查
+    IntegerNarrowing integer_narrowing_; // 全局整数变量的存储宽度收窄
+    bool narrow_integers_;              // 是否收窄全局整数变量
+    std::string profile_generate_;      // 插桩时写入的剖析文件，空表示不插桩
+    std::vector<std::string> profile_keys_; // 剖析计数器的键
+    std::map<const ASTNode*, size_t> profile_slots_; // 处理器和 if 语句的第一个计数器
+    const ProfileData* profile_;        // 剖析数据
+    MessageDispatch message_dispatch_;  // 报文 ID 分派表
+    EventTables event_tables_;          // 定时器 ID 和按键处理器数组
+    SwitchLowering switch_lowering_;    // switch 语句的分派方式
+    WriteFormats write_formats_;        // 常量格式字符串的 write 调用的格式化方式
+    IntegerWrap integer_wrap_;          // 需要按回绕语义生成的有符号整数运算
+    std::map<const ASTNode*, std::string> handler_names_; // 处理器生成的函数名（合并的处理器为代表的函数名）
+    std::map<uint32_t, const SignalInfo*> signal_frames_; // $信号 读取的报文（按 ID），保存最近收到的一帧
+    unsigned threads_;                  // 代码生成的线程数，0 表示使用 CPU 核数
+    unsigned shards_;                   // 分片数，0 表示输出单个文件
+    std::vector<OutputShard> output_shards_; // 最近一次生成的分片
 };
 
 /**
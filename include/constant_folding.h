@@ -0,0 +1,113 @@
+/**
+ * CAPL 常量折叠、常量传播和 on start 前缀的编译期求值
+ *
+ * 常量运算按生成代码的 C++ 语义求值：int 为 32 位有符号整数，float 为 double。
+ * 结果溢出、除零等无法确定运行时行为的运算不折叠
+ */
+
+#ifndef CAPL_CONSTANT_FOLDING_H
+#define CAPL_CONSTANT_FOLDING_H
+
+#include "pass_manager.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace capl {
+
+/**
+ * 编译期常量值
+ */
+struct ConstantValue {
+    bool is_float = false;      // 是否为浮点数
+    long long int_value = 0;    // 整数值
+    double float_value = 0.0;   // 浮点值
+    
+    static ConstantValue makeInt(long long value);
+    static ConstantValue makeFloat(double value);
+    
+    /**
+     * 作为条件时是否为真
+     */
+    bool isTrue() const { return is_float ? float_value != 0.0 : int_value != 0; }
+    
+    /**
+     * 按变量类型转换（赋值语义）
+     * @param capl_type 变量的 CAPL 类型
+     * @param result 转换结果
+     * @return 转换是否有确定的结果
+     */
+    bool convertTo(const std::string& capl_type, ConstantValue& result) const;
+    
+    /**
+     * 生成对应的字面量节点
+     * @param line 行号
+     * @return 字面量节点，无法表示（如 inf）时返回 nullptr
+     */
+    std::unique_ptr<ASTNode> toLiteral(int line) const;
+    
+    bool operator==(const ConstantValue& other) const;
+    bool operator!=(const ConstantValue& other) const { return !(*this == other); }
+};
+
+/**
+ * 变量名到常量值的映射
+ */
+using ConstantEnv = std::map<std::string, ConstantValue>;
+
+/**
+ * 对表达式求值
+ * @param expr 表达式节点
+ * @param result 求值结果
+ * @param env 已知常量值的变量，可为 nullptr
+ * @return 表达式是否为可确定的常量
+ */
+bool evaluateConstant(const ASTNode* expr, ConstantValue& result, const ConstantEnv* env = nullptr);
+
+/**
+ * 常量折叠：把操作数均为常量的表达式替换为字面量，
+ * 并按常量条件化简 ?:、&&、||
+ */
+class ConstantFoldingPass : public Pass {
+public:
+    const char* getName() const override { return "constant-fold"; }
+    int run(ASTNode* program) override;
+
+private:
+    int foldChildren(ASTNode* node);
+};
+
+/**
+ * 常量传播：把已知为常量的局部标量和从不被写入的全局标量的读取替换为字面量
+ */
+class ConstantPropagationPass : public Pass {
+public:
+    const char* getName() const override { return "constant-prop"; }
+    int run(ASTNode* program) override;
+
+private:
+    void propagateStatement(ASTNode* node, ConstantEnv& env);
+    void propagateExpr(ASTNode* parent, size_t index, ConstantEnv& env);
+    void assign(const std::string& name, const ConstantValue* value, ConstantEnv& env);
+    bool isTracked(const std::string& name) const;
+    
+    std::map<std::string, std::string> tracked_;    // 当前函数中可跟踪的变量及其类型
+    std::set<std::string> shadowed_;                // 当前函数中被局部变量遮蔽的名称
+    int changes_ = 0;                               // 替换次数
+};
+
+/**
+ * on start 前缀求值：on start 开头连续的、只依赖常量的全局标量赋值在编译期执行，
+ * 结果成为全局变量的静态初始值，语句从 on start 中删除；开头没有初始值或初始值为常量的
+ * 局部变量声明不影响全局变量，先跳过
+ */
+class StartPrefixPass : public Pass {
+public:
+    const char* getName() const override { return "start-prefix"; }
+    int run(ASTNode* program) override;
+};
+
+} // namespace capl
+
+#endif // CAPL_CONSTANT_FOLDING_H
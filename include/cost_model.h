@@ -0,0 +1,115 @@
+/**
+ * CAPL 事件处理器静态开销模型
+ *
+ * 估算每个事件处理器在最坏情况下执行的操作数和循环迭代次数，
+ * 用于在上台架之前发现超出实时预算的处理器
+ */
+
+#ifndef CAPL_COST_MODEL_H
+#define CAPL_COST_MODEL_H
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+class FunctionNode;
+
+/**
+ * 单个事件处理器（或用户函数）的开销估算结果
+ */
+struct HandlerCost {
+    std::string name;               // 处理器描述，如 "on message 0x200"
+    int line = 0;                   // 定义行号
+    bool is_function = false;       // 是否为用户函数（不参与预算检查）
+    uint64_t operations = 0;        // 最坏情况操作数
+    uint64_t max_trip_count = 0;    // 单个循环的最大迭代次数
+    uint64_t loop_iterations = 0;   // 所有循环的总迭代次数（嵌套循环相乘）
+    int loop_count = 0;             // 循环数量
+    int unbounded_loops = 0;        // 无法确定常量边界的循环数量
+};
+
+/**
+ * 静态开销模型
+ *
+ * 操作数按抽象操作计：每次变量读写、算术/比较运算、下标和成员访问计 1，
+ * 内置函数按经验权重计，用户函数调用展开为被调函数的开销。
+ * 循环次数取自 for (i = A; i < B; i++) 形式的常量边界，
+ * 无法确定边界的循环按 kDefaultTripCount 次估算并在报告中标出。
+ */
+class CostModel {
+public:
+    /**
+     * 无常量边界循环的假定迭代次数
+     */
+    static constexpr uint64_t kDefaultTripCount = 100;
+    
+    /**
+     * 默认每事件操作数预算
+     */
+    static constexpr uint64_t kDefaultBudget = 10000;
+    
+    /**
+     * 构造函数
+     */
+    CostModel();
+    
+    /**
+     * 设置每个事件处理器的操作数预算
+     * @param budget 预算，0 表示不检查
+     */
+    void setBudget(uint64_t budget) { budget_ = budget; }
+    uint64_t getBudget() const { return budget_; }
+    
+    /**
+     * 分析整个程序
+     * @param program AST 根节点
+     */
+    void analyze(const ASTNode* program);
+    
+    /**
+     * 获取分析结果（按源码顺序）
+     * @return 开销列表
+     */
+    const std::vector<HandlerCost>& getCosts() const { return costs_; }
+    
+    /**
+     * 查找指定处理器的开销
+     * @param name 处理器描述
+     * @return 开销指针，未找到返回 nullptr
+     */
+    const HandlerCost* findCost(const std::string& name) const;
+    
+    /**
+     * 检查预算，返回超出预算的警告信息
+     * @return 警告信息列表
+     */
+    std::vector<std::string> checkBudget() const;
+    
+    /**
+     * 输出开销报告
+     * @param out 输出流
+     */
+    void printReport(std::ostream& out) const;
+
+private:
+    uint64_t estimate(const ASTNode* node, HandlerCost& cost, uint64_t enclosing_trips);
+    const HandlerCost& estimateFunction(const FunctionNode* func);
+    uint64_t builtinCost(const std::string& name) const;
+    bool constantTripCount(const ASTNode* for_node, uint64_t& trips) const;
+    
+    uint64_t budget_;                                       // 预算
+    std::vector<HandlerCost> costs_;                        // 分析结果
+    std::map<std::string, const FunctionNode*> functions_;  // 用户函数
+    std::map<std::string, HandlerCost> function_costs_;     // 用户函数开销缓存
+    std::set<std::string> in_progress_;                     // 递归检测
+};
+
+} // namespace capl
+
+#endif // CAPL_COST_MODEL_H
@@ -0,0 +1,37 @@
+/**
+ * CAPL 全程序死代码消除
+ *
+ * 从所有事件处理器出发分析整个程序，删除常量条件下不可达的分支、
+ * 没有处理器调用的函数、除了更新自身之外从不被读取的全局和局部变量（连同对它们的存储），
+ * 在直线代码中被覆盖之前从未被读取的存储和因此只剩计数的循环，并展开不再声明变量的代码块
+ */
+
+#ifndef CAPL_DEAD_CODE_ELIMINATION_H
+#define CAPL_DEAD_CODE_ELIMINATION_H
+
+#include "pass_manager.h"
+#include <set>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+/**
+ * 死代码消除遍
+ */
+class DeadCodeEliminationPass : public Pass {
+public:
+    const char* getName() const override { return "dce"; }
+    int run(ASTNode* program) override;
+
+private:
+    int foldBranches(ASTNode* node);
+    int removeUncalledFunctions(ASTNode* program);
+    int removeOverwrittenStores(ASTNode* node, std::vector<std::set<std::string>>& scopes);
+    int removeUnusedLocals(ASTNode* function, ASTNode* program);
+    int removeUnusedGlobals(ASTNode* program);
+};
+
+} // namespace capl
+
+#endif // CAPL_DEAD_CODE_ELIMINATION_H
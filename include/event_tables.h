@@ -0,0 +1,107 @@
+/**
+ * CAPL 定时器和按键处理器的编译期编号
+ *
+ * 每个 on timer 处理器的定时器按源码顺序分配从 0 开始的连续整数 ID，
+ * setTimer/cancelTimer 直接以 ID 为下标访问定长的定时器数组；
+ * on key 处理器按按键字符的编码放入 256 项的处理器数组，on key * 填充其余的项。
+ * 设置定时器和分派按键都只需一次数组访问，不涉及字符串。
+ * 同一定时器或按键有多个处理器时只分派第一个；无法用一个字节表示的按键不加入数组
+ */
+
+#ifndef CAPL_EVENT_TABLES_H
+#define CAPL_EVENT_TABLES_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 编译期编号的定时器
+ */
+struct TimerEntry {
+    std::string name;                   // 定时器名称
+    int id = 0;                         // 定时器 ID
+    const ASTNode* handler = nullptr;   // on timer 处理器
+};
+
+/**
+ * 定时器和按键处理器的编译期编号
+ */
+class EventTables {
+public:
+    /**
+     * 按键处理器数组的项数
+     */
+    static constexpr int kKeyCount = 256;
+    
+    /**
+     * 构造函数
+     */
+    EventTables();
+    
+    /**
+     * 为程序中的定时器和按键处理器编号
+     * @param program AST 根节点
+     */
+    void build(const ASTNode* program);
+    
+    /**
+     * 清空编号结果
+     */
+    void clear();
+    
+    /**
+     * 获取定时器（按 ID 排序）
+     */
+    const std::vector<TimerEntry>& getTimers() const { return timers_; }
+    
+    /**
+     * 查找定时器 ID
+     * @param name 定时器名称
+     * @return 定时器 ID，不是定时器时返回 -1
+     */
+    int findTimer(const std::string& name) const;
+    
+    /**
+     * 获取按键处理器数组，下标为按键编码，没有处理器的项为 nullptr
+     */
+    const std::vector<const ASTNode*>& getKeyHandlers() const { return keys_; }
+    
+    /**
+     * 获取 on key * 处理器
+     * @return 处理器，不存在时返回 nullptr
+     */
+    const ASTNode* getKeyWildcard() const { return key_wildcard_; }
+    
+    /**
+     * 获取无法放入按键数组的 on key 处理器
+     */
+    const std::vector<const ASTNode*>& getUnresolvedKeys() const { return unresolved_keys_; }
+    
+    /**
+     * 是否有任何按键处理器
+     */
+    bool hasKeyHandlers() const;
+    
+    /**
+     * 按键事件名对应的按键编码
+     * @param event_name 事件名（按键字符）
+     * @return 0-255 的编码，不是单个字节时返回 -1
+     */
+    static int keyCode(const std::string& event_name);
+
+private:
+    std::vector<TimerEntry> timers_;                // 定时器
+    std::map<std::string, int> timer_ids_;          // 定时器名称到 ID
+    std::vector<const ASTNode*> keys_;              // 按键处理器数组
+    const ASTNode* key_wildcard_;                   // on key * 处理器
+    std::vector<const ASTNode*> unresolved_keys_;   // 无法放入数组的按键处理器
+};
+
+} // namespace capl
+
+#endif // CAPL_EVENT_TABLES_H
@@ -0,0 +1,40 @@
+/**
+ * CAPL 报文字段读取的公共子表达式消除
+ *
+ * 在同一语句列表中，对同一报文字段（id、dlc、channel、dir、常量下标的
+ * data[n] 和 byte(n)）的多次读取改为读取一次并缓存在局部临时变量中。
+ * 写入该字段、整体写入报文、调用报文的其他成员函数、把报文传给可能修改它的
+ * 函数，以及（对全局报文）调用任何函数，都会使缓存失效
+ */
+
+#ifndef CAPL_FIELD_CSE_H
+#define CAPL_FIELD_CSE_H
+
+#include "pass_manager.h"
+#include <map>
+#include <set>
+#include <string>
+
+namespace capl {
+
+/**
+ * 报文字段读取的公共子表达式消除遍
+ */
+class FieldCSEPass : public Pass {
+public:
+    const char* getName() const override { return "field-cse"; }
+    int run(ASTNode* program) override;
+
+private:
+    int processList(ASTNode* list);
+    int processNested(ASTNode* node);
+    std::string freshName(const std::string& base);
+    
+    std::set<std::string> roots_;           // 当前处理器中可缓存字段的报文变量
+    std::set<std::string> global_roots_;    // 其中的全局报文变量
+    std::set<std::string> used_names_;      // 程序中已使用的名称
+};
+
+} // namespace capl
+
+#endif // CAPL_FIELD_CSE_H
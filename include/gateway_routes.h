@@ -0,0 +1,85 @@
+/**
+ * CAPL 纯转发报文处理器识别
+ *
+ * 报文处理器的函数体只由对 this.id、this.channel 的常量赋值和 output(this)
+ * 组成时，其效果只是按常量改写报文头后重新发送。这类处理器编译为路由表项，
+ * 运行时收到报文后按 ID 查表直接转发，不调用处理器，也不复制报文数据
+ */
+
+#ifndef CAPL_GATEWAY_ROUTES_H
+#define CAPL_GATEWAY_ROUTES_H
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 一条转发路由：处理器中的每个 output(this) 对应一条
+ */
+struct GatewayRoute {
+    const ASTNode* handler = nullptr;   // 对应的报文处理器
+    uint32_t id = 0;                    // 接收的报文 ID
+    uint32_t out_id = 0;                // 转发的报文 ID
+    int out_channel = -1;               // 转发的通道，-1 表示沿用接收通道
+};
+
+/**
+ * 纯转发报文处理器识别
+ */
+class GatewayRoutes {
+public:
+    /**
+     * 构造函数
+     */
+    GatewayRoutes();
+    
+    /**
+     * 识别程序中的纯转发报文处理器
+     * @param program AST 根节点
+     */
+    void analyze(const ASTNode* program);
+    
+    /**
+     * 清空识别结果
+     */
+    void clear();
+    
+    /**
+     * 获取路由（按接收 ID 排序，同一 ID 的路由保持 output 的顺序）
+     * @return 路由列表
+     */
+    const std::vector<GatewayRoute>& getRoutes() const { return routes_; }
+    
+    /**
+     * 获取编译为路由的处理器
+     * @return 处理器集合
+     */
+    const std::set<const ASTNode*>& getForwarders() const { return forwarders_; }
+    
+    /**
+     * 处理器是否已编译为路由，不再生成处理函数
+     * @param handler 事件处理器节点
+     */
+    bool isForwarder(const ASTNode* handler) const { return forwarders_.count(handler) > 0; }
+    
+    /**
+     * 匹配纯转发处理器
+     * @param handler ON_MESSAGE 节点
+     * @param routes 输出的路由
+     * @return 是否为纯转发处理器
+     */
+    static bool matchForwarder(const ASTNode* handler, std::vector<GatewayRoute>& routes);
+
+private:
+    std::vector<GatewayRoute> routes_;          // 路由
+    std::set<const ASTNode*> forwarders_;       // 编译为路由的处理器
+};
+
+} // namespace capl
+
+#endif // CAPL_GATEWAY_ROUTES_H
@@ -0,0 +1,90 @@
+/**
+ * CAPL 相同事件处理器合并
+ *
+ * 对每个事件处理器的函数体做规范化（整数字面量按数值、局部变量按声明顺序编号），
+ * 计算散列并逐一比较规范化结果，同类事件中函数体相同的处理器归为一个等价类，
+ * 代码生成时每个等价类只生成一份实现
+ */
+
+#ifndef CAPL_HANDLER_FOLDING_H
+#define CAPL_HANDLER_FOLDING_H
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 函数体相同的一组事件处理器
+ */
+struct HandlerClass {
+    std::vector<const ASTNode*> handlers;   // 处理器，按源码顺序，第一个为代表
+    size_t hash = 0;                        // 规范化函数体的散列值
+};
+
+/**
+ * 相同事件处理器合并
+ */
+class HandlerFolding {
+public:
+    /**
+     * 构造函数
+     */
+    HandlerFolding();
+    
+    /**
+     * 对程序中的事件处理器分类
+     * @param program AST 根节点
+     * @param excluded 不参与分类的处理器（例如已编译为网关路由的处理器）
+     */
+    void compute(const ASTNode* program, const std::set<const ASTNode*>& excluded = {});
+    
+    /**
+     * 清空分类结果，之后每个处理器单独生成
+     */
+    void clear();
+    
+    /**
+     * 获取等价类（按代表在源码中的顺序）
+     * @return 等价类列表
+     */
+    const std::vector<HandlerClass>& getClasses() const { return classes_; }
+    
+    /**
+     * 查找处理器所在的等价类
+     * @param handler 事件处理器节点
+     * @return 等价类，未参与分类时返回 nullptr
+     */
+    const HandlerClass* findClass(const ASTNode* handler) const;
+    
+    /**
+     * 处理器是否需要生成实现（是所在等价类的代表或未参与分类）
+     * @param handler 事件处理器节点
+     */
+    bool isRepresentative(const ASTNode* handler) const;
+    
+    /**
+     * 被合并到其他处理器实现中的处理器数量
+     */
+    int getFoldedCount() const;
+    
+    /**
+     * 计算处理器函数体的规范化形式
+     * @param handler 事件处理器节点
+     * @return 规范化文本，函数体相同的处理器结果相同
+     */
+    static std::string normalize(const ASTNode* handler);
+
+private:
+    std::vector<HandlerClass> classes_;             // 等价类
+    std::map<const ASTNode*, size_t> class_of_;     // 处理器所在的等价类下标
+};
+
+} // namespace capl
+
+#endif // CAPL_HANDLER_FOLDING_H
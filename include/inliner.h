@@ -0,0 +1,74 @@
+/**
+ * CAPL 用户函数内联
+ *
+ * 在语句级调用处（f(...);、x = f(...);、T x = f(...);、return f(...);）
+ * 把小函数的函数体展开为代码块：形参和局部变量换成不冲突的新名称，
+ * 尾部的 return 改为给结果变量赋值；结果赋给同类型的全局变量或新声明的局部变量时，
+ * return 直接给它赋值，不生成结果变量和复制。函数体不使用的形参不生成临时变量；丢弃返回值的调用
+ * 不生成结果变量，展开后不声明变量时语句直接放在调用处，没有语句时调用整个删除。
+ * 函数大小（AST 节点数）不超过当前优化级别的阈值时才内联，递归函数从不内联。
+ * 有剖析数据时，热点处理器中的调用按 -O3 的阈值内联，冷处理器中的调用不内联
+ */
+
+#ifndef CAPL_INLINER_H
+#define CAPL_INLINER_H
+
+#include "pass_manager.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class FunctionNode;
+class ProfileData;
+
+/**
+ * 内联遍
+ */
+class InlinerPass : public Pass {
+public:
+    /**
+     * 构造函数
+     * @param threshold 可内联函数的最大大小（AST 节点数）
+     * @param profile 剖析数据，nullptr 表示所有调用者使用同一阈值
+     */
+    explicit InlinerPass(int threshold, const ProfileData* profile = nullptr);
+    
+    /**
+     * 优化级别对应的内联阈值
+     * @param optimize_level 优化级别 (0-3)
+     * @return 阈值，0 表示不内联
+     */
+    static int thresholdFor(int optimize_level);
+    
+    const char* getName() const override { return "inline"; }
+    int run(ASTNode* program) override;
+    std::vector<std::string> getDecisions() const override { return decisions_; }
+
+private:
+    bool isInlinable(const FunctionNode* func, std::string& reason) const;
+    int inlineCalls(ASTNode* node, const std::string& caller, const std::set<std::string>& caller_names);
+    std::unique_ptr<ASTNode> expandCall(const FunctionNode* func, ASTNode* call,
+                                        const std::set<std::string>& caller_names, bool discard,
+                                        const std::string& target, std::string& result, std::string& reason);
+    std::string freshName(const std::string& base);
+    
+    int callerThreshold(const ASTNode* unit) const;
+    
+    int threshold_;                                     // 大小阈值
+    int current_threshold_ = 0;                         // 当前调用者的大小阈值
+    const ProfileData* profile_;                        // 剖析数据
+    std::map<std::string, const FunctionNode*> functions_;  // 用户函数
+    std::map<std::string, std::string> global_types_;   // 全局标量变量的类型
+    std::set<std::string> recursive_;                   // 递归函数
+    std::set<std::string> used_names_;                  // 程序中已使用的名称
+    std::set<std::string> reported_;                    // 已报告拒绝原因的函数
+    std::vector<std::string> decisions_;                // 内联决策
+};
+
+} // namespace capl
+
+#endif // CAPL_INLINER_H
@@ -0,0 +1,141 @@
+/**
+ * CAPL 全局整数变量的存储宽度收窄
+ *
+ * 对 variables 块中的整数标量和数组做值域分析：收集初始值和所有写入的值
+ * （常量、报文字段、其他变量按其类型或已知值域、以及它们的算术组合），
+ * 按声明类型转换后求并集，迭代到不动点。值域能由更窄的类型表示时，
+ * 状态结构体中改用该类型存储。只收窄 int、long、word：它们和更窄的类型
+ * 读取时都提升为 int，运算语义不变。
+ * 自增、除 &= 常量以外的复合赋值以及作为数组实参传给函数的变量保持原类型
+ */
+
+#ifndef CAPL_INTEGER_NARROWING_H
+#define CAPL_INTEGER_NARROWING_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 整数值域
+ */
+struct ValueRange {
+    bool known = false;     // 值域是否已知
+    long long lo = 0;       // 下界（含）
+    long long hi = 0;       // 上界（含）
+    
+    static ValueRange make(long long lo, long long hi);
+    
+    /**
+     * 两个值域的并集，任一未知时结果未知
+     */
+    ValueRange unite(const ValueRange& other) const;
+    
+    bool operator==(const ValueRange& other) const;
+    bool operator!=(const ValueRange& other) const { return !(*this == other); }
+};
+
+/**
+ * 收窄后的全局变量
+ */
+struct NarrowedVariable {
+    std::string name;           // 变量名
+    std::string capl_type;      // 声明的 CAPL 类型
+    int array_size = 0;         // 数组长度，0 表示标量
+    ValueRange range;           // 所有可能的值
+    std::string cpp_type;       // 收窄后的存储类型
+    size_t size = 0;            // 收窄后的元素字节数
+    size_t original_size = 0;   // 原类型的元素字节数
+    
+    /**
+     * 收窄节省的字节数
+     */
+    size_t getSavedBytes() const;
+};
+
+/**
+ * 全局整数变量的存储宽度收窄
+ */
+class IntegerNarrowing {
+public:
+    /**
+     * 值域不再扩大前的最大迭代轮数，之后仍在变化的变量直接取类型的全部值域
+     */
+    static constexpr int kWideningRounds = 4;
+    
+    /**
+     * 构造函数
+     */
+    IntegerNarrowing();
+    
+    /**
+     * 分析程序中的全局整数变量
+     * @param program AST 根节点
+     */
+    void analyze(const ASTNode* program);
+    
+    /**
+     * 清空分析结果
+     */
+    void clear();
+    
+    /**
+     * 获取收窄的变量（按声明顺序）
+     * @return 变量列表
+     */
+    const std::vector<NarrowedVariable>& getVariables() const { return variables_; }
+    
+    /**
+     * 查找收窄的变量
+     * @param name 变量名
+     * @return 变量信息，未收窄时返回 nullptr
+     */
+    const NarrowedVariable* findVariable(const std::string& name) const;
+    
+    /**
+     * 收窄节省的总字节数
+     */
+    size_t getSavedBytes() const;
+    
+    /**
+     * CAPL 整数类型的全部值域
+     * @param capl_type CAPL 类型名
+     * @return 值域，非整数类型或超出 long long 时未知
+     */
+    static ValueRange typeRange(const std::string& capl_type);
+
+private:
+    /**
+     * 对候选变量的一次写入
+     */
+    struct Store {
+        std::string name;                   // 被写入的全局变量
+        const ASTNode* value = nullptr;     // 写入的值，nullptr 表示任意值
+        long long mask = -1;                // &= 常量时的掩码
+        const ASTNode* unit = nullptr;      // 所在的处理器或函数
+    };
+    
+    void collectStores(const ASTNode* node, const ASTNode* unit);
+    ValueRange rangeOf(const ASTNode* expr, const ASTNode* unit) const;
+    ValueRange variableRange(const std::string& name, const ASTNode* unit) const;
+    std::string variableType(const std::string& name, const ASTNode* unit) const;
+    bool isUnsignedWide(const ASTNode* expr, const ASTNode* unit) const;
+    ValueRange storedRange(const Store& store) const;
+    
+    std::map<std::string, const ASTNode*> globals_;                         // 全局变量声明
+    std::map<std::string, const ASTNode*> functions_;                       // 用户函数
+    std::map<const ASTNode*, std::map<std::string, std::string>> unit_locals_; // 每个处理器或函数的局部变量类型
+    std::map<std::string, ValueRange> ranges_;                              // 候选变量的当前值域
+    std::vector<std::string> order_;                                        // 候选变量的声明顺序
+    std::vector<Store> stores_;                                             // 对候选变量的写入
+    std::vector<NarrowedVariable> variables_;                               // 分析结果
+};
+
+} // namespace capl
+
+#endif // CAPL_INTEGER_NARROWING_H
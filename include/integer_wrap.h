@@ -0,0 +1,72 @@
+/**
+ * 有符号整数运算的回绕分析
+ *
+ * CAPL 的整数运算按二进制补码回绕，而 C++ 中有符号整数溢出是未定义行为。CAPL 的 int 为 16 位，
+ * 生成为 int16_t：两个 16 位以内的操作数提升为 int 后加、减、乘都不会溢出，照常生成内置运算符。
+ * 分析按声明类型估算每个表达式需要的有符号位数，结果可能超出 32 位的 +、-、*、取负、
+ * ++/-- 和复合赋值（long、int64 操作数或嵌套的宽运算）由运行时库的 capl_add、capl_sub、
+ * capl_mul 等函数在同宽的无符号类型中运算后转换回来。浮点运算不受影响
+ */
+
+#ifndef CAPL_INTEGER_WRAP_H
+#define CAPL_INTEGER_WRAP_H
+
+#include <cstddef>
+#include <set>
+#include <string>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 有符号整数运算的回绕分析
+ */
+class IntegerWrap {
+public:
+    /**
+     * 表达式位数：浮点数
+     */
+    static constexpr int kFloat = -1;
+    
+    /**
+     * 表达式位数：无法确定的整数（如内置函数的返回值），按 64 位处理
+     */
+    static constexpr int kUnknown = 64;
+    
+    /**
+     * 找出程序中可能发生有符号溢出、需要回绕的运算
+     * @param program AST 根节点
+     */
+    void analyze(const ASTNode* program);
+    
+    /**
+     * 清空分析结果
+     */
+    void clear();
+    
+    /**
+     * 运算是否需要按回绕语义生成
+     * @param node BINARY_EXPR、UNARY_EXPR 或 ASSIGNMENT_EXPR 节点
+     */
+    bool needsWrap(const ASTNode* node) const { return wrapped_.count(node) > 0; }
+    
+    /**
+     * 获取需要回绕的运算数
+     */
+    size_t getCount() const { return wrapped_.size(); }
+    
+    /**
+     * CAPL 标量类型的值需要的有符号位数（无符号类型多一位）
+     * @param capl_type CAPL 类型
+     * @return 位数，浮点数为 kFloat，其他类型为 kUnknown
+     */
+    static int typeBits(const std::string& capl_type);
+    
+private:
+    std::set<const ASTNode*> wrapped_;  // 需要回绕的运算
+};
+
+} // namespace capl
+
+#endif // CAPL_INTEGER_WRAP_H
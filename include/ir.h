@@ -0,0 +1,191 @@
+/**
+ * CAPL 中间表示 (IR)
+ *
+ * 位于 AST 和代码生成之间的低层表示：每个事件处理器和用户函数是一个由基本块
+ * 组成的函数，局部标量为 SSA 形式的虚拟寄存器，全局变量、数组和报文字段
+ * 只能通过显式的 load/store 访问
+ */
+
+#ifndef CAPL_IR_H
+#define CAPL_IR_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * IR 指令操作码
+ */
+enum class IROpcode {
+    PARAM,          // %r = param 名称 : 类型（仅出现在入口块）
+    ALLOCA,         // alloca $名称 : 类型[N]（局部数组或报文）
+    LOAD,           // %r = load @全局 [下标]
+    STORE,          // store @全局 [下标], 值
+    LOAD_FIELD,     // %r = loadfield $this [下标] .字段 [字段下标]
+    STORE_FIELD,    // storefield $m [下标] .字段 [字段下标], 值
+    BINARY,         // %r = 运算符 a, b
+    UNARY,          // %r = 运算符 a
+    CALL,           // [%r =] call 函数(参数...)
+    PHI,            // %r = phi [值, 前驱块]...
+    BR,             // br 目标块
+    COND_BR,        // condbr 条件, 真目标块, 假目标块
+    SWITCH,         // switch 值, 默认块 [常量: 目标块]...
+    RET,            // ret [值]
+};
+
+/**
+ * IR 操作数
+ */
+struct IRValue {
+    enum class Kind {
+        NONE,       // 无
+        REG,        // 虚拟寄存器
+        INT,        // 整数常量
+        FLOAT,      // 浮点常量
+        STRING,     // 字符串常量
+        SYMBOL,     // 非值符号：定时器、内存对象 (@全局/$局部)
+        UNDEF,      // 未定义值
+    };
+    
+    Kind kind = Kind::NONE;
+    int reg = -1;               // 寄存器编号
+    long long int_value = 0;    // 整数值
+    double float_value = 0.0;   // 浮点值
+    std::string text;           // 字符串内容、符号名或浮点常量的原始写法
+    
+    static IRValue makeReg(int reg);
+    static IRValue makeInt(long long value);
+    static IRValue makeFloat(double value, const std::string& spelling);
+    static IRValue makeString(const std::string& value);
+    static IRValue makeSymbol(const std::string& name);
+    static IRValue makeUndef();
+    
+    bool isReg() const { return kind == Kind::REG; }
+    bool isConstant() const { return kind == Kind::INT || kind == Kind::FLOAT || kind == Kind::STRING; }
+    bool operator==(const IRValue& other) const;
+    bool operator!=(const IRValue& other) const { return !(*this == other); }
+    
+    std::string toString() const;
+};
+
+/**
+ * IR 指令
+ *
+ * 内存访问指令的操作数依次为：[元素下标]、[字段下标]、[存储的值]
+ */
+struct IRInstruction {
+    IROpcode opcode = IROpcode::RET;
+    int result = -1;                // 结果寄存器，-1 表示无结果
+    std::string name;               // 运算符、被调函数名、形参名或字段名
+    std::string symbol;             // 内存对象 (@全局、$局部、$this)
+    std::string type;               // PARAM/ALLOCA 的类型
+    int array_size = 0;             // ALLOCA 的数组长度
+    bool has_index = false;         // 内存访问是否带元素下标
+    bool has_field_index = false;   // 字段访问是否带字段下标，如 byte(0)
+    std::vector<IRValue> operands;  // 操作数
+    std::vector<int> targets;       // BR/COND_BR 的目标块；SWITCH 的默认块和与 case 常量操作数对应的目标块；
+                                    // PHI 中与操作数对应的前驱块
+    int line = 0;                   // 源码行号
+    
+    bool isTerminator() const;
+    
+    /**
+     * 转换为文本形式（不含缩进）
+     */
+    std::string toString() const;
+};
+
+/**
+ * 基本块
+ */
+struct IRBasicBlock {
+    int id = 0;                                 // 块编号，等于在函数中的下标
+    std::vector<IRInstruction> instructions;    // 指令，phi 在最前，终结指令在最后
+    std::vector<int> preds;                     // 前驱块
+    std::vector<int> succs;                     // 后继块
+};
+
+/**
+ * IR 函数（事件处理器或用户函数）
+ */
+struct IRFunction {
+    std::string name;                   // 事件描述或函数名
+    bool is_handler = false;            // 是否为事件处理器
+    std::string return_type = "void";   // 返回类型
+    std::vector<IRBasicBlock> blocks;   // 基本块，blocks[0] 为入口
+    int register_count = 0;             // 虚拟寄存器数量
+    int line = 0;                       // 定义行号
+    const ASTNode* source = nullptr;    // 对应的 AST 节点
+};
+
+/**
+ * 全局变量
+ */
+struct IRGlobal {
+    std::string name;       // 变量名
+    std::string type;       // CAPL 类型
+    int array_size = 0;     // 数组长度，0 表示标量
+};
+
+/**
+ * IR 模块（整个程序）
+ */
+struct IRModule {
+    std::vector<IRGlobal> globals;      // 全局变量
+    std::vector<IRFunction> functions;  // 处理器和函数，按源码顺序
+    
+    /**
+     * 输出文本形式
+     * @param out 输出流
+     */
+    void print(std::ostream& out) const;
+};
+
+/**
+ * IR 验证器
+ *
+ * 检查控制流图的一致性、终结指令和 phi 的位置、寄存器的唯一定义，
+ * 以及每个寄存器的定义支配其所有使用
+ */
+class IRVerifier {
+public:
+    /**
+     * 验证模块
+     * @param module IR 模块
+     * @return 是否通过
+     */
+    bool verify(const IRModule& module);
+    
+    /**
+     * 获取验证错误
+     * @return 错误列表
+     */
+    const std::vector<std::string>& getErrors() const { return errors_; }
+
+private:
+    void verifyFunction(const IRFunction& function);
+    void error(const IRFunction& function, int block, const std::string& message);
+    
+    std::vector<std::string> errors_;   // 验证错误
+};
+
+/**
+ * 计算函数的直接支配者
+ * @param function IR 函数
+ * @return 每个块的直接支配者，入口块为自身，不可达块为 -1
+ */
+std::vector<int> computeDominators(const IRFunction& function);
+
+/**
+ * 判断块 a 是否支配块 b
+ * @param idom computeDominators 的结果
+ */
+bool dominates(const std::vector<int>& idom, int a, int b);
+
+} // namespace capl
+
+#endif // CAPL_IR_H
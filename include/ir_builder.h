@@ -0,0 +1,136 @@
+/**
+ * CAPL AST 到 IR 的降级
+ *
+ * 在语义分析之后逐个处理器（函数）构造 IR。局部标量在构造过程中直接转为
+ * SSA 形式：对每个基本块记录变量的当前定义，读取时沿前驱查找，必要时插入
+ * phi；前驱未全部确定的块（循环头、汇合块）先插入未完成的 phi，
+ * 在块封闭时补齐来源。构造完成后删除不可达块和平凡 phi
+ */
+
+#ifndef CAPL_IR_BUILDER_H
+#define CAPL_IR_BUILDER_H
+
+#include "ir.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+class FunctionNode;
+class OnEventNode;
+
+/**
+ * IR 构造器
+ */
+class IRBuilder {
+public:
+    /**
+     * 从 AST 构造 IR 模块
+     * @param program AST 根节点
+     * @return IR 模块
+     */
+    std::unique_ptr<IRModule> build(const ASTNode* program);
+    
+    /**
+     * 获取构造错误（不支持的构造）
+     * @return 错误列表
+     */
+    const std::vector<std::string>& getErrors() const { return errors_; }
+
+private:
+    /**
+     * 局部变量：标量为 SSA 变量，数组和报文为内存对象
+     */
+    struct LocalVar {
+        std::string ssa_name;   // SSA 变量的唯一名称
+        bool memory = false;    // 是否为内存对象
+    };
+    
+    /**
+     * 可赋值的位置
+     */
+    struct LValue {
+        enum class Kind { VARIABLE, MEMORY, FIELD, INVALID };
+        Kind kind = Kind::INVALID;
+        std::string name;           // SSA 变量名或内存符号
+        std::string field;          // 字段名
+        bool has_index = false;     // 是否带元素下标
+        IRValue index;              // 元素下标
+        bool has_field_index = false;
+        IRValue field_index;        // 字段下标
+    };
+    
+    /**
+     * 循环和 switch 的 break/continue 目标，switch 的 continue 目标为外层循环的目标（没有时为 -1）
+     */
+    struct LoopTargets {
+        int break_block;
+        int continue_block;
+    };
+    
+    void lowerFunction(const ASTNode* node, const std::string& name, bool is_handler,
+                       const std::string& return_type, const FunctionNode* function);
+    void finishFunction();
+    
+    // 基本块和指令
+    int newBlock();
+    void addEdge(int from, int to);
+    void sealBlock(int block);
+    bool isTerminated() const;
+    void startUnreachableBlock();
+    IRValue emit(IRInstruction inst, bool has_result);
+    void emitBranch(int target);
+    void emitCondBranch(const IRValue& cond, int if_true, int if_false);
+    
+    // SSA 变量
+    void writeVariable(const std::string& var, int block, const IRValue& value);
+    IRValue readVariable(const std::string& var, int block);
+    IRValue readVariableRecursive(const std::string& var, int block);
+    IRValue addPhiOperands(const std::string& var, int block, int phi);
+    int insertPhi(int block);
+    IRInstruction* findPhi(int block, int reg);
+    
+    // 作用域
+    const LocalVar* lookupLocal(const std::string& name) const;
+    void declareLocal(const std::string& name, bool memory);
+    std::string memorySymbol(const std::string& name) const;
+    
+    // 语句和表达式
+    void lowerStatement(const ASTNode* node);
+    void lowerStatements(const ASTNode* node);
+    void lowerDeclaration(const ASTNode* node);
+    IRValue lowerExpr(const ASTNode* node);
+    IRValue lowerShortCircuit(const ASTNode* node, bool is_and);
+    IRValue lowerConditional(const ASTNode* node);
+    IRValue lowerCall(const ASTNode* node);
+    LValue lowerLValue(const ASTNode* node);
+    IRValue loadLValue(const LValue& lvalue, int line);
+    void storeLValue(const LValue& lvalue, const IRValue& value, int line);
+    
+    // 构造完成后的清理
+    void removeUnreachableBlocks();
+    void removeTrivialPhis();
+    void renumberRegisters();
+    
+    std::unique_ptr<IRModule> module_;                          // 正在构造的模块
+    IRFunction* function_ = nullptr;                            // 正在构造的函数
+    int current_ = 0;                                           // 当前块
+    int current_line_ = 0;                                      // 当前语句行号
+    std::map<std::string, IRGlobal> globals_;                   // 全局变量
+    std::map<std::string, std::string> function_types_;         // 用户函数返回类型
+    std::vector<std::map<std::string, LocalVar>> scopes_;       // 局部作用域
+    std::map<std::string, int> name_counts_;                    // SSA 变量重名计数
+    std::map<int, std::map<std::string, IRValue>> current_def_; // 块内变量的当前定义
+    std::map<int, std::map<std::string, int>> incomplete_phis_; // 未封闭块中的 phi
+    std::set<int> sealed_;                                      // 已封闭的块
+    std::vector<LoopTargets> loops_;                            // 循环嵌套
+    std::vector<std::string> errors_;                           // 构造错误
+};
+
+} // namespace capl
+
+#endif // CAPL_IR_BUILDER_H
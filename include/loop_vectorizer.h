@@ -0,0 +1,132 @@
+/**
+ * CAPL 可向量化循环识别
+ *
+ * 识别计数循环 for (int i = A; i < B; i++)，其中 A、B 为常量，循环体只由
+ * 对数组元素 a[i] 的赋值组成，且不存在跨迭代依赖：被写入的数组只以 i 为下标
+ * 读取，循环中不写标量。代码生成把这类循环提取为以 __restrict 指针为参数、
+ * 迭代次数已知的内核函数，较大的循环再生成 AVX2 和默认 (SSE2) 两个版本，
+ * 在加载时按 CPUID 选择。有剖析数据时，热点处理器中的循环放宽展开限制，
+ * 冷处理器中的循环不展开也不生成多版本
+ */
+
+#ifndef CAPL_LOOP_VECTORIZER_H
+#define CAPL_LOOP_VECTORIZER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+class ProfileData;
+
+/**
+ * 内核函数的参数：循环中使用的数组或不变标量
+ */
+struct LoopOperand {
+    std::string name;           // 变量名
+    std::string capl_type;      // CAPL 类型（数组为元素类型）
+    bool is_array = false;      // 是否为数组
+    bool global = false;        // 是否为全局变量
+    bool written = false;       // 是否被写入
+};
+
+/**
+ * 可向量化的循环
+ */
+struct VectorLoop {
+    const ASTNode* node = nullptr;          // FOR_STMT 节点
+    std::string kernel_name;                // 生成的内核函数名
+    std::string unit;                       // 所在的处理器或函数
+    std::string loop_var;                   // 循环变量
+    long long begin = 0;                    // 起始值
+    long long end = 0;                      // 结束值（不含）
+    std::vector<LoopOperand> operands;      // 内核参数
+    int unroll = 1;                         // 展开次数
+    bool clones = false;                    // 是否生成按 CPU 选择的多个版本
+    
+    long long getTripCount() const { return end - begin; }
+};
+
+/**
+ * 可向量化循环识别
+ */
+class LoopVectorizer {
+public:
+    /**
+     * 迭代次数不超过此值的循环完全展开
+     */
+    static constexpr long long kFullUnrollLimit = 16;
+    
+    /**
+     * 部分展开的次数
+     */
+    static constexpr int kPartialUnroll = 4;
+    
+    /**
+     * 迭代次数达到此值的循环生成 AVX2/SSE2 多版本
+     */
+    static constexpr long long kCloneThreshold = 64;
+    
+    /**
+     * 热点处理器中完全展开的迭代次数上限
+     */
+    static constexpr long long kHotFullUnrollLimit = 32;
+    
+    /**
+     * 热点处理器中部分展开的次数
+     */
+    static constexpr int kHotPartialUnroll = 8;
+    
+    /**
+     * 构造函数
+     */
+    LoopVectorizer();
+    
+    /**
+     * 识别程序中的可向量化循环
+     * @param program AST 根节点
+     */
+    void analyze(const ASTNode* program);
+    
+    /**
+     * 设置剖析数据，按处理器的执行频率调整展开
+     * @param profile 剖析数据，nullptr 表示不使用
+     */
+    void setProfile(const ProfileData* profile) { profile_ = profile; }
+    
+    /**
+     * 清空识别结果
+     */
+    void clear();
+    
+    /**
+     * 获取识别出的循环（按源码顺序）
+     * @return 循环列表
+     */
+    const std::vector<VectorLoop>& getLoops() const { return loops_; }
+    
+    /**
+     * 查找 for 语句对应的可向量化循环
+     * @param for_node FOR_STMT 节点
+     * @return 循环信息，不可向量化时返回 nullptr
+     */
+    const VectorLoop* findLoop(const ASTNode* for_node) const;
+
+private:
+    void analyzeUnit(const ASTNode* unit, const std::string& unit_name);
+    void visit(const ASTNode* node, const std::string& unit_name);
+    bool matchLoop(const ASTNode* for_node, VectorLoop& loop) const;
+    
+    std::map<std::string, const ASTNode*> globals_;     // 全局变量声明
+    std::map<std::string, const ASTNode*> locals_;      // 当前处理器中的局部变量声明
+    std::map<std::string, int> local_counts_;           // 局部变量的声明次数
+    std::vector<VectorLoop> loops_;                     // 识别结果
+    std::map<const ASTNode*, size_t> index_;            // for 节点到循环下标
+    const ProfileData* profile_ = nullptr;              // 剖析数据
+};
+
+} // namespace capl
+
+#endif // CAPL_LOOP_VECTORIZER_H
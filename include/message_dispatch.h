@@ -0,0 +1,158 @@
+/**
+ * CAPL 报文分派表构造
+ *
+ * 根据编译期已知的报文处理器 ID 选择分派结构，运行时收到报文后一次查表
+ * 即可找到处理器：
+ * - 全部为 11 位标准帧 ID 且足够密集时，使用以最小 ID 为基址的直接索引表
+ * - 否则（稀疏或 29 位扩展帧 ID）构造两级完美散列：ID 先散列到桶，
+ *   每个桶在编译期选好一个位移，使桶内所有 ID 与位移异或后再散列到互不冲突的表项
+ * 报文名在数据库解析时已解析为 ID，同一 ID 的重复处理器已报告为错误
+ */
+
+#ifndef CAPL_MESSAGE_DISPATCH_H
+#define CAPL_MESSAGE_DISPATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 分派结构
+ */
+enum class DispatchKind {
+    None,           // 没有数值 ID 的报文处理器
+    Direct,         // 直接索引表
+    PerfectHash     // 完美散列表
+};
+
+/**
+ * 分派表中的一个处理器
+ */
+struct DispatchEntry {
+    uint32_t id = 0;                    // 报文 ID
+    const ASTNode* handler = nullptr;   // 报文处理器
+    size_t slot = 0;                    // 在表中的位置
+};
+
+/**
+ * 报文分派表构造
+ */
+class MessageDispatch {
+public:
+    /**
+     * 标准帧 ID 的上界（不含）
+     */
+    static constexpr uint32_t kStandardIdLimit = 0x800;
+    
+    /**
+     * 直接索引表中每个处理器平均最多占用的表项数，更稀疏时改用散列
+     */
+    static constexpr size_t kDirectMaxSpanPerEntry = 8;
+    
+    /**
+     * 散列表的最大表项数
+     */
+    static constexpr size_t kMaxHashSlots = 1 << 16;
+    
+    /**
+     * 选桶用的乘数
+     */
+    static constexpr uint32_t kBucketMultiplier = 0x9E3779B1u;
+    
+    /**
+     * 构造函数
+     */
+    MessageDispatch();
+    
+    /**
+     * 为程序中的报文处理器构造分派表
+     * @param program AST 根节点
+     * @param excluded 不需要分派的处理器（例如已编译为网关路由的处理器）
+     */
+    void build(const ASTNode* program, const std::set<const ASTNode*>& excluded = {});
+    
+    /**
+     * 清空分派表
+     */
+    void clear();
+    
+    /**
+     * 获取分派结构
+     */
+    DispatchKind getKind() const { return kind_; }
+    
+    /**
+     * 获取分派的处理器（按 ID 排序）
+     */
+    const std::vector<DispatchEntry>& getEntries() const { return entries_; }
+    
+    /**
+     * 获取表项数
+     */
+    size_t getTableSize() const { return table_size_; }
+    
+    /**
+     * 获取直接索引表的基址（最小 ID）
+     */
+    uint32_t getBase() const { return base_; }
+    
+    /**
+     * 获取完美散列每个桶的位移
+     */
+    const std::vector<uint32_t>& getDisplacements() const { return displacements_; }
+    
+    /**
+     * 获取选桶时乘法结果右移的位数
+     */
+    int getBucketShift() const { return bucket_shift_; }
+    
+    /**
+     * 获取 on message * 处理器
+     * @return 处理器，不存在时返回 nullptr
+     */
+    const ASTNode* getWildcard() const { return wildcard_; }
+    
+    /**
+     * 散列混合函数，生成代码中使用相同的实现
+     * @param x 输入
+     * @return 混合后的值
+     */
+    static uint32_t mix(uint32_t x);
+    
+    /**
+     * 解析报文处理器的数值 ID
+     * @param text 事件名（如 "0x100"）
+     * @param id 输出的 ID
+     * @return 是否为 32 位以内的数值 ID，数据库报文名和 * 返回 false
+     */
+    static bool parseMessageId(const std::string& text, uint32_t& id);
+    
+    /**
+     * 获取报文处理器的报文 ID：数值 ID 或已由数据库解析的报文名
+     * @param handler on message 处理器
+     * @param id 输出的 ID
+     * @return 是否有编译期已知的 ID
+     */
+    static bool handlerMessageId(const ASTNode* handler, uint32_t& id);
+
+private:
+    bool buildPerfectHash(size_t slots, int bucket_bits);
+    
+    DispatchKind kind_;                         // 分派结构
+    std::vector<DispatchEntry> entries_;        // 分派的处理器
+    size_t table_size_;                         // 表项数
+    uint32_t base_;                             // 直接索引表的基址
+    std::vector<uint32_t> displacements_;       // 完美散列每个桶的位移
+    int bucket_shift_;                          // 选桶时的右移位数
+    const ASTNode* wildcard_;                   // on message * 处理器
+};
+
+} // namespace capl
+
+#endif // CAPL_MESSAGE_DISPATCH_H
@@ -0,0 +1,135 @@
+/**
+ * 生成代码的输出缓冲区
+ *
+ * 代码生成期间所有输出追加到一块可增长的内存中，缩进字符串按层级缓存复用；
+ * 生成结束后一次 write() 写入同目录下的临时文件再 rename 到目标路径，
+ * 目标文件不会出现写了一半的内容。内容与已有文件逐字节相同时不写入，
+ * 保持文件的修改时间，下游构建系统不会因此重新编译
+ */
+
+#ifndef CAPL_OUTPUT_BUFFER_H
+#define CAPL_OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <deque>
+#include <ios>
+#include <string>
+#include <type_traits>
+
+namespace capl {
+
+/**
+ * 写入文件的结果
+ */
+enum class WriteResult {
+    Written,        // 内容有变化，已写入
+    Unchanged,      // 内容与已有文件相同，未写入
+    Failed          // 写入失败
+};
+
+/**
+ * 生成代码的输出缓冲区
+ */
+class OutputBuffer {
+public:
+    /**
+     * 每级缩进的空格数
+     */
+    static constexpr int kIndentWidth = 4;
+    
+    /**
+     * 构造函数
+     * @param reserve 预留的字节数
+     */
+    explicit OutputBuffer(size_t reserve = 64 * 1024);
+    
+    OutputBuffer& operator<<(const std::string& text) {
+        data_ += text;
+        return *this;
+    }
+    
+    OutputBuffer& operator<<(const char* text) {
+        data_ += text;
+        return *this;
+    }
+    
+    OutputBuffer& operator<<(char c) {
+        data_ += c;
+        return *this;
+    }
+    
+    /**
+     * 追加整数，按当前进制（std::hex/std::dec）格式化
+     */
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value &&
+                                                             !std::is_same<T, bool>::value>::type>
+    OutputBuffer& operator<<(T value) {
+        // 与 std::ostream 一致：十六进制按同宽度的无符号数输出
+        if (std::is_signed<T>::value && !hex_) {
+            appendSigned(static_cast<long long>(value));
+        } else {
+            appendUnsigned(static_cast<typename std::make_unsigned<T>::type>(value));
+        }
+        return *this;
+    }
+    
+    /**
+     * 追加原始字节（用于二进制文件）
+     * @param data 数据
+     * @param size 字节数
+     */
+    void append(const void* data, size_t size) {
+        data_.append(static_cast<const char*>(data), size);
+    }
+
+    /**
+     * 应用 std::hex、std::dec 等进制操纵符
+     */
+    OutputBuffer& operator<<(std::ios_base& (*manipulator)(std::ios_base&));
+    
+    /**
+     * 获取缩进字符串
+     * @param level 缩进层级
+     * @return 缓存的缩进字符串，引用在缓冲区生命周期内有效
+     */
+    const std::string& indent(int level);
+    
+    /**
+     * 获取已生成的内容
+     */
+    const std::string& str() const { return data_; }
+    
+    /**
+     * 获取已生成的字节数
+     */
+    size_t size() const { return data_.size(); }
+    
+    /**
+     * 将内容写入文件：先写临时文件，同步到磁盘后再 rename，内容未变化时不写入；
+     * 替换已有文件时保留其权限
+     * @param path 目标文件路径
+     * @param error 失败时输出的错误描述
+     * @return 写入结果
+     */
+    WriteResult writeToFile(const std::string& path, std::string& error) const;
+    
+    /**
+     * 检查文件内容是否与给定内容逐字节相同
+     * @param path 文件路径
+     * @param content 内容
+     * @return 文件存在且内容相同时返回 true
+     */
+    static bool fileMatches(const std::string& path, const std::string& content);
+
+private:
+    void appendSigned(long long value);
+    void appendUnsigned(unsigned long long value);
+    
+    std::string data_;                  // 已生成的内容
+    std::deque<std::string> indents_;   // 按层级缓存的缩进字符串（deque 追加时不移动已有元素）
+    bool hex_;                          // 整数是否按十六进制输出
+};
+
+} // namespace capl
+
+#endif // CAPL_OUTPUT_BUFFER_H
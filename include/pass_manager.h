@@ -0,0 +1,139 @@
+/**
+ * CAPL 优化遍管理器
+ *
+ * 位于语义分析和代码生成之间，按优化级别注册优化遍，
+ * 依次运行（需要时反复运行到不动点），并记录每个遍的耗时和修改次数
+ */
+
+#ifndef CAPL_PASS_MANAGER_H
+#define CAPL_PASS_MANAGER_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+class ProfileData;
+
+/**
+ * 优化遍基类
+ */
+class Pass {
+public:
+    virtual ~Pass() = default;
+    
+    /**
+     * 获取遍名称（用于统计输出）
+     * @return 遍名称
+     */
+    virtual const char* getName() const = 0;
+    
+    /**
+     * 在程序上运行一次
+     * @param program AST 根节点
+     * @return 修改次数，0 表示程序未变化
+     */
+    virtual int run(ASTNode* program) = 0;
+    
+    /**
+     * 获取需要在统计中报告的决策（如内联与否及原因）
+     * @return 决策列表
+     */
+    virtual std::vector<std::string> getDecisions() const { return {}; }
+};
+
+/**
+ * 单个优化遍的运行统计
+ */
+struct PassStats {
+    std::string name;       // 遍名称
+    int runs = 0;           // 运行次数
+    int changes = 0;        // 累计修改次数
+    double time_ms = 0.0;   // 累计耗时（毫秒）
+};
+
+/**
+ * 优化遍管理器
+ */
+class PassManager {
+public:
+    /**
+     * 不动点迭代的最大轮数，防止相互抵消的遍无限循环
+     */
+    static constexpr int kMaxIterations = 8;
+    
+    /**
+     * 构造函数
+     * @param optimize_level 优化级别 (0-3)
+     */
+    explicit PassManager(int optimize_level = 0);
+    
+    /**
+     * 设置剖析数据，需在 buildPipeline 之前调用
+     * @param profile 剖析数据，nullptr 表示不使用
+     */
+    void setProfile(const ProfileData* profile) { profile_ = profile; }
+    
+    /**
+     * 按优化级别注册内置优化遍
+     */
+    void buildPipeline();
+    
+    /**
+     * 添加只运行一次的遍
+     * @param pass 优化遍
+     */
+    void addPass(std::unique_ptr<Pass> pass);
+    
+    /**
+     * 添加一组反复运行直到不再修改程序的遍
+     * @param passes 优化遍列表
+     */
+    void addFixedPointGroup(std::vector<std::unique_ptr<Pass>> passes);
+    
+    /**
+     * 运行所有已注册的遍
+     * @param program AST 根节点
+     * @return 总修改次数
+     */
+    int run(ASTNode* program);
+    
+    /**
+     * 获取统计信息（按注册顺序）
+     * @return 统计列表
+     */
+    const std::vector<PassStats>& getStats() const { return stats_; }
+    
+    int getOptimizeLevel() const { return optimize_level_; }
+    
+    /**
+     * 输出统计报告
+     * @param out 输出流
+     */
+    void printStats(std::ostream& out) const;
+
+private:
+    /**
+     * 一组按顺序运行的遍
+     */
+    struct Stage {
+        std::vector<std::unique_ptr<Pass>> passes;  // 遍
+        std::vector<size_t> stat_indices;           // 对应的统计项
+        bool fixed_point = false;                   // 是否运行到不动点
+    };
+    
+    int runOnce(Stage& stage, ASTNode* program);
+    
+    int optimize_level_;                // 优化级别
+    const ProfileData* profile_ = nullptr; // 剖析数据
+    std::vector<Stage> stages_;         // 运行阶段
+    std::vector<PassStats> stats_;      // 统计信息
+    int iterations_ = 0;                // 不动点迭代总轮数
+};
+
+} // namespace capl
+
+#endif // CAPL_PASS_MANAGER_H
@@ -0,0 +1,26 @@
+/**
+ * CAPL 内置优化遍
+ */
+
+#ifndef CAPL_PASSES_H
+#define CAPL_PASSES_H
+
+#include "pass_manager.h"
+
+namespace capl {
+
+/**
+ * 删除不可达语句：同一语句列表中 return、break、continue 之后的语句
+ */
+class UnreachableCodePass : public Pass {
+public:
+    const char* getName() const override { return "unreachable-code"; }
+    int run(ASTNode* program) override;
+
+private:
+    int simplify(ASTNode* node);
+};
+
+} // namespace capl
+
+#endif // CAPL_PASSES_H
@@ -0,0 +1,139 @@
+/**
+ * CAPL 运行剖析数据
+ *
+ * --profile-generate 生成的程序为每个事件处理器和 if 语句的两个分支计数，
+ * 退出时把计数写入剖析文件，每行为 "键 次数"：
+ *   handler on message 0x100 123456
+ *   branch on message 0x100 #2 taken 1000
+ *   branch on message 0x100 #2 not_taken 3
+ * 分支的键是 if 语句在源码中所在的处理器或函数和在其中按先序的序号，在任何优化遍之前命名，
+ * 内联产生的副本沿用源 if 语句的键并共用计数，插桩和读入时内联不同也能对应。每个键只能出现一次。
+ * --profile-use 读入剖析文件，把处理器分为热点、普通和冷处理器，
+ * 供内联、循环展开、函数属性、路由顺序和分支预测提示使用
+ */
+
+#ifndef CAPL_PROFILE_DATA_H
+#define CAPL_PROFILE_DATA_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 处理器的执行频率分类
+ */
+enum class Heat {
+    Unknown,    // 剖析数据中没有该处理器
+    Cold,       // 从未执行
+    Warm,       // 执行过但不在热点中
+    Hot         // 执行次数最多、合计占总次数 kHotFraction 的处理器
+};
+
+/**
+ * if 语句的分支计数
+ */
+struct BranchProfile {
+    unsigned long long taken = 0;       // 条件为真的次数
+    unsigned long long not_taken = 0;   // 条件为假的次数
+};
+
+/**
+ * 运行剖析数据
+ */
+class ProfileData {
+public:
+    /**
+     * 热点处理器合计覆盖的执行次数比例
+     */
+    static constexpr double kHotFraction = 0.9;
+    
+    /**
+     * 分支有一侧的比例达到此值时生成分支预测提示
+     */
+    static constexpr double kBiasedBranch = 0.9;
+    
+    /**
+     * 构造函数
+     */
+    ProfileData();
+    
+    /**
+     * 读入剖析文件
+     * @param path 文件路径
+     * @param error 失败原因
+     * @return 是否成功
+     */
+    bool load(const std::string& path, std::string& error);
+    
+    /**
+     * 清空剖析数据
+     */
+    void clear();
+    
+    /**
+     * 是否没有任何剖析数据
+     */
+    bool empty() const { return handlers_.empty() && branches_.empty(); }
+    
+    /**
+     * 获取处理器的执行次数
+     * @param handler 处理器显示名（如 "on message 0x100"）
+     * @return 执行次数，没有数据时为 0
+     */
+    unsigned long long getHandlerCount(const std::string& handler) const;
+    
+    /**
+     * 获取处理器的执行频率分类
+     * @param handler 处理器显示名
+     * @return 频率分类
+     */
+    Heat getHeat(const std::string& handler) const;
+    
+    /**
+     * 查找 if 语句的分支计数
+     * @param branch if 语句的名称（所在处理器或函数和序号，如 "on message 0x100 #2"）
+     * @return 分支计数，没有数据时返回 nullptr
+     */
+    const BranchProfile* findBranch(const std::string& branch) const;
+    
+    /**
+     * 获取 if 语句偏向的分支
+     * @param branch if 语句的名称
+     * @return 1 表示条件多为真，-1 表示多为假，0 表示没有明显偏向或没有数据
+     */
+    int getBranchBias(const std::string& branch) const;
+    
+    /**
+     * 获取各分类的处理器数量
+     * @param heat 频率分类
+     */
+    int countHandlers(Heat heat) const;
+    
+    /**
+     * 获取有分支计数的 if 语句数量
+     */
+    size_t getBranchCount() const { return branches_.size(); }
+
+private:
+    void classify();
+    
+    std::map<std::string, unsigned long long> handlers_;    // 处理器执行次数
+    std::map<std::string, BranchProfile> branches_;         // 按 if 语句名称的分支计数
+    std::set<std::string> hot_;                             // 热点处理器
+};
+
+/**
+ * 在任何优化遍之前为程序中的 if 语句命名剖析键：源码中所在的处理器或函数加上在其中
+ * 按先序的序号（从 1 开始），名称保存在 IfStmtNode 上，随内联的副本复制
+ * @param program 程序根节点
+ */
+void assignBranchNames(ASTNode* program);
+
+} // namespace capl
+
+#endif // CAPL_PROFILE_DATA_H
@@ -0,0 +1,137 @@
+/**
+ * CAPL 全局状态内存布局
+ *
+ * 计算 variables 块中每个全局变量的大小和对齐，按写入者分组到独立的缓存行，
+ * 组内按对齐降序排列以减少填充，生成单个对齐的状态结构体；定时器和报文缓存等
+ * 运行时状态放在最后一组，节点的全部状态是一块连续的平凡可复制内存
+ */
+
+#ifndef CAPL_STATE_LAYOUT_H
+#define CAPL_STATE_LAYOUT_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+class IntegerNarrowing;
+
+/**
+ * 状态结构体中的单个字段
+ */
+struct StateField {
+    std::string name;                   // 变量名
+    std::string capl_type;              // CAPL 类型
+    std::string cpp_type;               // 生成的 C++ 类型
+    int array_size = 0;                 // 数组长度，0 表示标量
+    size_t size = 0;                    // 字段总字节数
+    size_t align = 1;                   // 对齐要求
+    size_t offset = 0;                  // 在状态结构体中的偏移
+    int group = 0;                      // 缓存行分组编号
+    int decl_order = 0;                 // 声明顺序
+    std::vector<std::string> writers;   // 写入该变量的事件处理器
+    const ASTNode* decl = nullptr;      // 变量声明节点
+    bool runtime = false;               // 是否为定时器、报文缓存等运行时状态
+    std::string initializer;            // 运行时状态的初始值，为空时零初始化
+};
+
+/**
+ * 全局状态布局
+ */
+class StateLayout {
+public:
+    /**
+     * 缓存行大小（字节）
+     */
+    static constexpr size_t kCacheLineSize = 64;
+    
+    /**
+     * 生成代码中的状态结构体类型名和实例名
+     */
+    static constexpr const char* kStructName = "CaplState";
+    static constexpr const char* kInstanceName = "g_state";
+    
+    /**
+     * 构造函数
+     */
+    StateLayout();
+    
+    /**
+     * 根据程序计算布局
+     * @param program AST 根节点
+     * @param narrowing 整数存储宽度收窄结果，为 nullptr 时按声明类型存储
+     */
+    void compute(const ASTNode* program, const IntegerNarrowing* narrowing = nullptr);
+    
+    /**
+     * 在全局变量之后追加运行时状态：定时器槽位和仿真时间、$信号 读取的报文缓存
+     * （每个报文保存最近收到的一帧），共用最后一个缓存行组，须在 compute 之后调用
+     * @param program AST 根节点
+     * @param timer_count 定时器数
+     */
+    void addRuntimeState(const ASTNode* program, size_t timer_count);
+    
+    /**
+     * 获取布局后的字段（按偏移排序）
+     * @return 字段列表
+     */
+    const std::vector<StateField>& getFields() const { return fields_; }
+    
+    /**
+     * 查找字段
+     * @param name 变量名
+     * @return 字段指针，未找到返回 nullptr
+     */
+    const StateField* findField(const std::string& name) const;
+    
+    /**
+     * 结构体总字节数（含尾部填充）
+     */
+    size_t getTotalSize() const { return total_size_; }
+    
+    /**
+     * 填充字节数
+     */
+    size_t getPaddingBytes() const;
+    
+    /**
+     * 分组数量
+     */
+    int getGroupCount() const { return group_count_; }
+    
+    /**
+     * 输出布局报告
+     * @param out 输出流
+     */
+    void printReport(std::ostream& out) const;
+    
+    /**
+     * CAPL 类型对应的 C++ 类型
+     * @param capl_type CAPL 类型名
+     * @return C++ 类型名
+     */
+    static std::string cppType(const std::string& capl_type);
+    
+    /**
+     * CAPL 类型（标量）的大小和对齐
+     * @param capl_type CAPL 类型名
+     * @param size 输出的字节数
+     * @param align 输出的对齐要求
+     */
+    static void scalarSizeAlign(const std::string& capl_type, size_t& size, size_t& align);
+
+private:
+    void addRuntimeField(const std::string& name, const std::string& cpp_type, int array_size,
+                         size_t size, size_t align, const std::string& initializer);
+    
+    std::vector<StateField> fields_;    // 字段
+    size_t total_size_;                 // 总字节数
+    int group_count_;                   // 分组数量
+};
+
+} // namespace capl
+
+#endif // CAPL_STATE_LAYOUT_H
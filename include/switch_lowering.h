@@ -0,0 +1,141 @@
+/**
+ * CAPL switch 语句的分派方式选择
+ *
+ * 按 case 标签的数量和分布为每个 switch 选择分派方式，使分派不随标签数线性增长：
+ * - 标签落在 64 个连续值之内且跳转目标不超过 3 个时，用位测试：
+ *   判别值减去最小标签后作为位下标，与每个目标的标签位掩码相与
+ * - 标签足够多且足够密集时，用以最小标签为基址的跳转表一次跳转
+ * - 否则用有序的标签数组二分查找
+ * 生成的代码用 GNU 的标签地址 (&&label) 和计算跳转 (goto *) 实现跳转表
+ */
+
+#ifndef CAPL_SWITCH_LOWERING_H
+#define CAPL_SWITCH_LOWERING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * switch 的分派方式
+ */
+enum class SwitchKind {
+    BitTest,        // 位测试
+    JumpTable,      // 跳转表
+    BinarySearch    // 二分查找
+};
+
+/**
+ * 一个 case 标签
+ */
+struct SwitchCase {
+    long long value = 0;    // 标签值
+    size_t target = 0;      // 跳转到的 CASE_STMT（在 switch 的 case 中的下标），语句为空的 case 取之后第一个有语句的 case
+};
+
+/**
+ * 位测试的一个跳转目标
+ */
+struct SwitchBitMask {
+    size_t target = 0;      // 跳转到的 CASE_STMT
+    uint64_t mask = 0;      // 标签值减去最小标签后的位掩码
+};
+
+/**
+ * 一个 switch 语句的分派方式
+ */
+struct SwitchPlan {
+    const ASTNode* node = nullptr;      // SWITCH_STMT 节点
+    size_t id = 0;                      // 在程序中的编号（源码顺序），用于生成代码中的标签名
+    SwitchKind kind = SwitchKind::BinarySearch;
+    std::vector<SwitchCase> cases;      // case 标签（按值排序）
+    int default_target = -1;            // default 的 CASE_STMT，-1 表示跳出 switch
+    long long min_value = 0;            // 最小标签
+    uint64_t span = 0;                  // 最大标签与最小标签之差加一
+    std::vector<SwitchBitMask> masks;   // 位测试的掩码（按目标排序）
+};
+
+/**
+ * switch 语句的分派方式选择
+ */
+class SwitchLowering {
+public:
+    /**
+     * 位测试的位宽
+     */
+    static constexpr uint64_t kBitTestWidth = 64;
+    
+    /**
+     * 位测试最多的跳转目标数，更多时每个目标一次测试的开销超过查表
+     */
+    static constexpr size_t kMaxBitTestTargets = 3;
+    
+    /**
+     * 生成跳转表的最少标签数
+     */
+    static constexpr size_t kMinJumpTableCases = 4;
+    
+    /**
+     * 跳转表的最低密度（标签数占表项数的百分比）
+     */
+    static constexpr uint64_t kMinJumpTableDensity = 40;
+    
+    /**
+     * 为程序中所有 switch 语句选择分派方式
+     * @param program AST 根节点
+     */
+    void analyze(const ASTNode* program);
+    
+    /**
+     * 清空分析结果
+     */
+    void clear();
+    
+    /**
+     * 获取所有 switch 的分派方式（按源码顺序）
+     */
+    const std::vector<SwitchPlan>& getPlans() const { return plans_; }
+    
+    /**
+     * 查找 switch 语句的分派方式
+     * @param node SWITCH_STMT 节点
+     * @return 分派方式，不存在时返回 nullptr
+     */
+    const SwitchPlan* findPlan(const ASTNode* node) const;
+    
+    /**
+     * 统计使用某种分派方式的 switch 数量
+     * @param kind 分派方式
+     */
+    int countKind(SwitchKind kind) const;
+    
+    /**
+     * 为一个 switch 语句选择分派方式
+     * @param node SWITCH_STMT 节点
+     * @return 分派方式
+     */
+    static SwitchPlan plan(const ASTNode* node);
+    
+    /**
+     * 获取 case 标签的值
+     * @param case_stmt CASE_STMT 节点
+     * @param value 输出的标签值
+     * @return 是否为带整数常量标签的 case（default 返回 false）
+     */
+    static bool caseValue(const ASTNode* case_stmt, long long& value);
+
+private:
+    void collect(const ASTNode* node);
+    
+    std::vector<SwitchPlan> plans_;                 // 所有 switch 的分派方式
+    std::map<const ASTNode*, size_t> index_;        // SWITCH_STMT 节点到 plans_ 下标
+};
+
+} // namespace capl
+
+#endif // CAPL_SWITCH_LOWERING_H
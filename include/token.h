@@ -51,6 +51,8 @@ enum class TokenType {
     WORD,           // word
     DWORD,          // dword
     LONG,           // long
+    INT64,          // int64
+    QWORD,          // qword
     
     // CAN 相关关键字
     CAN,            // can
@@ -58,6 +60,7 @@ enum class TokenType {
     SIGNAL,         // signal
     ENVVAR,         // envvar
     SYSVAR,         // sysvar
+    SIGNAL_REF,     // $信号名 或 $报文名::信号名
     
     // 操作符
     ASSIGN,         // =
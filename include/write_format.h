@@ -0,0 +1,129 @@
+/**
+ * write() 格式字符串的编译期特化
+ *
+ * write() 的格式字符串为字符串常量时在编译期解析为文本段和转换段：
+ * - 文本段连同长度写入生成代码，运行时直接拷贝
+ * - 每个转换按类型选择整数、字符、字符串或浮点格式化函数，宽度、精度和标志都是常量
+ * - 实参为常量时在编译期按同样的规则格式化，并入相邻的文本段
+ * 实参个数与转换不符、整数转换的实参为浮点数、浮点转换的实参为整数、%s 的实参不是字符串等
+ * 在编译时报错；无法确定类型的实参（如内置函数的返回值）按转换类型转换。
+ * 格式字符串不是常量或使用 * 宽度、精度时不特化，由运行时库的 capl_write_format 格式化
+ */
+
+#ifndef CAPL_WRITE_FORMAT_H
+#define CAPL_WRITE_FORMAT_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace capl {
+
+class ASTNode;
+
+/**
+ * 表达式的值类型（按 CAPL 的声明类型推断）
+ */
+enum class FormatValueType {
+    Unknown,        // 无法确定
+    Integer,        // 有符号整数
+    Unsigned,       // 无符号整数
+    Float,          // 浮点数
+    String,         // char 数组或字符串常量
+    Message         // 报文
+};
+
+/**
+ * 格式字符串中的一段
+ */
+struct FormatSegment {
+    enum class Kind {
+        Text,       // 文本
+        Integer,    // %d %i %u %x %X %o
+        Char,       // %c
+        String,     // %s
+        Float       // %f %F %e %E %g %G
+    };
+    
+    Kind kind = Kind::Text;
+    std::string text;           // 文本段的内容
+    size_t arg = 0;             // 实参在 write 调用中的下标（格式字符串为 0）
+    char conversion = 0;        // 转换字符
+    unsigned flags = 0;         // kLeft、kZero、kPlus、kSpace、kAlternate 的组合
+    int width = 0;              // 最小宽度
+    int precision = -1;         // 精度，-1 表示未指定
+    int bits = 32;              // 整数转换的位宽 (8/16/32/64)
+    bool is_signed = true;      // 整数转换是否按有符号数格式化（%d %i）
+    bool star_width = false;    // 宽度为 *，由前一个实参给出
+    bool star_precision = false;    // 精度为 .*，由宽度之后的实参给出
+};
+
+/**
+ * 一个 write 调用的格式化方式
+ */
+struct FormatPlan {
+    const ASTNode* call = nullptr;          // write 的 CALL_EXPR 节点
+    std::vector<FormatSegment> segments;    // 各段（相邻的文本段已合并）
+    size_t conversions = 0;                 // 格式字符串中的转换数
+};
+
+/**
+ * write() 格式字符串的编译期特化
+ */
+class WriteFormats {
+public:
+    /**
+     * 格式标志
+     */
+    static constexpr unsigned kLeft = 1;        // -
+    static constexpr unsigned kZero = 2;        // 0
+    static constexpr unsigned kPlus = 4;        // +
+    static constexpr unsigned kSpace = 8;       // 空格
+    static constexpr unsigned kAlternate = 16;  // #
+    
+    /**
+     * 一行输出的最大字节数（与运行时库的行缓冲区一致），超出部分截断
+     */
+    static constexpr size_t kLineCapacity = 1024;
+    
+    /**
+     * 为程序中格式字符串为常量的 write 调用生成格式化方式
+     * @param program AST 根节点
+     * @param errors 输出的错误（实参个数或类型与格式不符、未知的转换等），为 nullptr 时不检查
+     */
+    void analyze(const ASTNode* program, std::vector<std::string>* errors = nullptr);
+    
+    /**
+     * 清空分析结果
+     */
+    void clear();
+    
+    /**
+     * 查找 write 调用的格式化方式
+     * @param call CALL_EXPR 节点
+     * @return 格式化方式，不需要特化（无实参且没有 %）或无法特化时返回 nullptr
+     */
+    const FormatPlan* findPlan(const ASTNode* call) const;
+    
+    /**
+     * 获取特化的 write 调用数
+     */
+    size_t getCount() const { return plans_.size(); }
+    
+    /**
+     * 解析格式字符串
+     * @param format 格式字符串
+     * @param segments 输出的各段，转换段的 arg 为实参下标，* 宽度和精度各占用之前的一个实参
+     * @param error 失败原因
+     * @return 是否成功
+     */
+    static bool parse(const std::string& format, std::vector<FormatSegment>& segments, std::string& error);
+
+private:
+    std::map<const ASTNode*, FormatPlan> plans_;    // write 调用到格式化方式
+};
+
+} // namespace capl
+
+#endif // CAPL_WRITE_FORMAT_H
@@ -0,0 +1,168 @@
+/**
+ * CAPL 运行时库实现
+ *
+ * 只使用 stdio：输出按行写入 stdout 的缓冲区，不逐行刷新；终止程序前先刷新
+ */
+
+#include "capl_rt.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+/**
+ * 输出一帧报文：output(msg) 和网关路由的转发共用，编译为路由的处理器与 -O0 输出相同
+ * @param id 报文 ID
+ */
+void printFrame(unsigned int id) {
+    std::printf("输出报文: 0x%x\n", id);
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * 输出一行文本
+ * @param text 以 0 结尾的文本
+ */
+void capl_write(const char* text) {
+    std::fputs(text, stdout);
+    std::fputc('\n', stdout);
+}
+
+/**
+ * 输出一行已格式化的文本
+ * @param text 文本
+ * @param length 字节数
+ */
+void capl_write_line(const char* text, size_t length) {
+    std::fwrite(text, 1, length, stdout);
+    std::fputc('\n', stdout);
+}
+
+/**
+ * 按运行时的格式字符串输出一行
+ * @param format 格式字符串，%l 为 32 位、%I64 为 64 位整数
+ */
+void capl_write_format(const char* format, ...) {
+    // 改写长度修饰：%l 的实参按 int 传递，%I64 改为 %ll
+    char spec[1024];
+    size_t n = 0;
+    const size_t limit = sizeof(spec) - 3;
+    for (const char* p = format; *p != '\0' && n < limit;) {
+        char c = *p++;
+        spec[n++] = c;
+        if (c != '%') {
+            continue;
+        }
+        if (*p == '%') {
+            spec[n++] = *p++;
+            continue;
+        }
+        while (*p != '\0' && std::strchr("-+ #0123456789.*", *p) != nullptr && n < limit) {
+            spec[n++] = *p++;
+        }
+        if (p[0] == 'I' && p[1] == '6' && p[2] == '4') {
+            spec[n++] = 'l';
+            spec[n++] = 'l';
+            p += 3;
+        } else if (p[0] == 'l' && p[1] != 'l') {
+            ++p;
+        }
+    }
+    spec[n] = '\0';
+    
+    char line[1024];
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(line, sizeof(line), spec, args);
+    va_end(args);
+    if (length < 0) {
+        length = 0;
+    }
+    capl_write_line(line, static_cast<size_t>(length) < sizeof(line) ? static_cast<size_t>(length) : sizeof(line) - 1);
+}
+
+/**
+ * 按编译期生成的转换说明格式化一个浮点数
+ * @param out 输出缓冲区
+ * @param capacity 缓冲区字节数（含结尾的 0）
+ * @param spec 转换说明
+ * @param value 浮点值
+ * @return 写入的字节数，缓冲区不足时截断
+ */
+size_t capl_format_double(char* out, size_t capacity, const char* spec, double value) {
+    if (capacity == 0) {
+        return 0;
+    }
+    int length = std::snprintf(out, capacity, spec, value);
+    if (length < 0) {
+        return 0;
+    }
+    return static_cast<size_t>(length) < capacity ? static_cast<size_t>(length) : capacity - 1;
+}
+
+/**
+ * 输出一个整数
+ * @param value 整数值
+ */
+void capl_output_int(int value) {
+    std::printf("输出: %d\n", value);
+}
+
+/**
+ * 输出报文
+ * @param msg 报文
+ */
+void capl_output_message(const capl_message* msg) {
+    printFrame(msg->id);
+}
+
+/**
+ * 以改写后的报文头转发报文，输出与改写报文头后 output(msg) 相同
+ * @param msg 接收的报文
+ * @param id 转发的报文 ID
+ * @param channel 转发的通道，与 capl_output_message 一样不出现在输出中
+ */
+void capl_forward(const capl_message* msg, unsigned int id, unsigned char channel) {
+    static_cast<void>(msg);
+    static_cast<void>(channel);
+    printFrame(id);
+}
+
+/**
+ * 报告数组下标越界并终止程序
+ * @param index 下标
+ * @param size 数组长度
+ * @param array 数组名
+ * @param line 源码行号
+ */
+void capl_index_error(long long index, int size, const char* array, int line) {
+    std::fflush(stdout);
+    std::fprintf(stderr, "数组下标越界: %s[%lld], 长度 %d, 行 %d\n", array, index, size, line);
+    std::abort();
+}
+
+/**
+ * 把剖析计数写入文件，每行为 "键 次数"
+ * @param path 剖析文件路径
+ * @param keys 计数器的键
+ * @param counts 计数
+ * @param count 计数器数量
+ * @return 成功返回 0，无法写入返回 -1
+ */
+int capl_write_profile(const char* path, const char* const* keys, const unsigned long long* counts, size_t count) {
+    std::FILE* file = std::fopen(path, "w");
+    if (!file) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        std::fprintf(file, "%s %llu\n", keys[i], counts[i]);
+    }
+    return std::fclose(file) == 0 ? 0 : -1;
+}
+
+} // extern "C"
@@ -0,0 +1,551 @@
+/**
+ * CAPL 运行时库 (libcapl_rt) 接口
+ *
+ * 生成的代码只包含本头文件，运行时函数预先编译在 libcapl_rt.a / libcapl_rt.so 中，
+ * 下游编译不再重复解析 iostream 等标准库头文件。接口为 C ABI，只依赖 <stddef.h> 和 <stdint.h>；
+ * 运行时库用 stdio 实现，不引入 iostream 的静态初始化。
+ * C++ 中另外在 capl_runtime 命名空间提供生成代码调用的内联包装和编译期特化的信号访问器
+ */
+
+#ifndef CAPL_RT_H
+#define CAPL_RT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define CAPL_RT_NORETURN __attribute__((noreturn))
+#else
+#define CAPL_RT_NORETURN
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * CAN 报文
+ */
+typedef struct capl_message {
+    unsigned int id;            /* 报文 ID */
+    unsigned char dlc;          /* 数据长度 */
+    unsigned char channel;      /* 通道 */
+    unsigned char dir;          /* 方向 */
+    unsigned char reserved;
+    unsigned char data[8];      /* 数据 */
+#ifdef __cplusplus
+    unsigned char& byte(int i) { return data[i]; }
+#endif
+} capl_message;
+
+/**
+ * 输出一行文本
+ * @param text 以 0 结尾的文本
+ */
+void capl_write(const char* text);
+
+/**
+ * 输出一行已格式化的文本
+ * @param text 文本（不需要以 0 结尾）
+ * @param length 字节数
+ */
+void capl_write_line(const char* text, size_t length);
+
+/**
+ * 按运行时的格式字符串输出一行，用于格式字符串不是常量或使用 * 宽度、精度的 write 调用。
+ * 格式中 CAPL 的 %l（32 位）和 %I64（64 位）长度修饰先改写为 C 的写法，超出一行容量的部分截断
+ * @param format 格式字符串
+ */
+void capl_write_format(const char* format, ...);
+
+/**
+ * 按编译期生成的转换说明格式化一个浮点数
+ * @param out 输出缓冲区
+ * @param capacity 缓冲区字节数（含结尾的 0）
+ * @param spec 转换说明，如 "%8.3f"
+ * @param value 浮点值
+ * @return 写入的字节数（不含结尾的 0），缓冲区不足时截断
+ */
+size_t capl_format_double(char* out, size_t capacity, const char* spec, double value);
+
+/**
+ * 输出一个整数
+ * @param value 整数值
+ */
+void capl_output_int(int value);
+
+/**
+ * 输出报文
+ * @param msg 报文
+ */
+void capl_output_message(const capl_message* msg);
+
+/**
+ * 以改写后的报文头转发报文，输出与改写报文头后 capl_output_message 相同
+ * @param msg 接收的报文
+ * @param id 转发的报文 ID
+ * @param channel 转发的通道
+ */
+void capl_forward(const capl_message* msg, unsigned int id, unsigned char channel);
+
+/**
+ * 报告数组下标越界并终止程序
+ * @param index 下标
+ * @param size 数组长度
+ * @param array 数组名
+ * @param line 源码行号
+ */
+CAPL_RT_NORETURN void capl_index_error(long long index, int size, const char* array, int line);
+
+/**
+ * 把剖析计数写入文件，每行为 "键 次数"
+ * @param path 剖析文件路径
+ * @param keys 计数器的键
+ * @param counts 计数
+ * @param count 计数器数量
+ * @return 成功返回 0，无法写入返回 -1
+ */
+int capl_write_profile(const char* path, const char* const* keys, const unsigned long long* counts, size_t count);
+
+/*
+ * 以下函数由生成代码定义，不在运行时库中。生成代码自带的 main 依次运行 on start 和
+ * on stop；以 -DCAPL_NO_MAIN 编译时不生成 main，由外部驱动调用这些入口分派事件。
+ * 节点的全局变量、报文缓存和定时器在一个结构体中，快照和恢复各是一次 memcpy，
+ * 剖析计数不属于节点状态
+ */
+
+/**
+ * 运行 on start 处理器
+ */
+void capl_start(void);
+
+/**
+ * 运行 on stop 处理器
+ */
+void capl_stop(void);
+
+/**
+ * 按报文 ID 把收到的报文分派给处理器、网关路由或 on message * 处理器
+ * @param msg 收到的报文，处理器可以修改
+ * @return 有处理器或路由处理了该报文时返回 1，否则返回 0
+ */
+int capl_dispatch(capl_message* msg);
+
+/**
+ * 推进仿真时间，依次触发到期的定时器
+ * @param ms 推进的毫秒数
+ */
+void capl_advance_time(long long ms);
+
+/**
+ * 分派按键事件
+ * @param key 按键编码
+ */
+void capl_dispatch_key(unsigned char key);
+
+/**
+ * 节点状态的字节数
+ * @return 快照缓冲区需要的字节数
+ */
+size_t capl_state_size(void);
+
+/**
+ * 把节点状态复制到缓冲区
+ * @param buffer 至少 capl_state_size() 字节的缓冲区
+ */
+void capl_snapshot(void* buffer);
+
+/**
+ * 从缓冲区恢复节点状态
+ * @param buffer capl_snapshot 写入的缓冲区
+ */
+void capl_restore(const void* buffer);
+
+#ifdef __cplusplus
+}
+
+namespace capl_runtime {
+
+using Message = capl_message;
+
+inline void write(const char* text) {
+    capl_write(text);
+}
+
+/**
+ * 运行时格式化的实参按 capl_write_format 的约定传递：字符串为指针，浮点数为 double，
+ * 64 位整数为 long long，其余整数为 int
+ */
+template <typename T>
+inline T* writeArg(T* value) {
+    return value;
+}
+
+template <typename T>
+inline auto writeArg(T value) {
+    if constexpr (static_cast<T>(0.5) != 0) {
+        return static_cast<double>(value);
+    } else if constexpr (sizeof(T) > sizeof(int)) {
+        return static_cast<long long>(value);
+    } else {
+        return static_cast<int>(value);
+    }
+}
+
+template <typename... Args>
+inline void write(const char* format, Args... args) {
+    capl_write_format(format, writeArg(args)...);
+}
+
+inline void output(int value) {
+    capl_output_int(value);
+}
+
+inline void output(const Message& msg) {
+    capl_output_message(&msg);
+}
+
+inline void forward(const Message& msg, unsigned int id, unsigned char channel) {
+    capl_forward(&msg, id, channel);
+}
+
+/**
+ * 有符号整数运算的回绕：结果类型与内置运算符相同，int、long、long long 在同宽的无符号类型中运算后
+ * 转换回来，溢出时按二进制补码回绕而不是未定义行为；无符号和浮点运算直接使用内置运算符
+ */
+template <typename T>
+struct WrapUnsigned {
+    using type = T;
+};
+
+template <>
+struct WrapUnsigned<int> {
+    using type = unsigned int;
+};
+
+template <>
+struct WrapUnsigned<long> {
+    using type = unsigned long;
+};
+
+template <>
+struct WrapUnsigned<long long> {
+    using type = unsigned long long;
+};
+
+template <typename A, typename B>
+inline auto capl_add(A a, B b) -> decltype(a + b) {
+    using R = decltype(a + b);
+    using U = typename WrapUnsigned<R>::type;
+    return static_cast<R>(static_cast<U>(static_cast<R>(a)) + static_cast<U>(static_cast<R>(b)));
+}
+
+template <typename A, typename B>
+inline auto capl_sub(A a, B b) -> decltype(a - b) {
+    using R = decltype(a - b);
+    using U = typename WrapUnsigned<R>::type;
+    return static_cast<R>(static_cast<U>(static_cast<R>(a)) - static_cast<U>(static_cast<R>(b)));
+}
+
+template <typename A, typename B>
+inline auto capl_mul(A a, B b) -> decltype(a * b) {
+    using R = decltype(a * b);
+    using U = typename WrapUnsigned<R>::type;
+    return static_cast<R>(static_cast<U>(static_cast<R>(a)) * static_cast<U>(static_cast<R>(b)));
+}
+
+template <typename A>
+inline auto capl_neg(A a) -> decltype(-a) {
+    using R = decltype(-a);
+    using U = typename WrapUnsigned<R>::type;
+    return static_cast<R>(U(0) - static_cast<U>(static_cast<R>(a)));
+}
+
+template <typename T, typename V>
+inline T& capl_add_assign(T& target, V value) {
+    target = static_cast<T>(capl_add(target, value));
+    return target;
+}
+
+template <typename T, typename V>
+inline T& capl_sub_assign(T& target, V value) {
+    target = static_cast<T>(capl_sub(target, value));
+    return target;
+}
+
+template <typename T, typename V>
+inline T& capl_mul_assign(T& target, V value) {
+    target = static_cast<T>(capl_mul(target, value));
+    return target;
+}
+
+template <typename T>
+inline T& capl_pre_inc(T& target) {
+    return capl_add_assign(target, 1);
+}
+
+template <typename T>
+inline T& capl_pre_dec(T& target) {
+    return capl_sub_assign(target, 1);
+}
+
+template <typename T>
+inline T capl_post_inc(T& target) {
+    T old = target;
+    capl_add_assign(target, 1);
+    return old;
+}
+
+template <typename T>
+inline T capl_post_dec(T& target) {
+    T old = target;
+    capl_sub_assign(target, 1);
+    return old;
+}
+
+inline int capl_check_index(long long index, int size, const char* array, int line) {
+    if (index < 0 || index >= size) {
+        capl_index_error(index, size, array, line);
+    }
+    return static_cast<int>(index);
+}
+
+/**
+ * write() 格式转换的标志，与编译器的 WriteFormats 一致
+ */
+enum WriteFormatFlags : unsigned {
+    kFormatLeft = 1,        /* - */
+    kFormatZero = 2,        /* 0 */
+    kFormatPlus = 4,        /* + */
+    kFormatSpace = 8,       /* 空格 */
+    kFormatAlternate = 16   /* # */
+};
+
+/**
+ * write() 格式化输出的行缓冲区：编译器把常量格式字符串展开为文本段和各转换的调用链，
+ * 文本段带预先算好的长度直接拷贝，整数就地转换为数字，浮点数使用编译期生成的转换说明。
+ * 整行在栈上拼好后由 end() 一次输出，超出 kCapacity 的部分截断
+ */
+class WriteLine {
+public:
+    static constexpr size_t kCapacity = 1024;
+    
+    WriteLine() : length_(0) {}
+    
+    WriteLine& text(const char* s, size_t n) {
+        append(s, n);
+        return *this;
+    }
+    
+    WriteLine& str(const char* s, int width = 0, unsigned flags = 0, int precision = -1) {
+        size_t n = 0;
+        while (s[n] && (precision < 0 || n < static_cast<size_t>(precision))) {
+            ++n;
+        }
+        padded(s, n, width, flags);
+        return *this;
+    }
+    
+    WriteLine& chr(char c, int width = 0, unsigned flags = 0) {
+        padded(&c, 1, width, flags);
+        return *this;
+    }
+    
+    WriteLine& dec(int64_t value, int width = 0, unsigned flags = 0, int precision = -1) {
+        uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        const char* sign = value < 0 ? "-" : (flags & kFormatPlus) ? "+" : (flags & kFormatSpace) ? " " : "";
+        return integer(magnitude, 10, false, sign, width, flags, precision);
+    }
+    
+    WriteLine& udec(uint64_t value, int width = 0, unsigned flags = 0, int precision = -1) {
+        return integer(value, 10, false, "", width, flags, precision);
+    }
+    
+    WriteLine& hex(uint64_t value, int width = 0, unsigned flags = 0, int precision = -1) {
+        return integer(value, 16, false, (flags & kFormatAlternate) && value ? "0x" : "", width, flags, precision);
+    }
+    
+    WriteLine& hexUpper(uint64_t value, int width = 0, unsigned flags = 0, int precision = -1) {
+        return integer(value, 16, true, (flags & kFormatAlternate) && value ? "0X" : "", width, flags, precision);
+    }
+    
+    WriteLine& oct(uint64_t value, int width = 0, unsigned flags = 0, int precision = -1) {
+        return integer(value, 8, false, "", width, flags, precision);
+    }
+    
+    WriteLine& real(const char* spec, double value) {
+        length_ += capl_format_double(buffer_ + length_, kCapacity + 1 - length_, spec, value);
+        return *this;
+    }
+    
+    void end() {
+        capl_write_line(buffer_, length_);
+    }
+
+private:
+    void append(const char* s, size_t n) {
+        if (n > kCapacity - length_) {
+            n = kCapacity - length_;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            buffer_[length_ + i] = s[i];
+        }
+        length_ += n;
+    }
+    
+    void fill(char c, int count) {
+        for (; count > 0 && length_ < kCapacity; --count) {
+            buffer_[length_++] = c;
+        }
+    }
+    
+    void padded(const char* s, size_t n, int width, unsigned flags) {
+        int padding = width - static_cast<int>(n);
+        if (!(flags & kFormatLeft)) {
+            fill(' ', padding);
+        }
+        append(s, n);
+        if (flags & kFormatLeft) {
+            fill(' ', padding);
+        }
+    }
+    
+    /**
+     * 按 printf 的规则输出整数：精度为最少数字位数，0 标志在未指定精度时以 0 填充宽度
+     */
+    WriteLine& integer(uint64_t value, unsigned base, bool upper, const char* prefix, int width, unsigned flags,
+                       int precision) {
+        const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+        char text[24];
+        int n = 0;
+        for (uint64_t rest = value; rest != 0; rest /= base) {
+            text[sizeof(text) - 1 - n++] = digits[rest % base];
+        }
+        int zeros = (precision < 0 ? 1 : precision) - n;
+        if (base == 8 && (flags & kFormatAlternate) && zeros <= 0 && (n == 0 || text[sizeof(text) - n] != '0')) {
+            zeros = 1;      // %#o 保证以 0 开头
+        }
+        zeros = zeros > 0 ? zeros : 0;
+        int prefix_length = 0;
+        while (prefix[prefix_length]) {
+            ++prefix_length;
+        }
+        int padding = width - prefix_length - zeros - n;
+        if ((flags & kFormatZero) && !(flags & kFormatLeft) && precision < 0) {
+            zeros += padding > 0 ? padding : 0;
+            padding = 0;
+        }
+        if (!(flags & kFormatLeft)) {
+            fill(' ', padding);
+        }
+        append(prefix, static_cast<size_t>(prefix_length));
+        fill('0', zeros);
+        append(text + sizeof(text) - n, static_cast<size_t>(n));
+        if (flags & kFormatLeft) {
+            fill(' ', padding);
+        }
+        return *this;
+    }
+    
+    char buffer_[kCapacity + 1];
+    size_t length_;
+};
+
+/**
+ * 信号的字节序：DBC 中的 @0 为 Motorola，@1 为 Intel
+ */
+enum SignalByteOrder { kMotorola = 0, kIntel = 1 };
+
+/**
+ * 信号的符号：DBC 中的 + 为无符号，- 为有符号
+ */
+enum SignalSign { kUnsigned = 0, kSigned = 1 };
+
+/**
+ * 报文的 8 字节数据按小端序 (Intel) 或大端序 (Motorola) 组成一个 64 位字，
+ * 编译器把逐字节的组合识别为一次加载（大端序再加一条字节交换），写回同理
+ */
+template <SignalByteOrder Order>
+inline uint64_t capl_load_data(const unsigned char* d) {
+    if (Order == kIntel) {
+        return static_cast<uint64_t>(d[0]) | static_cast<uint64_t>(d[1]) << 8 | static_cast<uint64_t>(d[2]) << 16 |
+               static_cast<uint64_t>(d[3]) << 24 | static_cast<uint64_t>(d[4]) << 32 |
+               static_cast<uint64_t>(d[5]) << 40 | static_cast<uint64_t>(d[6]) << 48 |
+               static_cast<uint64_t>(d[7]) << 56;
+    }
+    return static_cast<uint64_t>(d[7]) | static_cast<uint64_t>(d[6]) << 8 | static_cast<uint64_t>(d[5]) << 16 |
+           static_cast<uint64_t>(d[4]) << 24 | static_cast<uint64_t>(d[3]) << 32 |
+           static_cast<uint64_t>(d[2]) << 40 | static_cast<uint64_t>(d[1]) << 48 |
+           static_cast<uint64_t>(d[0]) << 56;
+}
+
+template <SignalByteOrder Order>
+inline void capl_store_data(unsigned char* d, uint64_t word) {
+    const int shift = Order == kIntel ? 0 : 56;     // d[0] 对应的移位
+    const int step = Order == kIntel ? 8 : -8;
+    d[0] = static_cast<unsigned char>(word >> shift);
+    d[1] = static_cast<unsigned char>(word >> (shift + step));
+    d[2] = static_cast<unsigned char>(word >> (shift + 2 * step));
+    d[3] = static_cast<unsigned char>(word >> (shift + 3 * step));
+    d[4] = static_cast<unsigned char>(word >> (shift + 4 * step));
+    d[5] = static_cast<unsigned char>(word >> (shift + 5 * step));
+    d[6] = static_cast<unsigned char>(word >> (shift + 6 * step));
+    d[7] = static_cast<unsigned char>(word >> (shift + 7 * step));
+}
+
+/**
+ * 编译期确定位置的信号访问器：在对应字节序的 64 位字中，信号是从 kShift 开始的连续 Length 位，
+ * 读写都只是一次加载、移位和掩码，没有描述符表和逐位循环。
+ * Intel 字节序的起始位为最低位；Motorola 字节序的起始位为最高位，
+ * 在大端序的字中位于 (7 - 字节) * 8 + 位，信号向低位延伸。
+ * factor 和 offset 是浮点数，C++17 不能作为模板参数，由生成代码在调用处以常量换算
+ * @tparam StartBit DBC 中的起始位
+ * @tparam Length 位长度 (1-64)
+ * @tparam Order 字节序
+ * @tparam Sign 符号
+ */
+template <unsigned StartBit, unsigned Length, SignalByteOrder Order, SignalSign Sign>
+struct Signal {
+    static_assert(Length >= 1 && Length <= 64, "信号长度应为 1-64 位");
+    static_assert(StartBit < 64, "信号起始位超出 8 字节的报文数据");
+    
+    // Intel 为信号最低位在字中的位置，Motorola 为信号最高位之上一位的位置
+    static constexpr unsigned kTop = Order == kIntel ? StartBit : (7 - StartBit / 8) * 8 + StartBit % 8 + 1;
+    static_assert(Order == kIntel ? kTop + Length <= 64 : kTop >= Length, "信号超出 8 字节的报文数据");
+    
+    static constexpr unsigned kShift = Order == kIntel ? kTop : kTop - Length;
+    static constexpr uint64_t kMask = Length == 64 ? ~0ULL : (1ULL << Length) - 1;
+    static constexpr uint64_t kSignBit = 1ULL << (Length - 1);
+    
+    /**
+     * 读取原始值，有符号信号做符号扩展
+     */
+    static int64_t get(const Message& msg) {
+        uint64_t raw = (capl_load_data<Order>(msg.data) >> kShift) & kMask;
+        if (Sign == kSigned) {
+            raw = (raw ^ kSignBit) - kSignBit;
+        }
+        return static_cast<int64_t>(raw);
+    }
+    
+    /**
+     * 写入原始值（截断为 Length 位），报文中的其他位不变
+     */
+    static void set(Message& msg, int64_t raw) {
+        uint64_t word = capl_load_data<Order>(msg.data);
+        word = (word & ~(kMask << kShift)) | ((static_cast<uint64_t>(raw) & kMask) << kShift);
+        capl_store_data<Order>(msg.data, word);
+    }
+};
+
+/**
+ * 物理值换算回原始值时四舍五入
+ */
+inline int64_t capl_signal_round(double value) {
+    return static_cast<int64_t>(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+} // namespace capl_runtime
+#endif
+
+#endif /* CAPL_RT_H */
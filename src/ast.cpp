@@ -21,6 +21,22 @@ ASTNode* ASTNode::getChild(size_t index) const {
     return nullptr;
 }
 
+std::unique_ptr<ASTNode> ASTNode::replaceChild(size_t index, std::unique_ptr<ASTNode> child) {
+    std::unique_ptr<ASTNode> old = std::move(children_.at(index));
+    children_[index] = std::move(child);
+    return old;
+}
+
+std::unique_ptr<ASTNode> ASTNode::removeChild(size_t index) {
+    std::unique_ptr<ASTNode> old = std::move(children_.at(index));
+    children_.erase(children_.begin() + static_cast<std::ptrdiff_t>(index));
+    return old;
+}
+
+void ASTNode::insertChild(size_t index, std::unique_ptr<ASTNode> child) {
+    children_.insert(children_.begin() + static_cast<std::ptrdiff_t>(index), std::move(child));
+}
+
 std::string ASTNode::toString(int indent) const {
     std::string result;
     for (int i = 0; i < indent; ++i) {
@@ -46,6 +62,12 @@ std::string ProgramNode::toString(int indent) const {
     }
     result += "Program\n";
     
+    for (const auto& database : databases_) {
+        for (int i = 0; i <= indent; ++i) {
+            result += "  ";
+        }
+        result += "Candb: " + database + "\n";
+    }
     for (const auto& child : children_) {
         result += child->toString(indent + 1);
     }
@@ -65,6 +87,10 @@ std::string FunctionNode::toString(int indent) const {
     }
     result += "Function: " + return_type_ + " " + name_ + "\n";
     
+    for (const auto& param : parameters_) {
+        result += param->toString(indent + 1);
+    }
+    
     for (const auto& child : children_) {
         result += child->toString(indent + 1);
     }
@@ -72,6 +98,10 @@ std::string FunctionNode::toString(int indent) const {
     return result;
 }
 
+void FunctionNode::addParameter(std::unique_ptr<ASTNode> param) {
+    parameters_.push_back(std::move(param));
+}
+
 // VariableDeclNode 实现
 VariableDeclNode::VariableDeclNode(const std::string& name, const std::string& type)
     : ASTNode(ASTNodeType::VARIABLE_DECL), name_(name), var_type_(type) {
@@ -82,7 +112,15 @@ std::string VariableDeclNode::toString(int indent) const {
     for (int i = 0; i < indent; ++i) {
         result += "  ";
     }
-    result += "VariableDecl: " + var_type_ + " " + name_ + "\n";
+    result += "VariableDecl: " + var_type_ + " ";
+    if (!message_ref_.empty()) {
+        result += message_ref_ + " ";
+    }
+    result += name_;
+    if (array_size_ > 0) {
+        result += "[" + std::to_string(array_size_) + "]";
+    }
+    result += "\n";
     
     for (const auto& child : children_) {
         result += child->toString(indent + 1);
@@ -111,8 +149,8 @@ std::string BinaryExprNode::toString(int indent) const {
 }
 
 // UnaryExprNode 实现
-UnaryExprNode::UnaryExprNode(const std::string& op)
-    : ASTNode(ASTNodeType::UNARY_EXPR), operator_(op) {
+UnaryExprNode::UnaryExprNode(const std::string& op, bool postfix)
+    : ASTNode(ASTNodeType::UNARY_EXPR), operator_(op), postfix_(postfix) {
 }
 
 std::string UnaryExprNode::toString(int indent) const {
@@ -120,7 +158,45 @@ std::string UnaryExprNode::toString(int indent) const {
     for (int i = 0; i < indent; ++i) {
         result += "  ";
     }
-    result += "UnaryExpr: " + operator_ + "\n";
+    result += "UnaryExpr: " + operator_ + (postfix_ ? " (postfix)" : "") + "\n";
+    
+    for (const auto& child : children_) {
+        result += child->toString(indent + 1);
+    }
+    
+    return result;
+}
+
+// AssignmentExprNode 实现
+AssignmentExprNode::AssignmentExprNode(const std::string& op)
+    : ASTNode(ASTNodeType::ASSIGNMENT_EXPR), operator_(op) {
+}
+
+std::string AssignmentExprNode::toString(int indent) const {
+    std::string result;
+    for (int i = 0; i < indent; ++i) {
+        result += "  ";
+    }
+    result += "AssignmentExpr: " + operator_ + "\n";
+    
+    for (const auto& child : children_) {
+        result += child->toString(indent + 1);
+    }
+    
+    return result;
+}
+
+// MemberExprNode 实现
+MemberExprNode::MemberExprNode(const std::string& member, bool is_call)
+    : ASTNode(ASTNodeType::MEMBER_EXPR), member_(member), is_call_(is_call) {
+}
+
+std::string MemberExprNode::toString(int indent) const {
+    std::string result;
+    for (int i = 0; i < indent; ++i) {
+        result += "  ";
+    }
+    result += "MemberExpr: " + member_ + (is_call_ ? "()" : "") + "\n";
     
     for (const auto& child : children_) {
         result += child->toString(indent + 1);
@@ -232,6 +308,41 @@ std::string OnEventNode::toString(int indent) const {
     return result;
 }
 
+std::string OnEventNode::getDisplayName() const {
+    switch (type_) {
+        case ASTNodeType::ON_MESSAGE:
+            return "on message " + event_name_;
+        case ASTNodeType::ON_TIMER:
+            return "on timer " + event_name_;
+        case ASTNodeType::ON_KEY:
+            return "on key '" + event_name_ + "'";
+        case ASTNodeType::ON_START:
+            return "on start";
+        case ASTNodeType::ON_STOP:
+            return "on stop";
+        default:
+            return "on " + event_name_;
+    }
+}
+
+// SignalAccessNode 实现
+SignalAccessNode::SignalAccessNode(const std::string& name)
+    : ASTNode(ASTNodeType::SIGNAL_ACCESS), name_(name) {
+}
+
+std::string SignalAccessNode::toString(int indent) const {
+    std::string result;
+    for (int i = 0; i < indent; ++i) {
+        result += "  ";
+    }
+    result += "SignalAccess: $" + name_ + "\n";
+    return result;
+}
+
+// IfStmtNode 实现
+IfStmtNode::IfStmtNode() : ASTNode(ASTNodeType::IF_STMT) {
+}
+
 // CallExprNode 实现
 CallExprNode::CallExprNode(const std::string& function_name)
     : ASTNode(ASTNodeType::CALL_EXPR), function_name_(function_name) {
@@ -251,4 +362,167 @@ std::string CallExprNode::toString(int indent) const {
     return result;
 }
 
+std::string getRootVariable(const ASTNode* node) {
+    while (node) {
+        switch (node->getType()) {
+            case ASTNodeType::IDENTIFIER:
+                return static_cast<const IdentifierNode*>(node)->getName();
+            case ASTNodeType::INDEX_EXPR:
+            case ASTNodeType::MEMBER_EXPR:
+                node = node->getChild(0);
+                break;
+            default:
+                return "";
+        }
+    }
+    return "";
+}
+
+bool isIncrementExpr(const ASTNode* node) {
+    if (!node || node->getType() != ASTNodeType::UNARY_EXPR) {
+        return false;
+    }
+    const std::string& op = static_cast<const UnaryExprNode*>(node)->getOperator();
+    return op == "++" || op == "--";
+}
+
+bool hasSideEffects(const ASTNode* node) {
+    if (!node) {
+        return false;
+    }
+    if (node->getType() == ASTNodeType::CALL_EXPR || node->getType() == ASTNodeType::ASSIGNMENT_EXPR ||
+        isIncrementExpr(node)) {
+        return true;
+    }
+    for (const auto& child : node->getChildren()) {
+        if (hasSideEffects(child.get())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isStatementList(const ASTNode* node) {
+    switch (node->getType()) {
+        case ASTNodeType::BLOCK_STMT:
+        case ASTNodeType::FUNCTION:
+        case ASTNodeType::ON_START:
+        case ASTNodeType::ON_STOP:
+        case ASTNodeType::ON_MESSAGE:
+        case ASTNodeType::ON_TIMER:
+        case ASTNodeType::ON_KEY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::unique_ptr<ASTNode> cloneTree(const ASTNode* node) {
+    if (!node) {
+        return nullptr;
+    }
+    
+    std::unique_ptr<ASTNode> copy;
+    switch (node->getType()) {
+        case ASTNodeType::PROGRAM: {
+            auto program_copy = std::make_unique<ProgramNode>();
+            for (const auto& database : static_cast<const ProgramNode*>(node)->getDatabases()) {
+                program_copy->addDatabase(database);
+            }
+            copy = std::move(program_copy);
+            break;
+        }
+        case ASTNodeType::FUNCTION: {
+            const FunctionNode* func = static_cast<const FunctionNode*>(node);
+            auto func_copy = std::make_unique<FunctionNode>(func->getName(), func->getReturnType());
+            for (const auto& param : func->getParameters()) {
+                func_copy->addParameter(cloneTree(param.get()));
+            }
+            copy = std::move(func_copy);
+            break;
+        }
+        case ASTNodeType::VARIABLE_DECL: {
+            const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+            auto decl_copy = std::make_unique<VariableDeclNode>(decl->getName(), decl->getVarType());
+            decl_copy->setArraySize(decl->getArraySize());
+            decl_copy->setMessageRef(decl->getMessageRef());
+            if (decl->hasMessageId()) {
+                decl_copy->setMessageId(decl->getMessageId(), decl->getMessageDlc());
+            }
+            copy = std::move(decl_copy);
+            break;
+        }
+        case ASTNodeType::BINARY_EXPR:
+            copy = std::make_unique<BinaryExprNode>(static_cast<const BinaryExprNode*>(node)->getOperator());
+            break;
+        case ASTNodeType::UNARY_EXPR: {
+            const UnaryExprNode* unary = static_cast<const UnaryExprNode*>(node);
+            copy = std::make_unique<UnaryExprNode>(unary->getOperator(), unary->isPostfix());
+            break;
+        }
+        case ASTNodeType::ASSIGNMENT_EXPR:
+            copy = std::make_unique<AssignmentExprNode>(static_cast<const AssignmentExprNode*>(node)->getOperator());
+            break;
+        case ASTNodeType::CALL_EXPR:
+            copy = std::make_unique<CallExprNode>(static_cast<const CallExprNode*>(node)->getFunctionName());
+            break;
+        case ASTNodeType::MEMBER_EXPR: {
+            const MemberExprNode* member = static_cast<const MemberExprNode*>(node);
+            auto member_copy = std::make_unique<MemberExprNode>(member->getMember(), member->isCall());
+            if (member->getSignal()) {
+                member_copy->setSignal(*member->getSignal());
+            }
+            copy = std::move(member_copy);
+            break;
+        }
+        case ASTNodeType::INTEGER_LITERAL:
+        case ASTNodeType::FLOAT_LITERAL:
+        case ASTNodeType::STRING_LITERAL:
+        case ASTNodeType::CHAR_LITERAL:
+        case ASTNodeType::BOOLEAN_LITERAL:
+            copy = std::make_unique<LiteralNode>(node->getType(), static_cast<const LiteralNode*>(node)->getValue());
+            break;
+        case ASTNodeType::IDENTIFIER:
+            copy = std::make_unique<IdentifierNode>(static_cast<const IdentifierNode*>(node)->getName());
+            break;
+        case ASTNodeType::IF_STMT: {
+            auto if_copy = std::make_unique<IfStmtNode>();
+            if_copy->setBranchName(static_cast<const IfStmtNode*>(node)->getBranchName());
+            copy = std::move(if_copy);
+            break;
+        }
+        case ASTNodeType::ON_MESSAGE:
+        case ASTNodeType::ON_TIMER:
+        case ASTNodeType::ON_KEY:
+        case ASTNodeType::ON_START:
+        case ASTNodeType::ON_STOP: {
+            const OnEventNode* event = static_cast<const OnEventNode*>(node);
+            auto event_copy = std::make_unique<OnEventNode>(node->getType(), event->getEventName());
+            if (event->hasMessageId()) {
+                event_copy->setMessageId(event->getMessageId());
+            }
+            copy = std::move(event_copy);
+            break;
+        }
+        case ASTNodeType::SIGNAL_ACCESS: {
+            const SignalAccessNode* signal = static_cast<const SignalAccessNode*>(node);
+            auto signal_copy = std::make_unique<SignalAccessNode>(signal->getName());
+            if (signal->isResolved()) {
+                signal_copy->setInfo(signal->getInfo());
+            }
+            copy = std::move(signal_copy);
+            break;
+        }
+        default:
+            copy = std::make_unique<ASTNode>(node->getType());
+            break;
+    }
+    
+    copy->setLine(node->getLine());
+    for (const auto& child : node->getChildren()) {
+        copy->addChild(cloneTree(child.get()));
+    }
+    return copy;
+}
+
 } // namespace capl
\ No newline at end of file
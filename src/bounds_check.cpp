@@ -0,0 +1,508 @@
+/**
+ * CAPL 数组下标范围分析实现
+ */
+
+#include "../include/bounds_check.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include <algorithm>
+#include <set>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 区间端点的绝对值上限，超出时视为未知，避免运算溢出
+ */
+constexpr long long kRangeLimit = 1LL << 40;
+
+/**
+ * 与 int 常量按有符号语义比较的整数类型（dword/qword 与负常量比较时按无符号转换，不分析）
+ */
+bool isIntegerType(const std::string& type) {
+    static const std::set<std::string> types = {
+        "int", "long", "char", "byte", "word", "int64"
+    };
+    return types.count(type) > 0;
+}
+
+bool isIdentifier(const ASTNode* node, const std::string& name) {
+    return node && node->getType() == ASTNodeType::IDENTIFIER &&
+           static_cast<const IdentifierNode*>(node)->getName() == name;
+}
+
+bool constantInt(const ASTNode* node, long long& value) {
+    ConstantValue constant;
+    if (!node || !evaluateConstant(node, constant) || constant.is_float) {
+        return false;
+    }
+    value = constant.int_value;
+    return true;
+}
+
+IndexRange bounded(long long lo, long long hi) {
+    if (lo < -kRangeLimit || hi > kRangeLimit) {
+        return IndexRange();
+    }
+    return IndexRange::make(lo, hi);
+}
+
+/**
+ * 子树中是否写入或重新声明了变量
+ */
+bool writesVariable(const ASTNode* node, const std::string& name) {
+    if (!node) {
+        return false;
+    }
+    if (node->getType() == ASTNodeType::VARIABLE_DECL &&
+        static_cast<const VariableDeclNode*>(node)->getName() == name) {
+        return true;
+    }
+    if ((node->getType() == ASTNodeType::ASSIGNMENT_EXPR || isIncrementExpr(node)) &&
+        getRootVariable(node->getChild(0)) == name) {
+        return true;
+    }
+    for (const auto& child : node->getChildren()) {
+        if (writesVariable(child.get(), name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 循环变量的步长：i++、++i、i += c 为正，i--、--i、i -= c 为负
+ * @return 步长，不是对 var 的常量步长更新时返回 0
+ */
+long long loopStep(const ASTNode* update, const std::string& var) {
+    if (!isIdentifier(update->getChild(0), var)) {
+        return 0;
+    }
+    if (isIncrementExpr(update)) {
+        return static_cast<const UnaryExprNode*>(update)->getOperator() == "++" ? 1 : -1;
+    }
+    long long step = 0;
+    if (update->getType() != ASTNodeType::ASSIGNMENT_EXPR || !constantInt(update->getChild(1), step) || step <= 0) {
+        return 0;
+    }
+    const std::string& op = static_cast<const AssignmentExprNode*>(update)->getOperator();
+    return op == "+=" ? step : op == "-=" ? -step : 0;
+}
+
+/**
+ * 交换比较运算符两侧后的运算符 (C < x 即 x > C)
+ */
+std::string mirrorCompare(const std::string& op) {
+    if (op == "<") return ">";
+    if (op == ">") return "<";
+    if (op == "<=") return ">=";
+    if (op == ">=") return "<=";
+    return op;
+}
+
+} // namespace
+
+IndexRange IndexRange::make(long long lo, long long hi) {
+    IndexRange range;
+    range.known = true;
+    range.lo = lo;
+    range.hi = hi;
+    return range;
+}
+
+/**
+ * 构造函数
+ */
+BoundsCheckAnalysis::BoundsCheckAnalysis() {
+}
+
+/**
+ * 分析程序中的数组下标访问
+ * @param program AST 根节点
+ */
+void BoundsCheckAnalysis::analyze(const ASTNode* program) {
+    clear();
+    if (!program) {
+        return;
+    }
+    
+    scopes_.emplace_back();
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                declare(var.get());
+            }
+        }
+    }
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            analyzeUnit(child.get(), static_cast<const FunctionNode*>(child.get())->getName());
+        } else if (child->getType() != ASTNodeType::BLOCK_STMT && isStatementList(child.get())) {
+            analyzeUnit(child.get(), static_cast<const OnEventNode*>(child.get())->getDisplayName());
+        }
+    }
+    scopes_.clear();
+}
+
+/**
+ * 清空分析结果
+ */
+void BoundsCheckAnalysis::clear() {
+    scopes_.clear();
+    unit_.clear();
+    checks_.clear();
+    index_.clear();
+}
+
+/**
+ * 查找下标表达式对应的访问
+ * @param index_expr INDEX_EXPR 节点
+ * @return 访问信息，数组长度未知时返回 nullptr
+ */
+const IndexCheck* BoundsCheckAnalysis::findCheck(const ASTNode* index_expr) const {
+    auto it = index_.find(index_expr);
+    return it != index_.end() ? &checks_[it->second] : nullptr;
+}
+
+/**
+ * 获取证明安全的访问数量
+ * @return 访问数量
+ */
+int BoundsCheckAnalysis::getProvenCount() const {
+    int count = 0;
+    for (const auto& check : checks_) {
+        count += check.proven ? 1 : 0;
+    }
+    return count;
+}
+
+void BoundsCheckAnalysis::analyzeUnit(const ASTNode* unit, const std::string& unit_name) {
+    unit_ = unit_name;
+    scopes_.emplace_back();
+    if (unit->getType() == ASTNodeType::FUNCTION) {
+        for (const auto& param : static_cast<const FunctionNode*>(unit)->getParameters()) {
+            declare(param.get());
+        }
+    }
+    visitChildren(unit);
+    scopes_.pop_back();
+}
+
+void BoundsCheckAnalysis::visit(const ASTNode* node) {
+    if (!node) {
+        return;
+    }
+    switch (node->getType()) {
+        case ASTNodeType::VARIABLE_DECL:
+            visitChildren(node);
+            declare(node);
+            break;
+        case ASTNodeType::BLOCK_STMT:
+            scopes_.emplace_back();
+            visitChildren(node);
+            scopes_.pop_back();
+            break;
+        case ASTNodeType::FOR_STMT:
+            visitFor(node);
+            break;
+        case ASTNodeType::IF_STMT:
+            visitIf(node);
+            break;
+        case ASTNodeType::INDEX_EXPR:
+            visitChildren(node);
+            recordIndex(node);
+            break;
+        default:
+            visitChildren(node);
+            break;
+    }
+}
+
+void BoundsCheckAnalysis::visitChildren(const ASTNode* node) {
+    for (const auto& child : node->getChildren()) {
+        visit(child.get());
+    }
+}
+
+/**
+ * 计数循环的循环体内，循环变量的取值区间由初值和终值确定
+ */
+void BoundsCheckAnalysis::visitFor(const ASTNode* node) {
+    scopes_.emplace_back();
+    visit(node->getChild(0));
+    visit(node->getChild(1));
+    visit(node->getChild(2));
+    
+    std::string var;
+    IndexRange range;
+    if (matchCountedLoop(node, var, range)) {
+        Binding binding = *lookup(var);
+        binding.range = range;
+        scopes_.back()[var] = binding;
+    }
+    visit(node->getChild(3));
+    scopes_.pop_back();
+}
+
+/**
+ * then 分支内，条件限定了未被该分支修改的局部整数变量的取值区间
+ */
+void BoundsCheckAnalysis::visitIf(const ASTNode* node) {
+    const ASTNode* then_branch = node->getChild(1);
+    visit(node->getChild(0));
+    
+    std::map<std::string, Bound> guards;
+    collectGuards(node->getChild(0), guards);
+    scopes_.emplace_back();
+    for (const auto& guard : guards) {
+        const Binding* outer = lookup(guard.first);
+        if (!outer || writesVariable(then_branch, guard.first)) {
+            continue;
+        }
+        Bound bound = guard.second;
+        if (outer->range.known) {
+            bound.lo = bound.has_lo ? std::max(bound.lo, outer->range.lo) : outer->range.lo;
+            bound.hi = bound.has_hi ? std::min(bound.hi, outer->range.hi) : outer->range.hi;
+            bound.has_lo = bound.has_hi = true;
+        }
+        if (bound.has_lo && bound.has_hi) {
+            Binding binding = *outer;
+            binding.range = bounded(bound.lo, bound.hi);
+            scopes_.back()[guard.first] = binding;
+        }
+    }
+    visit(then_branch);
+    scopes_.pop_back();
+    
+    if (node->getChildCount() > 2) {
+        visit(node->getChild(2));
+    }
+}
+
+void BoundsCheckAnalysis::declare(const ASTNode* decl) {
+    const VariableDeclNode* var = static_cast<const VariableDeclNode*>(decl);
+    Binding binding;
+    binding.array_size = var->getArraySize();
+    binding.integer = binding.array_size == 0 && isIntegerType(var->getVarType());
+    scopes_.back()[var->getName()] = binding;
+}
+
+void BoundsCheckAnalysis::recordIndex(const ASTNode* node) {
+    const ASTNode* base = node->getChild(0);
+    if (!base || base->getType() != ASTNodeType::IDENTIFIER) {
+        return;
+    }
+    const std::string& name = static_cast<const IdentifierNode*>(base)->getName();
+    const Binding* binding = lookup(name);
+    if (!binding || binding->array_size <= 0) {
+        return;
+    }
+    
+    IndexCheck check;
+    check.node = node;
+    check.array = name;
+    check.size = binding->array_size;
+    check.unit = unit_;
+    check.range = rangeOf(node->getChild(1));
+    check.proven = check.range.isEmpty() ||
+                   (check.range.known && check.range.lo >= 0 && check.range.hi < check.size);
+    index_[node] = checks_.size();
+    checks_.push_back(check);
+}
+
+const BoundsCheckAnalysis::Binding* BoundsCheckAnalysis::lookup(const std::string& name) const {
+    for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) {
+            return &found->second;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * 是否为局部变量（全局变量可能被调用的函数修改，不跟踪取值区间）
+ */
+bool BoundsCheckAnalysis::isLocal(const std::string& name) const {
+    for (size_t i = scopes_.size(); i-- > 1;) {
+        if (scopes_[i].count(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 求下标表达式的取值区间
+ * @param expr 表达式节点
+ * @return 取值区间，无法确定时 known 为 false
+ */
+IndexRange BoundsCheckAnalysis::rangeOf(const ASTNode* expr) const {
+    if (!expr) {
+        return IndexRange();
+    }
+    long long value = 0;
+    if (constantInt(expr, value)) {
+        return bounded(value, value);
+    }
+    
+    switch (expr->getType()) {
+        case ASTNodeType::IDENTIFIER: {
+            const Binding* binding = lookup(static_cast<const IdentifierNode*>(expr)->getName());
+            return binding && binding->integer ? binding->range : IndexRange();
+        }
+        case ASTNodeType::UNARY_EXPR: {
+            IndexRange operand = rangeOf(expr->getChild(0));
+            const std::string& op = static_cast<const UnaryExprNode*>(expr)->getOperator();
+            if (operand.known && op == "-") {
+                return bounded(-operand.hi, -operand.lo);
+            }
+            if (operand.known && op == "+") {
+                return operand;
+            }
+            return IndexRange();
+        }
+        case ASTNodeType::BINARY_EXPR: {
+            const std::string& op = static_cast<const BinaryExprNode*>(expr)->getOperator();
+            IndexRange lhs = rangeOf(expr->getChild(0));
+            IndexRange rhs = rangeOf(expr->getChild(1));
+            long long mask = 0;
+            // x % N 和 x & M 的结果与 x 的范围无关，只要 x 非负
+            if (op == "%" && lhs.known && lhs.lo >= 0 && constantInt(expr->getChild(1), mask) && mask > 0) {
+                return IndexRange::make(0, std::min(lhs.hi, mask - 1));
+            }
+            if (op == "&" && constantInt(expr->getChild(1), mask) && mask >= 0) {
+                return IndexRange::make(0, mask);
+            }
+            if (op == "&" && constantInt(expr->getChild(0), mask) && mask >= 0) {
+                return IndexRange::make(0, mask);
+            }
+            if (!lhs.known || !rhs.known) {
+                return IndexRange();
+            }
+            if (op == "+") {
+                return bounded(lhs.lo + rhs.lo, lhs.hi + rhs.hi);
+            }
+            if (op == "-") {
+                return bounded(lhs.lo - rhs.hi, lhs.hi - rhs.lo);
+            }
+            if (op == "*") {
+                long long products[] = {lhs.lo * rhs.lo, lhs.lo * rhs.hi, lhs.hi * rhs.lo, lhs.hi * rhs.hi};
+                return bounded(*std::min_element(products, products + 4), *std::max_element(products, products + 4));
+            }
+            return IndexRange();
+        }
+        default:
+            return IndexRange();
+    }
+}
+
+/**
+ * 匹配计数循环 for (i = A; i < B; i += c) 或 for (i = A; i >= B; i -= c)，
+ * A、B 为常量，i 为局部整数变量且循环体不修改 i
+ * @param for_node FOR_STMT 节点
+ * @param var 循环变量
+ * @param range 循环体内循环变量的取值区间
+ * @return 是否匹配
+ */
+bool BoundsCheckAnalysis::matchCountedLoop(const ASTNode* for_node, std::string& var, IndexRange& range) const {
+    const ASTNode* init = for_node->getChild(0);
+    long long begin = 0;
+    if (init->getType() == ASTNodeType::VARIABLE_DECL) {
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(init);
+        var = decl->getName();
+        if (!constantInt(decl->getInitializer(), begin)) {
+            return false;
+        }
+    } else {
+        const ASTNode* assign = init->getChild(0);
+        if (!assign || assign->getType() != ASTNodeType::ASSIGNMENT_EXPR ||
+            static_cast<const AssignmentExprNode*>(assign)->getOperator() != "=" ||
+            assign->getChild(0)->getType() != ASTNodeType::IDENTIFIER ||
+            !constantInt(assign->getChild(1), begin)) {
+            return false;
+        }
+        var = static_cast<const IdentifierNode*>(assign->getChild(0))->getName();
+    }
+    const Binding* binding = lookup(var);
+    if (!binding || !binding->integer || !isLocal(var)) {
+        return false;
+    }
+    
+    const ASTNode* cond = for_node->getChild(1);
+    long long end = 0;
+    if (cond->getType() != ASTNodeType::BINARY_EXPR || !isIdentifier(cond->getChild(0), var) ||
+        !constantInt(cond->getChild(1), end)) {
+        return false;
+    }
+    const std::string& cmp = static_cast<const BinaryExprNode*>(cond)->getOperator();
+    long long step = loopStep(for_node->getChild(2), var);
+    if (step > 0 && (cmp == "<" || cmp == "<=")) {
+        range = bounded(begin, cmp == "<" ? end - 1 : end);
+    } else if (step < 0 && (cmp == ">" || cmp == ">=")) {
+        range = bounded(cmp == ">" ? end + 1 : end, begin);
+    } else {
+        return false;
+    }
+    return range.known && !writesVariable(for_node->getChild(3), var);
+}
+
+/**
+ * 收集 && 连接的条件中 x < C、x >= C、C > x 等形式对局部整数变量的限定
+ * @param cond 条件表达式
+ * @param guards 变量名到边界的映射
+ */
+void BoundsCheckAnalysis::collectGuards(const ASTNode* cond, std::map<std::string, Bound>& guards) const {
+    if (!cond || cond->getType() != ASTNodeType::BINARY_EXPR) {
+        return;
+    }
+    std::string op = static_cast<const BinaryExprNode*>(cond)->getOperator();
+    if (op == "&&") {
+        collectGuards(cond->getChild(0), guards);
+        collectGuards(cond->getChild(1), guards);
+        return;
+    }
+    
+    const ASTNode* var_node = cond->getChild(0);
+    long long value = 0;
+    if (!constantInt(cond->getChild(1), value)) {
+        var_node = cond->getChild(1);
+        op = mirrorCompare(op);
+        if (!constantInt(cond->getChild(0), value)) {
+            return;
+        }
+    }
+    if (!var_node || var_node->getType() != ASTNodeType::IDENTIFIER) {
+        return;
+    }
+    const std::string& name = static_cast<const IdentifierNode*>(var_node)->getName();
+    const Binding* binding = lookup(name);
+    if (!binding || !binding->integer || !isLocal(name)) {
+        return;
+    }
+    
+    Bound& bound = guards[name];
+    auto lower = [&](long long lo) {
+        bound.lo = bound.has_lo ? std::max(bound.lo, lo) : lo;
+        bound.has_lo = true;
+    };
+    auto upper = [&](long long hi) {
+        bound.hi = bound.has_hi ? std::min(bound.hi, hi) : hi;
+        bound.has_hi = true;
+    };
+    if (op == "<") {
+        upper(value - 1);
+    } else if (op == "<=") {
+        upper(value);
+    } else if (op == ">") {
+        lower(value + 1);
+    } else if (op == ">=") {
+        lower(value);
+    } else if (op == "==") {
+        lower(value);
+        upper(value);
+    }
+}
+
+} // namespace capl
@@ -0,0 +1,983 @@
+/**
+ * CAN 数据库 (DBC) 加载实现
+ */
+
+#include "../include/can_database.h"
+#include "../include/ast.h"
+#include "../include/message_dispatch.h"
+#include "../include/output_buffer.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 只读映射的文件
+ */
+class MappedFile {
+public:
+    MappedFile() : data_(nullptr), size_(0) {}
+    
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    /**
+     * 映射文件
+     * @param path 文件路径
+     * @param error 失败原因
+     * @return 是否成功
+     */
+    bool open(const std::string& path, std::string& error) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            error = "不是普通文件";
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ > 0) {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                error = std::strerror(errno);
+                ::close(fd);
+                return false;
+            }
+            // 文本从头到尾扫描一遍
+            ::madvise(data, size_, MADV_SEQUENTIAL);
+            data_ = data;
+        }
+        ::close(fd);
+        return true;
+    }
+    
+    const char* data() const { return static_cast<const char*>(data_); }
+    size_t size() const { return size_; }
+
+private:
+    void* data_;        // 映射的地址，空文件为 nullptr
+    size_t size_;       // 文件长度
+};
+
+/**
+ * 索引缓存的文件头，后面依次为报文表、信号表、报文名索引、信号名索引和名称字符串池
+ */
+struct CacheHeader {
+    char magic[8];              // "CAPLDBC\0"
+    uint32_t version;           // kCacheVersion
+    uint32_t record_sizes;      // sizeof(DbcMessage) << 16 | sizeof(DbcSignal)，布局不同时不使用缓存
+    uint64_t source_hash;       // DBC 内容的散列
+    uint64_t source_size;       // DBC 的长度
+    uint32_t message_count;
+    uint32_t signal_count;
+    uint32_t names_size;
+    uint32_t reserved;
+};
+
+const char kCacheMagic[8] = {'C', 'A', 'P', 'L', 'D', 'B', 'C', '\0'};
+
+constexpr uint32_t kRecordSizes = static_cast<uint32_t>(sizeof(DbcMessage) << 16 | sizeof(DbcSignal));
+
+/**
+ * DBC 中独立信号的伪报文 VECTOR__INDEPENDENT_SIG_MSG 的 ID，不是真实报文
+ */
+constexpr unsigned long long kIndependentSignalsId = 0xC0000000ULL;
+
+/**
+ * DBC 中扩展帧 ID 的标志位
+ */
+constexpr unsigned long long kExtendedFlag = 0x80000000ULL;
+
+/**
+ * DBC 文本扫描器：在映射的内存上逐字符前进，记录行号
+ */
+class DbcScanner {
+public:
+    DbcScanner(const char* data, size_t size) : p_(data), end_(data + size), line_(1) {
+        // 跳过 UTF-8 BOM
+        if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+            p_ += 3;
+        }
+    }
+    
+    bool atEnd() const { return p_ >= end_; }
+    int line() const { return line_; }
+    
+    /**
+     * 跳过行内空白
+     */
+    void skipSpaces() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r')) {
+            ++p_;
+        }
+    }
+    
+    /**
+     * 跳过空白和空行
+     */
+    void skipBlank() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n')) {
+            line_ += *p_ == '\n' ? 1 : 0;
+            ++p_;
+        }
+    }
+    
+    /**
+     * 跳到下一行：引号中的换行（多行注释）不结束当前记录
+     */
+    void skipRecord() {
+        bool quoted = false;
+        while (p_ < end_) {
+            char c = *p_++;
+            if (c == '\n') {
+                ++line_;
+                if (!quoted) {
+                    return;
+                }
+            } else if (c == '"') {
+                quoted = !quoted;
+            } else if (c == '\\' && quoted && p_ < end_ && *p_ != '\n') {
+                ++p_;
+            }
+        }
+    }
+    
+    /**
+     * 当前位置是否为指定关键字（后跟空白），是则跳过
+     */
+    bool keyword(const char* word) {
+        size_t length = std::strlen(word);
+        if (static_cast<size_t>(end_ - p_) <= length || std::memcmp(p_, word, length) != 0 ||
+            (p_[length] != ' ' && p_[length] != '\t')) {
+            return false;
+        }
+        p_ += length;
+        return true;
+    }
+    
+    /**
+     * 读取标识符
+     * @param begin 输出标识符的起始位置
+     * @param length 输出标识符的长度
+     */
+    bool identifier(const char*& begin, size_t& length) {
+        skipSpaces();
+        if (p_ >= end_ || !(std::isalpha(static_cast<unsigned char>(*p_)) || *p_ == '_')) {
+            return false;
+        }
+        begin = p_;
+        while (p_ < end_ && (std::isalnum(static_cast<unsigned char>(*p_)) || *p_ == '_')) {
+            ++p_;
+        }
+        length = static_cast<size_t>(p_ - begin);
+        return true;
+    }
+    
+    /**
+     * 读取无符号十进制整数
+     */
+    bool unsignedNumber(unsigned long long& value) {
+        skipSpaces();
+        if (p_ >= end_ || !std::isdigit(static_cast<unsigned char>(*p_))) {
+            return false;
+        }
+        value = 0;
+        while (p_ < end_ && std::isdigit(static_cast<unsigned char>(*p_))) {
+            if (value > (~0ULL - 9) / 10) {
+                return false;
+            }
+            value = value * 10 + static_cast<unsigned>(*p_ - '0');
+            ++p_;
+        }
+        return true;
+    }
+    
+    /**
+     * 读取浮点数（如 -40、0.25、1E-005）
+     */
+    bool number(double& value) {
+        skipSpaces();
+        char buffer[64];
+        size_t length = 0;
+        while (p_ < end_ && length + 1 < sizeof(buffer) &&
+               (std::isdigit(static_cast<unsigned char>(*p_)) || *p_ == '+' || *p_ == '-' || *p_ == '.' ||
+                *p_ == 'e' || *p_ == 'E')) {
+            buffer[length++] = *p_++;
+        }
+        buffer[length] = '\0';
+        char* parsed = nullptr;
+        value = std::strtod(buffer, &parsed);
+        return length > 0 && parsed == buffer + length;
+    }
+    
+    /**
+     * 跳过空白后期望指定字符
+     */
+    bool expect(char c) {
+        skipSpaces();
+        if (p_ >= end_ || *p_ != c) {
+            return false;
+        }
+        ++p_;
+        return true;
+    }
+    
+    /**
+     * 当前字符（已到末尾时为 0）
+     */
+    char peek() {
+        skipSpaces();
+        return p_ < end_ ? *p_ : '\0';
+    }
+
+private:
+    const char* p_;         // 当前位置
+    const char* end_;       // 文本末尾
+    int line_;              // 当前行号
+};
+
+} // namespace
+
+/**
+ * 构造函数
+ */
+CanDatabase::CanDatabase() : from_cache_(false) {
+}
+
+/**
+ * 清空数据库
+ */
+void CanDatabase::clear() {
+    messages_.clear();
+    signals_.clear();
+    message_index_.clear();
+    signal_index_.clear();
+    names_.clear();
+    from_cache_ = false;
+    cache_error_.clear();
+}
+
+/**
+ * 加载 DBC 文件：索引缓存与文件内容一致时从缓存加载，否则解析文件并重写缓存
+ * @param path DBC 文件路径
+ * @param cache_path 索引缓存路径，空表示不使用缓存
+ * @param error 失败原因
+ * @return 是否成功
+ */
+bool CanDatabase::load(const std::string& path, const std::string& cache_path, std::string& error) {
+    clear();
+    path_ = path;
+    cache_path_ = cache_path;
+    
+    MappedFile source;
+    std::string reason;
+    if (!source.open(path, reason)) {
+        error = "无法打开 CAN 数据库: " + path + " (" + reason + ")";
+        return false;
+    }
+    uint64_t hash = hashContent(source.data(), source.size());
+    
+    // 缓存的散列和长度都与 DBC 相同时直接使用缓存
+    MappedFile cache;
+    if (!cache_path_.empty() && cache.open(cache_path_, reason) && loadCache(cache.data(), cache.size(), hash, source.size())) {
+        from_cache_ = true;
+        return true;
+    }
+    
+    if (!parse(source.data(), source.size(), error)) {
+        error = path + ":" + error;
+        return false;
+    }
+    if (!cache_path_.empty()) {
+        writeCache(hash, source.size(), cache_error_);
+    }
+    return true;
+}
+
+/**
+ * 解析内存中的 DBC 文本
+ * @param data 文本
+ * @param size 字节数
+ * @param error 失败原因（以行号开头）
+ * @return 是否成功
+ */
+bool CanDatabase::parse(const char* data, size_t size, std::string& error) {
+    messages_.clear();
+    signals_.clear();
+    names_.clear();
+    
+    DbcScanner scanner(data, size);
+    auto fail = [&](const std::string& message) {
+        error = std::to_string(scanner.line()) + ": " + message;
+        messages_.clear();
+        signals_.clear();
+        names_.clear();
+        return false;
+    };
+    auto addName = [&](const char* begin, size_t length, uint32_t& offset, uint32_t& name_length) {
+        offset = static_cast<uint32_t>(names_.size());
+        name_length = static_cast<uint32_t>(length);
+        names_.append(begin, length);
+    };
+    
+    // 当前报文：-1 表示还没有报文，-2 表示跳过的伪报文
+    long current = -1;
+    while (true) {
+        scanner.skipBlank();
+        if (scanner.atEnd()) {
+            break;
+        }
+        
+        // BO_ <ID> <报文名>: <DLC> <发送节点>
+        if (scanner.keyword("BO_")) {
+            unsigned long long id = 0;
+            unsigned long long dlc = 0;
+            const char* name = nullptr;
+            size_t name_length = 0;
+            if (!scanner.unsignedNumber(id) || id > 0xFFFFFFFFULL) {
+                return fail("期望报文 ID");
+            }
+            if (!scanner.identifier(name, name_length)) {
+                return fail("期望报文名");
+            }
+            if (!scanner.expect(':') || !scanner.unsignedNumber(dlc) || dlc > 64) {
+                return fail("期望 ':' 和报文长度 (0-64)");
+            }
+            if (id == kIndependentSignalsId) {
+                current = -2;
+            } else {
+                DbcMessage message = {};
+                message.extended = (id & kExtendedFlag) != 0;
+                message.id = static_cast<uint32_t>(id & ~kExtendedFlag);
+                addName(name, name_length, message.name, message.name_length);
+                message.first_signal = static_cast<uint32_t>(signals_.size());
+                message.dlc = static_cast<uint8_t>(dlc);
+                current = static_cast<long>(messages_.size());
+                messages_.push_back(message);
+            }
+            scanner.skipRecord();
+            continue;
+        }
+        
+        // SG_ <信号名> [M|mN] : <起始位>|<长度>@<字节序><符号> (<factor>,<offset>) [<min>|<max>] "<单位>" <接收节点>
+        if (scanner.keyword("SG_")) {
+            if (current == -1) {
+                return fail("信号不属于任何报文");
+            }
+            DbcSignal signal = {};
+            const char* name = nullptr;
+            size_t name_length = 0;
+            if (!scanner.identifier(name, name_length)) {
+                return fail("期望信号名");
+            }
+            if (scanner.peek() != ':') {
+                const char* mux = nullptr;
+                size_t mux_length = 0;
+                if (!scanner.identifier(mux, mux_length) || (mux[0] != 'M' && mux[0] != 'm')) {
+                    return fail("无效的多路复用标记");
+                }
+                signal.flags |= kMultiplexed;
+            }
+            unsigned long long start = 0;
+            unsigned long long length = 0;
+            if (!scanner.expect(':') || !scanner.unsignedNumber(start) || start >= 512 ||
+                !scanner.expect('|') || !scanner.unsignedNumber(length) || length == 0 || length > 64) {
+                return fail("期望信号的起始位 (0-511) 和长度 (1-64)");
+            }
+            char order = scanner.expect('@') ? scanner.peek() : '\0';
+            if ((order != '0' && order != '1') || !scanner.expect(order)) {
+                return fail("期望字节序 @0 或 @1");
+            }
+            char sign = scanner.peek();
+            if ((sign != '+' && sign != '-') || !scanner.expect(sign)) {
+                return fail("期望符号 + 或 -");
+            }
+            if (!scanner.expect('(') || !scanner.number(signal.factor) || !scanner.expect(',') ||
+                !scanner.number(signal.offset) || !scanner.expect(')')) {
+                return fail("期望 (factor,offset)");
+            }
+            if (current >= 0) {
+                addName(name, name_length, signal.name, signal.name_length);
+                signal.message = static_cast<uint32_t>(current);
+                signal.start_bit = static_cast<uint16_t>(start);
+                signal.length = static_cast<uint8_t>(length);
+                signal.flags |= (order == '1' ? kLittleEndian : 0) | (sign == '-' ? kSigned : 0);
+                signals_.push_back(signal);
+                messages_[current].signal_count++;
+            }
+            scanner.skipRecord();
+            continue;
+        }
+        
+        // 其他记录（节点、注释、属性、取值表等）与编译无关
+        scanner.skipRecord();
+    }
+    
+    buildIndex();
+    return true;
+}
+
+/**
+ * 建立按名称排序的报文和信号索引，同名时保持 DBC 中的顺序
+ */
+void CanDatabase::buildIndex() {
+    auto byName = [this](const auto& records) {
+        std::vector<uint32_t> index(records.size());
+        std::iota(index.begin(), index.end(), 0u);
+        std::stable_sort(index.begin(), index.end(), [&](uint32_t a, uint32_t b) {
+            return names_.compare(records[a].name, records[a].name_length,
+                                  names_, records[b].name, records[b].name_length) < 0;
+        });
+        return index;
+    };
+    message_index_ = byName(messages_);
+    signal_index_ = byName(signals_);
+}
+
+/**
+ * 在按名称排序的索引中二分查找
+ * @param matches 不为 nullptr 时输出同名记录数
+ */
+template <typename Record>
+const Record* CanDatabase::findByName(const std::vector<uint32_t>& index, const std::vector<Record>& records,
+                                      const std::string& name, size_t* matches) const {
+    auto compare = [&](uint32_t i) {
+        return names_.compare(records[i].name, records[i].name_length, name);
+    };
+    auto first = std::partition_point(index.begin(), index.end(), [&](uint32_t i) { return compare(i) < 0; });
+    auto last = std::partition_point(first, index.end(), [&](uint32_t i) { return compare(i) == 0; });
+    if (matches) {
+        *matches = static_cast<size_t>(last - first);
+    }
+    return first == last ? nullptr : &records[*first];
+}
+
+/**
+ * 按名称查找报文
+ * @param name 报文名
+ * @return 报文，不存在时返回 nullptr
+ */
+const DbcMessage* CanDatabase::findMessage(const std::string& name) const {
+    return findByName(message_index_, messages_, name, nullptr);
+}
+
+/**
+ * 按名称查找信号
+ * @param name 信号名
+ * @param matches 输出同名信号的个数
+ * @return 第一个同名信号，不存在时返回 nullptr
+ */
+const DbcSignal* CanDatabase::findSignal(const std::string& name, size_t& matches) const {
+    return findByName(signal_index_, signals_, name, &matches);
+}
+
+/**
+ * 在指定报文中查找信号
+ * @param message 报文
+ * @param name 信号名
+ * @return 信号，不存在时返回 nullptr
+ */
+const DbcSignal* CanDatabase::findSignal(const DbcMessage& message, const std::string& name) const {
+    for (uint32_t i = 0; i < message.signal_count; ++i) {
+        const DbcSignal& signal = signals_[message.first_signal + i];
+        if (names_.compare(signal.name, signal.name_length, name) == 0) {
+            return &signal;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * DBC 内容的 64 位散列：四路并行按 8 字节混合，比解析文本快得多
+ * @param data 内容
+ * @param size 字节数
+ * @return 散列值
+ */
+uint64_t CanDatabase::hashContent(const char* data, size_t size) {
+    const uint64_t kMultiplier = 0xFF51AFD7ED558CCDULL;
+    uint64_t lanes[4] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x27D4EB2F165667C5ULL};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, data + i + lane * 8, 8);
+            lanes[lane] = (lanes[lane] ^ word) * kMultiplier;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+    uint64_t hash = static_cast<uint64_t>(size);
+    for (uint64_t lane : lanes) {
+        hash = (hash ^ lane) * kMultiplier;
+    }
+    for (; i < size; i += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + i, std::min<size_t>(8, size - i));
+        hash = (hash ^ word) * kMultiplier;
+        hash ^= hash >> 29;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * 从映射的索引缓存加载：文件头、长度和所有下标都有效、名称索引有序时才使用
+ * @return 是否已从缓存加载
+ */
+bool CanDatabase::loadCache(const char* data, size_t size, uint64_t hash, uint64_t source_size) {
+    CacheHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || header.version != kCacheVersion ||
+        header.record_sizes != kRecordSizes || header.source_hash != hash || header.source_size != source_size) {
+        return false;
+    }
+    size_t messages = header.message_count;
+    size_t signals = header.signal_count;
+    size_t expected = sizeof(header) + messages * sizeof(DbcMessage) + signals * sizeof(DbcSignal) +
+                      (messages + signals) * sizeof(uint32_t) + header.names_size;
+    if (size != expected) {
+        return false;
+    }
+    
+    const char* p = data + sizeof(header);
+    auto take = [&p](auto& table, size_t count) {
+        table.resize(count);
+        std::memcpy(table.data(), p, count * sizeof(table[0]));
+        p += count * sizeof(table[0]);
+    };
+    take(messages_, messages);
+    take(signals_, signals);
+    take(message_index_, messages);
+    take(signal_index_, signals);
+    names_.assign(p, header.names_size);
+    
+    // 缓存可能被截断或改写，使用前检查所有下标
+    bool valid = true;
+    for (const DbcMessage& message : messages_) {
+        valid = valid && message.name + static_cast<size_t>(message.name_length) <= names_.size() &&
+                message.first_signal + static_cast<size_t>(message.signal_count) <= signals;
+    }
+    for (const DbcSignal& signal : signals_) {
+        valid = valid && signal.name + static_cast<size_t>(signal.name_length) <= names_.size() &&
+                signal.message < messages;
+    }
+    for (uint32_t index : message_index_) {
+        valid = valid && index < messages;
+    }
+    for (uint32_t index : signal_index_) {
+        valid = valid && index < signals;
+    }
+    
+    // 按名称查找时在索引上二分，索引必须与 buildIndex 的结果一样按名称排序、同名按表中顺序
+    auto sorted = [this](const std::vector<uint32_t>& index, const auto& records) {
+        for (size_t i = 1; i < index.size(); ++i) {
+            const auto& prev = records[index[i - 1]];
+            const auto& next = records[index[i]];
+            int order = names_.compare(prev.name, prev.name_length, names_, next.name, next.name_length);
+            if (order > 0 || (order == 0 && index[i - 1] >= index[i])) {
+                return false;
+            }
+        }
+        return true;
+    };
+    valid = valid && sorted(message_index_, messages_) && sorted(signal_index_, signals_);
+    if (!valid) {
+        messages_.clear();
+        signals_.clear();
+        message_index_.clear();
+        signal_index_.clear();
+        names_.clear();
+    }
+    return valid;
+}
+
+/**
+ * 把报文表、信号表、索引和字符串池写入索引缓存（原子替换）
+ * @param error 失败原因
+ * @return 是否成功
+ */
+bool CanDatabase::writeCache(uint64_t hash, uint64_t source_size, std::string& error) const {
+    CacheHeader header = {};
+    std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.record_sizes = kRecordSizes;
+    header.source_hash = hash;
+    header.source_size = source_size;
+    header.message_count = static_cast<uint32_t>(messages_.size());
+    header.signal_count = static_cast<uint32_t>(signals_.size());
+    header.names_size = static_cast<uint32_t>(names_.size());
+    
+    OutputBuffer out(sizeof(header) + messages_.size() * (sizeof(DbcMessage) + sizeof(uint32_t)) +
+                     signals_.size() * (sizeof(DbcSignal) + sizeof(uint32_t)) + names_.size());
+    out.append(&header, sizeof(header));
+    out.append(messages_.data(), messages_.size() * sizeof(DbcMessage));
+    out.append(signals_.data(), signals_.size() * sizeof(DbcSignal));
+    out.append(message_index_.data(), message_index_.size() * sizeof(uint32_t));
+    out.append(signal_index_.data(), signal_index_.size() * sizeof(uint32_t));
+    out.append(names_.data(), names_.size());
+    return out.writeToFile(cache_path_, error) != WriteResult::Failed;
+}
+
+namespace {
+
+/**
+ * 信号占用的最高数据位（按字节顺序、字节内从低到高编号），用于检查信号是否在 8 字节数据内
+ */
+int lastDataBit(const DbcSignal& signal) {
+    if (signal.flags & CanDatabase::kLittleEndian) {
+        return signal.start_bit + signal.length - 1;
+    }
+    // Motorola 字节序：起始位是最高位，向低位取，跨字节时进入下一个字节的最高位
+    int msb_byte = signal.start_bit / 8;
+    int bits_in_first = signal.start_bit % 8 + 1;
+    if (signal.length <= bits_in_first) {
+        return signal.start_bit;
+    }
+    int remaining = signal.length - bits_in_first;
+    return (msb_byte + (remaining + 7) / 8) * 8 + 7;
+}
+
+/**
+ * 是否为报文的内置成员（内置成员优先于同名信号）
+ */
+bool isBuiltinMember(const std::string& member) {
+    return member == "id" || member == "dlc" || member == "channel" || member == "dir" || member == "data" ||
+           member == "byte" || member == "reserved";
+}
+
+/**
+ * 是否为对信号的 ++、-- 或复合赋值（信号只支持读取和 = 赋值）
+ */
+bool isSignalUpdate(const ASTNode* access, const ASTNode* parent) {
+    if (!parent) {
+        return false;
+    }
+    if (parent->getType() == ASTNodeType::ASSIGNMENT_EXPR) {
+        return parent->getChild(0) == access && static_cast<const AssignmentExprNode*>(parent)->getOperator() != "=";
+    }
+    if (parent->getType() == ASTNodeType::UNARY_EXPR) {
+        const std::string& op = static_cast<const UnaryExprNode*>(parent)->getOperator();
+        return op == "++" || op == "--";
+    }
+    return false;
+}
+
+/**
+ * 解析程序中报文名和信号的遍历
+ */
+class DatabaseResolver {
+public:
+    DatabaseResolver(const std::vector<CanDatabase>& databases, std::vector<std::string>& errors)
+        : databases_(databases), errors_(errors) {}
+    
+    /**
+     * 记录变量块中以数值 ID 声明的 message 变量，on message 可以用变量名指代报文
+     */
+    void collectDeclaredIds(const ASTNode* program) {
+        for (const auto& block : program->getChildren()) {
+            if (block->getType() != ASTNodeType::BLOCK_STMT) {
+                continue;
+            }
+            for (const auto& child : block->getChildren()) {
+                if (child->getType() != ASTNodeType::VARIABLE_DECL) {
+                    continue;
+                }
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(child.get());
+                uint32_t id = 0;
+                if (decl->getVarType() == "message" && MessageDispatch::parseMessageId(decl->getMessageRef(), id)) {
+                    declared_ids_[decl->getName()] = id;
+                }
+            }
+        }
+    }
+    
+    /**
+     * 同一报文 ID（或 *）只能有一个报文处理器，重复时报告两个处理器
+     */
+    void checkDuplicateHandlers(const ASTNode* program) {
+        std::map<std::string, const OnEventNode*> handlers;
+        for (const auto& child : program->getChildren()) {
+            if (child->getType() != ASTNodeType::ON_MESSAGE) {
+                continue;
+            }
+            const OnEventNode* handler = static_cast<const OnEventNode*>(child.get());
+            std::string key = handler->getEventName();
+            uint32_t id = 0;
+            if (MessageDispatch::handlerMessageId(handler, id)) {
+                char text[16];
+                std::snprintf(text, sizeof(text), "0x%X", id);
+                key = text;
+            } else if (key != "*") {
+                continue;
+            }
+            auto inserted = handlers.emplace(key, handler);
+            if (!inserted.second) {
+                const OnEventNode* first = inserted.first->second;
+                error(handler, handler->getDisplayName() + " 与行 " + std::to_string(first->getLine()) + " 的 " +
+                               first->getDisplayName() + " 处理同一报文 " + key);
+            }
+        }
+    }
+    
+    void visit(ASTNode* node, const ASTNode* parent) {
+        // 进入报文处理器时记录 this 对应的数据库报文
+        DatabaseMessage saved_this = this_message_;
+        switch (node->getType()) {
+            case ASTNodeType::ON_MESSAGE:
+                this_message_ = resolveHandler(static_cast<OnEventNode*>(node));
+                break;
+            case ASTNodeType::VARIABLE_DECL:
+                resolveVariable(static_cast<VariableDeclNode*>(node));
+                break;
+            case ASTNodeType::SIGNAL_ACCESS:
+                resolveSignal(static_cast<SignalAccessNode*>(node), parent);
+                break;
+            case ASTNodeType::MEMBER_EXPR:
+                resolveMember(static_cast<MemberExprNode*>(node), parent);
+                break;
+            default:
+                break;
+        }
+        for (const auto& child : node->getChildren()) {
+            visit(child.get(), node);
+        }
+        this_message_ = saved_this;
+    }
+
+private:
+    /**
+     * 数据库中的报文及其所在的数据库
+     */
+    struct DatabaseMessage {
+        const CanDatabase* database = nullptr;
+        const DbcMessage* message = nullptr;
+    };
+    
+    void error(const ASTNode* node, const std::string& message) {
+        errors_.push_back("行 " + std::to_string(node->getLine()) + ": " + message);
+    }
+    
+    const DbcMessage* findMessage(const std::string& name, const CanDatabase*& database) const {
+        for (const CanDatabase& candidate : databases_) {
+            if (const DbcMessage* message = candidate.findMessage(name)) {
+                database = &candidate;
+                return message;
+            }
+        }
+        return nullptr;
+    }
+    
+    /**
+     * 按名称查找报文引用，数值 ID、* 或没有数据库时不查找
+     */
+    DatabaseMessage findReference(const ASTNode* node, const std::string& name) {
+        DatabaseMessage result;
+        uint32_t id = 0;
+        if (name.empty() || name == "*" || MessageDispatch::parseMessageId(name, id) || databases_.empty()) {
+            return result;
+        }
+        result.message = findMessage(name, result.database);
+        if (!result.message) {
+            error(node, "CAN 数据库中没有报文 " + name);
+        }
+        return result;
+    }
+    
+    DatabaseMessage resolveHandler(OnEventNode* handler) {
+        const std::string& name = handler->getEventName();
+        // 数据库中没有的报文名可以是变量块中以数值 ID 声明的 message 变量
+        const CanDatabase* database = nullptr;
+        auto declared = declared_ids_.find(name);
+        if (declared != declared_ids_.end() && !findMessage(name, database)) {
+            handler->setMessageId(declared->second);
+            return DatabaseMessage();
+        }
+        uint32_t id = 0;
+        if (databases_.empty() && name != "*" && !MessageDispatch::parseMessageId(name, id)) {
+            error(handler, "未知的报文名 " + name + "：没有用 candb 声明 CAN 数据库");
+            return DatabaseMessage();
+        }
+        DatabaseMessage message = findReference(handler, name);
+        if (message.message) {
+            handler->setMessageId(message.message->id);
+        }
+        return message;
+    }
+    
+    void resolveVariable(VariableDeclNode* decl) {
+        if (decl->getVarType() != "message") {
+            return;
+        }
+        // 同名的后一个声明覆盖前一个（局部变量在使用前声明）
+        message_vars_.erase(decl->getName());
+        DatabaseMessage message = findReference(decl, decl->getMessageRef());
+        if (message.message) {
+            decl->setMessageId(message.message->id, message.message->dlc);
+            message_vars_[decl->getName()] = message;
+        }
+    }
+    
+    /**
+     * 构造信号信息，信号超出 8 字节的报文数据时报错
+     */
+    bool makeInfo(const ASTNode* node, const CanDatabase& database, const DbcSignal& signal, SignalInfo& info) {
+        if (lastDataBit(signal) >= 64) {
+            error(node, "信号 " + database.getName(signal) + " 超出 8 字节的报文数据");
+            return false;
+        }
+        const DbcMessage& message = database.getMessage(signal);
+        info.message = database.getName(message);
+        info.message_id = message.id;
+        info.message_dlc = message.dlc;
+        info.start_bit = signal.start_bit;
+        info.length = signal.length;
+        info.little_endian = (signal.flags & CanDatabase::kLittleEndian) != 0;
+        info.is_signed = (signal.flags & CanDatabase::kSigned) != 0;
+        info.factor = signal.factor;
+        info.offset = signal.offset;
+        return true;
+    }
+    
+    void resolveSignal(SignalAccessNode* access, const ASTNode* parent) {
+        const std::string& name = access->getName();
+        if (databases_.empty()) {
+            error(access, "$" + name + " 需要先用 candb 声明 CAN 数据库");
+            return;
+        }
+        if (isSignalUpdate(access, parent) ||
+            (parent && parent->getType() == ASTNodeType::ASSIGNMENT_EXPR && parent->getChild(0) == access)) {
+            error(access, "信号 $" + name + " 只能读取，不能赋值");
+            return;
+        }
+        
+        const CanDatabase* database = nullptr;
+        const DbcSignal* signal = nullptr;
+        size_t separator = name.find("::");
+        if (separator != std::string::npos) {
+            // $报文名::信号名
+            std::string message_name = name.substr(0, separator);
+            const DbcMessage* message = findMessage(message_name, database);
+            if (!message) {
+                error(access, "CAN 数据库中没有报文 " + message_name);
+                return;
+            }
+            signal = database->findSignal(*message, name.substr(separator + 2));
+        } else {
+            size_t total = 0;
+            for (const CanDatabase& candidate : databases_) {
+                size_t matches = 0;
+                const DbcSignal* found = candidate.findSignal(name, matches);
+                if (found && !signal) {
+                    signal = found;
+                    database = &candidate;
+                }
+                total += matches;
+            }
+            if (total > 1) {
+                error(access, "信号 " + name + " 在多个报文中定义，请写为 $报文名::" + name);
+                return;
+            }
+        }
+        if (!signal) {
+            error(access, "CAN 数据库中没有信号 " + name);
+            return;
+        }
+        
+        SignalInfo info;
+        if (makeInfo(access, *database, *signal, info)) {
+            access->setInfo(info);
+        }
+    }
+    
+    /**
+     * 数据库报文变量或数据库报文处理器中 this 的信号成员
+     */
+    void resolveMember(MemberExprNode* member, const ASTNode* parent) {
+        const ASTNode* object = member->getChild(0);
+        if (member->isCall() || isBuiltinMember(member->getMember()) || !object ||
+            object->getType() != ASTNodeType::IDENTIFIER) {
+            return;
+        }
+        const std::string& object_name = static_cast<const IdentifierNode*>(object)->getName();
+        DatabaseMessage message;
+        if (object_name == "this") {
+            message = this_message_;
+        } else {
+            auto it = message_vars_.find(object_name);
+            if (it != message_vars_.end()) {
+                message = it->second;
+            }
+        }
+        if (!message.message) {
+            return;
+        }
+        
+        const std::string& name = member->getMember();
+        const DbcSignal* signal = message.database->findSignal(*message.message, name);
+        if (!signal) {
+            error(member, "报文 " + message.database->getName(*message.message) + " 中没有信号 " + name);
+            return;
+        }
+        if (isSignalUpdate(member, parent)) {
+            error(member, "信号 " + object_name + "." + name + " 只支持读取和 = 赋值");
+            return;
+        }
+        SignalInfo info;
+        if (makeInfo(member, *message.database, *signal, info)) {
+            member->setSignal(info);
+        }
+    }
+    
+    const std::vector<CanDatabase>& databases_;     // 按声明顺序查找的数据库
+    std::vector<std::string>& errors_;              // 错误
+    std::map<std::string, DatabaseMessage> message_vars_;   // 数据库报文变量
+    std::map<std::string, uint32_t> declared_ids_;  // 变量块中以数值 ID 声明的 message 变量
+    DatabaseMessage this_message_;                  // 当前报文处理器的数据库报文
+};
+
+} // namespace
+
+/**
+ * 用数据库解析程序中的 on message 报文名、message 变量和信号
+ * @param program AST 根节点
+ * @param databases 已加载的数据库
+ * @param errors 输出的错误
+ */
+void resolveDatabaseSymbols(ASTNode* program, const std::vector<CanDatabase>& databases,
+                            std::vector<std::string>& errors) {
+    if (!program) {
+        return;
+    }
+    DatabaseResolver resolver(databases, errors);
+    resolver.collectDeclaredIds(program);
+    resolver.visit(program, nullptr);
+    resolver.checkDuplicateHandlers(program);
+}
+
+} // namespace capl
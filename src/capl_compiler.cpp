@@ -4,6 +4,9 @@
 
 #include "../include/capl_compiler.h"
 #include "../include/ast.h"
+#include "../include/cost_model.h"
+#include "../include/ir_builder.h"
+#include "../include/pass_manager.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -13,7 +16,9 @@ namespace capl {
 /**
  * 构造函数
  */
-CAPLCompiler::CAPLCompiler() {
+CAPLCompiler::CAPLCompiler()
+    : cost_report_(false), cost_budget_(CostModel::kDefaultBudget), layout_report_(false),
+      optimize_level_(0), pass_stats_(false), ir_dump_(false), verify_ir_(false), debug_(false), jobs_(0), shards_(0) {
     // 初始化各个组件
     semantic_analyzer_ = std::make_unique<SemanticAnalyzer>();
     code_generator_ = std::make_unique<CodeGenerator>();
@@ -42,6 +47,10 @@ bool CAPLCompiler::syntaxCheck(const std::string& source_file) {
         std::string source_code = buffer.str();
         file.close();
         
+        // candb 的相对路径相对于源文件所在目录
+        size_t slash = source_file.find_last_of('/');
+        source_dir_ = slash == std::string::npos ? "" : source_file.substr(0, slash + 1);
+        
         // 进行语法检查
         return syntaxCheckFromString(source_code);
         
@@ -88,13 +97,23 @@ bool CAPLCompiler::syntaxCheckFromString(const std::string& source_code) {
             return false;
         }
         
+        if (!loadDatabases(ast, "")) {
+            return false;
+        }
+        
         // 3. 语义分析
         std::cout << "3. 语义分析..." << std::endl;
-        if (!semantic_analyzer_->analyze(ast)) {
+        if (!semantic_analyzer_->analyze(ast) || !checkWriteFormats(ast)) {
             errors_.push_back("语义分析失败");
             return false;
         }
         
+        runCostModel(ast);
+        
+        if (layout_report_) {
+            printLayoutReport(ast);
+        }
+        
         // 语法检查模式不进行代码生成
         std::cout << "语法检查完成!" << std::endl;
         return true;
@@ -134,6 +153,10 @@ bool CAPLCompiler::compile(const std::string& source_file, const std::string& ou
         std::string source_code = buffer.str();
         file.close();
         
+        // candb 的相对路径相对于源文件所在目录
+        size_t slash = source_file.find_last_of('/');
+        source_dir_ = slash == std::string::npos ? "" : source_file.substr(0, slash + 1);
+        
         // 编译源代码
         return compileFromString(source_code, output_file);
         
@@ -171,19 +194,154 @@ bool CAPLCompiler::compileFromString(const std::string& source_code, const std::
             return false;
         }
         
+        if (!loadDatabases(ast, output_file)) {
+            return false;
+        }
+        
         // 3. 语义分析
         std::cout << "3. 语义分析..." << std::endl;
-        if (!semantic_analyzer_->analyze(ast)) {
+        if (!semantic_analyzer_->analyze(ast) || !checkWriteFormats(ast)) {
             errors_.push_back("语义分析失败");
             return false;
         }
         
-        // 4. 代码生成
-        std::cout << "4. 代码生成..." << std::endl;
+        runCostModel(ast);
+        
+        if (layout_report_) {
+            printLayoutReport(ast);
+        }
+        
+        // 读入剖析数据，供优化和代码生成使用
+        profile_.clear();
+        if (!profile_use_.empty()) {
+            std::string error;
+            if (!profile_.load(profile_use_, error)) {
+                errors_.push_back(error);
+                return false;
+            }
+            std::cout << "剖析数据: " << profile_.countHandlers(Heat::Hot) << " 个热点处理器, "
+                      << profile_.countHandlers(Heat::Warm) << " 个普通处理器, "
+                      << profile_.countHandlers(Heat::Cold) << " 个冷处理器, "
+                      << profile_.getBranchCount() << " 个分支" << std::endl;
+        }
+        const ProfileData* profile = profile_use_.empty() ? nullptr : &profile_;
+        
+        // if 语句的剖析键在优化前按源码命名，内联不同时插桩和读入的键也一致
+        if (!profile_use_.empty() || !profile_generate_.empty()) {
+            assignBranchNames(ast.get());
+        }
+        
+        // 4. 优化
+        std::cout << "4. 优化 (-O" << optimize_level_ << ")..." << std::endl;
+        PassManager pass_manager(optimize_level_);
+        pass_manager.setProfile(profile);
+        pass_manager.buildPipeline();
+        pass_manager.run(ast.get());
+        if (pass_stats_) {
+            pass_manager.printStats(std::cout);
+        }
+        
+        // 只在输出或要求验证时构造中间表示，代码生成不使用它
+        if ((ir_dump_ || verify_ir_) && !buildIR(ast)) {
+            return false;
+        }
+        
+        // 5. 代码生成
+        std::cout << "5. 代码生成..." << std::endl;
+        code_generator_->setFoldHandlers(optimize_level_ >= 1);
+        code_generator_->setCompileRoutes(optimize_level_ >= 1);
+        code_generator_->setVectorizeLoops(optimize_level_ >= 2);
+        code_generator_->setEliminateBoundsChecks(!debug_ && optimize_level_ >= 2);
+        code_generator_->setNarrowIntegers(optimize_level_ >= 2);
+        code_generator_->setProfileGenerate(profile_generate_);
+        code_generator_->setProfile(profile);
+        code_generator_->setThreads(jobs_);
+        code_generator_->setShards(shards_);
         if (!code_generator_->generate(ast, semantic_analyzer_->getSymbolTable(), output_file)) {
             errors_.push_back("代码生成失败");
             return false;
         }
+        const HandlerFolding& folding = code_generator_->getHandlerFolding();
+        if (folding.getFoldedCount() > 0) {
+            std::cout << "合并相同的事件处理器: " << folding.getFoldedCount()
+                      << " 个处理器共用其他处理器的实现" << std::endl;
+        }
+        const MessageDispatch& dispatch = code_generator_->getMessageDispatch();
+        if (dispatch.getKind() == DispatchKind::Direct) {
+            std::cout << "报文分派: " << dispatch.getEntries().size() << " 个 ID, 直接索引表 ("
+                      << dispatch.getTableSize() << " 项)" << std::endl;
+        } else if (dispatch.getKind() == DispatchKind::PerfectHash) {
+            std::cout << "报文分派: " << dispatch.getEntries().size() << " 个 ID, 完美散列表 ("
+                      << dispatch.getTableSize() << " 项, " << dispatch.getDisplacements().size() << " 个桶)" << std::endl;
+        }
+        const EventTables& events = code_generator_->getEventTables();
+        if (!events.getTimers().empty() || events.hasKeyHandlers()) {
+            int keys = 0;
+            for (const ASTNode* handler : events.getKeyHandlers()) {
+                keys += handler ? 1 : 0;
+            }
+            std::cout << "定时器和按键: " << events.getTimers().size() << " 个定时器 ID, " << keys
+                      << " 个按键处理器" << (events.getKeyWildcard() ? " (含 on key *)" : "") << std::endl;
+        }
+        const SwitchLowering& switches = code_generator_->getSwitchLowering();
+        if (!switches.getPlans().empty()) {
+            std::cout << "switch 分派: " << switches.getPlans().size() << " 个 switch, "
+                      << switches.countKind(SwitchKind::JumpTable) << " 个跳转表, "
+                      << switches.countKind(SwitchKind::BinarySearch) << " 个二分查找, "
+                      << switches.countKind(SwitchKind::BitTest) << " 个位测试" << std::endl;
+        }
+        const WriteFormats& formats = code_generator_->getWriteFormats();
+        if (formats.getCount() > 0) {
+            std::cout << "格式化输出: " << formats.getCount() << " 个 write 调用的格式字符串在编译期展开" << std::endl;
+        }
+        const GatewayRoutes& routes = code_generator_->getGatewayRoutes();
+        if (!routes.getRoutes().empty()) {
+            std::cout << "网关路由: " << routes.getForwarders().size() << " 个纯转发处理器编译为路由表 ("
+                      << routes.getRoutes().size() << " 条路由)" << std::endl;
+        }
+        const auto& loops = code_generator_->getLoopVectorizer().getLoops();
+        if (!loops.empty()) {
+            int clones = 0;
+            for (const auto& loop : loops) {
+                clones += loop.clones ? 1 : 0;
+            }
+            std::cout << "可向量化的循环: " << loops.size() << " 个提取为内核函数, 其中 " << clones
+                      << " 个生成 AVX2/SSE2 版本" << std::endl;
+        }
+        const IntegerNarrowing& narrowing = code_generator_->getIntegerNarrowing();
+        if (!narrowing.getVariables().empty()) {
+            std::cout << "整数存储收窄: " << narrowing.getVariables().size() << " 个全局变量, 节省 "
+                      << narrowing.getSavedBytes() << " 字节 (";
+            for (size_t i = 0; i < narrowing.getVariables().size(); ++i) {
+                const NarrowedVariable& var = narrowing.getVariables()[i];
+                std::cout << (i > 0 ? ", " : "") << var.name << ": " << var.capl_type << " -> " << var.cpp_type;
+            }
+            std::cout << ")" << std::endl;
+        }
+        const BoundsCheckAnalysis& bounds = code_generator_->getBoundsCheckAnalysis();
+        if (!bounds.getChecks().empty()) {
+            size_t total = bounds.getChecks().size();
+            if (!debug_ && optimize_level_ >= 2) {
+                std::cout << "数组下标检查: 共 " << total << " 处, " << bounds.getProvenCount()
+                          << " 处证明不会越界已省略, 保留 " << total - bounds.getProvenCount() << " 处" << std::endl;
+            } else {
+                std::cout << "数组下标检查: 共 " << total << " 处, 全部保留" << std::endl;
+            }
+        }
+        
+        if (code_generator_->getProfileCounterCount() > 0) {
+            std::cout << "剖析插桩: " << code_generator_->getProfileCounterCount() << " 个计数器, 退出时写入 "
+                      << profile_generate_ << std::endl;
+        }
+        
+        const auto& shards = code_generator_->getOutputShards();
+        if (!shards.empty()) {
+            std::cout << "分片输出: " << shards.size() << " 个分片 (处理器和函数数/字节: ";
+            for (size_t i = 0; i < shards.size(); ++i) {
+                std::cout << (i > 0 ? ", " : "") << shards[i].units << "/" << shards[i].bytes;
+            }
+            std::cout << ")" << std::endl;
+        }
         
         std::cout << "编译成功!" << std::endl;
         return true;
@@ -194,6 +352,37 @@ bool CAPLCompiler::compileFromString(const std::string& source_code, const std::
     }
 }
 
+/**
+ * 运行静态开销模型，输出报告并检查预算
+ * @param ast AST 根节点
+ */
+void CAPLCompiler::runCostModel(const std::unique_ptr<ASTNode>& ast) {
+    CostModel cost_model;
+    cost_model.setBudget(cost_budget_);
+    cost_model.analyze(ast.get());
+    
+    if (cost_report_) {
+        cost_model.printReport(std::cout);
+    }
+    
+    for (const auto& warning : cost_model.checkBudget()) {
+        warnings_.push_back(warning);
+    }
+}
+
+/**
+ * 输出全局状态布局报告（含定时器和报文缓存）
+ * @param ast AST 根节点
+ */
+void CAPLCompiler::printLayoutReport(const std::unique_ptr<ASTNode>& ast) {
+    EventTables events;
+    events.build(ast.get());
+    StateLayout layout;
+    layout.compute(ast.get());
+    layout.addRuntimeState(ast.get(), events.getTimers().size());
+    layout.printReport(std::cout);
+}
+
 /**
  * 获取编译错误信息
  * @return 错误信息列表
@@ -210,4 +399,99 @@ const std::vector<std::string>& CAPLCompiler::getWarnings() const {
     return warnings_;
 }
 
-} // namespace capl
\ No newline at end of file
+/**
+ * 检查 write 调用的格式字符串与实参是否相符
+ * @param ast AST 根节点
+ * @return 是否通过检查
+ */
+bool CAPLCompiler::checkWriteFormats(const std::unique_ptr<ASTNode>& ast) {
+    WriteFormats formats;
+    std::vector<std::string> errors;
+    formats.analyze(ast.get(), &errors);
+    for (const auto& error : errors) {
+        errors_.push_back(error);
+    }
+    return errors.empty();
+}
+
+/**
+ * 加载 candb 声明的 CAN 数据库，解析报文名和信号
+ * @param ast AST 根节点
+ * @param output_file 输出文件路径，索引缓存写在其所在目录；为空时不使用缓存
+ * @return 是否成功
+ */
+bool CAPLCompiler::loadDatabases(const std::unique_ptr<ASTNode>& ast, const std::string& output_file) {
+    databases_.clear();
+    size_t output_slash = output_file.find_last_of('/');
+    std::string output_dir = output_slash == std::string::npos ? "" : output_file.substr(0, output_slash + 1);
+    const auto& paths = static_cast<const ProgramNode*>(ast.get())->getDatabases();
+    for (const auto& declared : paths) {
+        std::string path = declared[0] == '/' ? declared : source_dir_ + declared;
+        // 索引缓存是构建产物，写在输出目录而不是 DBC 所在的源码目录
+        std::string cache_path;
+        if (!output_file.empty()) {
+            size_t slash = path.find_last_of('/');
+            cache_path = output_dir + (slash == std::string::npos ? path : path.substr(slash + 1)) + ".idx";
+        }
+        CanDatabase database;
+        std::string error;
+        if (!database.load(path, cache_path, error)) {
+            errors_.push_back(error);
+            return false;
+        }
+        std::cout << "CAN 数据库: " << path << ", " << database.getMessages().size() << " 个报文, "
+                  << database.getSignals().size() << " 个信号 (";
+        if (database.isFromCache()) {
+            std::cout << "从索引缓存加载";
+        } else {
+            std::cout << "已解析" << (database.getCacheError().empty() && !database.getCachePath().empty() ?
+                                      ", 写入索引缓存 " + database.getCachePath() : "");
+        }
+        std::cout << ")" << std::endl;
+        if (!database.getCacheError().empty()) {
+            warnings_.push_back("无法写入 CAN 数据库索引缓存: " + database.getCacheError());
+        }
+        databases_.push_back(std::move(database));
+    }
+    
+    std::vector<std::string> errors;
+    resolveDatabaseSymbols(ast.get(), databases_, errors);
+    for (const auto& error : errors) {
+        errors_.push_back(error);
+    }
+    return errors.empty();
+}
+
+/**
+ * 构造并验证 SSA 中间表示，需要时输出
+ * @param ast AST 根节点
+ * @return 是否通过验证
+ */
+bool CAPLCompiler::buildIR(const std::unique_ptr<ASTNode>& ast) {
+    IRBuilder builder;
+    std::unique_ptr<IRModule> module = builder.build(ast.get());
+    for (const auto& error : builder.getErrors()) {
+        errors_.push_back("IR 构造失败: " + error);
+    }
+    if (!builder.getErrors().empty()) {
+        return false;
+    }
+    
+    if (ir_dump_) {
+        module->print(std::cout);
+    }
+    
+    IRVerifier verifier;
+    if (!verifier.verify(*module)) {
+        for (const auto& error : verifier.getErrors()) {
+            errors_.push_back("IR 验证失败: " + error);
+        }
+        return false;
+    }
+    if (verify_ir_) {
+        std::cout << "中间表示: " << module->functions.size() << " 个函数通过验证" << std::endl;
+    }
+    return true;
+}
+
+} // namespace capl
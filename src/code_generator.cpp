@@ -4,16 +4,1645 @@
 
 #include "../include/capl_compiler.h"
 #include "../include/ast.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
+#include <limits>
 #include <fstream>
 #include <functional>
+#include <set>
+#include <thread>
 
 namespace capl {
 
+namespace {
+
+/**
+ * 在线程池上执行 count 个相互独立的任务，调用线程也参与执行
+ * @param count 任务数
+ * @param threads 线程数（含调用线程）
+ * @param task 执行第 i 个任务
+ */
+void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& task) {
+    threads = static_cast<unsigned>(std::min<size_t>(std::max(threads, 1u), count));
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    
+    // 任务按下标依次领取；异常按任务保存，全部结束后重新抛出下标最小的一个
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(count);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            try {
+                task(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads && i < count; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/**
+ * 分片输出的文件路径：输出文件去掉扩展名后，头文件加 .h，
+ * 第 index 个分片加 _index 和原扩展名（没有扩展名时用 .cpp）
+ * @param output_file 输出文件路径
+ * @param index 分片序号，-1 表示共用头文件
+ */
+std::string shardPath(const std::string& output_file, int index) {
+    size_t slash = output_file.find_last_of('/');
+    size_t dot = output_file.find_last_of('.');
+    std::string stem = output_file;
+    std::string extension = ".cpp";
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash + 1)) {
+        stem = output_file.substr(0, dot);
+        extension = output_file.substr(dot);
+    }
+    return index < 0 ? stem + ".h" : stem + "_" + std::to_string(index) + extension;
+}
+
+/**
+ * 按大小把单元分配到分片：从大到小依次放入当前最小的分片，
+ * 大小相同的单元按源码顺序、负载相同的分片取序号小的，结果只取决于输入
+ * @param sizes 每个单元的大小（按源码顺序）
+ * @param loads 各分片已有的大小，分配后更新
+ * @return 每个单元所在的分片
+ */
+std::vector<size_t> balanceShards(const std::vector<size_t>& sizes, std::vector<size_t>& loads) {
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sizes[a] > sizes[b];
+    });
+    std::vector<size_t> shard_of(sizes.size(), 0);
+    for (size_t unit : order) {
+        size_t best = static_cast<size_t>(std::min_element(loads.begin(), loads.end()) - loads.begin());
+        shard_of[unit] = best;
+        loads[best] += sizes[unit];
+    }
+    return shard_of;
+}
+
+/**
+ * 按回绕语义运算的运行时库函数名
+ * @param op 二元运算符 (+ - *)
+ */
+std::string wrapFunction(const std::string& op) {
+    return op == "+" ? "capl_add" : (op == "-" ? "capl_sub" : "capl_mul");
+}
+
+/**
+ * 生成 C++ 字符串字面量
+ */
+std::string quoteString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        } else if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+            // 控制字符用 3 位八进制转义，不会与后面的字符连成一个转义
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\%03o", static_cast<unsigned char>(c));
+            quoted += escaped;
+            continue;
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/**
+ * 生成浮点常量：取能精确还原该值的最短写法，总是带小数点或指数
+ */
+std::string floatLiteral(double value) {
+    std::string text;
+    for (int precision = 1; precision <= 17; ++precision) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        text = buffer;
+        if (std::strtod(buffer, nullptr) == value) {
+            break;
+        }
+    }
+    if (text.find_first_of(".e") == std::string::npos) {
+        text += ".0";
+    }
+    return text;
+}
+
+/**
+ * 信号的访问器类型，如 Signal<0, 16, kIntel, kUnsigned>
+ */
+std::string signalAccessor(const SignalInfo& info) {
+    return "Signal<" + std::to_string(info.start_bit) + ", " + std::to_string(info.length) + ", " +
+           (info.little_endian ? "kIntel" : "kMotorola") + ", " + (info.is_signed ? "kSigned" : "kUnsigned") + ">";
+}
+
+/**
+ * factor 和 offset 都能精确表示为整数时，换算保持整数运算
+ */
+bool isIntegralScaling(const SignalInfo& info) {
+    const double kExactInteger = 9007199254740992.0;   // 2^53
+    auto isInteger = [&](double value) {
+        return value > -kExactInteger && value < kExactInteger &&
+               value == static_cast<double>(static_cast<long long>(value));
+    };
+    return isInteger(info.factor) && isInteger(info.offset);
+}
+
+/**
+ * 换算中的常量：整数换算时为整数，否则为浮点常量
+ */
+std::string scalingConstant(double value, bool integral) {
+    return integral ? std::to_string(static_cast<long long>(value)) : floatLiteral(value);
+}
+
+/**
+ * 数据库报文变量的初始值：报文 ID 和数据长度取自数据库，数据全 0
+ */
+std::string messageInitializer(const VariableDeclNode* decl) {
+    char buffer[48];
+    std::snprintf(buffer, sizeof(buffer), "{0x%x, %d, 0, 0, 0, {0}}", decl->getMessageId(), decl->getMessageDlc());
+    return buffer;
+}
+
+/**
+ * 格式标志：spec 为 true 时生成 printf 转换说明中的标志字符，否则生成运行时库的标志常量
+ */
+std::string formatFlags(unsigned flags, bool spec) {
+    static const struct {
+        unsigned flag;
+        char spec;
+        const char* name;
+    } kFlags[] = {
+        {WriteFormats::kLeft, '-', "kFormatLeft"},
+        {WriteFormats::kPlus, '+', "kFormatPlus"},
+        {WriteFormats::kSpace, ' ', "kFormatSpace"},
+        {WriteFormats::kAlternate, '#', "kFormatAlternate"},
+        {WriteFormats::kZero, '0', "kFormatZero"},
+    };
+    std::string result;
+    for (const auto& entry : kFlags) {
+        if (flags & entry.flag) {
+            if (spec) {
+                result += entry.spec;
+            } else {
+                result += (result.empty() ? "" : " | ") + std::string(entry.name);
+            }
+        }
+    }
+    return spec || !result.empty() ? result : "0";
+}
+
+/**
+ * 收集 $信号 读取的报文，每个报文 ID 取第一次出现的信号信息
+ */
+void collectSignalFrames(const ASTNode* node, std::map<uint32_t, const SignalInfo*>& frames) {
+    if (node->getType() == ASTNodeType::SIGNAL_ACCESS) {
+        const SignalAccessNode* signal = static_cast<const SignalAccessNode*>(node);
+        if (signal->isResolved()) {
+            frames.emplace(signal->getInfo().message_id, &signal->getInfo());
+        }
+    }
+    for (const auto& child : node->getChildren()) {
+        collectSignalFrames(child.get(), frames);
+    }
+}
+
+/**
+ * 事件名中不能出现在标识符里的字符改写为十六进制编码
+ */
+std::string sanitizeEventName(const std::string& name) {
+    if (name == "*") {
+        return "any";
+    }
+    std::string result;
+    for (char c : name) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            result += c;
+        } else {
+            static const char digits[] = "0123456789ABCDEF";
+            unsigned char code = static_cast<unsigned char>(c);
+            result += std::string("_x") + digits[code >> 4] + digits[code & 15];
+        }
+    }
+    return result;
+}
+
+/**
+ * 处理器生成的函数名：onStart、onStop、onMessage_<ID>、onTimer_<名称>、onKey_<按键>
+ */
+std::string handlerBaseName(const ASTNode* handler) {
+    const std::string& event = static_cast<const OnEventNode*>(handler)->getEventName();
+    switch (handler->getType()) {
+        case ASTNodeType::ON_START:
+            return "onStart";
+        case ASTNodeType::ON_STOP:
+            return "onStop";
+        case ASTNodeType::ON_MESSAGE:
+            return "onMessage_" + sanitizeEventName(event);
+        case ASTNodeType::ON_TIMER:
+            return "onTimer_" + sanitizeEventName(event);
+        default:
+            return "onKey_" + sanitizeEventName(event);
+    }
+}
+
+/**
+ * 生成用户函数的返回类型、名称和参数表
+ */
+std::string functionSignature(const FunctionNode* func) {
+    std::string signature = StateLayout::cppType(func->getReturnType()) + " " + func->getName() + "(";
+    const auto& params = func->getParameters();
+    for (size_t i = 0; i < params.size(); ++i) {
+        const VariableDeclNode* param = static_cast<const VariableDeclNode*>(params[i].get());
+        signature += (i > 0 ? ", " : "") + StateLayout::cppType(param->getVarType()) + " " +
+                     param->getName() + (param->getArraySize() != 0 ? "[]" : "");
+    }
+    return signature + ")";
+}
+
+/**
+ * 为处理器和 if 语句分配剖析计数器：处理器一个，if 语句的两个分支各一个。
+ * 内联产生的同一条源 if 语句的副本名称相同，共用计数器
+ */
+void assignProfileSlots(const ASTNode* node, std::map<std::string, size_t>& branch_slots,
+                        std::vector<std::string>& keys, std::map<const ASTNode*, size_t>& slots) {
+    switch (node->getType()) {
+        case ASTNodeType::ON_START:
+        case ASTNodeType::ON_MESSAGE:
+        case ASTNodeType::ON_TIMER:
+        case ASTNodeType::ON_KEY:
+        case ASTNodeType::ON_STOP:
+            slots[node] = keys.size();
+            keys.push_back("handler " + static_cast<const OnEventNode*>(node)->getDisplayName());
+            break;
+        case ASTNodeType::IF_STMT: {
+            const std::string& name = static_cast<const IfStmtNode*>(node)->getBranchName();
+            auto slot = branch_slots.emplace(name, keys.size());
+            slots[node] = slot.first->second;
+            if (slot.second) {
+                keys.push_back("branch " + name + " taken");
+                keys.push_back("branch " + name + " not_taken");
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    for (const auto& child : node->getChildren()) {
+        assignProfileSlots(child.get(), branch_slots, keys, slots);
+    }
+}
+
+} // namespace
+
 /**
  * 构造函数
  */
-CodeGenerator::CodeGenerator() {
+CodeGenerator::CodeGenerator()
+    : fold_handlers_(false), compile_routes_(false), vectorize_loops_(false),
+      eliminate_bounds_checks_(false), narrow_integers_(false), profile_(nullptr), threads_(0), shards_(0) {
+}
+
+/**
+ * 生成全局状态结构体
+ * @param out 输出流
+ */
+void CodeGenerator::generateStateStruct(OutputBuffer& out) {
+    const auto& fields = state_layout_.getFields();
+    if (fields.empty()) {
+        return;
+    }
+    
+    // 成员初始化中引用其他全局变量时直接使用成员名
+    UnitContext unit;
+    for (const auto& field : fields) {
+        unit.locals.insert(field.name);
+    }
+    
+    out << "// 全局状态：写入者相同的变量为一组，每组独占缓存行；定时器和报文缓存在最后一组\n";
+    out << "struct alignas(" << StateLayout::kCacheLineSize << ") " << StateLayout::kStructName << " {\n";
+    int current_group = -1;
+    for (const auto& field : fields) {
+        out << "    ";
+        if (field.group != current_group) {
+            current_group = field.group;
+            out << "alignas(" << StateLayout::kCacheLineSize << ") ";
+        }
+        out << field.cpp_type << " " << field.name;
+        if (field.array_size > 0) {
+            out << "[" << field.array_size << "]";
+        }
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(field.decl);
+        if (decl && decl->getInitializer()) {
+            out << " = " << generateExpr(decl->getInitializer(), unit);
+        } else if (decl && decl->hasMessageId() && !decl->isArray()) {
+            out << " = " << messageInitializer(decl);
+        } else if (!field.initializer.empty()) {
+            out << " = " << field.initializer;
+        }
+        out << ";  // 偏移 " << field.offset << "\n";
+    }
+    out << "};\n";
+    
+    // 布局分析与编译器实际布局必须一致
+    out << "static_assert(sizeof(" << StateLayout::kStructName << ") == " << state_layout_.getTotalSize()
+        << ", \"状态结构体大小与布局分析不一致\");\n";
+    for (const auto& field : fields) {
+        out << "static_assert(offsetof(" << StateLayout::kStructName << ", " << field.name << ") == "
+            << field.offset << ", \"" << field.name << " 偏移与布局分析不一致\");\n";
+    }
+    out << "static_assert(__is_trivially_copyable(" << StateLayout::kStructName << "), \"状态结构体必须可以按字节复制\");\n";
+    out << sharedLinkage() << StateLayout::kStructName << " " << StateLayout::kInstanceName << ";\n\n";
+}
+
+/**
+ * 生成剖析计数器和退出时写入剖析文件的静态对象
+ * @param out 输出流
+ */
+void CodeGenerator::generateProfileCounters(OutputBuffer& out) {
+    if (profile_keys_.empty()) {
+        return;
+    }
+    
+    out << "// 运行剖析计数器（--profile-generate），程序退出时写入 " << profile_generate_ << "\n";
+    out << sharedLinkage() << "unsigned long long capl_profile_counts[" << profile_keys_.size() << "];\n";
+    out << sharedLinkage() << "const char* const capl_profile_keys[" << profile_keys_.size() << "] = {\n";
+    for (const auto& key : profile_keys_) {
+        out << "    " << quoteString(key) << ",\n";
+    }
+    out << "};\n";
+    out << "struct CaplProfileWriter {\n";
+    out << "    ~CaplProfileWriter() {\n";
+    out << "        capl_write_profile(" << quoteString(profile_generate_) << ", capl_profile_keys, capl_profile_counts, "
+        << profile_keys_.size() << ");\n";
+    out << "    }\n";
+    out << "};\n";
+    out << sharedLinkage() << "CaplProfileWriter capl_profile_writer;\n\n";
+}
+
+/**
+ * 处理器的执行频率：合并的处理器取等价类中最热的一个
+ * @param handler 事件处理器节点
+ * @return 频率分类，没有剖析数据时为 Unknown
+ */
+Heat CodeGenerator::handlerHeat(const ASTNode* handler) const {
+    if (!profile_) {
+        return Heat::Unknown;
+    }
+    std::vector<const ASTNode*> handlers = {handler};
+    if (const HandlerClass* handlerClass = handler_folding_.findClass(handler)) {
+        handlers = handlerClass->handlers;
+    }
+    Heat heat = Heat::Unknown;
+    for (const ASTNode* member : handlers) {
+        heat = std::max(heat, profile_->getHeat(static_cast<const OnEventNode*>(member)->getDisplayName()));
+    }
+    return heat;
+}
+
+/**
+ * 生成报文分派表和分派函数 capl_dispatch：先一次查表找处理器，
+ * 未命中时依次尝试网关路由和 on message * 处理器。capl_dispatch 是外部驱动的入口，
+ * 声明在 capl_rt.h 中，没有报文处理器时也生成
+ * @param out 输出流
+ */
+void CodeGenerator::generateMessageDispatch(OutputBuffer& out) {
+    const auto& entries = message_dispatch_.getEntries();
+    bool routes = !gateway_routes_.getRoutes().empty();
+    const ASTNode* wildcard = message_dispatch_.getWildcard();
+    if (entries.empty() && !routes && !wildcard && signal_frames_.empty()) {
+        out << "// 按报文 ID 分派：没有报文处理器\n";
+        out << "int capl_dispatch(Message*) {\n";
+        out << "    return 0;\n";
+        out << "}\n\n";
+        return;
+    }
+    
+    size_t size = message_dispatch_.getTableSize();
+    std::vector<const DispatchEntry*> slots(size, nullptr);
+    for (const auto& entry : entries) {
+        slots[entry.slot] = &entry;
+    }
+    if (message_dispatch_.getKind() == DispatchKind::Direct) {
+        out << "// 报文分派表：ID 0x" << std::hex << message_dispatch_.getBase() << "-0x"
+            << message_dispatch_.getBase() + size - 1 << std::dec << " 直接索引 (" << entries.size()
+            << " 个处理器, " << size << " 项)\n";
+        out << "using CaplMessageHandler = void (*)(Message&);\n";
+        out << "static const CaplMessageHandler capl_message_table[" << size << "] = {\n";
+        for (const DispatchEntry* entry : slots) {
+            out << "    " << (entry ? handler_names_[entry->handler] : "nullptr") << ",\n";
+        }
+        out << "};\n\n";
+    } else if (message_dispatch_.getKind() == DispatchKind::PerfectHash) {
+        const auto& displacements = message_dispatch_.getDisplacements();
+        out << "// 报文分派表：" << entries.size() << " 个 ID 的完美散列 (" << displacements.size() << " 个桶, "
+            << size << " 项)，ID 选桶取位移后散列到唯一的表项\n";
+        out << "using CaplMessageHandler = void (*)(Message&);\n";
+        out << "struct CaplMessageSlot {\n";
+        out << "    uint32_t id;\n";
+        out << "    CaplMessageHandler handler;\n";
+        out << "};\n";
+        out << "static const uint32_t capl_message_displacements[" << displacements.size() << "] = {";
+        for (size_t i = 0; i < displacements.size(); ++i) {
+            out << (i > 0 ? ", " : "") << displacements[i];
+        }
+        out << "};\n";
+        out << "static const CaplMessageSlot capl_message_slots[" << size << "] = {\n";
+        for (const DispatchEntry* entry : slots) {
+            if (entry) {
+                out << "    {0x" << std::hex << entry->id << std::dec << ", " << handler_names_[entry->handler] << "},\n";
+            } else {
+                out << "    {0, nullptr},\n";
+            }
+        }
+        out << "};\n";
+        out << "inline uint32_t capl_message_mix(uint32_t x) {\n";
+        out << "    x ^= x >> 16;\n";
+        out << "    x *= 0x7FEB352Du;\n";
+        out << "    x ^= x >> 15;\n";
+        out << "    x *= 0x846CA68Bu;\n";
+        out << "    x ^= x >> 16;\n";
+        out << "    return x;\n";
+        out << "}\n\n";
+    }
+    
+    out << "// 按报文 ID 分派，返回是否有处理器或路由处理了该报文\n";
+    out << "int capl_dispatch(Message* frame) {\n";
+    out << "    Message& msg = *frame;\n";
+    if (!signal_frames_.empty()) {
+        // 处理器执行前更新报文缓存，处理器中的 $信号 读到的是本帧的值
+        out << "    switch (msg.id) {\n";
+        for (const auto& frame : signal_frames_) {
+            out << "        case 0x" << std::hex << frame.first << std::dec << ": " << StateLayout::kInstanceName << ".capl_rx_"
+                << frame.second->message << " = msg; break;\n";
+        }
+        out << "    }\n";
+    }
+    if (message_dispatch_.getKind() == DispatchKind::Direct) {
+        out << "    uint32_t index = msg.id - 0x" << std::hex << message_dispatch_.getBase() << std::dec << "u;\n";
+        out << "    if (index < " << size << "u && capl_message_table[index]) {\n";
+        out << "        capl_message_table[index](msg);\n";
+        out << "        return 1;\n";
+        out << "    }\n";
+    } else if (message_dispatch_.getKind() == DispatchKind::PerfectHash) {
+        out << "    uint32_t bucket = (msg.id * 0x" << std::hex << MessageDispatch::kBucketMultiplier << std::dec
+            << "u) >> " << message_dispatch_.getBucketShift() << ";\n";
+        out << "    const CaplMessageSlot& slot = capl_message_slots[capl_message_mix(msg.id ^ "
+            << "capl_message_displacements[bucket]) & " << size - 1 << "u];\n";
+        out << "    if (slot.handler && slot.id == msg.id) {\n";
+        out << "        slot.handler(msg);\n";
+        out << "        return 1;\n";
+        out << "    }\n";
+    }
+    if (routes) {
+        out << "    if (capl_route(msg)) {\n";
+        out << "        return 1;\n";
+        out << "    }\n";
+    }
+    if (wildcard) {
+        out << "    " << handler_names_[wildcard] << "(msg);\n";
+        out << "    return 1;\n";
+    } else {
+        out << "    return 0;\n";
+    }
+    out << "}\n\n";
+}
+
+/**
+ * 生成定时器的设置和取消，定时器槽位和仿真时间保存在全局状态结构体中
+ * @param out 输出流
+ */
+void CodeGenerator::generateTimerFunctions(OutputBuffer& out) {
+    if (event_tables_.getTimers().empty()) {
+        return;
+    }
+    const std::string state = StateLayout::kInstanceName;
+    out << "inline void setTimer(int timer, long long ms) {\n";
+    out << "    " << state << ".timers[timer].deadline = " << state << ".now_ms + ms;\n";
+    out << "    " << state << ".timers[timer].armed = true;\n";
+    out << "}\n";
+    out << "\n";
+    out << "inline void cancelTimer(int timer) {\n";
+    out << "    " << state << ".timers[timer].armed = false;\n";
+    out << "}\n\n";
+}
+
+/**
+ * 生成节点状态的快照和恢复：全局变量、报文缓存和定时器都在一个平凡可复制的结构体中，
+ * 各是一次 memcpy，测试可以在同一进程中反复把节点复位到保存的状态
+ * @param out 输出流
+ */
+void CodeGenerator::generateStateSnapshot(OutputBuffer& out) {
+    size_t size = state_layout_.getTotalSize();
+    out << "// 节点状态的快照和恢复，缓冲区至少 capl_state_size() 字节\n";
+    out << "size_t capl_state_size(void) {\n";
+    out << "    return " << size << ";\n";
+    out << "}\n";
+    if (size == 0) {
+        out << "void capl_snapshot(void*) {}\n";
+        out << "void capl_restore(const void*) {}\n\n";
+        return;
+    }
+    out << "void capl_snapshot(void* buffer) {\n";
+    out << "    memcpy(buffer, &" << StateLayout::kInstanceName << ", sizeof(" << StateLayout::kStructName << "));\n";
+    out << "}\n";
+    out << "void capl_restore(const void* buffer) {\n";
+    out << "    memcpy(&" << StateLayout::kInstanceName << ", buffer, sizeof(" << StateLayout::kStructName << "));\n";
+    out << "}\n\n";
+}
+
+/**
+ * 生成信号的读取：访问器取出原始值，再按 factor 和 offset 换算为物理值，
+ * 位置和换算都是常量，由 C++ 编译器折叠
+ * @param info 信号信息
+ * @param frame 报文表达式
+ * @return 表达式代码
+ */
+std::string CodeGenerator::generateSignalRead(const SignalInfo& info, const std::string& frame) const {
+    std::string raw = signalAccessor(info) + "::get(" + frame + ")";
+    if (info.factor == 1.0 && info.offset == 0.0) {
+        return raw;
+    }
+    
+    bool integral = isIntegralScaling(info);
+    std::string result = "(" + raw;
+    if (info.factor != 1.0) {
+        std::string factor = scalingConstant(info.factor, integral);
+        result += " * " + (info.factor < 0 ? "(" + factor + ")" : factor);
+    }
+    if (info.offset != 0.0) {
+        result += (info.offset < 0 ? " - " : " + ") + scalingConstant(std::fabs(info.offset), integral);
+    }
+    return result + ")";
+}
+
+/**
+ * 生成信号的写入：物理值按 (值 - offset) / factor 换算回原始值后写入报文，
+ * 非整数换算时四舍五入
+ * @param info 信号信息
+ * @param frame 报文表达式
+ * @param value 物理值表达式
+ * @return 表达式代码
+ */
+std::string CodeGenerator::generateSignalWrite(const SignalInfo& info, const std::string& frame,
+                                               const std::string& value) const {
+    std::string raw = value;
+    if (info.factor != 1.0 || info.offset != 0.0) {
+        bool integral = isIntegralScaling(info);
+        if (info.offset != 0.0) {
+            raw = "(" + value + (info.offset < 0 ? " + " : " - ") + scalingConstant(std::fabs(info.offset), integral) +
+                  ")";
+        }
+        if (info.factor != 1.0) {
+            std::string factor = scalingConstant(info.factor, integral);
+            raw += " / " + (info.factor < 0 ? "(" + factor + ")" : factor);
+        }
+        if (!integral) {
+            raw = "capl_signal_round(" + raw + ")";
+        }
+    }
+    return signalAccessor(info) + "::set(" + frame + ", " + raw + ")";
+}
+
+/**
+ * 生成 write 的格式化：文本段带长度直接拷贝，每个转换调用对应类型的格式化函数，
+ * 整数先按转换的位宽和符号转换
+ * @param plan 格式化方式
+ * @param unit 所在单元的生成状态
+ * @return 表达式代码
+ */
+std::string CodeGenerator::generateWrite(const FormatPlan& plan, const UnitContext& unit) const {
+    std::string result = "WriteLine()";
+    for (const FormatSegment& segment : plan.segments) {
+        if (segment.kind == FormatSegment::Kind::Text) {
+            result += ".text(" + quoteString(segment.text) + ", " + std::to_string(segment.text.size()) + ")";
+            continue;
+        }
+        if (segment.kind == FormatSegment::Kind::Float) {
+            // 转换说明在编译期生成，运行时不再解析格式字符串
+            std::string spec = "%" + formatFlags(segment.flags, true);
+            if (segment.width > 0) {
+                spec += std::to_string(segment.width);
+            }
+            if (segment.precision >= 0) {
+                spec += "." + std::to_string(segment.precision);
+            }
+            result += ".real(\"" + spec + segment.conversion + "\", static_cast<double>(" +
+                      generateExpr(plan.call->getChild(segment.arg), unit) + "))";
+            continue;
+        }
+        
+        std::string value = generateExpr(plan.call->getChild(segment.arg), unit);
+        std::string method;
+        switch (segment.kind) {
+            case FormatSegment::Kind::Char:
+                method = "chr";
+                value = "static_cast<char>(" + value + ")";
+                break;
+            case FormatSegment::Kind::String:
+                method = "str";
+                break;
+            default:
+                method = segment.conversion == 'x'   ? "hex"
+                         : segment.conversion == 'X' ? "hexUpper"
+                         : segment.conversion == 'o' ? "oct"
+                         : segment.conversion == 'u' ? "udec"
+                                                     : "dec";
+                value = std::string("static_cast<") + (segment.is_signed ? "int" : "uint") +
+                        std::to_string(segment.bits) + "_t>(" + value + ")";
+                break;
+        }
+        
+        // 省略默认的宽度、标志和精度
+        std::vector<std::string> args = {value};
+        bool has_precision = segment.precision >= 0 && segment.kind != FormatSegment::Kind::Char;
+        if (segment.width > 0 || segment.flags != 0 || has_precision) {
+            args.push_back(std::to_string(segment.width));
+        }
+        if (segment.flags != 0 || has_precision) {
+            args.push_back(formatFlags(segment.flags, false));
+        }
+        if (has_precision) {
+            args.push_back(std::to_string(segment.precision));
+        }
+        result += "." + method + "(";
+        for (size_t i = 0; i < args.size(); ++i) {
+            result += (i > 0 ? ", " : "") + args[i];
+        }
+        result += ")";
+    }
+    return result + ".end()";
+}
+
+/**
+ * 生成定时器 ID 的枚举
+ * @param out 输出流
+ */
+void CodeGenerator::generateTimerIds(OutputBuffer& out) {
+    const auto& timers = event_tables_.getTimers();
+    if (timers.empty()) {
+        return;
+    }
+    out << "// 定时器 ID：按 on timer 处理器的顺序在编译期分配\n";
+    out << "enum CaplTimerId : int {\n";
+    for (const auto& timer : timers) {
+        out << "    capl_timer_" << timer.name << " = " << timer.id << ",\n";
+    }
+    out << "};\n\n";
+}
+
+/**
+ * 生成定时器和按键的分派：定时器处理器数组以定时器 ID 为下标，
+ * 按键处理器数组以按键编码为下标，在编译期填好
+ * @param out 输出流
+ */
+void CodeGenerator::generateEventDispatch(OutputBuffer& out) {
+    const auto& timers = event_tables_.getTimers();
+    if (timers.empty()) {
+        out << "// 推进仿真时间：没有定时器\n";
+        out << "void capl_advance_time(long long) {}\n\n";
+    } else {
+        out << "// 定时器分派表：下标为定时器 ID\n";
+        out << "using CaplTimerHandler = void (*)();\n";
+        out << "static const CaplTimerHandler capl_timer_handlers[" << timers.size() << "] = {\n";
+        for (const auto& timer : timers) {
+            out << "    " << handler_names_[timer.handler] << ",\n";
+        }
+        out << "};\n\n";
+        out << "// 推进仿真时间，依次触发到期的定时器\n";
+        out << "void capl_advance_time(long long ms) {\n";
+        out << "    " << StateLayout::kInstanceName << ".now_ms += ms;\n";
+        out << "    for (int timer = 0; timer < " << timers.size() << "; ++timer) {\n";
+        out << "        TimerSlot& slot = " << StateLayout::kInstanceName << ".timers[timer];\n";
+        out << "        if (slot.armed && slot.deadline <= " << StateLayout::kInstanceName << ".now_ms) {\n";
+        out << "            slot.armed = false;\n";
+        out << "            capl_timer_handlers[timer]();\n";
+        out << "        }\n";
+        out << "    }\n";
+        out << "}\n\n";
+    }
+    
+    if (!event_tables_.hasKeyHandlers()) {
+        out << "// 分派按键事件：没有按键处理器\n";
+        out << "void capl_dispatch_key(unsigned char) {}\n\n";
+        return;
+    }
+    for (const ASTNode* handler : event_tables_.getUnresolvedKeys()) {
+        out << "// " << static_cast<const OnEventNode*>(handler)->getDisplayName()
+            << ": 按键无法用一个字节表示，未加入按键数组\n";
+    }
+    const ASTNode* wildcard = event_tables_.getKeyWildcard();
+    out << "// 按键分派表：下标为按键编码，" << (wildcard ? "其余按键由 on key * 处理" : "没有处理器的项为空") << "\n";
+    out << "using CaplKeyHandler = void (*)();\n";
+    out << "struct CaplKeyTable {\n";
+    out << "    CaplKeyHandler handlers[" << EventTables::kKeyCount << "];\n";
+    out << "};\n";
+    out << "static constexpr CaplKeyTable capl_make_key_table() {\n";
+    out << "    CaplKeyTable table{};\n";
+    if (wildcard) {
+        out << "    for (CaplKeyHandler& handler : table.handlers) {\n";
+        out << "        handler = " << handler_names_[wildcard] << ";\n";
+        out << "    }\n";
+    }
+    const auto& keys = event_tables_.getKeyHandlers();
+    for (int code = 0; code < EventTables::kKeyCount; ++code) {
+        if (keys[code]) {
+            out << "    table.handlers[" << code << "] = " << handler_names_[keys[code]] << ";  // "
+                << static_cast<const OnEventNode*>(keys[code])->getDisplayName() << "\n";
+        }
+    }
+    out << "    return table;\n";
+    out << "}\n";
+    out << "static constexpr CaplKeyTable capl_key_table = capl_make_key_table();\n\n";
+    out << "// 分派按键事件\n";
+    out << "void capl_dispatch_key(unsigned char key) {\n";
+    if (wildcard) {
+        out << "    capl_key_table.handlers[key]();\n";
+    } else {
+        out << "    if (capl_key_table.handlers[key]) {\n";
+        out << "        capl_key_table.handlers[key]();\n";
+        out << "    }\n";
+    }
+    out << "}\n\n";
+}
+
+/**
+ * 生成网关路由表：收到报文时按 ID 二分查找，命中的路由改写报文头后直接转发
+ * @param out 输出流
+ */
+void CodeGenerator::generateGatewayRoutes(OutputBuffer& out) {
+    const auto& routes = gateway_routes_.getRoutes();
+    if (routes.empty()) {
+        return;
+    }
+    
+    out << "// 网关路由表：纯转发的报文处理器，按接收 ID 排序\n";
+    out << "struct CaplRoute {\n";
+    out << "    unsigned int id;            // 接收的报文 ID\n";
+    out << "    unsigned int out_id;        // 转发的报文 ID\n";
+    out << "    int out_channel;            // 转发的通道，-1 表示沿用接收通道\n";
+    out << "};\n";
+    out << "static const CaplRoute capl_routes[" << routes.size() << "] = {\n";
+    for (const auto& route : routes) {
+        out << "    {0x" << std::hex << route.id << ", 0x" << route.out_id << std::dec << ", "
+            << route.out_channel << "},  // "
+            << static_cast<const OnEventNode*>(route.handler)->getDisplayName() << "\n";
+    }
+    out << "};\n\n";
+    
+    // 有剖析数据时，热点处理器的路由按执行次数排在前面，先线性比较
+    std::vector<GatewayRoute> hot_routes;
+    if (profile_) {
+        for (const auto& route : routes) {
+            if (handlerHeat(route.handler) == Heat::Hot) {
+                hot_routes.push_back(route);
+            }
+        }
+        std::stable_sort(hot_routes.begin(), hot_routes.end(), [&](const GatewayRoute& a, const GatewayRoute& b) {
+            return profile_->getHandlerCount(static_cast<const OnEventNode*>(a.handler)->getDisplayName()) >
+                   profile_->getHandlerCount(static_cast<const OnEventNode*>(b.handler)->getDisplayName());
+        });
+    }
+    if (!hot_routes.empty()) {
+        out << "// 热点路由，按剖析的执行次数排序\n";
+        out << "static const CaplRoute capl_hot_routes[" << hot_routes.size() << "] = {\n";
+        for (const auto& route : hot_routes) {
+            out << "    {0x" << std::hex << route.id << ", 0x" << route.out_id << std::dec << ", "
+                << route.out_channel << "},  // "
+                << static_cast<const OnEventNode*>(route.handler)->getDisplayName() << "\n";
+        }
+        out << "};\n\n";
+    }
+    
+    out << "// 按路由表转发报文，返回是否命中；同一 ID 的多条路由依次转发\n";
+    out << "static bool capl_route(const Message& msg) {\n";
+    out << "    bool hit = false;\n";
+    if (!hot_routes.empty()) {
+        out << "    for (const CaplRoute& hot : capl_hot_routes) {\n";
+        out << "        if (hot.id == msg.id) {\n";
+        out << "            forward(msg, hot.out_id, hot.out_channel < 0 ? msg.channel : hot.out_channel);\n";
+        out << "            hit = true;\n";
+        out << "        }\n";
+        out << "    }\n";
+        out << "    if (hit) {\n";
+        out << "        return true;\n";
+        out << "    }\n";
+    }
+    out << "    const CaplRoute* end = capl_routes + " << routes.size() << ";\n";
+    out << "    const CaplRoute* route = std::lower_bound(capl_routes, end, msg.id,\n";
+    out << "        [](const CaplRoute& entry, unsigned int id) { return entry.id < id; });\n";
+    out << "    for (; route != end && route->id == msg.id; ++route) {\n";
+    out << "        forward(msg, route->out_id, route->out_channel < 0 ? msg.channel : route->out_channel);\n";
+    out << "        hit = true;\n";
+    out << "    }\n";
+    out << "    return hit;\n";
+    out << "}\n\n";
+}
+
+/**
+ * 把各处理器和用户函数生成的代码按大小分配到分片，每个分片引用共用头文件
+ * @param units 每个顶层单元生成的代码（按源码顺序）
+ * @param main_part 路由表、分派表和 main，放在第一个分片
+ * @param output_file 输出文件路径，决定头文件和分片的文件名
+ * @return 各分片的代码
+ */
+std::vector<OutputBuffer> CodeGenerator::generateShards(const std::vector<OutputBuffer>& units,
+                                                        const OutputBuffer& main_part,
+                                                        const std::string& output_file) {
+    // 以生成代码的字节数估算下游编译开销，第一个分片预先计入 main 部分
+    std::vector<size_t> sizes;
+    for (const auto& unit : units) {
+        sizes.push_back(unit.size());
+    }
+    // 分片数不超过生成了代码的单元数，不输出只包含头文件引用的空分片
+    size_t nonempty = 0;
+    for (const auto& unit : units) {
+        nonempty += unit.size() > 0 ? 1 : 0;
+    }
+    unsigned count = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(shards_, nonempty)));
+    std::vector<size_t> loads(count, 0);
+    loads[0] = main_part.size();
+    std::vector<size_t> shard_of = balanceShards(sizes, loads);
+    
+    std::string header = shardPath(output_file, -1);
+    size_t slash = header.find_last_of('/');
+    std::string header_name = slash == std::string::npos ? header : header.substr(slash + 1);
+    
+    std::vector<OutputBuffer> shards;
+    output_shards_.clear();
+    for (unsigned i = 0; i < count; ++i) {
+        shards.emplace_back(loads[i] + 256);
+        shards.back() << "// 由 CAPL 编译器生成的 C++ 代码（分片 " << i + 1 << "/" << count << "）\n";
+        shards.back() << "#include \"" << header_name << "\"\n\n";
+        OutputShard info;
+        info.path = shardPath(output_file, static_cast<int>(i));
+        output_shards_.push_back(info);
+    }
+    for (size_t i = 0; i < units.size(); ++i) {
+        if (units[i].size() == 0) {
+            continue;
+        }
+        shards[shard_of[i]] << units[i].str();
+        output_shards_[shard_of[i]].units++;
+    }
+    shards[0] << main_part.str();
+    for (unsigned i = 0; i < count; ++i) {
+        output_shards_[i].bytes = shards[i].size();
+    }
+    return shards;
+}
+
+/**
+ * 名称是否为单元中的局部变量（形参、内核的操作数或外层代码块中已声明的变量）
+ * @param name 变量名
+ */
+bool CodeGenerator::UnitContext::isLocal(const std::string& name) const {
+    if (locals.count(name)) {
+        return true;
+    }
+    for (const auto& scope : scopes) {
+        if (scope.count(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 生成表达式代码
+ * @param node 表达式节点
+ * @param unit 所在单元的生成状态
+ * @return 表达式代码
+ */
+std::string CodeGenerator::generateExpr(ASTNode* node, const UnitContext& unit) const {
+    if (!node) {
+        return "";
+    }
+    
+    switch (node->getType()) {
+        case ASTNodeType::INTEGER_LITERAL:
+        case ASTNodeType::FLOAT_LITERAL: {
+            LiteralNode* litNode = static_cast<LiteralNode*>(node);
+            // 折叠产生的负数常量加括号，避免与前面的运算符连成 --
+            if (!litNode->getValue().empty() && litNode->getValue()[0] == '-') {
+                return "(" + litNode->getValue() + ")";
+            }
+            return litNode->getValue();
+        }
+        case ASTNodeType::STRING_LITERAL:
+        case ASTNodeType::CHAR_LITERAL: {
+            LiteralNode* litNode = static_cast<LiteralNode*>(node);
+            char quote = node->getType() == ASTNodeType::STRING_LITERAL ? '"' : '\'';
+            std::string result(1, quote);
+            for (char c : litNode->getValue()) {
+                switch (c) {
+                    case '\n': result += "\\n"; break;
+                    case '\t': result += "\\t"; break;
+                    case '\r': result += "\\r"; break;
+                    case '\\': result += "\\\\"; break;
+                    case '"':  result += quote == '"' ? "\\\"" : "\""; break;
+                    case '\'': result += quote == '\'' ? "\\'" : "'"; break;
+                    default:   result += c; break;
+                }
+            }
+            result += quote;
+            return result;
+        }
+        case ASTNodeType::IDENTIFIER: {
+            IdentifierNode* idNode = static_cast<IdentifierNode*>(node);
+            // CAPL 的 this 指当前报文，C++ 中 this 是关键字
+            if (idNode->getName() == "this") {
+                return "this_msg";
+            }
+            // 全局变量位于状态结构体中
+            if (!unit.isLocal(idNode->getName()) && state_layout_.findField(idNode->getName())) {
+                return std::string(StateLayout::kInstanceName) + "." + idNode->getName();
+            }
+            // 定时器名称替换为编译期分配的 ID
+            if (!unit.isLocal(idNode->getName()) && event_tables_.findTimer(idNode->getName()) >= 0) {
+                return "capl_timer_" + idNode->getName();
+            }
+            return idNode->getName();
+        }
+        case ASTNodeType::BINARY_EXPR: {
+            BinaryExprNode* binNode = static_cast<BinaryExprNode*>(node);
+            if (integer_wrap_.needsWrap(node)) {
+                return wrapFunction(binNode->getOperator()) + "(" + generateExpr(node->getChild(0), unit) +
+                       ", " + generateExpr(node->getChild(1), unit) + ")";
+            }
+            return "(" + generateExpr(node->getChild(0), unit) + " " + binNode->getOperator() + " " +
+                   generateExpr(node->getChild(1), unit) + ")";
+        }
+        case ASTNodeType::UNARY_EXPR: {
+            UnaryExprNode* unNode = static_cast<UnaryExprNode*>(node);
+            if (integer_wrap_.needsWrap(node)) {
+                const std::string& op = unNode->getOperator();
+                std::string name = op == "-" ? "capl_neg"
+                                   : std::string(unNode->isPostfix() ? "capl_post_" : "capl_pre_") +
+                                         (op == "++" ? "inc" : "dec");
+                return name + "(" + generateExpr(node->getChild(0), unit) + ")";
+            }
+            if (unNode->isPostfix()) {
+                return generateExpr(node->getChild(0), unit) + unNode->getOperator();
+            }
+            return unNode->getOperator() + generateExpr(node->getChild(0), unit);
+        }
+        case ASTNodeType::ASSIGNMENT_EXPR: {
+            AssignmentExprNode* assignNode = static_cast<AssignmentExprNode*>(node);
+            // 数据库报文的信号成员通过访问器写入（只支持 =）
+            ASTNode* target = node->getChild(0);
+            if (target->getType() == ASTNodeType::MEMBER_EXPR &&
+                static_cast<MemberExprNode*>(target)->getSignal()) {
+                return generateSignalWrite(*static_cast<MemberExprNode*>(target)->getSignal(),
+                                           generateExpr(target->getChild(0), unit),
+                                           generateExpr(node->getChild(1), unit));
+            }
+            if (integer_wrap_.needsWrap(node)) {
+                const std::string& op = assignNode->getOperator();
+                return wrapFunction(op.substr(0, op.size() - 1)) + "_assign(" +
+                       generateExpr(node->getChild(0), unit) + ", " + generateExpr(node->getChild(1), unit) + ")";
+            }
+            return generateExpr(node->getChild(0), unit) + " " + assignNode->getOperator() + " " +
+                   generateExpr(node->getChild(1), unit);
+        }
+        case ASTNodeType::CALL_EXPR: {
+            CallExprNode* callNode = static_cast<CallExprNode*>(node);
+            if (const FormatPlan* plan = write_formats_.findPlan(node)) {
+                return generateWrite(*plan, unit);
+            }
+            std::string result = callNode->getFunctionName() + "(";
+            for (size_t i = 0; i < node->getChildCount(); ++i) {
+                result += (i > 0 ? ", " : "") + generateExpr(node->getChild(i), unit);
+            }
+            return result + ")";
+        }
+        case ASTNodeType::MEMBER_EXPR: {
+            MemberExprNode* memberNode = static_cast<MemberExprNode*>(node);
+            if (memberNode->getSignal()) {
+                return generateSignalRead(*memberNode->getSignal(), generateExpr(node->getChild(0), unit));
+            }
+            std::string result = generateExpr(node->getChild(0), unit) + "." + memberNode->getMember();
+            if (memberNode->isCall()) {
+                result += "(";
+                for (size_t i = 1; i < node->getChildCount(); ++i) {
+                    result += (i > 1 ? ", " : "") + generateExpr(node->getChild(i), unit);
+                }
+                result += ")";
+            }
+            return result;
+        }
+        case ASTNodeType::INDEX_EXPR: {
+            // 证明不会越界的下标在未要求保留检查时省略检查
+            std::string index = generateExpr(node->getChild(1), unit);
+            const IndexCheck* check = bounds_check_.findCheck(node);
+            if (check && !(eliminate_bounds_checks_ && check->proven)) {
+                index = "capl_check_index(" + index + ", " + std::to_string(check->size) + ", \"" +
+                        check->array + "\", " + std::to_string(node->getLine()) + ")";
+            }
+            return generateExpr(node->getChild(0), unit) + "[" + index + "]";
+        }
+        case ASTNodeType::CONDITIONAL_EXPR:
+            return "(" + generateExpr(node->getChild(0), unit) + " ? " + generateExpr(node->getChild(1), unit) +
+                   " : " + generateExpr(node->getChild(2), unit) + ")";
+        case ASTNodeType::SIGNAL_ACCESS: {
+            const SignalInfo& info = static_cast<SignalAccessNode*>(node)->getInfo();
+            return generateSignalRead(info, std::string(StateLayout::kInstanceName) + ".capl_rx_" + info.message);
+        }
+        default:
+            return "";
+    }
+}
+
+/**
+ * 生成条件表达式，省略最外层括号
+ * @param node 条件表达式节点
+ * @param unit 所在单元的生成状态
+ */
+std::string CodeGenerator::generateCond(ASTNode* node, const UnitContext& unit) const {
+    std::string cond = generateExpr(node, unit);
+    if (node && node->getType() == ASTNodeType::BINARY_EXPR) {
+        return cond.substr(1, cond.size() - 2);
+    }
+    return cond;
+}
+
+/**
+ * 生成变量声明（不含分号）
+ * @param var 变量声明节点
+ * @param unit 所在单元的生成状态
+ */
+std::string CodeGenerator::generateDecl(VariableDeclNode* var, const UnitContext& unit) const {
+    std::string result = StateLayout::cppType(var->getVarType()) + " " + var->getName();
+    if (var->isArray()) {
+        result += "[" + std::to_string(var->getArraySize()) + "]";
+    }
+    if (var->getInitializer()) {
+        result += " = " + generateExpr(var->getInitializer(), unit);
+    } else if (var->hasMessageId() && !var->isArray()) {
+        result += " = " + messageInitializer(var);
+    }
+    return result;
+}
+
+/**
+ * 生成事件处理函数，合并的处理器只由代表生成
+ * @param handler 事件处理器节点
+ * @param out 输出流
+ * @param indent 缩进层数
+ * @param comment 事件类型注释
+ * @param unit 处理器的生成状态
+ */
+void CodeGenerator::generateHandler(ASTNode* handler, OutputBuffer& out, int indent, const char* comment,
+                                    UnitContext& unit) {
+    if (!handler_folding_.isRepresentative(handler) || gateway_routes_.isForwarder(handler)) {
+        return;
+    }
+    const std::string& indentStr = out.indent(indent);
+    const HandlerClass* handlerClass = handler_folding_.findClass(handler);
+    if (handlerClass && handlerClass->handlers.size() > 1) {
+        out << indentStr << "// ";
+        for (size_t i = 0; i < handlerClass->handlers.size(); ++i) {
+            out << (i > 0 ? ", " : "")
+                << static_cast<const OnEventNode*>(handlerClass->handlers[i])->getDisplayName();
+        }
+        out << " 事件处理（" << handlerClass->handlers.size() << " 个处理器共用）\n";
+    } else {
+        out << indentStr << "// " << comment << " 事件处理\n";
+    }
+    Heat heat = handlerHeat(handler);
+    out << indentStr;
+    if (heat == Heat::Hot) {
+        out << "[[gnu::hot]] ";
+    } else if (heat == Heat::Cold) {
+        out << "[[gnu::cold]] ";
+    }
+    out << "void " << handler_names_.at(handler) << "("
+        << (handler->getType() == ASTNodeType::ON_MESSAGE ? "Message& this_msg" : "") << ") {\n";
+    auto slot = profile_slots_.find(handler);
+    if (slot != profile_slots_.end()) {
+        out << indentStr << "    ++capl_profile_counts[" << slot->second << "];\n";
+    }
+    unit.scopes.assign(1, {});
+    for (const auto& child : handler->getChildren()) {
+        generateNode(child.get(), out, indent + 1, unit);
+    }
+    out << indentStr << "}\n\n";
+}
+
+/**
+ * 生成用户函数
+ * @param func 函数节点
+ * @param out 输出流
+ * @param indent 缩进层数
+ * @param unit 函数的生成状态
+ */
+void CodeGenerator::generateFunction(FunctionNode* func, OutputBuffer& out, int indent, UnitContext& unit) {
+    const std::string& indentStr = out.indent(indent);
+    unit.scopes.assign(1, {});
+    for (const auto& param : func->getParameters()) {
+        unit.locals.insert(static_cast<VariableDeclNode*>(param.get())->getName());
+    }
+    out << indentStr << functionSignature(func) << " {\n";
+    for (const auto& child : func->getChildren()) {
+        generateNode(child.get(), out, indent + 1, unit);
+    }
+    out << indentStr << "}\n\n";
+}
+
+/**
+ * 生成代码块内的语句，代码块中声明的局部变量只在块内遮蔽全局变量
+ * @param body 代码块节点
+ * @param out 输出流
+ * @param indent 代码块所在语句的缩进层数
+ * @param unit 所在单元的生成状态
+ */
+void CodeGenerator::generateBody(ASTNode* body, OutputBuffer& out, int indent, UnitContext& unit) {
+    unit.scopes.emplace_back();
+    for (const auto& child : body->getChildren()) {
+        generateNode(child.get(), out, indent + 1, unit);
+    }
+    unit.scopes.pop_back();
+}
+
+/**
+ * switch 展开为按分派方式跳转到各 case 标签的代码，case 之间顺序排列以保留贯穿
+ * @param node switch 语句节点
+ * @param out 输出流
+ * @param indent 缩进层数
+ * @param unit 所在单元的生成状态
+ */
+void CodeGenerator::generateSwitch(ASTNode* node, OutputBuffer& out, int indent, UnitContext& unit) {
+    const SwitchPlan* plan = switch_lowering_.findPlan(node);
+    std::string name = "capl_switch" + std::to_string(plan->id);
+    const std::string& indentStr = out.indent(indent);
+    const std::string& inner = out.indent(indent + 1);
+    auto caseLabel = [&](int target) {
+        return name + "_case" + std::to_string(target);
+    };
+    std::string endLabel = name + "_end";
+    std::string defaultLabel = plan->default_target >= 0 ? caseLabel(plan->default_target) : endLabel;
+    bool dispatch = !plan->cases.empty();
+    bool endUsed = dispatch && plan->default_target < 0;
+    std::set<size_t> targets;
+    for (const auto& entry : plan->cases) {
+        targets.insert(entry.target);
+    }
+    if (dispatch && plan->default_target >= 0) {
+        targets.insert(static_cast<size_t>(plan->default_target));
+    }
+    
+    out << indentStr << "{\n";
+    if (!dispatch) {
+        out << inner << "static_cast<void>(" << generateExpr(node->getChild(0), unit) << ");\n";
+    } else {
+        std::string value = name + "_value";
+        std::string offset = name + "_offset";
+        std::string base = std::to_string(static_cast<uint64_t>(plan->min_value)) + "ULL";
+        out << inner << "// switch (行 " << node->getLine() << "): " << plan->cases.size() << " 个标签, ";
+        switch (plan->kind) {
+            case SwitchKind::BitTest:
+                out << "位测试\n";
+                break;
+            case SwitchKind::JumpTable:
+                out << "跳转表 (" << plan->span << " 项)\n";
+                break;
+            case SwitchKind::BinarySearch:
+                out << "二分查找\n";
+                break;
+        }
+        out << inner << "const long long " << value << " = " << generateExpr(node->getChild(0), unit) << ";\n";
+        switch (plan->kind) {
+            case SwitchKind::BitTest: {
+                out << inner << "const unsigned long long " << offset << " = static_cast<unsigned long long>("
+                    << value << ") - " << base << ";\n";
+                out << inner << "if (" << offset << " < " << plan->span << ") {\n";
+                out << inner << "    const unsigned long long " << name << "_bit = 1ULL << " << offset << ";\n";
+                for (const auto& mask : plan->masks) {
+                    char hex[32];
+                    std::snprintf(hex, sizeof(hex), "0x%llxULL", static_cast<unsigned long long>(mask.mask));
+                    out << inner << "    if (" << name << "_bit & " << hex << ") goto "
+                        << caseLabel(static_cast<int>(mask.target)) << ";\n";
+                }
+                out << inner << "}\n";
+                out << inner << "goto " << defaultLabel << ";\n";
+                break;
+            }
+            case SwitchKind::JumpTable: {
+                std::vector<int> table(plan->span, -1);
+                for (const auto& entry : plan->cases) {
+                    table[static_cast<uint64_t>(entry.value) - static_cast<uint64_t>(plan->min_value)] =
+                        static_cast<int>(entry.target);
+                }
+                out << inner << "static void* const " << name << "_table[" << plan->span << "] = {\n";
+                for (size_t i = 0; i < table.size(); ++i) {
+                    out << inner << "    &&" << (table[i] >= 0 ? caseLabel(table[i]) : defaultLabel) << ",\n";
+                }
+                out << inner << "};\n";
+                out << inner << "const unsigned long long " << offset << " = static_cast<unsigned long long>("
+                    << value << ") - " << base << ";\n";
+                out << inner << "goto *(" << offset << " < " << plan->span << " ? " << name << "_table["
+                    << offset << "] : &&" << defaultLabel << ");\n";
+                break;
+            }
+            case SwitchKind::BinarySearch: {
+                size_t count = plan->cases.size();
+                out << inner << "static const long long " << name << "_values[" << count << "] = {";
+                for (size_t i = 0; i < count; ++i) {
+                    long long label = plan->cases[i].value;
+                    out << (i > 0 ? ", " : "");
+                    if (label == std::numeric_limits<long long>::min()) {
+                        out << "(-9223372036854775807LL - 1)";
+                    } else {
+                        out << label << "LL";
+                    }
+                }
+                out << "};\n";
+                out << inner << "static void* const " << name << "_targets[" << count << "] = {";
+                for (size_t i = 0; i < count; ++i) {
+                    out << (i > 0 ? ", " : "") << "&&" << caseLabel(static_cast<int>(plan->cases[i].target));
+                }
+                out << "};\n";
+                out << inner << "const long long* " << name << "_found = std::lower_bound(" << name
+                    << "_values, " << name << "_values + " << count << ", " << value << ");\n";
+                out << inner << "goto *(" << name << "_found != " << name << "_values + " << count
+                    << " && *" << name << "_found == " << value << " ? " << name << "_targets["
+                    << name << "_found - " << name << "_values] : &&" << defaultLabel << ");\n";
+                break;
+            }
+        }
+    }
+    
+    unit.break_targets.push_back({endLabel, false});
+    for (size_t i = 1; i < node->getChildCount(); ++i) {
+        ASTNode* caseNode = node->getChild(i);
+        long long label = 0;
+        std::string comment = SwitchLowering::caseValue(caseNode, label) ?
+            "case " + std::to_string(label) : std::string("default");
+        ASTNode* body = caseNode->getChild(caseNode->getChildCount() - 1);
+        if (!targets.count(i - 1) && body->getChildCount() == 0) {
+            // 空的 case 直接跳到之后的 case
+            out << inner << "// " << comment << "\n";
+            continue;
+        }
+        out << inner;
+        if (targets.count(i - 1)) {
+            out << caseLabel(static_cast<int>(i - 1)) << ": ";
+        }
+        out << "{  // " << comment << "\n";
+        generateBody(body, out, indent + 1, unit);
+        out << inner << "}\n";
+    }
+    endUsed = endUsed || unit.break_targets.back().used;
+    unit.break_targets.pop_back();
+    if (endUsed) {
+        out << inner << endLabel << ":;\n";
+    }
+    out << indentStr << "}\n";
+}
+
+/**
+ * 生成语句代码
+ * @param node 语句节点
+ * @param out 输出流
+ * @param indent 缩进层数
+ * @param unit 所在单元的生成状态
+ */
+void CodeGenerator::generateNode(ASTNode* node, OutputBuffer& out, int indent, UnitContext& unit) {
+    if (!node) {
+        return;
+    }
+    
+    const std::string& indentStr = out.indent(indent);
+    switch (node->getType()) {
+        case ASTNodeType::FUNCTION:
+            generateFunction(static_cast<FunctionNode*>(node), out, indent, unit);
+            break;
+        case ASTNodeType::VARIABLE_DECL: {
+            VariableDeclNode* varNode = static_cast<VariableDeclNode*>(node);
+            out << indentStr << generateDecl(varNode, unit) << ";\n";
+            // 初始值中的同名变量仍指全局变量，声明之后才遮蔽
+            if (!unit.scopes.empty()) {
+                unit.scopes.back().insert(varNode->getName());
+            }
+            break;
+        }
+        case ASTNodeType::ON_START:
+            generateHandler(node, out, indent, "on start", unit);
+            break;
+        case ASTNodeType::ON_MESSAGE:
+            generateHandler(node, out, indent, "on message", unit);
+            break;
+        case ASTNodeType::ON_TIMER:
+            generateHandler(node, out, indent, "on timer", unit);
+            break;
+        case ASTNodeType::ON_KEY:
+            generateHandler(node, out, indent, "on key", unit);
+            break;
+        case ASTNodeType::ON_STOP:
+            generateHandler(node, out, indent, "on stop", unit);
+            break;
+        case ASTNodeType::BLOCK_STMT: {
+            out << indentStr << "{\n";
+            generateBody(node, out, indent, unit);
+            out << indentStr << "}\n";
+            break;
+        }
+        case ASTNodeType::EXPRESSION_STMT: {
+            out << indentStr << generateExpr(node->getChild(0), unit) << ";\n";
+            break;
+        }
+        case ASTNodeType::IF_STMT: {
+            // 剖析显示偏向一侧的分支生成预测提示
+            std::string cond = generateCond(node->getChild(0), unit);
+            int bias = profile_ ? profile_->getBranchBias(static_cast<const IfStmtNode*>(node)->getBranchName()) : 0;
+            if (bias != 0) {
+                cond = "__builtin_expect(!!(" + cond + "), " + (bias > 0 ? "1" : "0") + ")";
+            }
+            out << indentStr << "if (" << cond << ") {\n";
+            auto slot = profile_slots_.find(node);
+            if (slot != profile_slots_.end()) {
+                out << indentStr << "    ++capl_profile_counts[" << slot->second << "];\n";
+            }
+            generateBody(node->getChild(1), out, indent, unit);
+            if (node->getChildCount() > 2 || slot != profile_slots_.end()) {
+                out << indentStr << "} else {\n";
+                if (slot != profile_slots_.end()) {
+                    out << indentStr << "    ++capl_profile_counts[" << slot->second + 1 << "];\n";
+                }
+                if (node->getChildCount() > 2) {
+                    generateBody(node->getChild(2), out, indent, unit);
+                }
+            }
+            out << indentStr << "}\n";
+            break;
+        }
+        case ASTNodeType::WHILE_STMT: {
+            out << indentStr << "while (" << generateCond(node->getChild(0), unit) << ") {\n";
+            unit.break_targets.push_back({"", false});
+            generateBody(node->getChild(1), out, indent, unit);
+            unit.break_targets.pop_back();
+            out << indentStr << "}\n";
+            break;
+        }
+        case ASTNodeType::FOR_STMT: {
+            if (const VectorLoop* loop = loop_vectorizer_.findLoop(node)) {
+                out << indentStr << loop->kernel_name << "(";
+                for (size_t i = 0; i < loop->operands.size(); ++i) {
+                    IdentifierNode operand(loop->operands[i].name);
+                    out << (i > 0 ? ", " : "") << generateExpr(&operand, unit);
+                }
+                out << ");\n";
+                break;
+            }
+            // for 的初始化语句中声明的变量只在循环内可见
+            ASTNode* init = node->getChild(0);
+            unit.scopes.emplace_back();
+            std::string initStr;
+            if (init->getType() == ASTNodeType::VARIABLE_DECL) {
+                initStr = generateDecl(static_cast<VariableDeclNode*>(init), unit);
+                unit.scopes.back().insert(static_cast<VariableDeclNode*>(init)->getName());
+            } else {
+                initStr = generateExpr(init->getChild(0), unit);
+            }
+            out << indentStr << "for (" << initStr << "; "
+                << generateCond(node->getChild(1), unit) << "; "
+                << generateExpr(node->getChild(2), unit) << ") {\n";
+            unit.break_targets.push_back({"", false});
+            generateBody(node->getChild(3), out, indent, unit);
+            unit.break_targets.pop_back();
+            unit.scopes.pop_back();
+            out << indentStr << "}\n";
+            break;
+        }
+        case ASTNodeType::SWITCH_STMT:
+            generateSwitch(node, out, indent, unit);
+            break;
+        case ASTNodeType::RETURN_STMT: {
+            out << indentStr << "return";
+            if (node->getChildCount() > 0) {
+                out << " " << generateExpr(node->getChild(0), unit);
+            }
+            out << ";\n";
+            break;
+        }
+        case ASTNodeType::BREAK_STMT:
+            // switch 展开为跳转，其中的 break 跳到结束标签
+            if (!unit.break_targets.empty() && !unit.break_targets.back().label.empty()) {
+                out << indentStr << "goto " << unit.break_targets.back().label << ";\n";
+                unit.break_targets.back().used = true;
+            } else {
+                out << indentStr << "break;\n";
+            }
+            break;
+        case ASTNodeType::CONTINUE_STMT:
+            out << indentStr << "continue;\n";
+            break;
+        default:
+            // 其他节点按表达式生成
+            out << generateExpr(node, unit);
+            break;
+    }
+}
+
+/**
+ * 生成一个顶层单元（事件处理器或用户函数），每个单元使用独立的生成状态
+ * @param node 顶层节点
+ * @param out 单元的输出缓冲区
+ */
+void CodeGenerator::generateUnit(ASTNode* node, OutputBuffer& out) {
+    UnitContext unit;
+    generateNode(node, out, 0, unit);
+}
+
+/**
+ * 生成循环内核函数，循环变量和操作数在内核中都是局部变量
+ * @param out 输出流
+ */
+void CodeGenerator::generateLoopKernels(OutputBuffer& out) {
+    const auto& loops = loop_vectorizer_.getLoops();
+    if (loops.empty()) {
+        return;
+    }
+    
+    bool clones = false;
+    for (const auto& loop : loops) {
+        clones = clones || loop.clones;
+    }
+    if (clones) {
+        // 加载时按 CPUID 在 AVX2 和默认 (SSE2) 版本之间选择
+        out << "#if defined(__x86_64__) && defined(__has_attribute)\n";
+        out << "#if __has_attribute(target_clones)\n";
+        out << "#define CAPL_VECTOR_CLONES __attribute__((target_clones(\"avx2\", \"default\")))\n";
+        out << "#endif\n";
+        out << "#endif\n";
+        out << "#ifndef CAPL_VECTOR_CLONES\n";
+        out << "#define CAPL_VECTOR_CLONES\n";
+        out << "#endif\n\n";
+    }
+    
+    for (const auto& loop : loops) {
+        out << "// " << loop.unit << " 中的 for 循环 (行 " << loop.node->getLine() << "): "
+            << loop.getTripCount() << " 次迭代，无跨迭代依赖\n";
+        if (loop.clones) {
+            out << "CAPL_VECTOR_CLONES\n";
+        }
+        out << (shards_ > 0 ? "static inline void " : "static void ") << loop.kernel_name << "(";
+        UnitContext unit;
+        unit.scopes.assign(1, {});
+        unit.locals.insert(loop.loop_var);
+        for (size_t i = 0; i < loop.operands.size(); ++i) {
+            const LoopOperand& operand = loop.operands[i];
+            unit.locals.insert(operand.name);
+            // 全局变量按状态结构体中（可能已收窄）的存储类型传入
+            const StateField* field = operand.global ? state_layout_.findField(operand.name) : nullptr;
+            std::string type = field ? field->cpp_type : StateLayout::cppType(operand.capl_type);
+            out << (i > 0 ? ", " : "");
+            if (operand.is_array) {
+                out << (operand.written ? "" : "const ") << type << "* __restrict " << operand.name;
+            } else {
+                out << "const " << type << " " << operand.name;
+            }
+        }
+        out << ") {\n";
+        out << "    #pragma GCC unroll " << loop.unroll << "\n";
+        out << "    for (int " << loop.loop_var << " = " << loop.begin << "; " << loop.loop_var << " < "
+            << loop.end << "; " << loop.loop_var << "++) {\n";
+        for (const auto& stmt : loop.node->getChild(3)->getChildren()) {
+            generateNode(stmt.get(), out, 2, unit);
+        }
+        out << "    }\n";
+        out << "}\n\n";
+    }
+}
+
+/**
+ * 生成整个程序：全局状态、循环内核、声明和各顶层单元，最后是分派表和入口
+ * @param program AST 根节点
+ * @param out 输出流（分片输出时为共用头文件）
+ * @param output_file 输出文件路径
+ * @return 分片输出时各分片的代码，否则为空
+ */
+std::vector<OutputBuffer> CodeGenerator::generateProgram(const ASTNode* program, OutputBuffer& out,
+                                                         const std::string& output_file) {
+    generateStateStruct(out);
+    generateTimerFunctions(out);
+    generateProfileCounters(out);
+    generateLoopKernels(out);
+    
+    // 分片输出时路由表、分派表和 main 只放在第一个分片中
+    OutputBuffer mainPart;
+    OutputBuffer& dispatchOut = shards_ > 0 ? mainPart : out;
+    generateGatewayRoutes(dispatchOut);
+    
+    generateTimerIds(out);
+    
+    // 用户函数可以在定义之前被调用，先生成声明
+    bool declared = false;
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            out << functionSignature(static_cast<const FunctionNode*>(child.get())) << ";\n";
+            declared = true;
+        }
+    }
+    if (declared) {
+        out << "\n";
+    }
+    
+    // 分片输出时处理器定义在各分片中，分派表通过共用头文件中的声明引用
+    if (shards_ > 0) {
+        bool handlers = false;
+        for (const auto& child : program->getChildren()) {
+            const ASTNode* handler = child.get();
+            if (handler_names_.count(handler) && handler_folding_.isRepresentative(handler) &&
+                !gateway_routes_.isForwarder(handler)) {
+                out << "void " << handler_names_.at(handler) << "("
+                    << (handler->getType() == ASTNodeType::ON_MESSAGE ? "Message& this_msg" : "")
+                    << ");\n";
+                handlers = true;
+            }
+        }
+        if (handlers) {
+            out << "\n";
+        }
+    }
+    
+    // 每个处理器和用户函数生成到各自的缓冲区，在线程池上并行生成后按源码顺序拼接，
+    // 输出与线程数和调度无关
+    std::vector<ASTNode*> units;
+    for (const auto& child : program->getChildren()) {
+        // variables 块中的全局变量已生成到状态结构体
+        if (child->getType() != ASTNodeType::BLOCK_STMT) {
+            units.push_back(child.get());
+        }
+    }
+    std::vector<OutputBuffer> unitOutputs;
+    for (size_t i = 0; i < units.size(); ++i) {
+        unitOutputs.emplace_back(4096);
+    }
+    unsigned threads = threads_ > 0 ? threads_ : std::thread::hardware_concurrency();
+    parallelFor(units.size(), threads, [&](size_t i) {
+        generateUnit(units[i], unitOutputs[i]);
+    });
+    if (shards_ == 0) {
+        for (const auto& unitOutput : unitOutputs) {
+            out << unitOutput.str();
+        }
+    }
+    generateMessageDispatch(dispatchOut);
+    generateEventDispatch(dispatchOut);
+    generateStateSnapshot(dispatchOut);
+    
+    // 外部驱动以 -DCAPL_NO_MAIN 编译生成代码，自己调用 capl_start、capl_dispatch 等入口
+    dispatchOut << "// 运行 on start 和 on stop 处理器\n";
+    for (ASTNodeType type : {ASTNodeType::ON_START, ASTNodeType::ON_STOP}) {
+        dispatchOut << (type == ASTNodeType::ON_START ? "void capl_start(void) {\n" :
+                                                         "void capl_stop(void) {\n");
+        for (const auto& child : program->getChildren()) {
+            if (child->getType() == type) {
+                dispatchOut << "    " << handler_names_[child.get()] << "();\n";
+            }
+        }
+        dispatchOut << "}\n";
+    }
+    dispatchOut << "\n";
+    dispatchOut << "#ifndef CAPL_NO_MAIN\n";
+    dispatchOut << "int main() {\n";
+    dispatchOut << "    // CAPL 程序开始\n";
+    dispatchOut << "    capl_start();\n";
+    dispatchOut << "    capl_stop();\n";
+    dispatchOut << "    return 0;\n";
+    dispatchOut << "}\n";
+    dispatchOut << "#endif\n";
+    
+    if (shards_ == 0) {
+        return {};
+    }
+    return generateShards(unitOutputs, mainPart, output_file);
 }
 
 /**
@@ -32,123 +1661,162 @@ bool CodeGenerator::generate(const std::unique_ptr<ASTNode>& ast,
     }
     
     try {
-        std::ofstream output(output_file);
-        if (!output.is_open()) {
-            std::cerr << "错误: 无法打开输出文件: " << output_file << std::endl;
-            return false;
+        // 全部代码先生成到内存缓冲区，最后一次写入文件
+        OutputBuffer output;
+        
+        // 分片输出时这部分为各分片共用的头文件，其中的函数和变量定义为 inline
+        bool sharded = shards_ > 0;
+        
+        // 数组下标范围分析，决定哪些下标访问需要越界检查
+        bounds_check_.analyze(ast.get());
+        
+        // 定时器和按键在编译期编号
+        event_tables_.build(ast.get());
+        
+        // 纯转发的报文处理器编译为路由表，不再生成处理函数
+        if (compile_routes_ && profile_generate_.empty()) {
+            gateway_routes_.analyze(ast.get());
+        } else {
+            gateway_routes_.clear();
         }
         
-        // 生成 C++ 代码头部
+        // 按 case 标签的分布选择 switch 的分派方式
+        switch_lowering_.analyze(ast.get());
+        
+        // 常量格式字符串的 write 调用在编译期展开
+        write_formats_.analyze(ast.get());
+        
+        // 可能超出 int 的有符号整数运算按回绕语义生成
+        integer_wrap_.analyze(ast.get());
+        
+        // 运行时函数预先编译在 libcapl_rt 中，只包含其接口头文件；状态快照用到 memcpy，
+        // 路由表和 switch 的二分查找用到 std::lower_bound
         output << "// 由 CAPL 编译器生成的 C++ 代码\n";
-        output << "#include <iostream>\n";
-        output << "#include <string>\n";
-        output << "#include <vector>\n";
-        output << "#include <map>\n\n";
-        
-        // 生成 CAPL 运行时支持代码
-        output << "// CAPL 运行时支持函数\n";
-        output << "namespace capl_runtime {\n";
-        output << "    void write(const std::string& msg) {\n";
-        output << "        std::cout << msg << std::endl;\n";
-        output << "    }\n";
-        output << "    \n";
-        output << "    void setTimer(const std::string& name, int ms) {\n";
-        output << "        // 定时器实现占位符\n";
-        output << "    }\n";
-        output << "    \n";
-        output << "    void output(int value) {\n";
-        output << "        std::cout << \"输出: \" << value << std::endl;\n";
-        output << "    }\n";
-        output << "}\n\n";
+        if (sharded) {
+            output << "#pragma once\n";
+        }
+        output << "#include \"capl_rt.h\"\n";
+        output << "#include <string.h>\n";
+        if (!gateway_routes_.getRoutes().empty() || switch_lowering_.countKind(SwitchKind::BinarySearch) > 0) {
+            output << "#include <algorithm>\n";
+        }
+        output << "\n";
         output << "using namespace capl_runtime;\n\n";
         
-        // 使用 lambda 函数递归生成代码
-        std::function<void(ASTNode*, std::ofstream&, int)> generateNode = 
-            [&](ASTNode* node, std::ofstream& out, int indent) {
-                if (!node) {
-                    return;
-                }
-                
-                std::string indentStr(indent * 4, ' ');
-                
-                switch (node->getType()) {
-                    case ASTNodeType::PROGRAM: {
-                        out << "int main() {\n";
-                        out << "    // CAPL 程序开始\n";
-                        for (const auto& child : node->getChildren()) {
-                            generateNode(child.get(), out, indent + 1);
-                        }
-                        out << "    return 0;\n";
-                        out << "}\n";
-                        break;
-                    }
-                    case ASTNodeType::FUNCTION: {
-                        FunctionNode* funcNode = static_cast<FunctionNode*>(node);
-                        out << indentStr << funcNode->getReturnType() << " " 
-                            << funcNode->getName() << "() {\n";
-                        for (const auto& child : node->getChildren()) {
-                            generateNode(child.get(), out, indent + 1);
-                        }
-                        out << indentStr << "}\n\n";
-                        break;
-                    }
-                    case ASTNodeType::VARIABLE_DECL: {
-                        VariableDeclNode* varNode = static_cast<VariableDeclNode*>(node);
-                        out << indentStr << varNode->getVarType() << " " 
-                            << varNode->getName() << ";\n";
-                        break;
-                    }
-                    case ASTNodeType::ON_START: {
-                        out << indentStr << "// on start 事件处理\n";
-                        out << indentStr << "void onStart() {\n";
-                        for (const auto& child : node->getChildren()) {
-                            generateNode(child.get(), out, indent + 1);
-                        }
-                        out << indentStr << "}\n\n";
-                        break;
-                    }
-                    case ASTNodeType::ON_MESSAGE: {
-                        out << indentStr << "// on message 事件处理\n";
-                        out << indentStr << "void onMessage() {\n";
-                        for (const auto& child : node->getChildren()) {
-                            generateNode(child.get(), out, indent + 1);
-                        }
-                        out << indentStr << "}\n\n";
-                        break;
-                    }
-                    case ASTNodeType::CALL_EXPR: {
-                        CallExprNode* callNode = static_cast<CallExprNode*>(node);
-                        out << indentStr << callNode->getFunctionName() << "();\n";
-                        break;
-                    }
-                    case ASTNodeType::INTEGER_LITERAL:
-                    case ASTNodeType::FLOAT_LITERAL:
-                    case ASTNodeType::STRING_LITERAL: {
-                        LiteralNode* litNode = static_cast<LiteralNode*>(node);
-                        out << litNode->getValue();
-                        break;
-                    }
-                    case ASTNodeType::IDENTIFIER: {
-                        IdentifierNode* idNode = static_cast<IdentifierNode*>(node);
-                        out << idNode->getName();
-                        break;
-                    }
-                    default:
-                        // 对于其他类型的节点，递归处理子节点
-                        for (const auto& child : node->getChildren()) {
-                            generateNode(child.get(), out, indent);
-                        }
-                        break;
-                }
-            };
+        if (!event_tables_.getTimers().empty()) {
+            output << "// 定时器以编译期分配的整数 ID 为下标保存在定长数组中，设置和取消不涉及字符串\n";
+            output << "struct TimerSlot {\n";
+            output << "    long long deadline;     // 到期时间 (ms)\n";
+            output << "    bool armed;             // 是否已设置\n";
+            output << "};\n\n";
+        }
         
-        // 开始生成代码
-        generateNode(ast.get(), output, 0);
+        // 值域允许时用更窄的整数类型存储全局变量，再计算全局状态布局
+        if (narrow_integers_) {
+            integer_narrowing_.analyze(ast.get());
+        } else {
+            integer_narrowing_.clear();
+        }
+        state_layout_.compute(ast.get(), &integer_narrowing_);
         
-        output.close();
-        std::cout << "代码生成成功: " << output_file << std::endl;
-        return true;
+        // 定时器和 $信号 读取的报文缓存放在全局变量之后，节点的全部状态是一个结构体
+        state_layout_.addRuntimeState(ast.get(), event_tables_.getTimers().size());
+        signal_frames_.clear();
+        collectSignalFrames(ast.get(), signal_frames_);
+        
+        // 函数体相同的处理器只生成一份实现
+        if (fold_handlers_ && profile_generate_.empty()) {
+            handler_folding_.compute(ast.get(), gateway_routes_.getForwarders());
+        } else {
+            handler_folding_.clear();
+        }
+        
+        // 每个处理器生成名称唯一的函数，合并的处理器使用代表的函数
+        handler_names_.clear();
+        std::set<std::string> used_names;
+        for (const auto& child : ast->getChildren()) {
+            if (child->getType() == ASTNodeType::FUNCTION) {
+                used_names.insert(static_cast<const FunctionNode*>(child.get())->getName());
+            }
+        }
+        for (const auto& child : ast->getChildren()) {
+            const ASTNode* handler = child.get();
+            if (child->getType() == ASTNodeType::FUNCTION || child->getType() == ASTNodeType::BLOCK_STMT ||
+                !isStatementList(handler) || !handler_folding_.isRepresentative(handler) ||
+                gateway_routes_.isForwarder(handler)) {
+                continue;
+            }
+            std::string name = handlerBaseName(handler);
+            for (int suffix = 2; used_names.count(name) > 0; ++suffix) {
+                name = handlerBaseName(handler) + "_" + std::to_string(suffix);
+            }
+            used_names.insert(name);
+            handler_names_[handler] = name;
+        }
+        for (const auto& handler_class : handler_folding_.getClasses()) {
+            for (const ASTNode* handler : handler_class.handlers) {
+                handler_names_[handler] = handler_names_[handler_class.handlers.front()];
+            }
+        }
+        
+        // 编译期已知的报文 ID 生成分派表
+        message_dispatch_.build(ast.get(), gateway_routes_.getForwarders());
         
+        // 无跨迭代依赖的计数数组循环提取为内核函数
+        if (vectorize_loops_) {
+            loop_vectorizer_.setProfile(profile_);
+            loop_vectorizer_.analyze(ast.get());
+        } else {
+            loop_vectorizer_.clear();
+        }
+        
+        // 插桩时为每个处理器和 if 分支分配计数器
+        profile_keys_.clear();
+        profile_slots_.clear();
+        if (!profile_generate_.empty()) {
+            std::map<std::string, size_t> branch_slots;
+            assignProfileSlots(ast.get(), branch_slots, profile_keys_, profile_slots_);
+        }
+        
+        // 开始生成代码，分片输出时 output 为共用头文件
+        output_shards_.clear();
+        std::vector<OutputBuffer> shardOutputs = generateProgram(ast.get(), output, output_file);
+        
+        std::string error;
+        if (sharded) {
+            // 共用头文件和各分片分别按内容是否变化写入，未变化的文件不触发下游重新编译
+            std::string header = shardPath(output_file, -1);
+            WriteResult result = output.writeToFile(header, error);
+            int unchanged = result == WriteResult::Unchanged ? 1 : 0;
+            for (size_t i = 0; i < shardOutputs.size() && result != WriteResult::Failed; ++i) {
+                result = shardOutputs[i].writeToFile(output_shards_[i].path, error);
+                unchanged += result == WriteResult::Unchanged ? 1 : 0;
+            }
+            if (result == WriteResult::Failed) {
+                std::cerr << "错误: 无法写入输出文件: " << error << std::endl;
+                return false;
+            }
+            std::cout << "代码生成成功: " << header << " 和 " << output_shards_.size() << " 个分片 ("
+                      << output_shards_.front().path << " - " << output_shards_.back().path << ")";
+            if (unchanged > 0) {
+                std::cout << ", " << unchanged << " 个文件内容未变化，未重写";
+            }
+            std::cout << std::endl;
+            return true;
+        }
+        
+        WriteResult result = output.writeToFile(output_file, error);
+        if (result == WriteResult::Failed) {
+            std::cerr << "错误: 无法写入输出文件: " << error << std::endl;
+            return false;
+        }
+        if (result == WriteResult::Unchanged) {
+            std::cout << "代码生成成功: " << output_file << " (内容未变化，未重写文件)" << std::endl;
+        } else {
+            std::cout << "代码生成成功: " << output_file << std::endl;
+        }
+        return true;
+    
     } catch (const std::exception& e) {
         std::cerr << "代码生成错误: " << e.what() << std::endl;
         return false;
@@ -0,0 +1,888 @@
+/**
+ * CAPL 常量折叠、常量传播和 on start 前缀求值实现
+ */
+
+#include "../include/constant_folding.h"
+#include "../include/ast.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+
+namespace capl {
+
+namespace {
+
+bool fitsInt32(long long value) {
+    return value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max();
+}
+
+/**
+ * 收集子树中被写入的变量名
+ */
+void collectWrites(const ASTNode* node, std::set<std::string>& writes) {
+    if (!node) {
+        return;
+    }
+    if (node->getType() == ASTNodeType::ASSIGNMENT_EXPR || isIncrementExpr(node)) {
+        std::string target = getRootVariable(node->getChild(0));
+        if (!target.empty()) {
+            writes.insert(target);
+        }
+    }
+    for (const auto& child : node->getChildren()) {
+        collectWrites(child.get(), writes);
+    }
+}
+
+/**
+ * 收集子树中的局部变量声明，返回每个名称的声明次数
+ */
+void collectDecls(const ASTNode* node, std::map<std::string, int>& counts,
+                  std::map<std::string, std::string>& types) {
+    if (!node) {
+        return;
+    }
+    if (node->getType() == ASTNodeType::VARIABLE_DECL) {
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+        counts[decl->getName()]++;
+        if (decl->getArraySize() == 0 && decl->getVarType() != "message") {
+            types[decl->getName()] = decl->getVarType();
+        }
+    }
+    for (const auto& child : node->getChildren()) {
+        collectDecls(child.get(), counts, types);
+    }
+}
+
+bool isHandlerOrFunction(const ASTNode* node) {
+    switch (node->getType()) {
+        case ASTNodeType::FUNCTION:
+        case ASTNodeType::ON_START:
+        case ASTNodeType::ON_STOP:
+        case ASTNodeType::ON_MESSAGE:
+        case ASTNodeType::ON_TIMER:
+        case ASTNodeType::ON_KEY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * 整数二元运算，按 32 位 int 语义
+ */
+bool foldIntBinary(const std::string& op, long long a, long long b, long long& result) {
+    if (op == "+") {
+        result = a + b;
+    } else if (op == "-") {
+        result = a - b;
+    } else if (op == "*") {
+        result = a * b;
+    } else if (op == "/" || op == "%") {
+        if (b == 0 || (a == std::numeric_limits<int32_t>::min() && b == -1)) {
+            return false;
+        }
+        result = op == "/" ? a / b : a % b;
+    } else if (op == "&") {
+        result = a & b;
+    } else if (op == "|") {
+        result = a | b;
+    } else if (op == "^") {
+        result = a ^ b;
+    } else if (op == "<<") {
+        if (a < 0 || b < 0 || b >= 31) {
+            return false;
+        }
+        result = a << b;
+    } else if (op == ">>") {
+        if (b < 0 || b >= 32) {
+            return false;
+        }
+        result = a >> b;
+    } else if (op == "==") {
+        result = a == b;
+    } else if (op == "!=") {
+        result = a != b;
+    } else if (op == "<") {
+        result = a < b;
+    } else if (op == "<=") {
+        result = a <= b;
+    } else if (op == ">") {
+        result = a > b;
+    } else if (op == ">=") {
+        result = a >= b;
+    } else if (op == "&&") {
+        result = a && b;
+    } else if (op == "||") {
+        result = a || b;
+    } else {
+        return false;
+    }
+    // 有符号溢出在 C++ 中是未定义行为，不折叠
+    return fitsInt32(result);
+}
+
+bool foldFloatBinary(const std::string& op, double a, double b, ConstantValue& result) {
+    if (op == "+") {
+        result = ConstantValue::makeFloat(a + b);
+    } else if (op == "-") {
+        result = ConstantValue::makeFloat(a - b);
+    } else if (op == "*") {
+        result = ConstantValue::makeFloat(a * b);
+    } else if (op == "/") {
+        if (b == 0.0) {
+            return false;
+        }
+        result = ConstantValue::makeFloat(a / b);
+    } else if (op == "==") {
+        result = ConstantValue::makeInt(a == b);
+    } else if (op == "!=") {
+        result = ConstantValue::makeInt(a != b);
+    } else if (op == "<") {
+        result = ConstantValue::makeInt(a < b);
+    } else if (op == "<=") {
+        result = ConstantValue::makeInt(a <= b);
+    } else if (op == ">") {
+        result = ConstantValue::makeInt(a > b);
+    } else if (op == ">=") {
+        result = ConstantValue::makeInt(a >= b);
+    } else if (op == "&&") {
+        result = ConstantValue::makeInt(a != 0.0 && b != 0.0);
+    } else if (op == "||") {
+        result = ConstantValue::makeInt(a != 0.0 || b != 0.0);
+    } else {
+        return false;
+    }
+    return !result.is_float || std::isfinite(result.float_value);
+}
+
+/**
+ * 节点是否可被折叠为字面量（字面量本身不再折叠）
+ */
+bool isFoldable(const ASTNode* node) {
+    switch (node->getType()) {
+        case ASTNodeType::BINARY_EXPR:
+        case ASTNodeType::CONDITIONAL_EXPR:
+            return true;
+        case ASTNodeType::UNARY_EXPR:
+            return !isIncrementExpr(node);
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+// ConstantValue 实现
+ConstantValue ConstantValue::makeInt(long long value) {
+    ConstantValue constant;
+    constant.int_value = value;
+    return constant;
+}
+
+ConstantValue ConstantValue::makeFloat(double value) {
+    ConstantValue constant;
+    constant.is_float = true;
+    constant.float_value = value;
+    return constant;
+}
+
+bool ConstantValue::convertTo(const std::string& capl_type, ConstantValue& result) const {
+    if (capl_type == "float") {
+        result = is_float ? *this : makeFloat(static_cast<double>(int_value));
+        return true;
+    }
+    long long value = int_value;
+    if (is_float) {
+        if (!std::isfinite(float_value) || std::fabs(float_value) >= 2147483648.0) {
+            return false;
+        }
+        value = static_cast<long long>(float_value);
+    }
+    // byte、word 参与运算时提升为 int，转换后的值可以按 int 常量使用；
+    // dword、qword、int64 的运算不按 32 位 int 进行，不作为常量传播
+    if (capl_type == "char") {
+        value = static_cast<signed char>(static_cast<unsigned char>(value & 0xFF));
+    } else if (capl_type == "byte" || capl_type == "word") {
+        long long mask = capl_type == "byte" ? 0xFF : 0xFFFF;
+        // 超出范围的浮点数转换为无符号类型是未定义行为
+        if (is_float && (value & mask) != value) {
+            return false;
+        }
+        value &= mask;
+    } else if (capl_type == "int") {
+        if (is_float && (value < -32768 || value > 32767)) {
+            return false;
+        }
+        value = static_cast<int16_t>(static_cast<uint16_t>(value & 0xFFFF));
+    } else if (capl_type == "long") {
+        value = static_cast<int32_t>(static_cast<uint32_t>(value & 0xFFFFFFFFLL));
+    } else {
+        return false;
+    }
+    result = makeInt(value);
+    return true;
+}
+
+std::unique_ptr<ASTNode> ConstantValue::toLiteral(int line) const {
+    std::unique_ptr<ASTNode> literal;
+    if (is_float) {
+        if (!std::isfinite(float_value)) {
+            return nullptr;
+        }
+        std::ostringstream spelling;
+        spelling.precision(17);
+        spelling << float_value;
+        std::string text = spelling.str();
+        if (text.find_first_of(".e") == std::string::npos) {
+            text += ".0";
+        }
+        literal = std::make_unique<LiteralNode>(ASTNodeType::FLOAT_LITERAL, text);
+    } else {
+        literal = std::make_unique<LiteralNode>(ASTNodeType::INTEGER_LITERAL, std::to_string(int_value));
+    }
+    literal->setLine(line);
+    return literal;
+}
+
+bool ConstantValue::operator==(const ConstantValue& other) const {
+    if (is_float != other.is_float) {
+        return false;
+    }
+    return is_float ? float_value == other.float_value : int_value == other.int_value;
+}
+
+/**
+ * 对表达式求值
+ */
+bool evaluateConstant(const ASTNode* expr, ConstantValue& result, const ConstantEnv* env) {
+    if (!expr) {
+        return false;
+    }
+    
+    switch (expr->getType()) {
+        case ASTNodeType::INTEGER_LITERAL: {
+            try {
+                long long value = std::stoll(static_cast<const LiteralNode*>(expr)->getValue(), nullptr, 0);
+                // 超出 int 范围的字面量在 C++ 中类型不同，不参与折叠
+                if (!fitsInt32(value)) {
+                    return false;
+                }
+                result = ConstantValue::makeInt(value);
+                return true;
+            } catch (const std::exception&) {
+                return false;
+            }
+        }
+        
+        case ASTNodeType::FLOAT_LITERAL: {
+            try {
+                result = ConstantValue::makeFloat(std::stod(static_cast<const LiteralNode*>(expr)->getValue()));
+                return true;
+            } catch (const std::exception&) {
+                return false;
+            }
+        }
+        
+        case ASTNodeType::CHAR_LITERAL: {
+            const std::string& text = static_cast<const LiteralNode*>(expr)->getValue();
+            result = ConstantValue::makeInt(text.empty() ? 0 : static_cast<signed char>(text[0]));
+            return true;
+        }
+        
+        case ASTNodeType::IDENTIFIER: {
+            if (!env) {
+                return false;
+            }
+            auto it = env->find(static_cast<const IdentifierNode*>(expr)->getName());
+            if (it == env->end()) {
+                return false;
+            }
+            result = it->second;
+            return true;
+        }
+        
+        case ASTNodeType::UNARY_EXPR: {
+            const std::string& op = static_cast<const UnaryExprNode*>(expr)->getOperator();
+            ConstantValue operand;
+            if (isIncrementExpr(expr) || !evaluateConstant(expr->getChild(0), operand, env)) {
+                return false;
+            }
+            if (op == "!") {
+                result = ConstantValue::makeInt(!operand.isTrue());
+                return true;
+            }
+            if (operand.is_float) {
+                if (op == "-") {
+                    result = ConstantValue::makeFloat(-operand.float_value);
+                    return true;
+                }
+                if (op == "+") {
+                    result = operand;
+                    return true;
+                }
+                return false;
+            }
+            long long value;
+            if (op == "-") {
+                value = -operand.int_value;
+            } else if (op == "+") {
+                value = operand.int_value;
+            } else if (op == "~") {
+                value = ~operand.int_value;
+            } else {
+                return false;
+            }
+            if (!fitsInt32(value)) {
+                return false;
+            }
+            result = ConstantValue::makeInt(value);
+            return true;
+        }
+        
+        case ASTNodeType::BINARY_EXPR: {
+            const std::string& op = static_cast<const BinaryExprNode*>(expr)->getOperator();
+            ConstantValue lhs, rhs;
+            if (!evaluateConstant(expr->getChild(0), lhs, env)) {
+                return false;
+            }
+            // 短路运算只需左操作数即可确定
+            if (op == "&&" && !lhs.isTrue()) {
+                result = ConstantValue::makeInt(0);
+                return true;
+            }
+            if (op == "||" && lhs.isTrue()) {
+                result = ConstantValue::makeInt(1);
+                return true;
+            }
+            if (!evaluateConstant(expr->getChild(1), rhs, env)) {
+                return false;
+            }
+            if (lhs.is_float || rhs.is_float) {
+                double a = lhs.is_float ? lhs.float_value : static_cast<double>(lhs.int_value);
+                double b = rhs.is_float ? rhs.float_value : static_cast<double>(rhs.int_value);
+                return foldFloatBinary(op, a, b, result);
+            }
+            long long value;
+            if (!foldIntBinary(op, lhs.int_value, rhs.int_value, value)) {
+                return false;
+            }
+            result = ConstantValue::makeInt(value);
+            return true;
+        }
+        
+        case ASTNodeType::CONDITIONAL_EXPR: {
+            ConstantValue cond;
+            if (!evaluateConstant(expr->getChild(0), cond, env)) {
+                return false;
+            }
+            return evaluateConstant(expr->getChild(cond.isTrue() ? 1 : 2), result, env);
+        }
+        
+        default:
+            return false;
+    }
+}
+
+// ConstantFoldingPass 实现
+
+/**
+ * 常量折叠
+ * @param program AST 根节点
+ * @return 折叠的表达式数
+ */
+int ConstantFoldingPass::run(ASTNode* program) {
+    return foldChildren(program);
+}
+
+int ConstantFoldingPass::foldChildren(ASTNode* node) {
+    int changes = 0;
+    for (size_t i = 0; i < node->getChildCount(); ++i) {
+        ASTNode* child = node->getChild(i);
+        changes += foldChildren(child);
+        
+        if (!isFoldable(child)) {
+            continue;
+        }
+        
+        ConstantValue value;
+        if (evaluateConstant(child, value)) {
+            if (auto literal = value.toLiteral(child->getLine())) {
+                node->replaceChild(i, std::move(literal));
+                ++changes;
+            }
+            continue;
+        }
+        
+        // 条件已知的 ?: 只保留选中的分支
+        if (child->getType() == ASTNodeType::CONDITIONAL_EXPR) {
+            ConstantValue cond;
+            if (evaluateConstant(child->getChild(0), cond)) {
+                std::unique_ptr<ASTNode> taken = child->removeChild(cond.isTrue() ? 1 : 2);
+                node->replaceChild(i, std::move(taken));
+                ++changes;
+            }
+        }
+    }
+    return changes;
+}
+
+// ConstantPropagationPass 实现
+
+/**
+ * 常量传播
+ * @param program AST 根节点
+ * @return 替换为字面量的变量读取次数
+ */
+int ConstantPropagationPass::run(ASTNode* program) {
+    changes_ = 0;
+    
+    // 从不被写入的全局标量在整个程序中都是常量
+    std::set<std::string> written;
+    collectWrites(program, written);
+    
+    ConstantEnv global_constants;
+    std::map<std::string, std::string> global_types;
+    std::set<std::string> global_names;
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() != ASTNodeType::BLOCK_STMT) {
+            continue;
+        }
+        for (const auto& var : child->getChildren()) {
+            const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(var.get());
+            global_names.insert(decl->getName());
+            if (decl->getArraySize() != 0 || decl->getVarType() == "message" || written.count(decl->getName())) {
+                continue;
+            }
+            ConstantValue value = ConstantValue::makeInt(0);
+            if (decl->getInitializer() && !evaluateConstant(decl->getInitializer(), value, &global_constants)) {
+                continue;
+            }
+            ConstantValue converted;
+            if (value.convertTo(decl->getVarType(), converted)) {
+                global_constants[decl->getName()] = converted;
+                global_types[decl->getName()] = decl->getVarType();
+            }
+        }
+    }
+    
+    for (const auto& child : program->getChildren()) {
+        if (!isHandlerOrFunction(child.get())) {
+            continue;
+        }
+        
+        // 只跟踪声明唯一的局部标量和形参，避免处理同名遮蔽；与全局变量同名的局部变量
+        // 只在所在代码块内遮蔽全局变量，块外的同名读写是全局变量，不跟踪
+        std::map<std::string, int> counts;
+        std::map<std::string, std::string> types;
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            for (const auto& param : static_cast<const FunctionNode*>(child.get())->getParameters()) {
+                collectDecls(param.get(), counts, types);
+            }
+        }
+        collectDecls(child.get(), counts, types);
+        
+        tracked_.clear();
+        shadowed_.clear();
+        for (const auto& entry : counts) {
+            shadowed_.insert(entry.first);
+            if (entry.second == 1 && types.count(entry.first) && !global_names.count(entry.first)) {
+                tracked_[entry.first] = types[entry.first];
+            }
+        }
+        
+        ConstantEnv env;
+        for (const auto& entry : global_constants) {
+            if (!shadowed_.count(entry.first)) {
+                env[entry.first] = entry.second;
+            }
+        }
+        for (size_t i = 0; i < child->getChildCount(); ++i) {
+            propagateStatement(child->getChild(i), env);
+        }
+    }
+    return changes_;
+}
+
+bool ConstantPropagationPass::isTracked(const std::string& name) const {
+    return tracked_.count(name) > 0;
+}
+
+/**
+ * 记录对局部变量的赋值，value 为 nullptr 表示值未知
+ */
+void ConstantPropagationPass::assign(const std::string& name, const ConstantValue* value, ConstantEnv& env) {
+    if (!isTracked(name)) {
+        return;
+    }
+    ConstantValue converted;
+    if (value && value->convertTo(tracked_[name], converted)) {
+        env[name] = converted;
+    } else {
+        env.erase(name);
+    }
+}
+
+void ConstantPropagationPass::propagateStatement(ASTNode* node, ConstantEnv& env) {
+    if (!node) {
+        return;
+    }
+    
+    switch (node->getType()) {
+        case ASTNodeType::EXPRESSION_STMT:
+        case ASTNodeType::RETURN_STMT:
+            if (node->getChildCount() > 0) {
+                propagateExpr(node, 0, env);
+            }
+            break;
+        
+        case ASTNodeType::VARIABLE_DECL: {
+            const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+            if (!decl->getInitializer()) {
+                ConstantValue zero = ConstantValue::makeInt(0);
+                assign(decl->getName(), &zero, env);
+                break;
+            }
+            propagateExpr(node, 0, env);
+            ConstantValue value;
+            bool known = evaluateConstant(decl->getInitializer(), value, &env);
+            assign(decl->getName(), known ? &value : nullptr, env);
+            break;
+        }
+        
+        case ASTNodeType::BLOCK_STMT:
+            for (size_t i = 0; i < node->getChildCount(); ++i) {
+                propagateStatement(node->getChild(i), env);
+            }
+            break;
+        
+        case ASTNodeType::IF_STMT: {
+            propagateExpr(node, 0, env);
+            ConstantEnv then_env = env;
+            ConstantEnv else_env = env;
+            propagateStatement(node->getChild(1), then_env);
+            if (node->getChildCount() > 2) {
+                propagateStatement(node->getChild(2), else_env);
+            }
+            // 汇合处只保留两个分支一致的值
+            env.clear();
+            for (const auto& entry : then_env) {
+                auto other = else_env.find(entry.first);
+                if (other != else_env.end() && other->second == entry.second) {
+                    env.insert(entry);
+                }
+            }
+            break;
+        }
+        
+        case ASTNodeType::SWITCH_STMT: {
+            propagateExpr(node, 0, env);
+            // 每个 case 可以从判别处跳入，也可以从上一个 case 贯穿进入，
+            // 其中被写入的变量在各 case 入口和 switch 之后都未知
+            std::set<std::string> written;
+            for (size_t i = 1; i < node->getChildCount(); ++i) {
+                collectWrites(node->getChild(i), written);
+            }
+            for (const auto& name : written) {
+                env.erase(name);
+            }
+            for (size_t i = 1; i < node->getChildCount(); ++i) {
+                ASTNode* case_stmt = node->getChild(i);
+                ConstantEnv case_env = env;
+                propagateStatement(case_stmt->getChild(case_stmt->getChildCount() - 1), case_env);
+            }
+            break;
+        }
+        
+        case ASTNodeType::WHILE_STMT:
+        case ASTNodeType::FOR_STMT: {
+            bool is_for = node->getType() == ASTNodeType::FOR_STMT;
+            if (is_for) {
+                propagateStatement(node->getChild(0), env);
+            }
+            
+            // 循环中被写入的变量在循环入口处未知
+            std::set<std::string> written;
+            for (size_t i = is_for ? 1 : 0; i < node->getChildCount(); ++i) {
+                collectWrites(node->getChild(i), written);
+            }
+            for (const auto& name : written) {
+                env.erase(name);
+            }
+            
+            size_t cond = is_for ? 1 : 0;
+            if (node->getChild(cond)->getType() != ASTNodeType::EXPRESSION_STMT) {
+                propagateExpr(node, cond, env);
+            }
+            ConstantEnv body_env = env;
+            propagateStatement(node->getChild(is_for ? 3 : 1), body_env);
+            if (is_for && node->getChild(2)->getType() != ASTNodeType::EXPRESSION_STMT) {
+                ConstantEnv update_env = env;
+                propagateExpr(node, 2, update_env);
+            }
+            break;
+        }
+        
+        default:
+            break;
+    }
+}
+
+/**
+ * 按求值顺序处理 parent 的第 index 个子表达式：替换已知常量的读取，并记录赋值
+ */
+void ConstantPropagationPass::propagateExpr(ASTNode* parent, size_t index, ConstantEnv& env) {
+    ASTNode* node = parent->getChild(index);
+    if (!node) {
+        return;
+    }
+    
+    switch (node->getType()) {
+        case ASTNodeType::IDENTIFIER: {
+            auto it = env.find(static_cast<const IdentifierNode*>(node)->getName());
+            if (it != env.end()) {
+                if (auto literal = it->second.toLiteral(node->getLine())) {
+                    parent->replaceChild(index, std::move(literal));
+                    ++changes_;
+                }
+            }
+            return;
+        }
+        
+        case ASTNodeType::ASSIGNMENT_EXPR: {
+            const std::string& op = static_cast<const AssignmentExprNode*>(node)->getOperator();
+            ASTNode* target = node->getChild(0);
+            propagateExpr(node, 1, env);
+            if (target->getType() != ASTNodeType::IDENTIFIER) {
+                // 下标和成员对象中的读取
+                for (size_t i = 1; i < target->getChildCount(); ++i) {
+                    propagateExpr(target, i, env);
+                }
+                if (target->getType() == ASTNodeType::MEMBER_EXPR ||
+                    target->getChild(0)->getType() != ASTNodeType::IDENTIFIER) {
+                    propagateExpr(target, 0, env);
+                }
+                return;
+            }
+            
+            const std::string& name = static_cast<const IdentifierNode*>(target)->getName();
+            ConstantValue value;
+            bool known = evaluateConstant(node->getChild(1), value, &env);
+            if (known && op != "=") {
+                ConstantValue combined;
+                BinaryExprNode combine(op.substr(0, 1));
+                combine.addChild(std::make_unique<IdentifierNode>(name));
+                combine.addChild(value.toLiteral(0));
+                known = evaluateConstant(&combine, combined, &env);
+                value = combined;
+            }
+            assign(name, known ? &value : nullptr, env);
+            return;
+        }
+        
+        case ASTNodeType::UNARY_EXPR: {
+            if (!isIncrementExpr(node)) {
+                propagateExpr(node, 0, env);
+                return;
+            }
+            ASTNode* target = node->getChild(0);
+            if (target->getType() != ASTNodeType::IDENTIFIER) {
+                for (size_t i = 1; i < target->getChildCount(); ++i) {
+                    propagateExpr(target, i, env);
+                }
+                return;
+            }
+            const std::string& name = static_cast<const IdentifierNode*>(target)->getName();
+            auto it = env.find(name);
+            if (it != env.end() && !it->second.is_float) {
+                bool inc = static_cast<const UnaryExprNode*>(node)->getOperator() == "++";
+                long long next = it->second.int_value + (inc ? 1 : -1);
+                ConstantValue value = ConstantValue::makeInt(next);
+                assign(name, fitsInt32(next) ? &value : nullptr, env);
+            } else {
+                assign(name, nullptr, env);
+            }
+            return;
+        }
+        
+        case ASTNodeType::BINARY_EXPR: {
+            const std::string& op = static_cast<const BinaryExprNode*>(node)->getOperator();
+            propagateExpr(node, 0, env);
+            if (op == "&&" || op == "||") {
+                // 右操作数不一定执行，其中的赋值之后值未知
+                ConstantEnv rhs_env = env;
+                propagateExpr(node, 1, rhs_env);
+                std::set<std::string> written;
+                collectWrites(node->getChild(1), written);
+                for (const auto& name : written) {
+                    env.erase(name);
+                }
+                return;
+            }
+            propagateExpr(node, 1, env);
+            return;
+        }
+        
+        case ASTNodeType::CONDITIONAL_EXPR: {
+            propagateExpr(node, 0, env);
+            for (size_t i = 1; i < 3; ++i) {
+                ConstantEnv branch_env = env;
+                propagateExpr(node, i, branch_env);
+            }
+            std::set<std::string> written;
+            collectWrites(node->getChild(1), written);
+            collectWrites(node->getChild(2), written);
+            for (const auto& name : written) {
+                env.erase(name);
+            }
+            return;
+        }
+        
+        case ASTNodeType::MEMBER_EXPR: {
+            // 对象本身是内存位置，只处理其中的下标和调用参数
+            ASTNode* object = node->getChild(0);
+            if (object && object->getType() == ASTNodeType::INDEX_EXPR) {
+                propagateExpr(object, 1, env);
+            }
+            for (size_t i = 1; i < node->getChildCount(); ++i) {
+                propagateExpr(node, i, env);
+            }
+            return;
+        }
+        
+        case ASTNodeType::INDEX_EXPR:
+            propagateExpr(node, 1, env);
+            return;
+        
+        default:
+            for (size_t i = 0; i < node->getChildCount(); ++i) {
+                propagateExpr(node, i, env);
+            }
+            return;
+    }
+}
+
+// StartPrefixPass 实现
+
+/**
+ * on start 前缀求值
+ * @param program AST 根节点
+ * @return 移入静态初始值的语句数
+ */
+int StartPrefixPass::run(ASTNode* program) {
+    ASTNode* start = nullptr;
+    std::map<std::string, VariableDeclNode*> globals;
+    ConstantEnv env;
+    
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::ON_START && !start) {
+            start = child.get();
+        } else if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                VariableDeclNode* decl = static_cast<VariableDeclNode*>(var.get());
+                if (decl->getArraySize() != 0 || decl->getVarType() == "message") {
+                    continue;
+                }
+                globals[decl->getName()] = decl;
+                // 初始值按声明顺序求值，依赖非常量的变量不参与
+                ConstantValue value = ConstantValue::makeInt(0);
+                if (decl->getInitializer() && !evaluateConstant(decl->getInitializer(), value, &env)) {
+                    continue;
+                }
+                ConstantValue converted;
+                if (value.convertTo(decl->getVarType(), converted)) {
+                    env[decl->getName()] = converted;
+                }
+            }
+        }
+    }
+    if (!start) {
+        return 0;
+    }
+    
+    // on start 中声明的局部变量会遮蔽全局变量，不处理这些名称
+    std::map<std::string, int> local_counts;
+    std::map<std::string, std::string> local_types;
+    collectDecls(start, local_counts, local_types);
+    
+    // 跳过开头没有初始值或初始值为常量的局部变量声明：它们不读写全局变量，
+    // 初始值读取全局变量的声明会看到前移后的值，不跳过
+    size_t first = 0;
+    while (first < start->getChildCount() && start->getChild(first)->getType() == ASTNodeType::VARIABLE_DECL) {
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(start->getChild(first));
+        ConstantValue value;
+        if (decl->getInitializer() && !evaluateConstant(decl->getInitializer(), value, nullptr)) {
+            break;
+        }
+        ++first;
+    }
+    
+    std::map<std::string, ConstantValue> hoisted;
+    int changes = 0;
+    while (first < start->getChildCount()) {
+        ASTNode* stmt = start->getChild(first);
+        if (stmt->getType() != ASTNodeType::EXPRESSION_STMT || stmt->getChildCount() == 0) {
+            break;
+        }
+        ASTNode* expr = stmt->getChild(0);
+        if (expr->getType() != ASTNodeType::ASSIGNMENT_EXPR && !isIncrementExpr(expr)) {
+            break;
+        }
+        ASTNode* target = expr->getChild(0);
+        if (target->getType() != ASTNodeType::IDENTIFIER) {
+            break;
+        }
+        const std::string& name = static_cast<const IdentifierNode*>(target)->getName();
+        auto global = globals.find(name);
+        if (global == globals.end() || local_counts.count(name)) {
+            break;
+        }
+        
+        // 在当前已知的全局值下计算赋值结果
+        ConstantValue value;
+        bool known;
+        if (expr->getType() == ASTNodeType::ASSIGNMENT_EXPR) {
+            const std::string& op = static_cast<const AssignmentExprNode*>(expr)->getOperator();
+            if (op == "=") {
+                known = evaluateConstant(expr->getChild(1), value, &env);
+            } else {
+                BinaryExprNode combine(op.substr(0, 1));
+                combine.addChild(std::make_unique<IdentifierNode>(name));
+                ConstantValue rhs;
+                known = evaluateConstant(expr->getChild(1), rhs, &env);
+                if (known) {
+                    combine.addChild(rhs.toLiteral(0));
+                    known = evaluateConstant(&combine, value, &env);
+                }
+            }
+        } else {
+            BinaryExprNode combine(static_cast<const UnaryExprNode*>(expr)->getOperator() == "++" ? "+" : "-");
+            combine.addChild(std::make_unique<IdentifierNode>(name));
+            combine.addChild(ConstantValue::makeInt(1).toLiteral(0));
+            known = evaluateConstant(&combine, value, &env);
+        }
+        
+        ConstantValue converted;
+        if (!known || !value.convertTo(global->second->getVarType(), converted) || !converted.toLiteral(0)) {
+            break;
+        }
+        env[name] = converted;
+        hoisted[name] = converted;
+        start->removeChild(first);
+        ++changes;
+    }
+    
+    for (const auto& entry : hoisted) {
+        VariableDeclNode* decl = globals[entry.first];
+        auto literal = entry.second.toLiteral(decl->getLine());
+        if (decl->getInitializer()) {
+            decl->replaceChild(0, std::move(literal));
+        } else {
+            decl->addChild(std::move(literal));
+        }
+    }
+    return changes;
+}
+
+} // namespace capl
@@ -0,0 +1,446 @@
+/**
+ * CAPL 事件处理器静态开销模型实现
+ */
+
+#include "../include/cost_model.h"
+#include "../include/ast.h"
+#include <algorithm>
+#include <iomanip>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 读取整数字面量的值
+ * @param node 节点
+ * @param value 输出的值
+ * @return 节点是否为整数字面量
+ */
+bool integerLiteralValue(const ASTNode* node, long long& value) {
+    if (!node || node->getType() != ASTNodeType::INTEGER_LITERAL) {
+        return false;
+    }
+    try {
+        value = std::stoll(static_cast<const LiteralNode*>(node)->getValue(), nullptr, 0);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+/**
+ * 检查节点是否为指定名称的标识符
+ */
+bool isIdentifier(const ASTNode* node, const std::string& name) {
+    return node && node->getType() == ASTNodeType::IDENTIFIER &&
+           static_cast<const IdentifierNode*>(node)->getName() == name;
+}
+
+/**
+ * 检查子树中是否修改了指定变量
+ */
+bool writesVariable(const ASTNode* node, const std::string& name) {
+    if (!node) {
+        return false;
+    }
+    if ((node->getType() == ASTNodeType::ASSIGNMENT_EXPR) && isIdentifier(node->getChild(0), name)) {
+        return true;
+    }
+    if (node->getType() == ASTNodeType::UNARY_EXPR) {
+        const std::string& op = static_cast<const UnaryExprNode*>(node)->getOperator();
+        if ((op == "++" || op == "--") && isIdentifier(node->getChild(0), name)) {
+            return true;
+        }
+    }
+    for (const auto& child : node->getChildren()) {
+        if (writesVariable(child.get(), name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 饱和乘法，避免嵌套循环估算溢出
+ */
+uint64_t saturatingMul(uint64_t a, uint64_t b) {
+    if (a != 0 && b > UINT64_MAX / a) {
+        return UINT64_MAX;
+    }
+    return a * b;
+}
+
+uint64_t saturatingAdd(uint64_t a, uint64_t b) {
+    return (a > UINT64_MAX - b) ? UINT64_MAX : a + b;
+}
+
+} // namespace
+
+/**
+ * 构造函数
+ */
+CostModel::CostModel() : budget_(kDefaultBudget) {
+}
+
+/**
+ * 分析整个程序
+ * @param program AST 根节点
+ */
+void CostModel::analyze(const ASTNode* program) {
+    costs_.clear();
+    functions_.clear();
+    function_costs_.clear();
+    in_progress_.clear();
+    
+    if (!program) {
+        return;
+    }
+    
+    // 先收集用户函数，调用处按被调函数开销展开
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            const FunctionNode* func = static_cast<const FunctionNode*>(child.get());
+            functions_[func->getName()] = func;
+        }
+    }
+    
+    for (const auto& child : program->getChildren()) {
+        switch (child->getType()) {
+            case ASTNodeType::ON_START:
+            case ASTNodeType::ON_STOP:
+            case ASTNodeType::ON_MESSAGE:
+            case ASTNodeType::ON_TIMER:
+            case ASTNodeType::ON_KEY: {
+                const OnEventNode* handler = static_cast<const OnEventNode*>(child.get());
+                HandlerCost cost;
+                cost.name = handler->getDisplayName();
+                cost.line = handler->getLine();
+                for (const auto& stmt : handler->getChildren()) {
+                    cost.operations = saturatingAdd(cost.operations, estimate(stmt.get(), cost, 1));
+                }
+                costs_.push_back(cost);
+                break;
+            }
+            case ASTNodeType::FUNCTION:
+                costs_.push_back(estimateFunction(static_cast<const FunctionNode*>(child.get())));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * 估算用户函数的开销（带缓存）
+ */
+const HandlerCost& CostModel::estimateFunction(const FunctionNode* func) {
+    auto it = function_costs_.find(func->getName());
+    if (it != function_costs_.end()) {
+        return it->second;
+    }
+    
+    HandlerCost cost;
+    cost.name = func->getName() + "()";
+    cost.line = func->getLine();
+    cost.is_function = true;
+    
+    in_progress_.insert(func->getName());
+    for (const auto& stmt : func->getChildren()) {
+        cost.operations = saturatingAdd(cost.operations, estimate(stmt.get(), cost, 1));
+    }
+    in_progress_.erase(func->getName());
+    
+    return function_costs_[func->getName()] = cost;
+}
+
+/**
+ * 内置函数的经验开销
+ */
+uint64_t CostModel::builtinCost(const std::string& name) const {
+    if (name == "write") {
+        return 50;      // 格式化并输出到 Write 窗口
+    }
+    if (name == "output") {
+        return 20;      // 报文发送
+    }
+    if (name == "setTimer" || name == "cancelTimer") {
+        return 5;
+    }
+    return 5;           // 未知的外部函数
+}
+
+/**
+ * 计算 for (i = A; i op B; i += step) 形式循环的常量迭代次数：
+ * 比较循环的起始值已越过终值时迭代 0 次，!= 循环的 B - A 与步长异号时不认为有常量迭代次数
+ * @param for_node FOR_STMT 节点
+ * @param trips 输出的迭代次数
+ * @return 是否能确定常量迭代次数
+ */
+bool CostModel::constantTripCount(const ASTNode* for_node, uint64_t& trips) const {
+    const ASTNode* init = for_node->getChild(0);
+    const ASTNode* cond = for_node->getChild(1);
+    const ASTNode* update = for_node->getChild(2);
+    const ASTNode* body = for_node->getChild(3);
+    
+    // 初始化: int i = A 或 i = A
+    std::string var;
+    long long start = 0;
+    if (init->getType() == ASTNodeType::VARIABLE_DECL) {
+        var = static_cast<const VariableDeclNode*>(init)->getName();
+        if (!integerLiteralValue(init->getChild(0), start)) {
+            return false;
+        }
+    } else {
+        const ASTNode* assign = init->getChild(0);
+        if (!assign || assign->getType() != ASTNodeType::ASSIGNMENT_EXPR ||
+            static_cast<const AssignmentExprNode*>(assign)->getOperator() != "=" ||
+            assign->getChild(0)->getType() != ASTNodeType::IDENTIFIER ||
+            !integerLiteralValue(assign->getChild(1), start)) {
+            return false;
+        }
+        var = static_cast<const IdentifierNode*>(assign->getChild(0))->getName();
+    }
+    
+    // 条件: i op B
+    if (cond->getType() != ASTNodeType::BINARY_EXPR || !isIdentifier(cond->getChild(0), var)) {
+        return false;
+    }
+    long long end = 0;
+    if (!integerLiteralValue(cond->getChild(1), end)) {
+        return false;
+    }
+    const std::string& op = static_cast<const BinaryExprNode*>(cond)->getOperator();
+    
+    // 更新: i++, i--, i += k, i -= k
+    long long step = 0;
+    if (update->getType() == ASTNodeType::UNARY_EXPR && isIdentifier(update->getChild(0), var)) {
+        const std::string& update_op = static_cast<const UnaryExprNode*>(update)->getOperator();
+        step = update_op == "++" ? 1 : (update_op == "--" ? -1 : 0);
+    } else if (update->getType() == ASTNodeType::ASSIGNMENT_EXPR && isIdentifier(update->getChild(0), var)) {
+        const std::string& update_op = static_cast<const AssignmentExprNode*>(update)->getOperator();
+        long long k = 0;
+        if (integerLiteralValue(update->getChild(1), k)) {
+            step = update_op == "+=" ? k : (update_op == "-=" ? -k : 0);
+        }
+    }
+    if (step == 0) {
+        return false;
+    }
+    
+    // 循环体内修改循环变量时无法确定边界
+    if (writesVariable(body, var)) {
+        return false;
+    }
+    
+    // 步长方向与终值方向相反时，!= 循环要越过整数范围才可能终止
+    if (op == "!=" && ((end > start && step < 0) || (end < start && step > 0))) {
+        return false;
+    }
+    
+    long long distance;
+    if (step > 0 && (op == "<" || op == "!=")) {
+        distance = end - start;
+    } else if (step > 0 && op == "<=") {
+        distance = end - start + 1;
+    } else if (step < 0 && (op == ">" || op == "!=")) {
+        distance = start - end;
+        step = -step;
+    } else if (step < 0 && op == ">=") {
+        distance = start - end + 1;
+        step = -step;
+    } else {
+        return false;
+    }
+    
+    if (op == "!=" && distance % step != 0) {
+        return false;   // 步长越过终值，循环不会终止
+    }
+    trips = distance > 0 ? static_cast<uint64_t>((distance + step - 1) / step) : 0;
+    return true;
+}
+
+/**
+ * 递归估算节点开销
+ * @param node 节点
+ * @param cost 当前处理器的统计信息
+ * @param enclosing_trips 外层循环的累计迭代次数
+ * @return 节点的最坏情况操作数（单次执行）
+ */
+uint64_t CostModel::estimate(const ASTNode* node, HandlerCost& cost, uint64_t enclosing_trips) {
+    if (!node) {
+        return 0;
+    }
+    
+    auto sumChildren = [&](size_t first) {
+        uint64_t total = 0;
+        for (size_t i = first; i < node->getChildCount(); ++i) {
+            total = saturatingAdd(total, estimate(node->getChild(i), cost, enclosing_trips));
+        }
+        return total;
+    };
+    
+    switch (node->getType()) {
+        case ASTNodeType::INTEGER_LITERAL:
+        case ASTNodeType::FLOAT_LITERAL:
+        case ASTNodeType::STRING_LITERAL:
+        case ASTNodeType::CHAR_LITERAL:
+        case ASTNodeType::BOOLEAN_LITERAL:
+            return 0;
+        
+        case ASTNodeType::IDENTIFIER:
+        case ASTNodeType::BREAK_STMT:
+        case ASTNodeType::CONTINUE_STMT:
+            return 1;
+        
+        case ASTNodeType::BINARY_EXPR:
+        case ASTNodeType::UNARY_EXPR:
+        case ASTNodeType::INDEX_EXPR:
+        case ASTNodeType::ASSIGNMENT_EXPR:
+        case ASTNodeType::RETURN_STMT:
+            return saturatingAdd(1, sumChildren(0));
+        
+        case ASTNodeType::MEMBER_EXPR: {
+            const MemberExprNode* member = static_cast<const MemberExprNode*>(node);
+            return saturatingAdd(member->isCall() ? 2 : 1, sumChildren(0));
+        }
+        
+        case ASTNodeType::CONDITIONAL_EXPR: {
+            uint64_t condition = estimate(node->getChild(0), cost, enclosing_trips);
+            uint64_t a = estimate(node->getChild(1), cost, enclosing_trips);
+            uint64_t b = estimate(node->getChild(2), cost, enclosing_trips);
+            return saturatingAdd(condition + 1, std::max(a, b));
+        }
+        
+        case ASTNodeType::CALL_EXPR: {
+            const CallExprNode* call = static_cast<const CallExprNode*>(node);
+            uint64_t args = sumChildren(0);
+            auto it = functions_.find(call->getFunctionName());
+            if (it == functions_.end()) {
+                return saturatingAdd(args, builtinCost(call->getFunctionName()));
+            }
+            if (in_progress_.count(call->getFunctionName())) {
+                // 递归调用：深度未知
+                cost.unbounded_loops++;
+                return saturatingAdd(args, 2);
+            }
+            
+            // 被调函数的循环计入调用者
+            const HandlerCost& callee = estimateFunction(it->second);
+            cost.loop_count += callee.loop_count;
+            cost.unbounded_loops += callee.unbounded_loops;
+            cost.max_trip_count = std::max(cost.max_trip_count, callee.max_trip_count);
+            cost.loop_iterations = saturatingAdd(cost.loop_iterations,
+                                                 saturatingMul(callee.loop_iterations, enclosing_trips));
+            return saturatingAdd(args, saturatingAdd(2, callee.operations));
+        }
+        
+        case ASTNodeType::VARIABLE_DECL:
+            return node->getChildCount() > 0 ? saturatingAdd(1, sumChildren(0)) : 0;
+        
+        case ASTNodeType::IF_STMT: {
+            uint64_t condition = estimate(node->getChild(0), cost, enclosing_trips);
+            uint64_t then_cost = estimate(node->getChild(1), cost, enclosing_trips);
+            uint64_t else_cost = estimate(node->getChild(2), cost, enclosing_trips);
+            return saturatingAdd(condition + 1, std::max(then_cost, else_cost));
+        }
+        
+        case ASTNodeType::SWITCH_STMT:
+            // 一次分派跳转，贯穿时可能依次执行所有 case
+            return saturatingAdd(2, sumChildren(0));
+        
+        case ASTNodeType::WHILE_STMT:
+        case ASTNodeType::FOR_STMT: {
+            bool is_for = node->getType() == ASTNodeType::FOR_STMT;
+            uint64_t trips = kDefaultTripCount;
+            if (!is_for || !constantTripCount(node, trips)) {
+                trips = kDefaultTripCount;
+                cost.unbounded_loops++;
+            }
+            cost.loop_count++;
+            cost.max_trip_count = std::max(cost.max_trip_count, trips);
+            
+            uint64_t total_trips = saturatingMul(enclosing_trips, trips);
+            cost.loop_iterations = saturatingAdd(cost.loop_iterations, total_trips);
+            
+            const ASTNode* condition = node->getChild(is_for ? 1 : 0);
+            const ASTNode* body = node->getChild(is_for ? 3 : 1);
+            uint64_t cond_cost = estimate(condition, cost, enclosing_trips);
+            uint64_t iteration = saturatingAdd(cond_cost + 1, estimate(body, cost, total_trips));
+            uint64_t init_cost = 0;
+            if (is_for) {
+                init_cost = estimate(node->getChild(0), cost, enclosing_trips);
+                iteration = saturatingAdd(iteration, estimate(node->getChild(2), cost, enclosing_trips));
+            }
+            return saturatingAdd(init_cost + cond_cost, saturatingMul(trips, iteration));
+        }
+        
+        default:
+            return sumChildren(0);
+    }
+}
+
+/**
+ * 查找指定处理器的开销
+ */
+const HandlerCost* CostModel::findCost(const std::string& name) const {
+    for (const auto& cost : costs_) {
+        if (cost.name == name) {
+            return &cost;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * 检查预算
+ */
+std::vector<std::string> CostModel::checkBudget() const {
+    std::vector<std::string> warnings;
+    if (budget_ == 0) {
+        return warnings;
+    }
+    
+    for (const auto& cost : costs_) {
+        if (cost.is_function || cost.operations <= budget_) {
+            continue;
+        }
+        std::string warning = cost.name + " (行 " + std::to_string(cost.line) + ") 的估算开销 " +
+                              std::to_string(cost.operations) + " 操作超出预算 " +
+                              std::to_string(budget_);
+        if (cost.unbounded_loops > 0) {
+            warning += "（含 " + std::to_string(cost.unbounded_loops) + " 个无常量边界的循环，按 " +
+                       std::to_string(kDefaultTripCount) + " 次估算）";
+        }
+        warnings.push_back(warning);
+    }
+    return warnings;
+}
+
+/**
+ * 输出开销报告
+ */
+void CostModel::printReport(std::ostream& out) const {
+    out << "事件处理器开销报告";
+    if (budget_ > 0) {
+        out << " (预算: " << budget_ << " 操作/事件)";
+    }
+    out << "\n";
+    out << "    操作数    最大循环      总迭代  处理器\n";
+    
+    for (const auto& cost : costs_) {
+        out << std::setw(10) << cost.operations
+            << std::setw(12) << cost.max_trip_count
+            << std::setw(12) << cost.loop_iterations
+            << "  " << cost.name << " (行 " << cost.line << ")";
+        if (cost.unbounded_loops > 0) {
+            out << " [" << cost.unbounded_loops << " 个循环无常量边界]";
+        }
+        if (!cost.is_function && budget_ > 0 && cost.operations > budget_) {
+            out << " [超出预算]";
+        }
+        out << "\n";
+    }
+}
+
+} // namespace capl
@@ -0,0 +1,686 @@
+/**
+ * CAPL 全程序死代码消除实现
+ */
+
+#include "../include/dead_code_elimination.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include "../include/integer_narrowing.h"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace capl {
+
+namespace {
+
+bool isHandlerOrFunction(const ASTNode* node) {
+    return node->getType() != ASTNodeType::BLOCK_STMT && isStatementList(node);
+}
+
+bool isStore(const ASTNode* node) {
+    return node && (node->getType() == ASTNodeType::ASSIGNMENT_EXPR || isIncrementExpr(node));
+}
+
+bool containsCall(const ASTNode* node) {
+    if (!node) {
+        return false;
+    }
+    if (node->getType() == ASTNodeType::CALL_EXPR) {
+        return true;
+    }
+    for (const auto& child : node->getChildren()) {
+        if (containsCall(child.get())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isIdentifier(const ASTNode* node, const std::string& name) {
+    return node && node->getType() == ASTNodeType::IDENTIFIER &&
+           static_cast<const IdentifierNode*>(node)->getName() == name;
+}
+
+/**
+ * 子树中是否出现指定名称的标识符
+ */
+bool mentions(const ASTNode* node, const std::string& name) {
+    if (!node) {
+        return false;
+    }
+    if (node->getType() == ASTNodeType::IDENTIFIER && static_cast<const IdentifierNode*>(node)->getName() == name) {
+        return true;
+    }
+    for (const auto& child : node->getChildren()) {
+        if (mentions(child.get(), name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 各层作用域中已声明的局部变量
+ */
+using Scopes = std::vector<std::set<std::string>>;
+
+/**
+ * 名称是否为作用域中声明的局部变量（形参或已声明的局部变量）
+ */
+bool isLocal(const Scopes& scopes, const std::string& name) {
+    for (const auto& scope : scopes) {
+        if (scope.count(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void collectReads(const ASTNode* node, std::map<std::string, int>& reads, bool statement_level = false,
+                  Scopes* scopes = nullptr);
+
+/**
+ * 存储目标中的读取：下标和调用参数，不含根变量本身
+ */
+void collectTargetReads(const ASTNode* target, std::map<std::string, int>& reads, Scopes* scopes) {
+    while (target) {
+        if (target->getType() == ASTNodeType::INDEX_EXPR) {
+            collectReads(target->getChild(1), reads, false, scopes);
+        } else if (target->getType() == ASTNodeType::MEMBER_EXPR) {
+            for (size_t i = 1; i < target->getChildCount(); ++i) {
+                collectReads(target->getChild(i), reads, false, scopes);
+            }
+        } else {
+            return;
+        }
+        target = target->getChild(0);
+    }
+}
+
+/**
+ * 统计变量被读取的次数。语句级的存储（x = ...、x += ...、x++）不计为对 x 的读取，
+ * 没有副作用的右值中对 x 自身的读取（x = x + a[i]）也不计入，这样的存储随 x 一起删除；
+ * 表达式内部的赋值按读取处理。给出 scopes 时按块作用域只统计全局变量的读取，
+ * 同名形参和局部变量的读取不计入
+ */
+void collectReads(const ASTNode* node, std::map<std::string, int>& reads, bool statement_level, Scopes* scopes) {
+    if (!node) {
+        return;
+    }
+    if (statement_level && isStore(node)) {
+        collectTargetReads(node->getChild(0), reads, scopes);
+        if (node->getType() != ASTNodeType::ASSIGNMENT_EXPR) {
+            return;
+        }
+        const ASTNode* target = node->getChild(0);
+        const ASTNode* value = node->getChild(1);
+        if (target->getType() != ASTNodeType::IDENTIFIER || hasSideEffects(value)) {
+            collectReads(value, reads, false, scopes);
+            return;
+        }
+        std::map<std::string, int> value_reads;
+        collectReads(value, value_reads, false, scopes);
+        value_reads.erase(static_cast<const IdentifierNode*>(target)->getName());
+        for (const auto& entry : value_reads) {
+            reads[entry.first] += entry.second;
+        }
+        return;
+    }
+    
+    bool opens_scope = scopes && (isStatementList(node) || node->getType() == ASTNodeType::FOR_STMT);
+    if (opens_scope) {
+        scopes->emplace_back();
+        if (node->getType() == ASTNodeType::FUNCTION) {
+            for (const auto& param : static_cast<const FunctionNode*>(node)->getParameters()) {
+                scopes->back().insert(static_cast<const VariableDeclNode*>(param.get())->getName());
+            }
+        }
+    }
+    
+    switch (node->getType()) {
+        case ASTNodeType::IDENTIFIER: {
+            const std::string& name = static_cast<const IdentifierNode*>(node)->getName();
+            if (!scopes || !isLocal(*scopes, name)) {
+                reads[name]++;
+            }
+            break;
+        }
+        case ASTNodeType::VARIABLE_DECL:
+            collectReads(node->getChild(0), reads, false, scopes);
+            if (scopes && !scopes->empty()) {
+                scopes->back().insert(static_cast<const VariableDeclNode*>(node)->getName());
+            }
+            break;
+        case ASTNodeType::EXPRESSION_STMT:
+            collectReads(node->getChild(0), reads, true, scopes);
+            break;
+        case ASTNodeType::FOR_STMT:
+            for (size_t i = 0; i < node->getChildCount(); ++i) {
+                collectReads(node->getChild(i), reads, i == 2, scopes);
+            }
+            break;
+        default:
+            for (const auto& child : node->getChildren()) {
+                collectReads(child.get(), reads, false, scopes);
+            }
+            break;
+    }
+    
+    if (opens_scope) {
+        scopes->pop_back();
+    }
+}
+
+/**
+ * 函数中声明的局部变量和形参的名称及声明次数（不区分作用域）
+ */
+void collectDeclNames(const ASTNode* node, std::map<std::string, int>& names) {
+    if (!node) {
+        return;
+    }
+    if (node->getType() == ASTNodeType::FUNCTION) {
+        for (const auto& param : static_cast<const FunctionNode*>(node)->getParameters()) {
+            names[static_cast<const VariableDeclNode*>(param.get())->getName()]++;
+        }
+    }
+    if (node->getType() == ASTNodeType::VARIABLE_DECL) {
+        names[static_cast<const VariableDeclNode*>(node)->getName()]++;
+    }
+    for (const auto& child : node->getChildren()) {
+        collectDeclNames(child.get(), names);
+    }
+}
+
+/**
+ * 去掉存储后剩下的语句：保留有副作用的右值，否则为空
+ */
+std::unique_ptr<ASTNode> storeRemainder(ASTNode* store) {
+    if (store->getType() == ASTNodeType::ASSIGNMENT_EXPR && hasSideEffects(store->getChild(1))) {
+        return store->removeChild(1);
+    }
+    return nullptr;
+}
+
+/**
+ * 用 replacement 替换 parent 的第 index 个语句；replacement 为空时删除语句，
+ * 不在语句列表中的位置（for 的初始化和更新）换成空语句。返回下一个要检查的下标
+ */
+size_t replaceStatement(ASTNode* parent, size_t index, std::unique_ptr<ASTNode> replacement) {
+    if (replacement) {
+        parent->replaceChild(index, std::move(replacement));
+        return index + 1;
+    }
+    if (isStatementList(parent)) {
+        parent->removeChild(index);
+        return index;
+    }
+    auto empty = std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT);
+    parent->replaceChild(index, std::move(empty));
+    return index + 1;
+}
+
+std::unique_ptr<ASTNode> makeExpressionStatement(std::unique_ptr<ASTNode> expr) {
+    if (!expr) {
+        return nullptr;
+    }
+    auto stmt = std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT);
+    stmt->setLine(expr->getLine());
+    stmt->addChild(std::move(expr));
+    return stmt;
+}
+
+/**
+ * 语句是否声明名为 name 的变量（for 的初始化部分中的声明只在循环中可见）
+ */
+bool declaresName(const ASTNode* stmt, const std::string& name) {
+    if (stmt->getType() == ASTNodeType::FOR_STMT) {
+        stmt = stmt->getChild(0);
+    }
+    return stmt->getType() == ASTNodeType::VARIABLE_DECL &&
+           static_cast<const VariableDeclNode*>(stmt)->getName() == name;
+}
+
+/**
+ * 删除子树中对 name 的语句级存储，返回删除数。global 为真时 name 是全局变量：
+ * 同名局部变量声明之后直到所在代码块结束的存储写的是局部变量，不删除
+ */
+int removeStoresTo(ASTNode* node, const std::string& name, bool global = false) {
+    int changes = 0;
+    for (size_t i = 0; i < node->getChildCount();) {
+        ASTNode* child = node->getChild(i);
+        if (global && declaresName(child, name)) {
+            if (child->getType() == ASTNodeType::VARIABLE_DECL) {
+                break;
+            }
+            ++i;
+            continue;
+        }
+        bool for_update = node->getType() == ASTNodeType::FOR_STMT && i == 2;
+        ASTNode* store = nullptr;
+        if (child->getType() == ASTNodeType::EXPRESSION_STMT && isStore(child->getChild(0))) {
+            store = child->getChild(0);
+        } else if (for_update && isStore(child)) {
+            store = child;
+        }
+        
+        if (store && getRootVariable(store->getChild(0)) == name && !hasSideEffects(store->getChild(0))) {
+            std::unique_ptr<ASTNode> remainder = storeRemainder(store);
+            if (remainder && !for_update) {
+                remainder = makeExpressionStatement(std::move(remainder));
+            }
+            i = replaceStatement(node, i, std::move(remainder));
+            ++changes;
+            continue;
+        }
+        
+        changes += removeStoresTo(child, name, global);
+        ++i;
+    }
+    return changes;
+}
+
+/**
+ * 删除子树中名为 name 的变量声明，保留有副作用的初始化表达式
+ */
+int removeDeclaration(ASTNode* node, const std::string& name) {
+    int changes = 0;
+    for (size_t i = 0; i < node->getChildCount();) {
+        ASTNode* child = node->getChild(i);
+        if (child->getType() == ASTNodeType::VARIABLE_DECL &&
+            static_cast<const VariableDeclNode*>(child)->getName() == name) {
+            std::unique_ptr<ASTNode> remainder;
+            if (hasSideEffects(child->getChild(0))) {
+                remainder = makeExpressionStatement(child->removeChild(0));
+            }
+            i = replaceStatement(node, i, std::move(remainder));
+            ++changes;
+            continue;
+        }
+        changes += removeDeclaration(child, name);
+        ++i;
+    }
+    return changes;
+}
+
+/**
+ * 语句列表中第 index 个语句对 name 的整体赋值在被读取之前是否又被整体赋值。
+ * 被调函数可能读取全局变量，但看不到局部变量
+ */
+bool isOverwritten(const ASTNode* list, size_t index, const std::string& name, bool is_local) {
+    for (size_t j = index + 1; j < list->getChildCount(); ++j) {
+        const ASTNode* next = list->getChild(j);
+        if (next->getType() == ASTNodeType::EXPRESSION_STMT) {
+            const ASTNode* expr = next->getChild(0);
+            if (expr && expr->getType() == ASTNodeType::ASSIGNMENT_EXPR &&
+                static_cast<const AssignmentExprNode*>(expr)->getOperator() == "=" &&
+                expr->getChild(0)->getType() == ASTNodeType::IDENTIFIER &&
+                static_cast<const IdentifierNode*>(expr->getChild(0))->getName() == name &&
+                !mentions(expr->getChild(1), name) && (is_local || !containsCall(expr->getChild(1)))) {
+                return true;
+            }
+            if (mentions(next, name) || (!is_local && containsCall(next))) {
+                return false;
+            }
+            continue;
+        }
+        if (next->getType() == ASTNodeType::VARIABLE_DECL &&
+            static_cast<const VariableDeclNode*>(next)->getName() != name &&
+            !mentions(next, name) && (is_local || !containsCall(next))) {
+            continue;
+        }
+        return false;
+    }
+    return false;
+}
+
+/**
+ * for 循环是否没有任何效果：循环变量在初始化部分声明，循环体为空，条件把循环变量与常量比较，
+ * 更新为 ++ 或 --，且终值在循环变量类型的范围内，循环一定结束
+ */
+bool isEmptyCountedLoop(const ASTNode* for_node) {
+    const ASTNode* init = for_node->getChild(0);
+    const ASTNode* cond = for_node->getChild(1);
+    const ASTNode* update = for_node->getChild(2);
+    const ASTNode* body = for_node->getChild(3);
+    if (init->getType() != ASTNodeType::VARIABLE_DECL || hasSideEffects(init->getChild(0)) ||
+        body->getChildCount() != 0) {
+        return false;
+    }
+    const VariableDeclNode* var = static_cast<const VariableDeclNode*>(init);
+    ValueRange range = IntegerNarrowing::typeRange(var->getVarType());
+    ConstantValue end;
+    if (!range.known || var->isArray() || cond->getType() != ASTNodeType::BINARY_EXPR ||
+        !isIdentifier(cond->getChild(0), var->getName()) || !evaluateConstant(cond->getChild(1), end) ||
+        end.is_float || update->getType() != ASTNodeType::UNARY_EXPR ||
+        !isIdentifier(update->getChild(0), var->getName())) {
+        return false;
+    }
+    const std::string& op = static_cast<const BinaryExprNode*>(cond)->getOperator();
+    const std::string& step = static_cast<const UnaryExprNode*>(update)->getOperator();
+    if (step == "++") {
+        return (op == "<" && end.int_value <= range.hi) || (op == "<=" && end.int_value < range.hi);
+    }
+    if (step == "--") {
+        return (op == ">" && end.int_value >= range.lo) || (op == ">=" && end.int_value > range.lo);
+    }
+    return false;
+}
+
+/**
+ * 收集子树中调用的函数名
+ */
+void collectCalls(const ASTNode* node, std::set<std::string>& calls) {
+    if (!node) {
+        return;
+    }
+    if (node->getType() == ASTNodeType::CALL_EXPR) {
+        calls.insert(static_cast<const CallExprNode*>(node)->getFunctionName());
+    }
+    for (const auto& child : node->getChildren()) {
+        collectCalls(child.get(), calls);
+    }
+}
+
+} // namespace
+
+/**
+ * 死代码消除
+ * @param program AST 根节点
+ * @return 删除或化简的次数
+ */
+int DeadCodeEliminationPass::run(ASTNode* program) {
+    int changes = foldBranches(program);
+    changes += removeUncalledFunctions(program);
+    for (const auto& child : program->getChildren()) {
+        if (isHandlerOrFunction(child.get())) {
+            Scopes scopes(1);
+            if (child->getType() == ASTNodeType::FUNCTION) {
+                for (const auto& param : static_cast<const FunctionNode*>(child.get())->getParameters()) {
+                    scopes.back().insert(static_cast<const VariableDeclNode*>(param.get())->getName());
+                }
+            }
+            changes += removeOverwrittenStores(child.get(), scopes);
+            changes += removeUnusedLocals(child.get(), program);
+        }
+    }
+    changes += removeUnusedGlobals(program);
+    return changes;
+}
+
+/**
+ * 删除常量条件下不可达的分支和循环、循环体为空的计数循环，展开不声明变量的代码块
+ */
+int DeadCodeEliminationPass::foldBranches(ASTNode* node) {
+    int changes = 0;
+    for (size_t i = 0; i < node->getChildCount();) {
+        ASTNode* child = node->getChild(i);
+        if (!isStatementList(node)) {
+            changes += foldBranches(child);
+            ++i;
+            continue;
+        }
+        
+        ConstantValue cond;
+        switch (child->getType()) {
+            case ASTNodeType::IF_STMT:
+                if (evaluateConstant(child->getChild(0), cond)) {
+                    std::unique_ptr<ASTNode> taken;
+                    if (cond.isTrue()) {
+                        taken = child->removeChild(1);
+                    } else if (child->getChildCount() > 2) {
+                        taken = child->removeChild(2);
+                    }
+                    i = replaceStatement(node, i, std::move(taken));
+                    ++changes;
+                    continue;
+                }
+                // 两个分支都为空时只保留条件的副作用
+                if (child->getChild(1)->getChildCount() == 0 &&
+                    (child->getChildCount() < 3 || child->getChild(2)->getChildCount() == 0)) {
+                    std::unique_ptr<ASTNode> remainder;
+                    if (hasSideEffects(child->getChild(0))) {
+                        remainder = makeExpressionStatement(child->removeChild(0));
+                    }
+                    i = replaceStatement(node, i, std::move(remainder));
+                    ++changes;
+                    continue;
+                }
+                break;
+            
+            case ASTNodeType::BLOCK_STMT: {
+                // 存储删除或内联后留下的代码块不声明变量时，语句移到外层，空代码块直接删除
+                bool declares = false;
+                for (const auto& stmt : child->getChildren()) {
+                    declares = declares || stmt->getType() == ASTNodeType::VARIABLE_DECL;
+                }
+                if (!declares) {
+                    std::unique_ptr<ASTNode> block = node->removeChild(i);
+                    while (block->getChildCount() > 0) {
+                        node->insertChild(i++, block->removeChild(0));
+                    }
+                    ++changes;
+                    continue;
+                }
+                break;
+            }
+            
+            case ASTNodeType::WHILE_STMT:
+                if (evaluateConstant(child->getChild(0), cond) && !cond.isTrue()) {
+                    i = replaceStatement(node, i, nullptr);
+                    ++changes;
+                    continue;
+                }
+                break;
+            
+            case ASTNodeType::FOR_STMT: {
+                // 死存储删除后循环体为空的计数循环没有效果
+                if (isEmptyCountedLoop(child)) {
+                    i = replaceStatement(node, i, nullptr);
+                    ++changes;
+                    continue;
+                }
+                ASTNode* for_cond = child->getChild(1);
+                if (for_cond->getType() != ASTNodeType::EXPRESSION_STMT &&
+                    evaluateConstant(for_cond, cond) && !cond.isTrue()) {
+                    // 只剩初始化部分，放在代码块中保持其作用域
+                    std::unique_ptr<ASTNode> init = child->removeChild(0);
+                    std::unique_ptr<ASTNode> block;
+                    if (!(init->getType() == ASTNodeType::EXPRESSION_STMT && init->getChildCount() == 0)) {
+                        block = std::make_unique<ASTNode>(ASTNodeType::BLOCK_STMT);
+                        block->setLine(child->getLine());
+                        block->addChild(std::move(init));
+                    }
+                    i = replaceStatement(node, i, std::move(block));
+                    ++changes;
+                    continue;
+                }
+                break;
+            }
+            
+            default:
+                break;
+        }
+        
+        changes += foldBranches(child);
+        ++i;
+    }
+    return changes;
+}
+
+/**
+ * 删除从任何事件处理器出发都调用不到的用户函数
+ */
+int DeadCodeEliminationPass::removeUncalledFunctions(ASTNode* program) {
+    std::map<std::string, const ASTNode*> functions;
+    std::set<std::string> reachable;
+    std::vector<std::string> work;
+    
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            functions[static_cast<const FunctionNode*>(child.get())->getName()] = child.get();
+        }
+    }
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            continue;
+        }
+        std::set<std::string> calls;
+        collectCalls(child.get(), calls);
+        work.insert(work.end(), calls.begin(), calls.end());
+    }
+    while (!work.empty()) {
+        std::string name = work.back();
+        work.pop_back();
+        auto it = functions.find(name);
+        if (it == functions.end() || !reachable.insert(name).second) {
+            continue;
+        }
+        std::set<std::string> calls;
+        collectCalls(it->second, calls);
+        work.insert(work.end(), calls.begin(), calls.end());
+    }
+    
+    int changes = 0;
+    for (size_t i = 0; i < program->getChildCount();) {
+        ASTNode* child = program->getChild(i);
+        if (child->getType() == ASTNodeType::FUNCTION &&
+            !reachable.count(static_cast<const FunctionNode*>(child)->getName())) {
+            program->removeChild(i);
+            ++changes;
+            continue;
+        }
+        ++i;
+    }
+    return changes;
+}
+
+/**
+ * 直线代码中，对标量的赋值在被读取之前又被整体赋值时，前一次赋值是死存储。
+ * scopes 为各层作用域中已声明的局部变量，按块作用域区分同名的局部和全局变量
+ */
+int DeadCodeEliminationPass::removeOverwrittenStores(ASTNode* node, std::vector<std::set<std::string>>& scopes) {
+    bool opens_scope = node->getType() == ASTNodeType::BLOCK_STMT || node->getType() == ASTNodeType::FOR_STMT;
+    if (opens_scope) {
+        scopes.emplace_back();
+    }
+    
+    int changes = 0;
+    for (size_t i = 0; i < node->getChildCount();) {
+        ASTNode* stmt = node->getChild(i);
+        ASTNode* store = isStatementList(node) && stmt->getType() == ASTNodeType::EXPRESSION_STMT
+                             ? stmt->getChild(0) : nullptr;
+        if (store && store->getType() == ASTNodeType::ASSIGNMENT_EXPR &&
+            static_cast<const AssignmentExprNode*>(store)->getOperator() == "=" &&
+            store->getChild(0)->getType() == ASTNodeType::IDENTIFIER) {
+            const std::string& name = static_cast<const IdentifierNode*>(store->getChild(0))->getName();
+            if (isOverwritten(node, i, name, isLocal(scopes, name))) {
+                i = replaceStatement(node, i, makeExpressionStatement(storeRemainder(store)));
+                ++changes;
+                continue;
+            }
+        }
+        
+        changes += removeOverwrittenStores(stmt, scopes);
+        if (stmt->getType() == ASTNodeType::VARIABLE_DECL) {
+            scopes.back().insert(static_cast<const VariableDeclNode*>(stmt)->getName());
+        }
+        ++i;
+    }
+    
+    if (opens_scope) {
+        scopes.pop_back();
+    }
+    return changes;
+}
+
+/**
+ * 删除函数中从不被读取的局部变量及对它们的存储
+ */
+int DeadCodeEliminationPass::removeUnusedLocals(ASTNode* function, ASTNode* program) {
+    std::set<std::string> globals;
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                globals.insert(static_cast<const VariableDeclNode*>(var.get())->getName());
+            }
+        }
+    }
+    
+    std::map<std::string, int> decls;
+    collectDeclNames(function, decls);
+    std::map<std::string, int> reads;
+    collectReads(function, reads);
+    
+    std::set<std::string> params;
+    if (function->getType() == ASTNodeType::FUNCTION) {
+        for (const auto& param : static_cast<const FunctionNode*>(function)->getParameters()) {
+            params.insert(static_cast<const VariableDeclNode*>(param.get())->getName());
+        }
+    }
+    
+    int changes = 0;
+    for (const auto& entry : decls) {
+        const std::string& name = entry.first;
+        // 与全局变量同名或多次声明时无法仅凭名称区分，不处理
+        if (entry.second != 1 || params.count(name) || globals.count(name) || reads.count(name)) {
+            continue;
+        }
+        changes += removeStoresTo(function, name);
+        changes += removeDeclaration(function, name);
+    }
+    return changes;
+}
+
+/**
+ * 删除从不被读取的全局变量及所有对它的存储
+ */
+int DeadCodeEliminationPass::removeUnusedGlobals(ASTNode* program) {
+    // 全局变量的初始化表达式照常统计，处理器和函数中按块作用域只统计全局变量的读取
+    std::map<std::string, int> reads;
+    for (const auto& child : program->getChildren()) {
+        Scopes scopes;
+        collectReads(child.get(), reads, false, child->getType() == ASTNodeType::BLOCK_STMT ? nullptr : &scopes);
+    }
+    
+    ASTNode* variables = nullptr;
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            variables = child.get();
+        }
+    }
+    if (!variables) {
+        return 0;
+    }
+    
+    int changes = 0;
+    for (size_t i = 0; i < variables->getChildCount();) {
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(variables->getChild(i));
+        const std::string name = decl->getName();
+        if (reads.count(name) || hasSideEffects(decl->getInitializer())) {
+            ++i;
+            continue;
+        }
+        
+        // 同名形参和局部变量作用域中的存储写的是局部变量，不删除
+        for (const auto& child : program->getChildren()) {
+            if (!isHandlerOrFunction(child.get())) {
+                continue;
+            }
+            bool is_param = false;
+            if (child->getType() == ASTNodeType::FUNCTION) {
+                for (const auto& param : static_cast<const FunctionNode*>(child.get())->getParameters()) {
+                    is_param = is_param || static_cast<const VariableDeclNode*>(param.get())->getName() == name;
+                }
+            }
+            if (!is_param) {
+                changes += removeStoresTo(child.get(), name, true);
+            }
+        }
+        variables->removeChild(i);
+        ++changes;
+    }
+    return changes;
+}
+
+} // namespace capl
@@ -0,0 +1,105 @@
+/**
+ * CAPL 定时器和按键处理器的编译期编号实现
+ */
+
+#include "../include/event_tables.h"
+#include "../include/ast.h"
+
+namespace capl {
+
+/**
+ * 构造函数
+ */
+EventTables::EventTables() : keys_(kKeyCount, nullptr), key_wildcard_(nullptr) {
+}
+
+/**
+ * 为程序中的定时器和按键处理器编号
+ * @param program AST 根节点
+ */
+void EventTables::build(const ASTNode* program) {
+    clear();
+    if (!program) {
+        return;
+    }
+    
+    for (const auto& child : program->getChildren()) {
+        const ASTNode* handler = child.get();
+        if (handler->getType() != ASTNodeType::ON_TIMER && handler->getType() != ASTNodeType::ON_KEY) {
+            continue;
+        }
+        const std::string& name = static_cast<const OnEventNode*>(handler)->getEventName();
+        if (handler->getType() == ASTNodeType::ON_TIMER) {
+            if (name.empty() || timer_ids_.count(name) > 0) {
+                continue;
+            }
+            TimerEntry timer;
+            timer.name = name;
+            timer.id = static_cast<int>(timers_.size());
+            timer.handler = handler;
+            timer_ids_[name] = timer.id;
+            timers_.push_back(timer);
+        } else {
+            int code = keyCode(name);
+            if (name == "*") {
+                if (!key_wildcard_) {
+                    key_wildcard_ = handler;
+                }
+            } else if (code < 0) {
+                unresolved_keys_.push_back(handler);
+            } else if (!keys_[code]) {
+                keys_[code] = handler;
+            }
+        }
+    }
+}
+
+/**
+ * 清空编号结果
+ */
+void EventTables::clear() {
+    timers_.clear();
+    timer_ids_.clear();
+    keys_.assign(kKeyCount, nullptr);
+    key_wildcard_ = nullptr;
+    unresolved_keys_.clear();
+}
+
+/**
+ * 查找定时器 ID
+ * @param name 定时器名称
+ * @return 定时器 ID，不是定时器时返回 -1
+ */
+int EventTables::findTimer(const std::string& name) const {
+    auto it = timer_ids_.find(name);
+    return it != timer_ids_.end() ? it->second : -1;
+}
+
+/**
+ * 是否有任何按键处理器
+ */
+bool EventTables::hasKeyHandlers() const {
+    if (key_wildcard_) {
+        return true;
+    }
+    for (const ASTNode* handler : keys_) {
+        if (handler) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 按键事件名对应的按键编码
+ * @param event_name 事件名（按键字符）
+ * @return 0-255 的编码，不是单个字节时返回 -1
+ */
+int EventTables::keyCode(const std::string& event_name) {
+    if (event_name.size() != 1 || event_name == "*") {
+        return -1;
+    }
+    return static_cast<unsigned char>(event_name[0]);
+}
+
+} // namespace capl
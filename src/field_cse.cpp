@@ -0,0 +1,412 @@
+/**
+ * CAPL 报文字段读取的公共子表达式消除实现
+ */
+
+#include "../include/field_cse.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include <algorithm>
+#include <vector>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 报文的 data 字节数，常量下标超出此范围的读取不缓存
+ */
+constexpr long long kMessageBytes = 8;
+
+/**
+ * 不修改参数的内置函数
+ */
+bool isReadOnlyBuiltin(const std::string& name) {
+    return name == "write" || name == "output";
+}
+
+/**
+ * 表达式中的一处字段读取
+ */
+struct FieldRead {
+    ASTNode* parent;    // 父节点
+    size_t index;       // 在父节点中的位置
+};
+
+/**
+ * 一条语句中的字段读取和失效信息
+ */
+struct StatementInfo {
+    std::map<std::string, std::vector<FieldRead>> reads;    // 按字段键分组的读取
+    std::set<std::string> killed_keys;                      // 被写入的字段
+    std::set<std::string> killed_roots;                     // 所有字段都失效的报文
+    bool kills_globals = false;                             // 是否调用了可能修改全局报文的函数
+    
+    bool kills(const std::string& key, const std::string& root, bool global) const {
+        return killed_keys.count(key) || killed_roots.count(root) || (global && kills_globals);
+    }
+};
+
+/**
+ * 字段读取的规范键，如 "this.id"、"m.data[3]"（byte(3) 与 data[3] 相同）
+ * @param node 表达式节点
+ * @param roots 可缓存字段的报文变量
+ * @param root 输出报文变量名
+ * @return 键，不是可缓存的字段读取时返回空串
+ */
+std::string fieldKey(const ASTNode* node, const std::set<std::string>& roots, std::string& root) {
+    const ASTNode* object = nullptr;
+    std::string field;
+    const ASTNode* index = nullptr;
+    
+    if (node->getType() == ASTNodeType::MEMBER_EXPR) {
+        const MemberExprNode* member = static_cast<const MemberExprNode*>(node);
+        object = node->getChild(0);
+        if (member->isCall()) {
+            if (member->getMember() != "byte" || node->getChildCount() != 2) {
+                return "";
+            }
+            index = node->getChild(1);
+        } else if (member->getMember() == "id" || member->getMember() == "dlc" ||
+                   member->getMember() == "channel" || member->getMember() == "dir") {
+            field = member->getMember();
+        } else {
+            return "";
+        }
+    } else if (node->getType() == ASTNodeType::INDEX_EXPR) {
+        const ASTNode* base = node->getChild(0);
+        if (base->getType() != ASTNodeType::MEMBER_EXPR || static_cast<const MemberExprNode*>(base)->isCall() ||
+            static_cast<const MemberExprNode*>(base)->getMember() != "data") {
+            return "";
+        }
+        object = base->getChild(0);
+        index = node->getChild(1);
+    } else {
+        return "";
+    }
+    
+    if (!object || object->getType() != ASTNodeType::IDENTIFIER) {
+        return "";
+    }
+    root = static_cast<const IdentifierNode*>(object)->getName();
+    if (!roots.count(root)) {
+        return "";
+    }
+    if (index) {
+        ConstantValue value;
+        if (!evaluateConstant(index, value) || value.is_float || value.int_value < 0 ||
+            value.int_value >= kMessageBytes) {
+            return "";
+        }
+        field = "data[" + std::to_string(value.int_value) + "]";
+    }
+    return root + "." + field;
+}
+
+class StatementScanner {
+public:
+    StatementScanner(const std::set<std::string>& roots, StatementInfo& info) : roots_(roots), info_(info) {}
+    
+    void scan(ASTNode* parent, size_t index) {
+        ASTNode* node = parent->getChild(index);
+        if (!node) {
+            return;
+        }
+        
+        std::string root;
+        std::string key = fieldKey(node, roots_, root);
+        if (!key.empty()) {
+            info_.reads[key].push_back(FieldRead{parent, index});
+            return;
+        }
+        
+        switch (node->getType()) {
+            case ASTNodeType::ASSIGNMENT_EXPR:
+                scanTarget(node, 0);
+                scan(node, 1);
+                kill(node->getChild(0));
+                return;
+            case ASTNodeType::UNARY_EXPR:
+                if (isIncrementExpr(node)) {
+                    scanTarget(node, 0);
+                    kill(node->getChild(0));
+                    return;
+                }
+                break;
+            case ASTNodeType::CALL_EXPR: {
+                const std::string& name = static_cast<const CallExprNode*>(node)->getFunctionName();
+                bool read_only = isReadOnlyBuiltin(name);
+                for (size_t i = 0; i < node->getChildCount(); ++i) {
+                    scan(node, i);
+                    // 按引用传递的报文可能被修改
+                    const ASTNode* arg = node->getChild(i);
+                    if (!read_only && arg->getType() == ASTNodeType::IDENTIFIER) {
+                        info_.killed_roots.insert(static_cast<const IdentifierNode*>(arg)->getName());
+                    }
+                }
+                if (!read_only) {
+                    info_.kills_globals = true;
+                }
+                return;
+            }
+            case ASTNodeType::MEMBER_EXPR:
+                // 报文的其他成员函数可能修改报文
+                if (static_cast<const MemberExprNode*>(node)->isCall()) {
+                    std::string object = getRootVariable(node->getChild(0));
+                    if (!object.empty()) {
+                        info_.killed_roots.insert(object);
+                    }
+                }
+                break;
+            case ASTNodeType::VARIABLE_DECL:
+                scan(node, 0);
+                info_.killed_roots.insert(static_cast<const VariableDeclNode*>(node)->getName());
+                return;
+            default:
+                break;
+        }
+        for (size_t i = 0; i < node->getChildCount(); ++i) {
+            scan(node, i);
+        }
+    }
+
+private:
+    /**
+     * 扫描赋值目标中的读取（下标和参数），目标本身不是读取
+     */
+    void scanTarget(ASTNode* parent, size_t index) {
+        ASTNode* target = parent->getChild(index);
+        std::string root;
+        if (!fieldKey(target, roots_, root).empty()) {
+            return;
+        }
+        if (target->getType() == ASTNodeType::INDEX_EXPR) {
+            scanTarget(target, 0);
+            scan(target, 1);
+        } else if (target->getType() == ASTNodeType::MEMBER_EXPR) {
+            scanTarget(target, 0);
+            for (size_t i = 1; i < target->getChildCount(); ++i) {
+                scan(target, i);
+            }
+        } else if (target->getType() != ASTNodeType::IDENTIFIER) {
+            scan(parent, index);
+        }
+    }
+    
+    void kill(const ASTNode* target) {
+        std::string root;
+        std::string key = fieldKey(target, roots_, root);
+        if (!key.empty()) {
+            info_.killed_keys.insert(key);
+            return;
+        }
+        root = getRootVariable(target);
+        if (!root.empty()) {
+            info_.killed_roots.insert(root);
+        }
+    }
+    
+    const std::set<std::string>& roots_;
+    StatementInfo& info_;
+};
+
+void collectNames(const ASTNode* node, std::set<std::string>& names) {
+    if (node->getType() == ASTNodeType::IDENTIFIER) {
+        names.insert(static_cast<const IdentifierNode*>(node)->getName());
+    } else if (node->getType() == ASTNodeType::VARIABLE_DECL) {
+        names.insert(static_cast<const VariableDeclNode*>(node)->getName());
+    } else if (node->getType() == ASTNodeType::FUNCTION) {
+        const FunctionNode* func = static_cast<const FunctionNode*>(node);
+        names.insert(func->getName());
+        for (const auto& param : func->getParameters()) {
+            collectNames(param.get(), names);
+        }
+    }
+    for (const auto& child : node->getChildren()) {
+        collectNames(child.get(), names);
+    }
+}
+
+void countDecls(const ASTNode* node, std::map<std::string, const VariableDeclNode*>& decls,
+                std::map<std::string, int>& counts) {
+    if (node->getType() == ASTNodeType::VARIABLE_DECL) {
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+        decls[decl->getName()] = decl;
+        counts[decl->getName()]++;
+    }
+    for (const auto& child : node->getChildren()) {
+        countDecls(child.get(), decls, counts);
+    }
+}
+
+bool isMessageScalar(const VariableDeclNode* decl) {
+    return decl->getVarType() == "message" && decl->getArraySize() == 0;
+}
+
+} // namespace
+
+/**
+ * 在每个处理器和函数中缓存重复的字段读取
+ * @param program AST 根节点
+ * @return 被替换的读取次数
+ */
+int FieldCSEPass::run(ASTNode* program) {
+    used_names_.clear();
+    collectNames(program, used_names_);
+    
+    std::map<std::string, const VariableDeclNode*> globals;
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                globals[static_cast<const VariableDeclNode*>(var.get())->getName()] =
+                    static_cast<const VariableDeclNode*>(var.get());
+            }
+        }
+    }
+    
+    int changes = 0;
+    for (const auto& child : program->getChildren()) {
+        ASTNode* unit = child.get();
+        if (unit->getType() == ASTNodeType::BLOCK_STMT || !isStatementList(unit)) {
+            continue;
+        }
+        
+        // 只处理名称唯一对应一个报文变量的情况
+        std::map<std::string, const VariableDeclNode*> locals;
+        std::map<std::string, int> counts;
+        countDecls(unit, locals, counts);
+        if (unit->getType() == ASTNodeType::FUNCTION) {
+            for (const auto& param : static_cast<const FunctionNode*>(unit)->getParameters()) {
+                countDecls(param.get(), locals, counts);
+            }
+        }
+        
+        roots_.clear();
+        global_roots_.clear();
+        if (unit->getType() == ASTNodeType::ON_MESSAGE && !counts.count("this")) {
+            roots_.insert("this");
+        }
+        for (const auto& entry : locals) {
+            if (counts[entry.first] == 1 && !globals.count(entry.first) && isMessageScalar(entry.second)) {
+                roots_.insert(entry.first);
+            }
+        }
+        for (const auto& entry : globals) {
+            if (!counts.count(entry.first) && isMessageScalar(entry.second)) {
+                roots_.insert(entry.first);
+                global_roots_.insert(entry.first);
+            }
+        }
+        if (!roots_.empty()) {
+            changes += processNested(unit);
+        }
+    }
+    return changes;
+}
+
+/**
+ * 处理节点下的所有语句列表（外层先于内层）
+ */
+int FieldCSEPass::processNested(ASTNode* node) {
+    int changes = 0;
+    if (isStatementList(node)) {
+        changes += processList(node);
+    }
+    for (const auto& child : node->getChildren()) {
+        changes += processNested(child.get());
+    }
+    return changes;
+}
+
+/**
+ * 在一个语句列表中缓存重复的字段读取
+ * @param list 语句列表
+ * @return 被替换的读取次数
+ */
+int FieldCSEPass::processList(ASTNode* list) {
+    std::vector<StatementInfo> infos(list->getChildCount());
+    std::set<std::string> keys;
+    for (size_t i = 0; i < list->getChildCount(); ++i) {
+        StatementScanner scanner(roots_, infos[i]);
+        scanner.scan(list, i);
+        for (const auto& entry : infos[i].reads) {
+            keys.insert(entry.first);
+        }
+    }
+    
+    // 每个字段在连续的、不使其失效的语句中的读取构成一段，读取两次以上的段使用临时变量
+    std::vector<std::pair<size_t, std::unique_ptr<ASTNode>>> temps;
+    int changes = 0;
+    for (const auto& key : keys) {
+        std::string root = key.substr(0, key.find('.'));
+        bool global = global_roots_.count(root) > 0;
+        
+        std::vector<FieldRead> run;
+        size_t run_start = 0;
+        auto flush = [&]() {
+            if (run.size() >= 2) {
+                std::string field = key.substr(key.find('.') + 1);
+                std::string base;
+                for (char c : field) {
+                    if (c != '[' && c != ']') {
+                        base += c;
+                    }
+                }
+                std::string name = freshName(root + "_" + base);
+                
+                ASTNode* first = run.front().parent->getChild(run.front().index);
+                // id 为 32 位无符号数（扩展帧标志位于最高位），其余字段不超过一个字节
+                auto decl = std::make_unique<VariableDeclNode>(name, field == "id" ? "dword" : "byte");
+                decl->setLine(first->getLine());
+                decl->addChild(cloneTree(first));
+                temps.emplace_back(run_start, std::move(decl));
+                
+                for (const auto& read : run) {
+                    auto id = std::make_unique<IdentifierNode>(name);
+                    id->setLine(read.parent->getChild(read.index)->getLine());
+                    read.parent->replaceChild(read.index, std::move(id));
+                }
+                changes += static_cast<int>(run.size());
+            }
+            run.clear();
+        };
+        
+        for (size_t i = 0; i < infos.size(); ++i) {
+            if (infos[i].kills(key, root, global)) {
+                flush();
+                continue;
+            }
+            auto it = infos[i].reads.find(key);
+            if (it == infos[i].reads.end()) {
+                continue;
+            }
+            if (run.empty()) {
+                run_start = i;
+            }
+            run.insert(run.end(), it->second.begin(), it->second.end());
+        }
+        flush();
+    }
+    
+    // 从后往前插入临时变量声明，保持前面的下标不变
+    std::stable_sort(temps.begin(), temps.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (auto& temp : temps) {
+        list->insertChild(temp.first, std::move(temp.second));
+    }
+    return changes;
+}
+
+/**
+ * 生成程序中未使用的名称
+ * @param base 名称前缀
+ * @return 新名称
+ */
+std::string FieldCSEPass::freshName(const std::string& base) {
+    std::string name = base;
+    for (int suffix = 2; used_names_.count(name); ++suffix) {
+        name = base + std::to_string(suffix);
+    }
+    used_names_.insert(name);
+    return name;
+}
+
+} // namespace capl
@@ -0,0 +1,115 @@
+/**
+ * CAPL 纯转发报文处理器识别实现
+ */
+
+#include "../include/gateway_routes.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include "../include/message_dispatch.h"
+#include <algorithm>
+
+namespace capl {
+
+namespace {
+
+bool isThis(const ASTNode* node) {
+    return node && node->getType() == ASTNodeType::IDENTIFIER &&
+           static_cast<const IdentifierNode*>(node)->getName() == "this";
+}
+
+} // namespace
+
+/**
+ * 构造函数
+ */
+GatewayRoutes::GatewayRoutes() {
+}
+
+/**
+ * 识别程序中的纯转发报文处理器
+ * @param program AST 根节点
+ */
+void GatewayRoutes::analyze(const ASTNode* program) {
+    clear();
+    if (!program) {
+        return;
+    }
+    
+    for (const auto& child : program->getChildren()) {
+        std::vector<GatewayRoute> routes;
+        if (child->getType() == ASTNodeType::ON_MESSAGE && matchForwarder(child.get(), routes)) {
+            forwarders_.insert(child.get());
+            routes_.insert(routes_.end(), routes.begin(), routes.end());
+        }
+    }
+    std::stable_sort(routes_.begin(), routes_.end(), [](const GatewayRoute& a, const GatewayRoute& b) {
+        return a.id < b.id;
+    });
+}
+
+/**
+ * 清空识别结果
+ */
+void GatewayRoutes::clear() {
+    routes_.clear();
+    forwarders_.clear();
+}
+
+/**
+ * 匹配纯转发处理器：语句只能是 this.id = 常量、this.channel = 常量 和 output(this)，
+ * 且至少有一个 output(this)；最后一个 output 之后的改写不影响任何输出
+ * @param handler ON_MESSAGE 节点
+ * @param routes 输出的路由
+ * @return 是否为纯转发处理器
+ */
+bool GatewayRoutes::matchForwarder(const ASTNode* handler, std::vector<GatewayRoute>& routes) {
+    GatewayRoute route;
+    route.handler = handler;
+    if (!MessageDispatch::handlerMessageId(handler, route.id)) {
+        return false;
+    }
+    route.out_id = route.id;
+    
+    for (const auto& stmt : handler->getChildren()) {
+        const ASTNode* expr = stmt->getChild(0);
+        if (stmt->getType() != ASTNodeType::EXPRESSION_STMT || !expr) {
+            return false;
+        }
+        
+        // output(this)
+        if (expr->getType() == ASTNodeType::CALL_EXPR) {
+            if (static_cast<const CallExprNode*>(expr)->getFunctionName() != "output" ||
+                expr->getChildCount() != 1 || !isThis(expr->getChild(0))) {
+                return false;
+            }
+            routes.push_back(route);
+            continue;
+        }
+        
+        // this.id = 常量 或 this.channel = 常量
+        if (expr->getType() != ASTNodeType::ASSIGNMENT_EXPR ||
+            static_cast<const AssignmentExprNode*>(expr)->getOperator() != "=") {
+            return false;
+        }
+        const ASTNode* target = expr->getChild(0);
+        if (target->getType() != ASTNodeType::MEMBER_EXPR || !isThis(target->getChild(0)) ||
+            static_cast<const MemberExprNode*>(target)->isCall()) {
+            return false;
+        }
+        ConstantValue value;
+        if (!evaluateConstant(expr->getChild(1), value) || value.is_float || value.int_value < 0) {
+            return false;
+        }
+        const std::string& member = static_cast<const MemberExprNode*>(target)->getMember();
+        if (member == "id" && value.int_value <= 0xFFFFFFFFLL) {
+            route.out_id = static_cast<uint32_t>(value.int_value);
+        } else if (member == "channel" && value.int_value <= 0xFF) {
+            route.out_channel = static_cast<int>(value.int_value);
+        } else {
+            return false;
+        }
+    }
+    return !routes.empty();
+}
+
+} // namespace capl
@@ -0,0 +1,246 @@
+/**
+ * CAPL 相同事件处理器合并实现
+ */
+
+#include "../include/handler_folding.h"
+#include "../include/ast.h"
+#include <functional>
+#include <unordered_map>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 规范化时的局部变量作用域
+ */
+class Normalizer {
+public:
+    std::string run(const ASTNode* handler) {
+        scopes_.assign(1, {});
+        next_local_ = 0;
+        text_.clear();
+        for (const auto& child : handler->getChildren()) {
+            visit(child.get());
+        }
+        return text_;
+    }
+
+private:
+    void visit(const ASTNode* node) {
+        if (!node) {
+            text_ += "_;";
+            return;
+        }
+        
+        text_ += std::to_string(static_cast<int>(node->getType()));
+        switch (node->getType()) {
+            case ASTNodeType::INTEGER_LITERAL:
+                text_ += "#" + integerValue(static_cast<const LiteralNode*>(node)->getValue());
+                break;
+            case ASTNodeType::FLOAT_LITERAL:
+            case ASTNodeType::STRING_LITERAL:
+            case ASTNodeType::CHAR_LITERAL: {
+                const std::string& value = static_cast<const LiteralNode*>(node)->getValue();
+                text_ += "#" + std::to_string(value.size()) + ":" + value;
+                break;
+            }
+            case ASTNodeType::IDENTIFIER:
+                text_ += "#" + lookup(static_cast<const IdentifierNode*>(node)->getName());
+                break;
+            case ASTNodeType::BINARY_EXPR:
+                text_ += "#" + static_cast<const BinaryExprNode*>(node)->getOperator();
+                break;
+            case ASTNodeType::UNARY_EXPR: {
+                const UnaryExprNode* unary = static_cast<const UnaryExprNode*>(node);
+                text_ += "#" + unary->getOperator() + (unary->isPostfix() ? "p" : "");
+                break;
+            }
+            case ASTNodeType::ASSIGNMENT_EXPR:
+                text_ += "#" + static_cast<const AssignmentExprNode*>(node)->getOperator();
+                break;
+            case ASTNodeType::CALL_EXPR:
+                text_ += "#" + static_cast<const CallExprNode*>(node)->getFunctionName();
+                break;
+            case ASTNodeType::MEMBER_EXPR: {
+                const MemberExprNode* member = static_cast<const MemberExprNode*>(node);
+                text_ += "#" + member->getMember() + (member->isCall() ? "()" : "");
+                break;
+            }
+            case ASTNodeType::SIGNAL_ACCESS:
+                text_ += "#" + static_cast<const SignalAccessNode*>(node)->getName();
+                break;
+            case ASTNodeType::VARIABLE_DECL: {
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+                text_ += "#" + decl->getVarType() + "[" + std::to_string(decl->getArraySize()) + "]";
+                // 初始化表达式在变量声明之前求值
+                text_ += "(";
+                for (const auto& child : node->getChildren()) {
+                    visit(child.get());
+                }
+                text_ += ")";
+                scopes_.back()[decl->getName()] = "%" + std::to_string(next_local_++);
+                text_ += ";";
+                return;
+            }
+            default:
+                break;
+        }
+        
+        // 代码块和 for 语句引入新的作用域
+        bool scoped = node->getType() == ASTNodeType::BLOCK_STMT || node->getType() == ASTNodeType::FOR_STMT;
+        if (scoped) {
+            scopes_.push_back({});
+        }
+        text_ += "(";
+        for (const auto& child : node->getChildren()) {
+            visit(child.get());
+        }
+        text_ += ")";
+        if (scoped) {
+            scopes_.pop_back();
+        }
+    }
+    
+    /**
+     * 局部变量按声明顺序编号，其他名称（全局变量、定时器、this）保持原名
+     */
+    std::string lookup(const std::string& name) const {
+        for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
+            auto found = it->find(name);
+            if (found != it->end()) {
+                return found->second;
+            }
+        }
+        return "@" + name;
+    }
+    
+    /**
+     * 整数字面量按 C++ 语义取值，0x10 与 16 相同
+     */
+    static std::string integerValue(const std::string& value) {
+        try {
+            return std::to_string(std::stoll(value, nullptr, 0));
+        } catch (const std::exception&) {
+            return value;
+        }
+    }
+    
+    std::vector<std::map<std::string, std::string>> scopes_;   // 局部变量的规范名称
+    int next_local_ = 0;                                        // 下一个局部变量编号
+    std::string text_;                                          // 规范化结果
+};
+
+bool isHandler(const ASTNode* node) {
+    switch (node->getType()) {
+        case ASTNodeType::ON_START:
+        case ASTNodeType::ON_STOP:
+        case ASTNodeType::ON_MESSAGE:
+        case ASTNodeType::ON_TIMER:
+        case ASTNodeType::ON_KEY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+/**
+ * 构造函数
+ */
+HandlerFolding::HandlerFolding() {
+}
+
+/**
+ * 对程序中的事件处理器分类
+ * @param program AST 根节点
+ * @param excluded 不参与分类的处理器
+ */
+void HandlerFolding::compute(const ASTNode* program, const std::set<const ASTNode*>& excluded) {
+    clear();
+    if (!program) {
+        return;
+    }
+    
+    // 散列值相同的等价类，需要比较规范化文本排除散列冲突
+    std::unordered_map<size_t, std::vector<size_t>> buckets;
+    std::vector<std::string> texts;
+    
+    for (const auto& child : program->getChildren()) {
+        const ASTNode* handler = child.get();
+        if (!isHandler(handler) || excluded.count(handler) > 0) {
+            continue;
+        }
+        // 不同类型事件中 this 的含义不同，只合并同类事件
+        std::string text = std::to_string(static_cast<int>(handler->getType())) + ":" + normalize(handler);
+        size_t hash = std::hash<std::string>()(text);
+        
+        size_t index = classes_.size();
+        for (size_t candidate : buckets[hash]) {
+            if (texts[candidate] == text) {
+                index = candidate;
+                break;
+            }
+        }
+        if (index == classes_.size()) {
+            HandlerClass handler_class;
+            handler_class.hash = hash;
+            classes_.push_back(handler_class);
+            texts.push_back(text);
+            buckets[hash].push_back(index);
+        }
+        classes_[index].handlers.push_back(handler);
+        class_of_[handler] = index;
+    }
+}
+
+/**
+ * 清空分类结果
+ */
+void HandlerFolding::clear() {
+    classes_.clear();
+    class_of_.clear();
+}
+
+/**
+ * 查找处理器所在的等价类
+ * @param handler 事件处理器节点
+ * @return 等价类，未参与分类时返回 nullptr
+ */
+const HandlerClass* HandlerFolding::findClass(const ASTNode* handler) const {
+    auto it = class_of_.find(handler);
+    return it != class_of_.end() ? &classes_[it->second] : nullptr;
+}
+
+/**
+ * 处理器是否需要生成实现
+ * @param handler 事件处理器节点
+ */
+bool HandlerFolding::isRepresentative(const ASTNode* handler) const {
+    const HandlerClass* handler_class = findClass(handler);
+    return !handler_class || handler_class->handlers.front() == handler;
+}
+
+/**
+ * 被合并到其他处理器实现中的处理器数量
+ */
+int HandlerFolding::getFoldedCount() const {
+    int folded = 0;
+    for (const auto& handler_class : classes_) {
+        folded += static_cast<int>(handler_class.handlers.size()) - 1;
+    }
+    return folded;
+}
+
+/**
+ * 计算处理器函数体的规范化形式
+ * @param handler 事件处理器节点
+ * @return 规范化文本
+ */
+std::string HandlerFolding::normalize(const ASTNode* handler) {
+    Normalizer normalizer;
+    return normalizer.run(handler);
+}
+
+} // namespace capl
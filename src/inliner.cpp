@@ -0,0 +1,658 @@
+/**
+ * CAPL 用户函数内联实现
+ */
+
+#include "../include/inliner.h"
+#include "../include/ast.h"
+#include "../include/profile_data.h"
+#include <algorithm>
+#include <functional>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 子树的 AST 节点数，作为函数大小的估计
+ */
+int treeSize(const ASTNode* node) {
+    if (!node) {
+        return 0;
+    }
+    int size = 1;
+    for (const auto& child : node->getChildren()) {
+        size += treeSize(child.get());
+    }
+    return size;
+}
+
+void collectCalls(const ASTNode* node, std::set<std::string>& calls) {
+    if (!node) {
+        return;
+    }
+    if (node->getType() == ASTNodeType::CALL_EXPR) {
+        calls.insert(static_cast<const CallExprNode*>(node)->getFunctionName());
+    }
+    for (const auto& child : node->getChildren()) {
+        collectCalls(child.get(), calls);
+    }
+}
+
+/**
+ * 收集子树中出现的所有名称（标识符和声明）
+ */
+void collectNames(const ASTNode* node, std::set<std::string>& names) {
+    if (!node) {
+        return;
+    }
+    if (node->getType() == ASTNodeType::IDENTIFIER) {
+        names.insert(static_cast<const IdentifierNode*>(node)->getName());
+    } else if (node->getType() == ASTNodeType::VARIABLE_DECL) {
+        names.insert(static_cast<const VariableDeclNode*>(node)->getName());
+    } else if (node->getType() == ASTNodeType::FUNCTION) {
+        const FunctionNode* func = static_cast<const FunctionNode*>(node);
+        names.insert(func->getName());
+        for (const auto& param : func->getParameters()) {
+            collectNames(param.get(), names);
+        }
+    } else if (node->getType() == ASTNodeType::ON_TIMER) {
+        names.insert(static_cast<const OnEventNode*>(node)->getEventName());
+    }
+    for (const auto& child : node->getChildren()) {
+        collectNames(child.get(), names);
+    }
+}
+
+bool containsReturn(const ASTNode* node) {
+    if (node->getType() == ASTNodeType::RETURN_STMT) {
+        return true;
+    }
+    for (const auto& child : node->getChildren()) {
+        if (containsReturn(child.get())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 语句是否在所有路径上都执行 return
+ */
+bool alwaysReturns(const ASTNode* node) {
+    switch (node->getType()) {
+        case ASTNodeType::RETURN_STMT:
+            return true;
+        case ASTNodeType::BLOCK_STMT:
+            for (const auto& child : node->getChildren()) {
+                if (alwaysReturns(child.get())) {
+                    return true;
+                }
+            }
+            return false;
+        case ASTNodeType::IF_STMT:
+            return node->getChildCount() > 2 && alwaysReturns(node->getChild(1)) && alwaysReturns(node->getChild(2));
+        default:
+            return false;
+    }
+}
+
+/**
+ * 语句列表是否直接声明了变量
+ */
+bool declaresVariables(const ASTNode* list) {
+    for (const auto& stmt : list->getChildren()) {
+        if (stmt->getType() == ASTNodeType::VARIABLE_DECL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<ASTNode> makeIdentifier(const std::string& name, int line) {
+    auto id = std::make_unique<IdentifierNode>(name);
+    id->setLine(line);
+    return id;
+}
+
+std::unique_ptr<ASTNode> makeAssignment(const std::string& name, std::unique_ptr<ASTNode> value, int line) {
+    auto assign = std::make_unique<AssignmentExprNode>("=");
+    assign->setLine(line);
+    assign->addChild(makeIdentifier(name, line));
+    assign->addChild(std::move(value));
+    auto stmt = std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT);
+    stmt->setLine(line);
+    stmt->addChild(std::move(assign));
+    return stmt;
+}
+
+/**
+ * 把语句列表中的 return 改写为给结果变量赋值。return 之后的语句移入
+ * 不返回的分支，使每个 return 都位于末尾
+ * @param list 语句列表
+ * @param result 结果变量名，void 函数或丢弃结果时为空，此时只保留返回值的副作用
+ * @return 是否成功（循环中的 return 等无法改写）
+ */
+bool rewriteReturns(ASTNode* list, const std::string& result) {
+    for (size_t i = 0; i < list->getChildCount(); ++i) {
+        ASTNode* stmt = list->getChild(i);
+        if (stmt->getType() == ASTNodeType::RETURN_STMT) {
+            while (list->getChildCount() > i + 1) {
+                list->removeChild(i + 1);
+            }
+            if (stmt->getChildCount() == 0) {
+                if (!result.empty()) {
+                    return false;
+                }
+                list->removeChild(i);
+            } else if (result.empty() && !hasSideEffects(stmt->getChild(0))) {
+                list->removeChild(i);
+            } else if (result.empty()) {
+                auto expr_stmt = std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT);
+                expr_stmt->setLine(stmt->getLine());
+                expr_stmt->addChild(stmt->removeChild(0));
+                list->replaceChild(i, std::move(expr_stmt));
+            } else {
+                list->replaceChild(i, makeAssignment(result, stmt->removeChild(0), stmt->getLine()));
+            }
+            return true;
+        }
+        if (!containsReturn(stmt)) {
+            continue;
+        }
+        
+        // 后续语句只在不返回的路径上执行
+        std::vector<std::unique_ptr<ASTNode>> rest;
+        while (list->getChildCount() > i + 1) {
+            rest.push_back(list->removeChild(i + 1));
+        }
+        
+        if (stmt->getType() == ASTNodeType::BLOCK_STMT) {
+            for (auto& next : rest) {
+                stmt->addChild(std::move(next));
+            }
+            return rewriteReturns(stmt, result);
+        }
+        if (stmt->getType() != ASTNodeType::IF_STMT) {
+            return false;
+        }
+        
+        bool then_returns = alwaysReturns(stmt->getChild(1));
+        bool else_returns = stmt->getChildCount() > 2 && alwaysReturns(stmt->getChild(2));
+        if (then_returns && !else_returns) {
+            if (stmt->getChildCount() < 3) {
+                auto else_block = std::make_unique<ASTNode>(ASTNodeType::BLOCK_STMT);
+                else_block->setLine(stmt->getLine());
+                stmt->addChild(std::move(else_block));
+            }
+            for (auto& next : rest) {
+                stmt->getChild(2)->addChild(std::move(next));
+            }
+        } else if (else_returns && !then_returns) {
+            for (auto& next : rest) {
+                stmt->getChild(1)->addChild(std::move(next));
+            }
+        } else if (!then_returns) {
+            return false;
+        }
+        
+        return rewriteReturns(stmt->getChild(1), result) &&
+               (stmt->getChildCount() < 3 || rewriteReturns(stmt->getChild(2), result));
+    }
+    return true;
+}
+
+/**
+ * 按作用域把局部变量改为新名称，并收集未改名的自由名称（全局变量等）
+ */
+void renameLocals(ASTNode* node, std::vector<std::map<std::string, std::string>>& scopes,
+                  const std::function<std::string(const std::string&)>& fresh, std::set<std::string>& free_names) {
+    for (size_t i = 0; i < node->getChildCount(); ++i) {
+        ASTNode* child = node->getChild(i);
+        switch (child->getType()) {
+            case ASTNodeType::VARIABLE_DECL: {
+                // 初始化表达式中的名称在声明之前解析
+                renameLocals(child, scopes, fresh, free_names);
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(child);
+                std::string name = fresh(decl->getName());
+                scopes.back()[decl->getName()] = name;
+                
+                auto renamed = std::make_unique<VariableDeclNode>(name, decl->getVarType());
+                renamed->setLine(decl->getLine());
+                renamed->setArraySize(decl->getArraySize());
+                renamed->setMessageRef(decl->getMessageRef());
+                while (child->getChildCount() > 0) {
+                    renamed->addChild(child->removeChild(0));
+                }
+                node->replaceChild(i, std::move(renamed));
+                break;
+            }
+            case ASTNodeType::IDENTIFIER: {
+                const std::string& name = static_cast<const IdentifierNode*>(child)->getName();
+                bool found = false;
+                for (auto it = scopes.rbegin(); it != scopes.rend() && !found; ++it) {
+                    auto mapped = it->find(name);
+                    if (mapped != it->end()) {
+                        node->replaceChild(i, makeIdentifier(mapped->second, child->getLine()));
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    free_names.insert(name);
+                }
+                break;
+            }
+            case ASTNodeType::BLOCK_STMT:
+            case ASTNodeType::FOR_STMT:
+                scopes.emplace_back();
+                renameLocals(child, scopes, fresh, free_names);
+                scopes.pop_back();
+                break;
+            default:
+                renameLocals(child, scopes, fresh, free_names);
+                break;
+        }
+    }
+}
+
+/**
+ * 处理器或函数中声明的名称（局部变量和形参）
+ */
+std::set<std::string> declaredNames(const ASTNode* node) {
+    std::set<std::string> names;
+    std::function<void(const ASTNode*)> visit = [&](const ASTNode* current) {
+        if (current->getType() == ASTNodeType::VARIABLE_DECL) {
+            names.insert(static_cast<const VariableDeclNode*>(current)->getName());
+        }
+        for (const auto& child : current->getChildren()) {
+            visit(child.get());
+        }
+    };
+    visit(node);
+    if (node->getType() == ASTNodeType::FUNCTION) {
+        for (const auto& param : static_cast<const FunctionNode*>(node)->getParameters()) {
+            names.insert(static_cast<const VariableDeclNode*>(param.get())->getName());
+        }
+    }
+    return names;
+}
+
+} // namespace
+
+/**
+ * 构造函数
+ * @param threshold 可内联函数的最大大小（AST 节点数）
+ * @param profile 剖析数据，nullptr 表示所有调用者使用同一阈值
+ */
+InlinerPass::InlinerPass(int threshold, const ProfileData* profile)
+    : threshold_(threshold), profile_(profile) {
+}
+
+/**
+ * 优化级别对应的内联阈值
+ * @param optimize_level 优化级别 (0-3)
+ * @return 阈值，0 表示不内联
+ */
+int InlinerPass::thresholdFor(int optimize_level) {
+    switch (optimize_level) {
+        case 0:
+            return 0;
+        case 1:
+            return 16;
+        case 2:
+            return 48;
+        default:
+            return 160;
+    }
+}
+
+/**
+ * 在所有处理器和函数中内联满足条件的调用
+ * @param program AST 根节点
+ * @return 内联的调用处数量
+ */
+int InlinerPass::run(ASTNode* program) {
+    functions_.clear();
+    global_types_.clear();
+    recursive_.clear();
+    used_names_.clear();
+    reported_.clear();
+    decisions_.clear();
+    
+    std::map<std::string, std::set<std::string>> callees;
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            const FunctionNode* func = static_cast<const FunctionNode*>(child.get());
+            functions_[func->getName()] = func;
+            collectCalls(func, callees[func->getName()]);
+        } else if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(var.get());
+                if (!decl->isArray()) {
+                    global_types_[decl->getName()] = decl->getVarType();
+                }
+            }
+        }
+    }
+    collectNames(program, used_names_);
+    
+    // 能调用回自身的函数为递归函数
+    for (const auto& entry : functions_) {
+        std::set<std::string> visited;
+        std::vector<std::string> work(callees[entry.first].begin(), callees[entry.first].end());
+        while (!work.empty()) {
+            std::string name = work.back();
+            work.pop_back();
+            if (name == entry.first) {
+                recursive_.insert(name);
+                break;
+            }
+            if (!functions_.count(name) || !visited.insert(name).second) {
+                continue;
+            }
+            work.insert(work.end(), callees[name].begin(), callees[name].end());
+        }
+    }
+    
+    // 先处理被调函数，使内联的函数体已经展开了它自己的调用
+    std::vector<ASTNode*> order;
+    std::set<std::string> done;
+    std::function<void(const std::string&)> visit = [&](const std::string& name) {
+        if (!functions_.count(name) || !done.insert(name).second) {
+            return;
+        }
+        for (const auto& callee : callees[name]) {
+            visit(callee);
+        }
+        order.push_back(const_cast<FunctionNode*>(functions_[name]));
+    };
+    for (const auto& entry : functions_) {
+        visit(entry.first);
+    }
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() != ASTNodeType::FUNCTION && isStatementList(child.get()) &&
+            child->getType() != ASTNodeType::BLOCK_STMT) {
+            order.push_back(child.get());
+        }
+    }
+    
+    int changes = 0;
+    for (ASTNode* unit : order) {
+        std::string caller = unit->getType() == ASTNodeType::FUNCTION ?
+            static_cast<const FunctionNode*>(unit)->getName() :
+            static_cast<const OnEventNode*>(unit)->getDisplayName();
+        current_threshold_ = callerThreshold(unit);
+        changes += inlineCalls(unit, caller, declaredNames(unit));
+    }
+    return changes;
+}
+
+/**
+ * 调用者的内联阈值：热点处理器放宽到 -O3 的阈值，冷处理器不内联
+ * @param unit 调用者（处理器或函数）
+ * @return 阈值
+ */
+int InlinerPass::callerThreshold(const ASTNode* unit) const {
+    if (!profile_ || unit->getType() == ASTNodeType::FUNCTION) {
+        return threshold_;
+    }
+    switch (profile_->getHeat(static_cast<const OnEventNode*>(unit)->getDisplayName())) {
+        case Heat::Hot:
+            return std::max(threshold_, thresholdFor(3));
+        case Heat::Cold:
+            return 0;
+        default:
+            return threshold_;
+    }
+}
+
+/**
+ * 判断函数是否可以内联
+ * @param func 函数
+ * @param reason 不能内联的原因
+ */
+bool InlinerPass::isInlinable(const FunctionNode* func, std::string& reason) const {
+    if (recursive_.count(func->getName())) {
+        reason = "递归函数";
+        return false;
+    }
+    for (const auto& param : func->getParameters()) {
+        if (static_cast<const VariableDeclNode*>(param.get())->getArraySize() != 0) {
+            reason = "数组参数按引用传递";
+            return false;
+        }
+    }
+    if (current_threshold_ == 0) {
+        reason = "调用者是冷处理器";
+        return false;
+    }
+    int size = treeSize(func) - 1;
+    if (size > current_threshold_) {
+        reason = "大小 " + std::to_string(size) + " 超过阈值 " + std::to_string(current_threshold_);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * 内联语句列表中的调用
+ * @param node 当前节点
+ * @param caller 调用者描述
+ * @param caller_names 调用者中声明的名称
+ * @return 内联的调用处数量
+ */
+int InlinerPass::inlineCalls(ASTNode* node, const std::string& caller, const std::set<std::string>& caller_names) {
+    int changes = 0;
+    for (size_t i = 0; i < node->getChildCount(); ++i) {
+        ASTNode* stmt = node->getChild(i);
+        ASTNode* call = nullptr;
+        bool discard = false;
+        if (isStatementList(node)) {
+            ASTNode* expr = stmt->getChild(0);
+            if (stmt->getType() == ASTNodeType::EXPRESSION_STMT && expr) {
+                if (expr->getType() == ASTNodeType::ASSIGNMENT_EXPR) {
+                    expr = expr->getChild(1);
+                } else {
+                    discard = true;     // f(...); 不使用返回值
+                }
+                call = expr;
+            } else if (stmt->getType() == ASTNodeType::RETURN_STMT ||
+                       (stmt->getType() == ASTNodeType::VARIABLE_DECL &&
+                        !static_cast<const VariableDeclNode*>(stmt)->isArray())) {
+                call = expr;
+            }
+        }
+        
+        const FunctionNode* func = nullptr;
+        if (call && call->getType() == ASTNodeType::CALL_EXPR) {
+            auto it = functions_.find(static_cast<const CallExprNode*>(call)->getFunctionName());
+            if (it != functions_.end() && it->second->getParameters().size() == call->getChildCount()) {
+                func = it->second;
+            }
+        }
+        if (!func) {
+            changes += inlineCalls(stmt, caller, caller_names);
+            continue;
+        }
+        
+        // 结果赋给类型相同的全局变量（未被调用者的局部变量遮蔽）或新声明的局部变量时，
+        // 可以直接作为结果变量
+        std::string target;
+        if (stmt->getType() == ASTNodeType::EXPRESSION_STMT && !discard) {
+            const AssignmentExprNode* assign = static_cast<const AssignmentExprNode*>(stmt->getChild(0));
+            const ASTNode* lhs = assign->getChild(0);
+            if (assign->getOperator() == "=" && lhs->getType() == ASTNodeType::IDENTIFIER) {
+                const std::string& name = static_cast<const IdentifierNode*>(lhs)->getName();
+                auto it = global_types_.find(name);
+                if (!caller_names.count(name) && it != global_types_.end() && it->second == func->getReturnType()) {
+                    target = name;
+                }
+            }
+        } else if (stmt->getType() == ASTNodeType::VARIABLE_DECL &&
+                   static_cast<const VariableDeclNode*>(stmt)->getVarType() == func->getReturnType()) {
+            target = static_cast<const VariableDeclNode*>(stmt)->getName();
+        }
+        
+        std::string reason;
+        std::string result;
+        std::unique_ptr<ASTNode> block;
+        if (isInlinable(func, reason)) {
+            block = expandCall(func, call, caller_names, discard, target, result, reason);
+        }
+        if (!block) {
+            if (reported_.insert(func->getName() + "\n" + reason).second) {
+                decisions_.push_back("不内联 " + func->getName() + ": " + reason);
+            }
+            continue;
+        }
+        
+        // 参数已移入代码块，调用处替换为结果变量
+        int line = stmt->getLine();
+        std::unique_ptr<ASTNode> original;
+        switch (stmt->getType()) {
+            case ASTNodeType::EXPRESSION_STMT:
+                if (discard && !declaresVariables(block.get())) {
+                    // 代码块不声明变量时语句直接放在调用处，展开为空时调用整个删除；
+                    // 下标停在最后一条插入的语句，循环的 ++i 之后检查调用后的语句
+                    node->removeChild(i);
+                    while (block->getChildCount() > 0) {
+                        node->insertChild(i++, block->removeChild(0));
+                    }
+                    --i;
+                    break;
+                }
+                original = node->replaceChild(i, std::move(block));
+                if (original->getChild(0)->getType() == ASTNodeType::ASSIGNMENT_EXPR && result != target) {
+                    original->getChild(0)->replaceChild(1, makeIdentifier(result, line));
+                    node->getChild(i)->addChild(std::move(original));
+                }
+                break;
+            case ASTNodeType::RETURN_STMT:
+                original = node->replaceChild(i, std::move(block));
+                original->replaceChild(0, makeIdentifier(result, line));
+                node->getChild(i)->addChild(std::move(original));
+                break;
+            default: {
+                // T x = f(...); 拆为声明和随后的代码块
+                stmt->removeChild(0);
+                if (result != target) {
+                    const std::string& name = static_cast<const VariableDeclNode*>(stmt)->getName();
+                    block->addChild(makeAssignment(name, makeIdentifier(result, line), line));
+                }
+                node->insertChild(++i, std::move(block));
+                break;
+            }
+        }
+        
+        decisions_.push_back("内联 " + func->getName() + " -> " + caller + " (大小 " +
+                             std::to_string(treeSize(func) - 1) + ", 阈值 " + std::to_string(current_threshold_) + ")");
+        ++changes;
+    }
+    return changes;
+}
+
+/**
+ * 展开一处调用
+ * @param func 被调函数
+ * @param call 调用表达式，成功时实参被移入生成的代码块
+ * @param caller_names 调用者中声明的名称
+ * @param discard 调用处是否丢弃返回值，丢弃时不生成结果变量
+ * @param target 调用处接收返回值的变量，为空表示没有可直接使用的变量
+ * @param result 输出结果变量名（void 函数或丢弃返回值时为空，直接使用 target 时与之相同）
+ * @param reason 失败原因
+ * @return 展开后的代码块，失败时返回 nullptr 且调用表达式不变
+ */
+std::unique_ptr<ASTNode> InlinerPass::expandCall(const FunctionNode* func, ASTNode* call,
+                                                 const std::set<std::string>& caller_names, bool discard,
+                                                 const std::string& target, std::string& result,
+                                                 std::string& reason) {
+    auto body = cloneTree(func);
+    std::set<std::string> saved_names = used_names_;
+    auto fresh = [&](const std::string& name) { return freshName(func->getName() + "_" + name); };
+    
+    // 形参和局部变量改用新名称，被调函数使用的其他名称不能被调用者的局部变量遮蔽
+    std::vector<std::map<std::string, std::string>> scopes(1);
+    std::vector<std::string> params;
+    for (const auto& param : func->getParameters()) {
+        const std::string& name = static_cast<const VariableDeclNode*>(param.get())->getName();
+        params.push_back(fresh(name));
+        scopes.back()[name] = params.back();
+    }
+    std::set<std::string> free_names;
+    renameLocals(body.get(), scopes, fresh, free_names);
+    for (const auto& name : free_names) {
+        if (caller_names.count(name)) {
+            reason = "调用处的局部变量 " + name + " 遮蔽了被调函数使用的全局名称";
+            used_names_ = saved_names;
+            return nullptr;
+        }
+    }
+    
+    // 全局变量作为结果变量时，函数体不能读写它，也不能调用可能读写它的用户函数
+    bool direct = !target.empty() && !free_names.count(target);
+    if (direct && !caller_names.count(target)) {
+        std::set<std::string> calls;
+        collectCalls(body.get(), calls);
+        for (const auto& name : calls) {
+            direct = direct && !functions_.count(name);
+        }
+    }
+    if (func->getReturnType() == "void" || discard) {
+        result.clear();
+    } else {
+        result = direct ? target : fresh("result");
+    }
+    if (!rewriteReturns(body.get(), result)) {
+        reason = "return 不在函数末尾";
+        used_names_ = saved_names;
+        return nullptr;
+    }
+    
+    auto block = std::make_unique<ASTNode>(ASTNodeType::BLOCK_STMT);
+    block->setLine(call->getLine());
+    if (!result.empty() && result != target) {
+        auto result_decl = std::make_unique<VariableDeclNode>(result, func->getReturnType());
+        result_decl->setLine(call->getLine());
+        block->addChild(std::move(result_decl));
+    }
+    // 函数体不使用的形参不生成临时变量，只保留实参的副作用
+    std::set<std::string> body_names;
+    collectNames(body.get(), body_names);
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (!body_names.count(params[i])) {
+            std::unique_ptr<ASTNode> arg = call->removeChild(0);
+            if (hasSideEffects(arg.get())) {
+                auto stmt = std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT);
+                stmt->setLine(call->getLine());
+                stmt->addChild(std::move(arg));
+                block->addChild(std::move(stmt));
+            }
+            continue;
+        }
+        const VariableDeclNode* param = static_cast<const VariableDeclNode*>(func->getParameters()[i].get());
+        auto decl = std::make_unique<VariableDeclNode>(params[i], param->getVarType());
+        decl->setLine(call->getLine());
+        decl->setMessageRef(param->getMessageRef());
+        decl->addChild(call->removeChild(0));
+        block->addChild(std::move(decl));
+    }
+    while (body->getChildCount() > 0) {
+        block->addChild(body->removeChild(0));
+    }
+    return block;
+}
+
+/**
+ * 生成程序中未使用的名称
+ * @param base 名称前缀
+ * @return 新名称
+ */
+std::string InlinerPass::freshName(const std::string& base) {
+    std::string name = base;
+    for (int suffix = 2; used_names_.count(name); ++suffix) {
+        name = base + std::to_string(suffix);
+    }
+    used_names_.insert(name);
+    return name;
+}
+
+} // namespace capl
@@ -0,0 +1,558 @@
+/**
+ * CAPL 全局整数变量的存储宽度收窄实现
+ */
+
+#include "../include/integer_narrowing.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include "../include/state_layout.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <set>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 可收窄的声明类型：读取时整数提升为 int，换成更窄的存储类型后运算语义不变。
+ * dword、int64、qword 参与运算时不提升为 int，收窄会改变运算的类型
+ */
+bool isCandidateType(const std::string& type) {
+    static const std::set<std::string> types = {"int", "long", "word"};
+    return types.count(type) > 0;
+}
+
+bool constantInt(const ASTNode* node, long long& value) {
+    ConstantValue constant;
+    if (!node || !evaluateConstant(node, constant) || constant.is_float) {
+        return false;
+    }
+    value = constant.int_value;
+    return true;
+}
+
+bool fitsInt32(const ValueRange& range) {
+    return range.known && range.lo >= std::numeric_limits<int32_t>::min() &&
+           range.hi <= std::numeric_limits<int32_t>::max();
+}
+
+/**
+ * int 运算的结果：超出 32 位时为未知（有符号溢出）
+ */
+ValueRange intResult(long long lo, long long hi) {
+    ValueRange range = ValueRange::make(lo, hi);
+    return fitsInt32(range) ? range : ValueRange();
+}
+
+/**
+ * 不超过 value 的最小 2^n - 1
+ */
+long long bitMask(long long value) {
+    long long mask = 0;
+    while (mask < value) {
+        mask = mask * 2 + 1;
+    }
+    return mask;
+}
+
+/**
+ * 按声明类型转换后的值域：超出类型范围的值回绕，此时取类型的全部值域
+ */
+ValueRange convertRange(const ValueRange& range, const std::string& capl_type) {
+    ValueRange type_range = IntegerNarrowing::typeRange(capl_type);
+    if (range.known && type_range.known && range.lo >= type_range.lo && range.hi <= type_range.hi) {
+        return range;
+    }
+    return type_range;
+}
+
+/**
+ * 能表示值域的最窄存储类型
+ * @param range 值域
+ * @param size 输出的字节数
+ * @return C++ 类型名，需要 8 字节时返回空串
+ */
+std::string narrowestType(const ValueRange& range, size_t& size) {
+    if (range.lo >= 0) {
+        if (range.hi <= 0xFF) {
+            size = 1;
+            return "uint8_t";
+        }
+        if (range.hi <= 0xFFFF) {
+            size = 2;
+            return "uint16_t";
+        }
+        if (range.hi <= 0xFFFFFFFFLL) {
+            size = 4;
+            return "uint32_t";
+        }
+    } else {
+        if (range.lo >= -128 && range.hi <= 127) {
+            size = 1;
+            return "int8_t";
+        }
+        if (range.lo >= -32768 && range.hi <= 32767) {
+            size = 2;
+            return "int16_t";
+        }
+        if (fitsInt32(range)) {
+            size = 4;
+            return "int32_t";
+        }
+    }
+    return "";
+}
+
+void collectLocalTypes(const ASTNode* node, std::map<std::string, std::string>& types) {
+    if (node->getType() == ASTNodeType::VARIABLE_DECL) {
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+        types[decl->getName()] = decl->getVarType();
+    }
+    for (const auto& child : node->getChildren()) {
+        collectLocalTypes(child.get(), types);
+    }
+}
+
+} // namespace
+
+ValueRange ValueRange::make(long long lo, long long hi) {
+    ValueRange range;
+    range.known = true;
+    range.lo = lo;
+    range.hi = hi;
+    return range;
+}
+
+ValueRange ValueRange::unite(const ValueRange& other) const {
+    if (!known || !other.known) {
+        return ValueRange();
+    }
+    return make(std::min(lo, other.lo), std::max(hi, other.hi));
+}
+
+bool ValueRange::operator==(const ValueRange& other) const {
+    return known == other.known && (!known || (lo == other.lo && hi == other.hi));
+}
+
+size_t NarrowedVariable::getSavedBytes() const {
+    size_t count = array_size > 0 ? static_cast<size_t>(array_size) : 1;
+    return (original_size - size) * count;
+}
+
+/**
+ * 构造函数
+ */
+IntegerNarrowing::IntegerNarrowing() {
+}
+
+/**
+ * CAPL 整数类型的全部值域
+ * @param capl_type CAPL 类型名
+ * @return 值域，非整数类型或超出 long long 时未知
+ */
+ValueRange IntegerNarrowing::typeRange(const std::string& capl_type) {
+    if (capl_type == "byte") {
+        return ValueRange::make(0, 0xFF);
+    }
+    if (capl_type == "char") {
+        return ValueRange::make(-128, 127);
+    }
+    if (capl_type == "word") {
+        return ValueRange::make(0, 0xFFFF);
+    }
+    if (capl_type == "int") {
+        return ValueRange::make(std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+    }
+    if (capl_type == "long") {
+        return ValueRange::make(std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+    }
+    if (capl_type == "dword") {
+        return ValueRange::make(0, 0xFFFFFFFFLL);
+    }
+    if (capl_type == "int64") {
+        return ValueRange::make(std::numeric_limits<long long>::min(), std::numeric_limits<long long>::max());
+    }
+    return ValueRange();
+}
+
+/**
+ * 分析程序中的全局整数变量
+ * @param program AST 根节点
+ */
+void IntegerNarrowing::analyze(const ASTNode* program) {
+    clear();
+    if (!program) {
+        return;
+    }
+    
+    // 1. 候选变量：整数标量和数组，初始值为初始化表达式或 0
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(var.get());
+                globals_[decl->getName()] = decl;
+                if (isCandidateType(decl->getVarType())) {
+                    order_.push_back(decl->getName());
+                }
+            }
+        } else if (child->getType() == ASTNodeType::FUNCTION) {
+            functions_[static_cast<const FunctionNode*>(child.get())->getName()] = child.get();
+        }
+    }
+    for (const auto& name : order_) {
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(globals_[name]);
+        ValueRange initial = ValueRange::make(0, 0);
+        if (decl->getInitializer()) {
+            initial = rangeOf(decl->getInitializer(), nullptr);
+        }
+        ranges_[name] = convertRange(initial, decl->getVarType());
+    }
+    
+    // 2. 收集每个处理器和函数中对候选变量的写入；被局部变量遮蔽的候选变量不收窄
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT || !isStatementList(child.get())) {
+            continue;
+        }
+        auto& locals = unit_locals_[child.get()];
+        collectLocalTypes(child.get(), locals);
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            for (const auto& param : static_cast<const FunctionNode*>(child.get())->getParameters()) {
+                collectLocalTypes(param.get(), locals);
+            }
+        }
+        for (const auto& local : locals) {
+            ranges_.erase(local.first);
+        }
+    }
+    for (const auto& child : program->getChildren()) {
+        if (unit_locals_.count(child.get())) {
+            collectStores(child.get(), child.get());
+        }
+    }
+    
+    // 3. 迭代到不动点，多轮后仍在扩大的值域直接取类型的全部值域
+    bool changed = true;
+    for (int round = 0; changed; ++round) {
+        changed = false;
+        for (const auto& store : stores_) {
+            auto it = ranges_.find(store.name);
+            if (it == ranges_.end()) {
+                continue;
+            }
+            ValueRange range = it->second.unite(storedRange(store));
+            if (range != it->second) {
+                if (round >= kWideningRounds) {
+                    const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(globals_[store.name]);
+                    range = convertRange(ValueRange(), decl->getVarType());
+                }
+                it->second = range;
+                changed = true;
+            }
+        }
+    }
+    
+    // 4. 选择能表示值域的最窄类型
+    for (const auto& name : order_) {
+        auto it = ranges_.find(name);
+        if (it == ranges_.end() || !it->second.known) {
+            continue;
+        }
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(globals_[name]);
+        NarrowedVariable var;
+        var.name = name;
+        var.capl_type = decl->getVarType();
+        var.array_size = decl->getArraySize();
+        var.range = it->second;
+        size_t align = 0;
+        StateLayout::scalarSizeAlign(var.capl_type, var.original_size, align);
+        var.cpp_type = narrowestType(var.range, var.size);
+        if (!var.cpp_type.empty() && var.size < var.original_size) {
+            variables_.push_back(var);
+        }
+    }
+}
+
+/**
+ * 清空分析结果
+ */
+void IntegerNarrowing::clear() {
+    globals_.clear();
+    functions_.clear();
+    unit_locals_.clear();
+    ranges_.clear();
+    order_.clear();
+    stores_.clear();
+    variables_.clear();
+}
+
+/**
+ * 查找收窄的变量
+ * @param name 变量名
+ * @return 变量信息，未收窄时返回 nullptr
+ */
+const NarrowedVariable* IntegerNarrowing::findVariable(const std::string& name) const {
+    for (const auto& var : variables_) {
+        if (var.name == name) {
+            return &var;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * 收窄节省的总字节数
+ */
+size_t IntegerNarrowing::getSavedBytes() const {
+    size_t saved = 0;
+    for (const auto& var : variables_) {
+        saved += var.getSavedBytes();
+    }
+    return saved;
+}
+
+/**
+ * 收集对候选变量的写入，并排除以数组实参形式传给函数的候选变量
+ */
+void IntegerNarrowing::collectStores(const ASTNode* node, const ASTNode* unit) {
+    if (node->getType() == ASTNodeType::ASSIGNMENT_EXPR || isIncrementExpr(node)) {
+        const ASTNode* target = node->getChild(0);
+        std::string name = getRootVariable(target);
+        if (ranges_.count(name)) {
+            bool element = target->getType() == ASTNodeType::IDENTIFIER ||
+                           (target->getType() == ASTNodeType::INDEX_EXPR &&
+                            target->getChild(0)->getType() == ASTNodeType::IDENTIFIER);
+            Store store;
+            store.name = name;
+            store.unit = unit;
+            if (element && node->getType() == ASTNodeType::ASSIGNMENT_EXPR) {
+                const std::string& op = static_cast<const AssignmentExprNode*>(node)->getOperator();
+                long long mask = 0;
+                if (op == "=") {
+                    store.value = node->getChild(1);
+                } else if (op == "&=" && constantInt(node->getChild(1), mask) && mask >= 0) {
+                    store.mask = mask;
+                }
+            }
+            stores_.push_back(store);
+        }
+    } else if (node->getType() == ASTNodeType::CALL_EXPR) {
+        for (const auto& arg : node->getChildren()) {
+            if (arg->getType() == ASTNodeType::IDENTIFIER) {
+                const std::string& name = static_cast<const IdentifierNode*>(arg.get())->getName();
+                auto it = globals_.find(name);
+                if (it != globals_.end() && static_cast<const VariableDeclNode*>(it->second)->getArraySize() != 0) {
+                    ranges_.erase(name);
+                }
+            }
+        }
+    }
+    for (const auto& child : node->getChildren()) {
+        collectStores(child.get(), unit);
+    }
+}
+
+/**
+ * 一次写入后变量可能的值（已按声明类型转换）
+ */
+ValueRange IntegerNarrowing::storedRange(const Store& store) const {
+    const std::string& type = static_cast<const VariableDeclNode*>(globals_.at(store.name))->getVarType();
+    if (store.value) {
+        return convertRange(rangeOf(store.value, store.unit), type);
+    }
+    if (store.mask >= 0) {
+        return convertRange(ValueRange::make(0, store.mask), type);
+    }
+    return convertRange(ValueRange(), type);
+}
+
+/**
+ * 变量读取的值域：局部变量和非候选全局变量取类型的全部值域
+ */
+ValueRange IntegerNarrowing::variableRange(const std::string& name, const ASTNode* unit) const {
+    auto unit_it = unit_locals_.find(unit);
+    if (unit_it == unit_locals_.end() || !unit_it->second.count(name)) {
+        auto range = ranges_.find(name);
+        if (range != ranges_.end()) {
+            return range->second;
+        }
+    }
+    return typeRange(variableType(name, unit));
+}
+
+/**
+ * 变量的声明类型，局部变量优先
+ */
+std::string IntegerNarrowing::variableType(const std::string& name, const ASTNode* unit) const {
+    auto unit_it = unit_locals_.find(unit);
+    if (unit_it != unit_locals_.end()) {
+        auto local = unit_it->second.find(name);
+        if (local != unit_it->second.end()) {
+            return local->second;
+        }
+    }
+    auto global = globals_.find(name);
+    if (global != globals_.end()) {
+        return static_cast<const VariableDeclNode*>(global->second)->getVarType();
+    }
+    return "";
+}
+
+/**
+ * 表达式是否含有 dword/qword 操作数：此时运算按无符号进行，小值域也可能回绕
+ */
+bool IntegerNarrowing::isUnsignedWide(const ASTNode* expr, const ASTNode* unit) const {
+    if (!expr) {
+        return false;
+    }
+    std::string type;
+    switch (expr->getType()) {
+        case ASTNodeType::IDENTIFIER:
+            type = variableType(static_cast<const IdentifierNode*>(expr)->getName(), unit);
+            break;
+        case ASTNodeType::INDEX_EXPR:
+            return isUnsignedWide(expr->getChild(0), unit);
+        case ASTNodeType::MEMBER_EXPR:
+            return static_cast<const MemberExprNode*>(expr)->getMember() == "id";
+        case ASTNodeType::CALL_EXPR: {
+            auto it = functions_.find(static_cast<const CallExprNode*>(expr)->getFunctionName());
+            if (it != functions_.end()) {
+                type = static_cast<const FunctionNode*>(it->second)->getReturnType();
+            }
+            break;
+        }
+        case ASTNodeType::BINARY_EXPR:
+        case ASTNodeType::UNARY_EXPR:
+        case ASTNodeType::CONDITIONAL_EXPR:
+            for (const auto& child : expr->getChildren()) {
+                if (isUnsignedWide(child.get(), unit)) {
+                    return true;
+                }
+            }
+            return false;
+        default:
+            return false;
+    }
+    return type == "dword" || type == "qword";
+}
+
+/**
+ * 求表达式的值域，运算按整数提升后的 int 语义
+ * @param expr 表达式节点
+ * @param unit 所在的处理器或函数，全局初始化表达式为 nullptr
+ * @return 值域，无法确定时 known 为 false
+ */
+ValueRange IntegerNarrowing::rangeOf(const ASTNode* expr, const ASTNode* unit) const {
+    if (!expr) {
+        return ValueRange();
+    }
+    long long value = 0;
+    if (constantInt(expr, value)) {
+        return ValueRange::make(value, value);
+    }
+    
+    switch (expr->getType()) {
+        case ASTNodeType::IDENTIFIER:
+            return variableRange(static_cast<const IdentifierNode*>(expr)->getName(), unit);
+        case ASTNodeType::INDEX_EXPR: {
+            const ASTNode* base = expr->getChild(0);
+            if (base->getType() == ASTNodeType::IDENTIFIER) {
+                return variableRange(static_cast<const IdentifierNode*>(base)->getName(), unit);
+            }
+            if (base->getType() == ASTNodeType::MEMBER_EXPR &&
+                static_cast<const MemberExprNode*>(base)->getMember() == "data") {
+                return ValueRange::make(0, 0xFF);
+            }
+            return ValueRange();
+        }
+        case ASTNodeType::MEMBER_EXPR: {
+            const std::string& member = static_cast<const MemberExprNode*>(expr)->getMember();
+            if (member == "byte" || member == "dlc" || member == "channel" || member == "dir") {
+                return ValueRange::make(0, 0xFF);
+            }
+            if (member == "id") {
+                return ValueRange::make(0, 0xFFFFFFFFLL);
+            }
+            return ValueRange();
+        }
+        case ASTNodeType::CALL_EXPR: {
+            auto it = functions_.find(static_cast<const CallExprNode*>(expr)->getFunctionName());
+            if (it != functions_.end()) {
+                return typeRange(static_cast<const FunctionNode*>(it->second)->getReturnType());
+            }
+            return ValueRange();
+        }
+        case ASTNodeType::CONDITIONAL_EXPR:
+            return rangeOf(expr->getChild(1), unit).unite(rangeOf(expr->getChild(2), unit));
+        case ASTNodeType::UNARY_EXPR: {
+            const std::string& op = static_cast<const UnaryExprNode*>(expr)->getOperator();
+            if (op == "!") {
+                return ValueRange::make(0, 1);
+            }
+            ValueRange operand = rangeOf(expr->getChild(0), unit);
+            if (!fitsInt32(operand) || isIncrementExpr(expr) || isUnsignedWide(expr, unit)) {
+                return ValueRange();
+            }
+            if (op == "-") {
+                return intResult(-operand.hi, -operand.lo);
+            }
+            return op == "+" ? operand : ValueRange();
+        }
+        case ASTNodeType::BINARY_EXPR:
+            break;
+        default:
+            return ValueRange();
+    }
+    
+    const std::string& op = static_cast<const BinaryExprNode*>(expr)->getOperator();
+    if (op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=" ||
+        op == "&&" || op == "||") {
+        return ValueRange::make(0, 1);
+    }
+    ValueRange lhs = rangeOf(expr->getChild(0), unit);
+    ValueRange rhs = rangeOf(expr->getChild(1), unit);
+    long long constant = 0;
+    if (op == "&") {
+        // 与非负数按位与的结果不超过该数
+        if (lhs.known && lhs.lo >= 0 && (!rhs.known || rhs.lo < 0 || lhs.hi <= rhs.hi)) {
+            return ValueRange::make(0, lhs.hi);
+        }
+        if (rhs.known && rhs.lo >= 0) {
+            return ValueRange::make(0, rhs.hi);
+        }
+        return ValueRange();
+    }
+    if (op == "%" && constantInt(expr->getChild(1), constant) && constant > 0) {
+        if (fitsInt32(lhs) && lhs.lo >= 0) {
+            return ValueRange::make(0, std::min(lhs.hi, constant - 1));
+        }
+        return ValueRange::make(-(constant - 1), constant - 1);
+    }
+    // 其余运算按 int 进行，含 dword/qword 操作数时按无符号运算，不分析
+    if (!fitsInt32(lhs) || !fitsInt32(rhs) || isUnsignedWide(expr, unit)) {
+        return ValueRange();
+    }
+    if (op == "+") {
+        return intResult(lhs.lo + rhs.lo, lhs.hi + rhs.hi);
+    }
+    if (op == "-") {
+        return intResult(lhs.lo - rhs.hi, lhs.hi - rhs.lo);
+    }
+    if (op == "*") {
+        long long products[] = {lhs.lo * rhs.lo, lhs.lo * rhs.hi, lhs.hi * rhs.lo, lhs.hi * rhs.hi};
+        return intResult(*std::min_element(products, products + 4), *std::max_element(products, products + 4));
+    }
+    if (op == "/" && rhs.known && rhs.lo == rhs.hi && rhs.lo > 0) {
+        return intResult(lhs.lo / rhs.lo, lhs.hi / rhs.lo);
+    }
+    if (op == ">>" && rhs.lo == rhs.hi && rhs.lo >= 0 && rhs.lo < 32 && lhs.lo >= 0) {
+        return ValueRange::make(lhs.lo >> rhs.lo, lhs.hi >> rhs.lo);
+    }
+    if ((op == "|" || op == "^") && lhs.lo >= 0 && rhs.lo >= 0) {
+        return ValueRange::make(0, bitMask(std::max(lhs.hi, rhs.hi)));
+    }
+    return ValueRange();
+}
+
+} // namespace capl
@@ -0,0 +1,309 @@
+/**
+ * 有符号整数运算的回绕分析实现
+ */
+
+#include "../include/integer_wrap.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 提升后 int 运算的位数，结果超出时需要回绕
+ */
+constexpr int kIntBits = 32;
+
+/**
+ * 有符号整数值需要的位数（含符号位）
+ */
+int valueBits(long long value) {
+    unsigned long long magnitude = value < 0 ? ~static_cast<unsigned long long>(value)
+                                             : static_cast<unsigned long long>(value);
+    int bits = 1;
+    while (magnitude != 0) {
+        magnitude >>= 1;
+        ++bits;
+    }
+    return bits;
+}
+
+/**
+ * 按块作用域查找变量类型，估算表达式位数并记录需要回绕的运算
+ */
+class WrapAnalyzer {
+public:
+    explicit WrapAnalyzer(std::set<const ASTNode*>& wrapped) : wrapped_(wrapped) {}
+    
+    void analyzeProgram(const ASTNode* program) {
+        for (const auto& child : program->getChildren()) {
+            if (child->getType() == ASTNodeType::BLOCK_STMT) {
+                for (const auto& decl : child->getChildren()) {
+                    if (decl->getType() == ASTNodeType::VARIABLE_DECL) {
+                        const VariableDeclNode* var = static_cast<const VariableDeclNode*>(decl.get());
+                        globals_[var->getName()] = var->getVarType();
+                    }
+                }
+            } else if (child->getType() == ASTNodeType::FUNCTION) {
+                const FunctionNode* func = static_cast<const FunctionNode*>(child.get());
+                functions_[func->getName()] = func->getReturnType();
+            }
+        }
+        for (const auto& child : program->getChildren()) {
+            if (child->getType() == ASTNodeType::BLOCK_STMT) {
+                for (const auto& decl : child->getChildren()) {
+                    visit(decl.get());
+                }
+                continue;
+            }
+            scopes_.assign(1, {});
+            if (child->getType() == ASTNodeType::FUNCTION) {
+                for (const auto& param : static_cast<const FunctionNode*>(child.get())->getParameters()) {
+                    const VariableDeclNode* var = static_cast<const VariableDeclNode*>(param.get());
+                    scopes_.back()[var->getName()] = var->getVarType();
+                }
+            }
+            for (const auto& stmt : child->getChildren()) {
+                visit(stmt.get());
+            }
+            scopes_.clear();
+        }
+    }
+
+private:
+    const std::string* findType(const std::string& name) const {
+        for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); ++scope) {
+            auto it = scope->find(name);
+            if (it != scope->end()) {
+                return &it->second;
+            }
+        }
+        auto it = globals_.find(name);
+        return it != globals_.end() ? &it->second : nullptr;
+    }
+    
+    /**
+     * 访问语句，代码块和 for 循环的声明只在其中可见
+     */
+    void visit(const ASTNode* node) {
+        if (!node) {
+            return;
+        }
+        switch (node->getType()) {
+            case ASTNodeType::BLOCK_STMT:
+            case ASTNodeType::FOR_STMT:
+                scopes_.emplace_back();
+                for (const auto& child : node->getChildren()) {
+                    visit(child.get());
+                }
+                scopes_.pop_back();
+                return;
+            case ASTNodeType::VARIABLE_DECL: {
+                const VariableDeclNode* var = static_cast<const VariableDeclNode*>(node);
+                bits(var->getInitializer());
+                if (!scopes_.empty()) {
+                    scopes_.back()[var->getName()] = var->getVarType();
+                }
+                return;
+            }
+            case ASTNodeType::BINARY_EXPR:
+            case ASTNodeType::UNARY_EXPR:
+            case ASTNodeType::ASSIGNMENT_EXPR:
+            case ASTNodeType::CALL_EXPR:
+            case ASTNodeType::MEMBER_EXPR:
+            case ASTNodeType::INDEX_EXPR:
+            case ASTNodeType::CONDITIONAL_EXPR:
+                bits(node);
+                return;
+            default:
+                for (const auto& child : node->getChildren()) {
+                    visit(child.get());
+                }
+                return;
+        }
+    }
+    
+    /**
+     * 运算结果可能超出 int 时记录回绕，返回回绕后结果类型的位数
+     */
+    int wrapIfWide(const ASTNode* node, int result, int a, int b) {
+        if (result <= kIntBits) {
+            return result;
+        }
+        wrapped_.insert(node);
+        return std::max({a, b, kIntBits});
+    }
+    
+    /**
+     * 估算表达式的值需要的有符号位数，同时分析子表达式
+     */
+    int bits(const ASTNode* node) {
+        if (!node) {
+            return kIntBits;
+        }
+        switch (node->getType()) {
+            case ASTNodeType::INTEGER_LITERAL:
+            case ASTNodeType::CHAR_LITERAL:
+            case ASTNodeType::BOOLEAN_LITERAL: {
+                ConstantValue value;
+                if (evaluateConstant(node, value) && !value.is_float) {
+                    return valueBits(value.int_value);
+                }
+                return IntegerWrap::kUnknown;
+            }
+            case ASTNodeType::FLOAT_LITERAL:
+                return IntegerWrap::kFloat;
+            case ASTNodeType::STRING_LITERAL:
+                return IntegerWrap::kUnknown;
+            case ASTNodeType::IDENTIFIER: {
+                const std::string* type = findType(static_cast<const IdentifierNode*>(node)->getName());
+                return type ? IntegerWrap::typeBits(*type) : IntegerWrap::kUnknown;
+            }
+            case ASTNodeType::INDEX_EXPR: {
+                bits(node->getChild(1));
+                const ASTNode* base = node->getChild(0);
+                if (base && base->getType() == ASTNodeType::IDENTIFIER) {
+                    const std::string* type = findType(static_cast<const IdentifierNode*>(base)->getName());
+                    return type ? IntegerWrap::typeBits(*type) : IntegerWrap::kUnknown;
+                }
+                bits(base);
+                return IntegerWrap::kUnknown;
+            }
+            case ASTNodeType::MEMBER_EXPR: {
+                const MemberExprNode* member = static_cast<const MemberExprNode*>(node);
+                for (const auto& child : node->getChildren()) {
+                    bits(child.get());
+                }
+                if (member->getSignal()) {
+                    return IntegerWrap::kFloat;     // 信号按换算后的物理值读取
+                }
+                const std::string& name = member->getMember();
+                if (name == "byte" || name == "dlc" || name == "dir" || name == "channel") {
+                    return 9;
+                }
+                return name == "id" ? 33 : IntegerWrap::kUnknown;
+            }
+            case ASTNodeType::SIGNAL_ACCESS:
+                return IntegerWrap::kFloat;
+            case ASTNodeType::CALL_EXPR: {
+                for (const auto& child : node->getChildren()) {
+                    bits(child.get());
+                }
+                auto it = functions_.find(static_cast<const CallExprNode*>(node)->getFunctionName());
+                return it != functions_.end() ? IntegerWrap::typeBits(it->second) : IntegerWrap::kUnknown;
+            }
+            case ASTNodeType::CONDITIONAL_EXPR: {
+                bits(node->getChild(0));
+                int a = bits(node->getChild(1));
+                int b = bits(node->getChild(2));
+                return a == IntegerWrap::kFloat || b == IntegerWrap::kFloat ? IntegerWrap::kFloat : std::max(a, b);
+            }
+            case ASTNodeType::UNARY_EXPR: {
+                const std::string& op = static_cast<const UnaryExprNode*>(node)->getOperator();
+                int a = bits(node->getChild(0));
+                if (op == "!") {
+                    return 2;
+                }
+                if (a == IntegerWrap::kFloat || op == "~" || op == "+") {
+                    return a;
+                }
+                // 取负和 ++/-- 的结果多一位
+                return wrapIfWide(node, a + 1, a, a);
+            }
+            case ASTNodeType::BINARY_EXPR:
+                return binaryBits(node, static_cast<const BinaryExprNode*>(node)->getOperator(),
+                                  bits(node->getChild(0)), bits(node->getChild(1)));
+            case ASTNodeType::ASSIGNMENT_EXPR: {
+                const std::string& op = static_cast<const AssignmentExprNode*>(node)->getOperator();
+                int target = bits(node->getChild(0));
+                int value = bits(node->getChild(1));
+                if (op != "=") {
+                    binaryBits(node, op.substr(0, op.size() - 1), target, value);
+                }
+                return target;
+            }
+            default:
+                for (const auto& child : node->getChildren()) {
+                    bits(child.get());
+                }
+                return IntegerWrap::kUnknown;
+        }
+    }
+    
+    int binaryBits(const ASTNode* node, const std::string& op, int a, int b) {
+        if (op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=" || op == "&&" ||
+            op == "||") {
+            return 2;
+        }
+        if (a == IntegerWrap::kFloat || b == IntegerWrap::kFloat) {
+            return IntegerWrap::kFloat;
+        }
+        if (op == "+" || op == "-") {
+            return wrapIfWide(node, std::max(a, b) + 1, a, b);
+        }
+        if (op == "*") {
+            return wrapIfWide(node, a + b - 1, a, b);
+        }
+        if (op == "<<") {
+            ConstantValue shift;
+            if (evaluateConstant(node->getChild(1), shift) && !shift.is_float && shift.int_value >= 0 &&
+                shift.int_value < 64) {
+                return std::min(a + static_cast<int>(shift.int_value), IntegerWrap::kUnknown);
+            }
+            return IntegerWrap::kUnknown;
+        }
+        if (op == "/" || op == "%" || op == ">>") {
+            return a;
+        }
+        return std::max(a, b);      // & | ^
+    }
+    
+    std::set<const ASTNode*>& wrapped_;                     // 需要回绕的运算
+    std::map<std::string, std::string> globals_;            // 全局变量的类型
+    std::map<std::string, std::string> functions_;          // 用户函数的返回类型
+    std::vector<std::map<std::string, std::string>> scopes_;    // 各层作用域中局部变量的类型
+};
+
+} // namespace
+
+/**
+ * CAPL 标量类型的值需要的有符号位数
+ * @param capl_type CAPL 类型
+ * @return 位数
+ */
+int IntegerWrap::typeBits(const std::string& capl_type) {
+    if (capl_type == "float") {
+        return kFloat;
+    }
+    static const std::map<std::string, int> bits = {
+        {"char", 8}, {"byte", 9}, {"int", 16}, {"word", 17}, {"long", 32}, {"dword", 33}, {"int64", 64}
+    };
+    auto it = bits.find(capl_type);
+    return it != bits.end() ? it->second : kUnknown;
+}
+
+/**
+ * 找出程序中可能发生有符号溢出的运算
+ * @param program AST 根节点
+ */
+void IntegerWrap::analyze(const ASTNode* program) {
+    clear();
+    if (!program) {
+        return;
+    }
+    WrapAnalyzer analyzer(wrapped_);
+    analyzer.analyzeProgram(program);
+}
+
+/**
+ * 清空分析结果
+ */
+void IntegerWrap::clear() {
+    wrapped_.clear();
+}
+
+} // namespace capl
@@ -0,0 +1,486 @@
+/**
+ * CAPL 中间表示实现：文本输出和验证
+ */
+
+#include "../include/ir.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace capl {
+
+// IRValue 实现
+IRValue IRValue::makeReg(int reg) {
+    IRValue value;
+    value.kind = Kind::REG;
+    value.reg = reg;
+    return value;
+}
+
+IRValue IRValue::makeInt(long long int_value) {
+    IRValue value;
+    value.kind = Kind::INT;
+    value.int_value = int_value;
+    return value;
+}
+
+IRValue IRValue::makeFloat(double float_value, const std::string& spelling) {
+    IRValue value;
+    value.kind = Kind::FLOAT;
+    value.float_value = float_value;
+    value.text = spelling;
+    return value;
+}
+
+IRValue IRValue::makeString(const std::string& text) {
+    IRValue value;
+    value.kind = Kind::STRING;
+    value.text = text;
+    return value;
+}
+
+IRValue IRValue::makeSymbol(const std::string& name) {
+    IRValue value;
+    value.kind = Kind::SYMBOL;
+    value.text = name;
+    return value;
+}
+
+IRValue IRValue::makeUndef() {
+    IRValue value;
+    value.kind = Kind::UNDEF;
+    return value;
+}
+
+bool IRValue::operator==(const IRValue& other) const {
+    if (kind != other.kind) {
+        return false;
+    }
+    switch (kind) {
+        case Kind::REG:
+            return reg == other.reg;
+        case Kind::INT:
+            return int_value == other.int_value;
+        case Kind::FLOAT:
+            return float_value == other.float_value;
+        case Kind::STRING:
+        case Kind::SYMBOL:
+            return text == other.text;
+        default:
+            return true;
+    }
+}
+
+std::string IRValue::toString() const {
+    switch (kind) {
+        case Kind::REG:
+            return "%" + std::to_string(reg);
+        case Kind::INT:
+            return std::to_string(int_value);
+        case Kind::FLOAT:
+            return text;
+        case Kind::STRING: {
+            std::string result = "\"";
+            for (char c : text) {
+                if (c == '\n') {
+                    result += "\\n";
+                } else if (c == '"' || c == '\\') {
+                    result += '\\';
+                    result += c;
+                } else {
+                    result += c;
+                }
+            }
+            return result + "\"";
+        }
+        case Kind::SYMBOL:
+            return text;
+        case Kind::UNDEF:
+            return "undef";
+        default:
+            return "<无>";
+    }
+}
+
+// IRInstruction 实现
+bool IRInstruction::isTerminator() const {
+    return opcode == IROpcode::BR || opcode == IROpcode::COND_BR || opcode == IROpcode::SWITCH ||
+           opcode == IROpcode::RET;
+}
+
+std::string IRInstruction::toString() const {
+    std::ostringstream out;
+    if (result >= 0) {
+        out << "%" << result << " = ";
+    }
+    
+    // 内存位置：符号 [下标] .字段 [字段下标]
+    size_t next = 0;
+    auto location = [&](bool with_field) {
+        out << symbol;
+        if (has_index && next < operands.size()) {
+            out << "[" << operands[next++].toString() << "]";
+        }
+        if (with_field) {
+            out << "." << name;
+            if (has_field_index && next < operands.size()) {
+                out << "(" << operands[next++].toString() << ")";
+            }
+        }
+    };
+    
+    switch (opcode) {
+        case IROpcode::PARAM:
+            out << "param " << name << " : " << type;
+            break;
+        case IROpcode::ALLOCA:
+            out << "alloca " << symbol << " : " << type;
+            if (array_size > 0) {
+                out << "[" << array_size << "]";
+            }
+            break;
+        case IROpcode::LOAD:
+            out << "load ";
+            location(false);
+            break;
+        case IROpcode::STORE:
+            out << "store ";
+            location(false);
+            out << ", " << (next < operands.size() ? operands[next].toString() : "<无>");
+            break;
+        case IROpcode::LOAD_FIELD:
+            out << "loadfield ";
+            location(true);
+            break;
+        case IROpcode::STORE_FIELD:
+            out << "storefield ";
+            location(true);
+            out << ", " << (next < operands.size() ? operands[next].toString() : "<无>");
+            break;
+        case IROpcode::BINARY:
+        case IROpcode::UNARY:
+            out << name;
+            for (size_t i = 0; i < operands.size(); ++i) {
+                out << (i > 0 ? ", " : " ") << operands[i].toString();
+            }
+            break;
+        case IROpcode::CALL:
+            out << "call " << name << "(";
+            for (size_t i = 0; i < operands.size(); ++i) {
+                out << (i > 0 ? ", " : "") << operands[i].toString();
+            }
+            out << ")";
+            break;
+        case IROpcode::PHI:
+            out << "phi";
+            for (size_t i = 0; i < operands.size(); ++i) {
+                out << (i > 0 ? ", " : " ") << "[" << operands[i].toString() << ", bb"
+                    << (i < targets.size() ? std::to_string(targets[i]) : "?") << "]";
+            }
+            break;
+        case IROpcode::BR:
+            out << "br bb" << (targets.empty() ? -1 : targets[0]);
+            break;
+        case IROpcode::COND_BR:
+            out << "condbr " << (operands.empty() ? "<无>" : operands[0].toString());
+            for (int target : targets) {
+                out << ", bb" << target;
+            }
+            break;
+        case IROpcode::SWITCH:
+            out << "switch " << (operands.empty() ? "<无>" : operands[0].toString()) << ", bb"
+                << (targets.empty() ? -1 : targets[0]) << " [";
+            for (size_t i = 1; i < operands.size(); ++i) {
+                out << (i > 1 ? ", " : "") << operands[i].toString() << ": bb"
+                    << (i < targets.size() ? std::to_string(targets[i]) : "?");
+            }
+            out << "]";
+            break;
+        case IROpcode::RET:
+            out << "ret";
+            if (!operands.empty()) {
+                out << " " << operands[0].toString();
+            }
+            break;
+    }
+    return out.str();
+}
+
+// IRModule 实现
+void IRModule::print(std::ostream& out) const {
+    out << "; CAPL IR\n";
+    for (const auto& global : globals) {
+        out << "global @" << global.name << " : " << global.type;
+        if (global.array_size > 0) {
+            out << "[" << global.array_size << "]";
+        }
+        out << "\n";
+    }
+    
+    for (const auto& function : functions) {
+        out << "\n";
+        if (function.is_handler) {
+            out << "handler \"" << function.name << "\" {\n";
+        } else {
+            out << "function " << function.return_type << " " << function.name << " {\n";
+        }
+        for (const auto& block : function.blocks) {
+            out << "bb" << block.id << ":";
+            if (!block.preds.empty()) {
+                out << "    ; 前驱:";
+                for (size_t i = 0; i < block.preds.size(); ++i) {
+                    out << (i > 0 ? ", bb" : " bb") << block.preds[i];
+                }
+            }
+            out << "\n";
+            for (const auto& inst : block.instructions) {
+                out << "    " << inst.toString() << "\n";
+            }
+        }
+        out << "}\n";
+    }
+}
+
+// 支配关系
+std::vector<int> computeDominators(const IRFunction& function) {
+    size_t count = function.blocks.size();
+    std::vector<int> idom(count, -1);
+    if (count == 0) {
+        return idom;
+    }
+    
+    // 逆后序编号
+    std::vector<int> order;
+    std::vector<int> rpo_index(count, -1);
+    std::vector<bool> visited(count, false);
+    std::vector<std::pair<int, size_t>> stack;
+    stack.push_back({0, 0});
+    visited[0] = true;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        const auto& succs = function.blocks[top.first].succs;
+        if (top.second < succs.size()) {
+            int succ = succs[top.second++];
+            if (succ >= 0 && static_cast<size_t>(succ) < count && !visited[succ]) {
+                visited[succ] = true;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); ++i) {
+        rpo_index[order[i]] = static_cast<int>(i);
+    }
+    
+    // Cooper-Harvey-Kennedy 迭代算法
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (rpo_index[a] > rpo_index[b]) {
+                a = idom[a];
+            }
+            while (rpo_index[b] > rpo_index[a]) {
+                b = idom[b];
+            }
+        }
+        return a;
+    };
+    
+    idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            int block = order[i];
+            int new_idom = -1;
+            for (int pred : function.blocks[block].preds) {
+                if (pred < 0 || static_cast<size_t>(pred) >= count || idom[pred] < 0) {
+                    continue;
+                }
+                new_idom = new_idom < 0 ? pred : intersect(pred, new_idom);
+            }
+            if (new_idom >= 0 && idom[block] != new_idom) {
+                idom[block] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    return idom;
+}
+
+bool dominates(const std::vector<int>& idom, int a, int b) {
+    if (b < 0 || static_cast<size_t>(b) >= idom.size() || idom[b] < 0) {
+        return false;
+    }
+    while (true) {
+        if (a == b) {
+            return true;
+        }
+        if (idom[b] == b) {
+            return false;
+        }
+        b = idom[b];
+    }
+}
+
+// IRVerifier 实现
+bool IRVerifier::verify(const IRModule& module) {
+    errors_.clear();
+    for (const auto& function : module.functions) {
+        verifyFunction(function);
+    }
+    return errors_.empty();
+}
+
+void IRVerifier::error(const IRFunction& function, int block, const std::string& message) {
+    std::string where = function.name;
+    if (block >= 0) {
+        where += ": bb" + std::to_string(block);
+    }
+    errors_.push_back(where + ": " + message);
+}
+
+void IRVerifier::verifyFunction(const IRFunction& function) {
+    const int block_count = static_cast<int>(function.blocks.size());
+    if (block_count == 0) {
+        error(function, -1, "函数没有基本块");
+        return;
+    }
+    auto validBlock = [&](int id) {
+        return id >= 0 && id < block_count;
+    };
+    
+    // 1. 块结构和控制流边
+    for (int b = 0; b < block_count; ++b) {
+        const IRBasicBlock& block = function.blocks[b];
+        if (block.id != b) {
+            error(function, b, "块编号与位置不一致");
+        }
+        if (block.instructions.empty() || !block.instructions.back().isTerminator()) {
+            error(function, b, "块不以终结指令结束");
+            continue;
+        }
+        
+        bool phi_allowed = true;
+        for (size_t i = 0; i < block.instructions.size(); ++i) {
+            const IRInstruction& inst = block.instructions[i];
+            if (inst.isTerminator() && i + 1 != block.instructions.size()) {
+                error(function, b, "终结指令之后还有指令");
+            }
+            if (inst.opcode == IROpcode::PHI) {
+                if (!phi_allowed) {
+                    error(function, b, "phi 不在块的开头");
+                }
+                std::set<int> phi_preds(inst.targets.begin(), inst.targets.end());
+                std::set<int> block_preds(block.preds.begin(), block.preds.end());
+                if (inst.operands.size() != inst.targets.size() || phi_preds != block_preds ||
+                    inst.targets.size() != block.preds.size()) {
+                    error(function, b, "phi %" + std::to_string(inst.result) + " 的来源与前驱块不一致");
+                }
+            } else {
+                phi_allowed = false;
+            }
+            if (inst.opcode == IROpcode::PARAM && b != 0) {
+                error(function, b, "param 只能出现在入口块");
+            }
+        }
+        
+        const IRInstruction& term = block.instructions.back();
+        std::vector<int> expected = term.targets;
+        if ((term.opcode == IROpcode::BR && expected.size() != 1) ||
+            (term.opcode == IROpcode::COND_BR && (expected.size() != 2 || term.operands.size() != 1)) ||
+            (term.opcode == IROpcode::SWITCH && (expected.empty() || term.operands.size() != expected.size())) ||
+            (term.opcode == IROpcode::RET && !expected.empty())) {
+            error(function, b, "终结指令的目标或操作数数量错误");
+        }
+        if (expected != block.succs) {
+            error(function, b, "后继块与终结指令的目标不一致");
+        }
+        for (int succ : block.succs) {
+            if (!validBlock(succ)) {
+                error(function, b, "跳转到不存在的块 bb" + std::to_string(succ));
+                continue;
+            }
+            const auto& preds = function.blocks[succ].preds;
+            if (std::find(preds.begin(), preds.end(), b) == preds.end()) {
+                error(function, b, "后继块 bb" + std::to_string(succ) + " 的前驱中缺少本块");
+            }
+        }
+        for (int pred : block.preds) {
+            if (!validBlock(pred)) {
+                error(function, b, "前驱块 bb" + std::to_string(pred) + " 不存在");
+                continue;
+            }
+            const auto& succs = function.blocks[pred].succs;
+            if (std::find(succs.begin(), succs.end(), b) == succs.end()) {
+                error(function, b, "前驱块 bb" + std::to_string(pred) + " 的后继中缺少本块");
+            }
+        }
+    }
+    if (!function.blocks[0].preds.empty()) {
+        error(function, 0, "入口块不能有前驱");
+    }
+    if (!errors_.empty()) {
+        return;
+    }
+    
+    // 2. 寄存器唯一定义
+    std::map<int, std::pair<int, size_t>> defs;     // 寄存器 -> (块, 指令下标)
+    for (int b = 0; b < block_count; ++b) {
+        const auto& instructions = function.blocks[b].instructions;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            int reg = instructions[i].result;
+            if (reg < 0) {
+                continue;
+            }
+            if (reg >= function.register_count) {
+                error(function, b, "寄存器 %" + std::to_string(reg) + " 超出寄存器数量");
+            }
+            if (!defs.emplace(reg, std::make_pair(b, i)).second) {
+                error(function, b, "寄存器 %" + std::to_string(reg) + " 被重复定义");
+            }
+        }
+    }
+    
+    // 3. 定义支配使用
+    std::vector<int> idom = computeDominators(function);
+    for (int b = 0; b < block_count; ++b) {
+        if (idom[b] < 0) {
+            error(function, b, "块从入口不可达");
+        }
+    }
+    for (int b = 0; b < block_count; ++b) {
+        const auto& instructions = function.blocks[b].instructions;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            const IRInstruction& inst = instructions[i];
+            for (size_t k = 0; k < inst.operands.size(); ++k) {
+                const IRValue& operand = inst.operands[k];
+                if (!operand.isReg()) {
+                    continue;
+                }
+                auto def = defs.find(operand.reg);
+                if (def == defs.end()) {
+                    error(function, b, "使用了未定义的寄存器 %" + std::to_string(operand.reg));
+                    continue;
+                }
+                bool ok;
+                if (inst.opcode == IROpcode::PHI) {
+                    // phi 的来源须在对应前驱块的末尾可用
+                    ok = k < inst.targets.size() && dominates(idom, def->second.first, inst.targets[k]);
+                } else if (def->second.first == b) {
+                    ok = def->second.second < i;
+                } else {
+                    ok = dominates(idom, def->second.first, b);
+                }
+                if (!ok) {
+                    error(function, b, "寄存器 %" + std::to_string(operand.reg) + " 的定义不支配其使用");
+                }
+            }
+        }
+    }
+}
+
+} // namespace capl
@@ -0,0 +1,1075 @@
+/**
+ * CAPL AST 到 IR 的降级实现
+ */
+
+#include "../include/ir_builder.h"
+#include "../include/ast.h"
+#include "../include/switch_lowering.h"
+#include <algorithm>
+#include <queue>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 空语句（FOR 中缺省的部分）
+ */
+bool isEmptyStatement(const ASTNode* node) {
+    return !node || (node->getType() == ASTNodeType::EXPRESSION_STMT && node->getChildCount() == 0);
+}
+
+/**
+ * 内置函数是否无返回值
+ */
+bool isVoidBuiltin(const std::string& name) {
+    return name == "write" || name == "output" || name == "setTimer" || name == "cancelTimer";
+}
+
+} // namespace
+
+/**
+ * 从 AST 构造 IR 模块
+ * @param program AST 根节点
+ * @return IR 模块
+ */
+std::unique_ptr<IRModule> IRBuilder::build(const ASTNode* program) {
+    module_ = std::make_unique<IRModule>();
+    globals_.clear();
+    function_types_.clear();
+    errors_.clear();
+    if (!program) {
+        return std::move(module_);
+    }
+    
+    // 全局变量和函数签名
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(var.get());
+                IRGlobal global;
+                global.name = decl->getName();
+                global.type = decl->getVarType();
+                global.array_size = decl->getArraySize();
+                globals_[global.name] = global;
+                module_->globals.push_back(global);
+            }
+        } else if (child->getType() == ASTNodeType::FUNCTION) {
+            const FunctionNode* func = static_cast<const FunctionNode*>(child.get());
+            function_types_[func->getName()] = func->getReturnType();
+        }
+    }
+    
+    for (const auto& child : program->getChildren()) {
+        switch (child->getType()) {
+            case ASTNodeType::FUNCTION: {
+                const FunctionNode* func = static_cast<const FunctionNode*>(child.get());
+                lowerFunction(func, func->getName(), false, func->getReturnType(), func);
+                break;
+            }
+            case ASTNodeType::ON_START:
+            case ASTNodeType::ON_STOP:
+            case ASTNodeType::ON_MESSAGE:
+            case ASTNodeType::ON_TIMER:
+            case ASTNodeType::ON_KEY: {
+                const OnEventNode* handler = static_cast<const OnEventNode*>(child.get());
+                lowerFunction(handler, handler->getDisplayName(), true, "void", nullptr);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    
+    return std::move(module_);
+}
+
+void IRBuilder::lowerFunction(const ASTNode* node, const std::string& name, bool is_handler,
+                              const std::string& return_type, const FunctionNode* function) {
+    module_->functions.emplace_back();
+    function_ = &module_->functions.back();
+    function_->name = name;
+    function_->is_handler = is_handler;
+    function_->return_type = return_type;
+    function_->line = node->getLine();
+    function_->source = node;
+    
+    scopes_.assign(1, std::map<std::string, LocalVar>());
+    name_counts_.clear();
+    current_def_.clear();
+    incomplete_phis_.clear();
+    sealed_.clear();
+    loops_.clear();
+    current_line_ = node->getLine();
+    
+    current_ = newBlock();
+    sealBlock(current_);
+    
+    if (function) {
+        for (const auto& param : function->getParameters()) {
+            const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(param.get());
+            bool memory = decl->getArraySize() != 0 || decl->getVarType() == "message";
+            declareLocal(decl->getName(), memory);
+            
+            IRInstruction inst;
+            inst.opcode = IROpcode::PARAM;
+            inst.name = decl->getName();
+            inst.type = decl->getVarType() + (decl->getArraySize() != 0 ? "[]" : "");
+            IRValue value = emit(inst, true);
+            if (!memory) {
+                writeVariable(lookupLocal(decl->getName())->ssa_name, current_, value);
+            }
+        }
+    }
+    
+    lowerStatements(node);
+    
+    if (!isTerminated()) {
+        IRInstruction ret;
+        ret.opcode = IROpcode::RET;
+        emit(ret, false);
+    }
+    
+    finishFunction();
+    function_ = nullptr;
+}
+
+void IRBuilder::finishFunction() {
+    removeUnreachableBlocks();
+    removeTrivialPhis();
+    renumberRegisters();
+}
+
+// 基本块和指令
+
+int IRBuilder::newBlock() {
+    IRBasicBlock block;
+    block.id = static_cast<int>(function_->blocks.size());
+    function_->blocks.push_back(block);
+    return block.id;
+}
+
+void IRBuilder::addEdge(int from, int to) {
+    function_->blocks[from].succs.push_back(to);
+    function_->blocks[to].preds.push_back(from);
+}
+
+/**
+ * 封闭块：块的前驱已全部确定，补齐未完成的 phi
+ */
+void IRBuilder::sealBlock(int block) {
+    auto it = incomplete_phis_.find(block);
+    if (it != incomplete_phis_.end()) {
+        std::map<std::string, int> phis = it->second;
+        incomplete_phis_.erase(it);
+        for (const auto& entry : phis) {
+            addPhiOperands(entry.first, block, entry.second);
+        }
+    }
+    sealed_.insert(block);
+}
+
+bool IRBuilder::isTerminated() const {
+    const auto& instructions = function_->blocks[current_].instructions;
+    return !instructions.empty() && instructions.back().isTerminator();
+}
+
+/**
+ * return/break/continue 之后的语句放入没有前驱的新块，构造完成后删除
+ */
+void IRBuilder::startUnreachableBlock() {
+    current_ = newBlock();
+    sealBlock(current_);
+}
+
+IRValue IRBuilder::emit(IRInstruction inst, bool has_result) {
+    if (has_result) {
+        inst.result = function_->register_count++;
+    }
+    inst.line = current_line_;
+    int result = inst.result;
+    function_->blocks[current_].instructions.push_back(std::move(inst));
+    return has_result ? IRValue::makeReg(result) : IRValue();
+}
+
+void IRBuilder::emitBranch(int target) {
+    IRInstruction inst;
+    inst.opcode = IROpcode::BR;
+    inst.targets.push_back(target);
+    emit(inst, false);
+    addEdge(current_, target);
+}
+
+void IRBuilder::emitCondBranch(const IRValue& cond, int if_true, int if_false) {
+    IRInstruction inst;
+    inst.opcode = IROpcode::COND_BR;
+    inst.operands.push_back(cond);
+    inst.targets.push_back(if_true);
+    inst.targets.push_back(if_false);
+    emit(inst, false);
+    addEdge(current_, if_true);
+    addEdge(current_, if_false);
+}
+
+// SSA 变量
+
+void IRBuilder::writeVariable(const std::string& var, int block, const IRValue& value) {
+    current_def_[block][var] = value;
+}
+
+IRValue IRBuilder::readVariable(const std::string& var, int block) {
+    auto block_defs = current_def_.find(block);
+    if (block_defs != current_def_.end()) {
+        auto def = block_defs->second.find(var);
+        if (def != block_defs->second.end()) {
+            return def->second;
+        }
+    }
+    return readVariableRecursive(var, block);
+}
+
+IRValue IRBuilder::readVariableRecursive(const std::string& var, int block) {
+    IRValue value;
+    const auto& preds = function_->blocks[block].preds;
+    if (!sealed_.count(block)) {
+        // 前驱未确定，先放置 phi，封闭时再补齐
+        int phi = insertPhi(block);
+        incomplete_phis_[block][var] = phi;
+        value = IRValue::makeReg(phi);
+    } else if (preds.empty()) {
+        value = IRValue::makeUndef();
+    } else if (preds.size() == 1) {
+        value = readVariable(var, preds[0]);
+    } else {
+        // 先记录 phi 以打破循环中的递归
+        int phi = insertPhi(block);
+        writeVariable(var, block, IRValue::makeReg(phi));
+        value = addPhiOperands(var, block, phi);
+    }
+    writeVariable(var, block, value);
+    return value;
+}
+
+IRValue IRBuilder::addPhiOperands(const std::string& var, int block, int phi) {
+    std::vector<IRValue> operands;
+    std::vector<int> preds = function_->blocks[block].preds;
+    for (int pred : preds) {
+        operands.push_back(readVariable(var, pred));
+    }
+    IRInstruction* inst = findPhi(block, phi);
+    inst->operands = operands;
+    inst->targets = preds;
+    return IRValue::makeReg(phi);
+}
+
+int IRBuilder::insertPhi(int block) {
+    auto& instructions = function_->blocks[block].instructions;
+    size_t pos = 0;
+    while (pos < instructions.size() && instructions[pos].opcode == IROpcode::PHI) {
+        ++pos;
+    }
+    IRInstruction inst;
+    inst.opcode = IROpcode::PHI;
+    inst.result = function_->register_count++;
+    inst.line = current_line_;
+    instructions.insert(instructions.begin() + static_cast<std::ptrdiff_t>(pos), inst);
+    return inst.result;
+}
+
+IRInstruction* IRBuilder::findPhi(int block, int reg) {
+    for (auto& inst : function_->blocks[block].instructions) {
+        if (inst.opcode == IROpcode::PHI && inst.result == reg) {
+            return &inst;
+        }
+    }
+    return nullptr;
+}
+
+// 作用域
+
+const IRBuilder::LocalVar* IRBuilder::lookupLocal(const std::string& name) const {
+    for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) {
+            return &found->second;
+        }
+    }
+    return nullptr;
+}
+
+void IRBuilder::declareLocal(const std::string& name, bool memory) {
+    int count = name_counts_[name]++;
+    LocalVar local;
+    local.ssa_name = count == 0 ? name : name + "." + std::to_string(count);
+    local.memory = memory;
+    scopes_.back()[name] = local;
+}
+
+/**
+ * 内存对象的符号：全局为 @名称，局部为 $名称，非内存对象返回空串
+ */
+std::string IRBuilder::memorySymbol(const std::string& name) const {
+    if (const LocalVar* local = lookupLocal(name)) {
+        return local->memory ? "$" + local->ssa_name : "";
+    }
+    if (name == "this") {
+        return "$this";
+    }
+    if (globals_.count(name)) {
+        return "@" + name;
+    }
+    return "";
+}
+
+// 语句
+
+void IRBuilder::lowerStatements(const ASTNode* node) {
+    for (const auto& child : node->getChildren()) {
+        lowerStatement(child.get());
+    }
+}
+
+void IRBuilder::lowerStatement(const ASTNode* node) {
+    if (!node) {
+        return;
+    }
+    if (node->getLine() > 0) {
+        current_line_ = node->getLine();
+    }
+    
+    switch (node->getType()) {
+        case ASTNodeType::EXPRESSION_STMT:
+            if (node->getChildCount() > 0) {
+                lowerExpr(node->getChild(0));
+            }
+            break;
+        
+        case ASTNodeType::VARIABLE_DECL:
+            lowerDeclaration(node);
+            break;
+        
+        case ASTNodeType::BLOCK_STMT:
+            scopes_.emplace_back();
+            lowerStatements(node);
+            scopes_.pop_back();
+            break;
+        
+        case ASTNodeType::IF_STMT: {
+            IRValue cond = lowerExpr(node->getChild(0));
+            int then_block = newBlock();
+            int merge_block = newBlock();
+            bool has_else = node->getChildCount() > 2;
+            int else_block = has_else ? newBlock() : merge_block;
+            emitCondBranch(cond, then_block, else_block);
+            sealBlock(then_block);
+            if (has_else) {
+                sealBlock(else_block);
+            }
+            
+            current_ = then_block;
+            lowerStatement(node->getChild(1));
+            emitBranch(merge_block);
+            
+            if (has_else) {
+                current_ = else_block;
+                lowerStatement(node->getChild(2));
+                emitBranch(merge_block);
+            }
+            
+            sealBlock(merge_block);
+            current_ = merge_block;
+            break;
+        }
+        
+        case ASTNodeType::WHILE_STMT: {
+            int header = newBlock();
+            emitBranch(header);
+            current_ = header;
+            IRValue cond = lowerExpr(node->getChild(0));
+            int body = newBlock();
+            int exit = newBlock();
+            emitCondBranch(cond, body, exit);
+            sealBlock(body);
+            
+            loops_.push_back({exit, header});
+            current_ = body;
+            lowerStatement(node->getChild(1));
+            emitBranch(header);
+            loops_.pop_back();
+            
+            sealBlock(header);
+            sealBlock(exit);
+            current_ = exit;
+            break;
+        }
+        
+        case ASTNodeType::FOR_STMT: {
+            scopes_.emplace_back();
+            lowerStatement(node->getChild(0));
+            
+            int header = newBlock();
+            emitBranch(header);
+            current_ = header;
+            int body = newBlock();
+            int exit = newBlock();
+            if (isEmptyStatement(node->getChild(1))) {
+                emitBranch(body);
+            } else {
+                IRValue cond = lowerExpr(node->getChild(1));
+                emitCondBranch(cond, body, exit);
+            }
+            sealBlock(body);
+            
+            int latch = newBlock();
+            loops_.push_back({exit, latch});
+            current_ = body;
+            lowerStatement(node->getChild(3));
+            emitBranch(latch);
+            loops_.pop_back();
+            
+            sealBlock(latch);
+            current_ = latch;
+            if (!isEmptyStatement(node->getChild(2))) {
+                lowerExpr(node->getChild(2));
+            }
+            emitBranch(header);
+            
+            sealBlock(header);
+            sealBlock(exit);
+            current_ = exit;
+            scopes_.pop_back();
+            break;
+        }
+        
+        case ASTNodeType::SWITCH_STMT: {
+            // 每个 case 一个块，按顺序排列以便贯穿；break 跳到 switch 之后，continue 属于外层循环
+            IRInstruction inst;
+            inst.opcode = IROpcode::SWITCH;
+            inst.operands.push_back(lowerExpr(node->getChild(0)));
+            int exit = newBlock();
+            inst.targets.push_back(exit);
+            std::vector<int> case_blocks;
+            for (size_t i = 1; i < node->getChildCount(); ++i) {
+                case_blocks.push_back(newBlock());
+                long long value = 0;
+                if (SwitchLowering::caseValue(node->getChild(i), value)) {
+                    inst.operands.push_back(IRValue::makeInt(value));
+                    inst.targets.push_back(case_blocks.back());
+                } else if (inst.targets[0] == exit) {
+                    inst.targets[0] = case_blocks.back();
+                }
+            }
+            std::vector<int> targets = inst.targets;
+            emit(inst, false);
+            for (int target : targets) {
+                addEdge(current_, target);
+            }
+            
+            loops_.push_back({exit, loops_.empty() ? -1 : loops_.back().continue_block});
+            for (size_t i = 0; i < case_blocks.size(); ++i) {
+                if (i > 0) {
+                    emitBranch(case_blocks[i]);
+                }
+                sealBlock(case_blocks[i]);
+                current_ = case_blocks[i];
+                const ASTNode* case_stmt = node->getChild(i + 1);
+                lowerStatement(case_stmt->getChild(case_stmt->getChildCount() - 1));
+            }
+            emitBranch(exit);
+            loops_.pop_back();
+            
+            sealBlock(exit);
+            current_ = exit;
+            break;
+        }
+        
+        case ASTNodeType::RETURN_STMT: {
+            IRInstruction ret;
+            ret.opcode = IROpcode::RET;
+            if (node->getChildCount() > 0) {
+                ret.operands.push_back(lowerExpr(node->getChild(0)));
+            }
+            emit(ret, false);
+            startUnreachableBlock();
+            break;
+        }
+        
+        case ASTNodeType::BREAK_STMT:
+        case ASTNodeType::CONTINUE_STMT: {
+            if (loops_.empty()) {
+                errors_.push_back("行 " + std::to_string(node->getLine()) + ": 循环之外的 break/continue");
+                break;
+            }
+            const LoopTargets& loop = loops_.back();
+            int target = node->getType() == ASTNodeType::BREAK_STMT ? loop.break_block : loop.continue_block;
+            if (target < 0) {
+                errors_.push_back("行 " + std::to_string(node->getLine()) + ": 循环之外的 continue");
+                break;
+            }
+            emitBranch(target);
+            startUnreachableBlock();
+            break;
+        }
+        
+        default:
+            errors_.push_back("行 " + std::to_string(node->getLine()) + ": IR 不支持的语句");
+            break;
+    }
+}
+
+void IRBuilder::lowerDeclaration(const ASTNode* node) {
+    const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+    bool memory = decl->getArraySize() != 0 || decl->getVarType() == "message";
+    
+    if (memory) {
+        declareLocal(decl->getName(), true);
+        IRInstruction inst;
+        inst.opcode = IROpcode::ALLOCA;
+        inst.symbol = memorySymbol(decl->getName());
+        inst.type = decl->getVarType();
+        inst.array_size = decl->getArraySize();
+        emit(inst, false);
+        return;
+    }
+    
+    // 初始化表达式在变量声明之前求值，其中的同名变量指外层变量
+    IRValue value;
+    if (decl->getInitializer()) {
+        value = lowerExpr(decl->getInitializer());
+    } else if (decl->getVarType() == "float") {
+        value = IRValue::makeFloat(0.0, "0.0");
+    } else {
+        value = IRValue::makeInt(0);
+    }
+    declareLocal(decl->getName(), false);
+    writeVariable(lookupLocal(decl->getName())->ssa_name, current_, value);
+}
+
+// 表达式
+
+IRValue IRBuilder::lowerExpr(const ASTNode* node) {
+    if (!node) {
+        return IRValue::makeUndef();
+    }
+    
+    switch (node->getType()) {
+        case ASTNodeType::INTEGER_LITERAL: {
+            const std::string& text = static_cast<const LiteralNode*>(node)->getValue();
+            try {
+                return IRValue::makeInt(std::stoll(text, nullptr, 0));
+            } catch (const std::exception&) {
+                errors_.push_back("行 " + std::to_string(node->getLine()) + ": 无效的整数常量 " + text);
+                return IRValue::makeUndef();
+            }
+        }
+        
+        case ASTNodeType::FLOAT_LITERAL: {
+            const std::string& text = static_cast<const LiteralNode*>(node)->getValue();
+            try {
+                return IRValue::makeFloat(std::stod(text), text);
+            } catch (const std::exception&) {
+                errors_.push_back("行 " + std::to_string(node->getLine()) + ": 无效的浮点常量 " + text);
+                return IRValue::makeUndef();
+            }
+        }
+        
+        case ASTNodeType::STRING_LITERAL:
+            return IRValue::makeString(static_cast<const LiteralNode*>(node)->getValue());
+        
+        case ASTNodeType::CHAR_LITERAL: {
+            const std::string& text = static_cast<const LiteralNode*>(node)->getValue();
+            return IRValue::makeInt(text.empty() ? 0 : static_cast<unsigned char>(text[0]));
+        }
+        
+        case ASTNodeType::IDENTIFIER: {
+            const std::string& name = static_cast<const IdentifierNode*>(node)->getName();
+            if (const LocalVar* local = lookupLocal(name)) {
+                if (local->memory) {
+                    return IRValue::makeSymbol(memorySymbol(name));
+                }
+                return readVariable(local->ssa_name, current_);
+            }
+            auto global = globals_.find(name);
+            if (global != globals_.end()) {
+                if (global->second.array_size != 0 || global->second.type == "message") {
+                    return IRValue::makeSymbol("@" + name);
+                }
+                IRInstruction inst;
+                inst.opcode = IROpcode::LOAD;
+                inst.symbol = "@" + name;
+                return emit(inst, true);
+            }
+            if (name == "this") {
+                return IRValue::makeSymbol("$this");
+            }
+            // 定时器等非值符号
+            return IRValue::makeSymbol(name);
+        }
+        
+        case ASTNodeType::BINARY_EXPR: {
+            const std::string& op = static_cast<const BinaryExprNode*>(node)->getOperator();
+            if (op == "&&" || op == "||") {
+                return lowerShortCircuit(node, op == "&&");
+            }
+            IRInstruction inst;
+            inst.opcode = IROpcode::BINARY;
+            inst.name = op;
+            inst.operands.push_back(lowerExpr(node->getChild(0)));
+            inst.operands.push_back(lowerExpr(node->getChild(1)));
+            return emit(inst, true);
+        }
+        
+        case ASTNodeType::UNARY_EXPR: {
+            const UnaryExprNode* unary = static_cast<const UnaryExprNode*>(node);
+            const std::string& op = unary->getOperator();
+            if (op == "++" || op == "--") {
+                LValue target = lowerLValue(node->getChild(0));
+                IRValue old_value = loadLValue(target, node->getLine());
+                IRInstruction inst;
+                inst.opcode = IROpcode::BINARY;
+                inst.name = op == "++" ? "+" : "-";
+                inst.operands.push_back(old_value);
+                inst.operands.push_back(IRValue::makeInt(1));
+                IRValue new_value = emit(inst, true);
+                storeLValue(target, new_value, node->getLine());
+                return unary->isPostfix() ? old_value : new_value;
+            }
+            IRInstruction inst;
+            inst.opcode = IROpcode::UNARY;
+            inst.name = op;
+            inst.operands.push_back(lowerExpr(node->getChild(0)));
+            return emit(inst, true);
+        }
+        
+        case ASTNodeType::ASSIGNMENT_EXPR: {
+            const std::string& op = static_cast<const AssignmentExprNode*>(node)->getOperator();
+            LValue target = lowerLValue(node->getChild(0));
+            IRValue value = lowerExpr(node->getChild(1));
+            if (op != "=") {
+                IRInstruction inst;
+                inst.opcode = IROpcode::BINARY;
+                inst.name = op.substr(0, op.size() - 1);
+                inst.operands.push_back(loadLValue(target, node->getLine()));
+                inst.operands.push_back(value);
+                value = emit(inst, true);
+            }
+            storeLValue(target, value, node->getLine());
+            return value;
+        }
+        
+        case ASTNodeType::CALL_EXPR:
+            return lowerCall(node);
+        
+        case ASTNodeType::MEMBER_EXPR:
+        case ASTNodeType::INDEX_EXPR:
+            return loadLValue(lowerLValue(node), node->getLine());
+        
+        case ASTNodeType::CONDITIONAL_EXPR:
+            return lowerConditional(node);
+        
+        case ASTNodeType::SIGNAL_ACCESS: {
+            // $信号 读取最近收到的该报文中的信号字段
+            const SignalAccessNode* signal = static_cast<const SignalAccessNode*>(node);
+            IRInstruction inst;
+            inst.opcode = IROpcode::LOAD_FIELD;
+            inst.line = node->getLine();
+            inst.symbol = "@capl_rx_" + signal->getInfo().message;
+            inst.name = signal->getName().substr(signal->getName().rfind(':') + 1);
+            return emit(inst, true);
+        }
+        
+        default:
+            errors_.push_back("行 " + std::to_string(node->getLine()) + ": IR 不支持的表达式");
+            return IRValue::makeUndef();
+    }
+}
+
+/**
+ * 短路求值：a && b 为 a ? (b != 0) : 0，a || b 为 a ? 1 : (b != 0)
+ */
+IRValue IRBuilder::lowerShortCircuit(const ASTNode* node, bool is_and) {
+    IRValue lhs = lowerExpr(node->getChild(0));
+    int lhs_block = current_;
+    int rhs_block = newBlock();
+    int merge_block = newBlock();
+    if (is_and) {
+        emitCondBranch(lhs, rhs_block, merge_block);
+    } else {
+        emitCondBranch(lhs, merge_block, rhs_block);
+    }
+    sealBlock(rhs_block);
+    
+    current_ = rhs_block;
+    IRInstruction normalize;
+    normalize.opcode = IROpcode::BINARY;
+    normalize.name = "!=";
+    normalize.operands.push_back(lowerExpr(node->getChild(1)));
+    normalize.operands.push_back(IRValue::makeInt(0));
+    IRValue rhs = emit(normalize, true);
+    int rhs_end = current_;
+    emitBranch(merge_block);
+    
+    sealBlock(merge_block);
+    current_ = merge_block;
+    int phi = insertPhi(merge_block);
+    IRInstruction* inst = findPhi(merge_block, phi);
+    inst->operands = {IRValue::makeInt(is_and ? 0 : 1), rhs};
+    inst->targets = {lhs_block, rhs_end};
+    return IRValue::makeReg(phi);
+}
+
+IRValue IRBuilder::lowerConditional(const ASTNode* node) {
+    IRValue cond = lowerExpr(node->getChild(0));
+    int true_block = newBlock();
+    int false_block = newBlock();
+    int merge_block = newBlock();
+    emitCondBranch(cond, true_block, false_block);
+    sealBlock(true_block);
+    sealBlock(false_block);
+    
+    current_ = true_block;
+    IRValue true_value = lowerExpr(node->getChild(1));
+    int true_end = current_;
+    emitBranch(merge_block);
+    
+    current_ = false_block;
+    IRValue false_value = lowerExpr(node->getChild(2));
+    int false_end = current_;
+    emitBranch(merge_block);
+    
+    sealBlock(merge_block);
+    current_ = merge_block;
+    int phi = insertPhi(merge_block);
+    IRInstruction* inst = findPhi(merge_block, phi);
+    inst->operands = {true_value, false_value};
+    inst->targets = {true_end, false_end};
+    return IRValue::makeReg(phi);
+}
+
+IRValue IRBuilder::lowerCall(const ASTNode* node) {
+    const std::string& name = static_cast<const CallExprNode*>(node)->getFunctionName();
+    IRInstruction inst;
+    inst.opcode = IROpcode::CALL;
+    inst.name = name;
+    for (const auto& arg : node->getChildren()) {
+        inst.operands.push_back(lowerExpr(arg.get()));
+    }
+    
+    auto user = function_types_.find(name);
+    bool has_result = user != function_types_.end() ? user->second != "void" : !isVoidBuiltin(name);
+    return emit(inst, has_result);
+}
+
+/**
+ * 求值赋值目标：局部标量、内存对象（可带下标）或报文字段（可带字段下标）
+ */
+IRBuilder::LValue IRBuilder::lowerLValue(const ASTNode* node) {
+    LValue lvalue;
+    if (!node) {
+        return lvalue;
+    }
+    
+    switch (node->getType()) {
+        case ASTNodeType::IDENTIFIER: {
+            const std::string& name = static_cast<const IdentifierNode*>(node)->getName();
+            const LocalVar* local = lookupLocal(name);
+            if (local && !local->memory) {
+                lvalue.kind = LValue::Kind::VARIABLE;
+                lvalue.name = local->ssa_name;
+            } else if (!memorySymbol(name).empty()) {
+                lvalue.kind = LValue::Kind::MEMORY;
+                lvalue.name = memorySymbol(name);
+            }
+            break;
+        }
+        
+        case ASTNodeType::INDEX_EXPR: {
+            const ASTNode* base = node->getChild(0);
+            if (base && base->getType() == ASTNodeType::IDENTIFIER) {
+                std::string symbol = memorySymbol(static_cast<const IdentifierNode*>(base)->getName());
+                if (!symbol.empty()) {
+                    lvalue.kind = LValue::Kind::MEMORY;
+                    lvalue.name = symbol;
+                    lvalue.has_index = true;
+                    lvalue.index = lowerExpr(node->getChild(1));
+                }
+            } else if (base && base->getType() == ASTNodeType::MEMBER_EXPR &&
+                       !static_cast<const MemberExprNode*>(base)->isCall()) {
+                // msg.data[i]
+                lvalue = lowerLValue(base);
+                if (lvalue.kind == LValue::Kind::FIELD && !lvalue.has_field_index) {
+                    lvalue.has_field_index = true;
+                    lvalue.field_index = lowerExpr(node->getChild(1));
+                } else {
+                    lvalue.kind = LValue::Kind::INVALID;
+                }
+            }
+            break;
+        }
+        
+        case ASTNodeType::MEMBER_EXPR: {
+            const MemberExprNode* member = static_cast<const MemberExprNode*>(node);
+            const ASTNode* object = node->getChild(0);
+            if (object && object->getType() == ASTNodeType::INDEX_EXPR) {
+                // msg_buffer[i].id
+                LValue element = lowerLValue(object);
+                if (element.kind == LValue::Kind::MEMORY) {
+                    lvalue = element;
+                }
+            } else if (object && object->getType() == ASTNodeType::IDENTIFIER) {
+                std::string symbol = memorySymbol(static_cast<const IdentifierNode*>(object)->getName());
+                if (!symbol.empty()) {
+                    lvalue.name = symbol;
+                }
+            }
+            if (lvalue.name.empty()) {
+                lvalue.kind = LValue::Kind::INVALID;
+                break;
+            }
+            lvalue.kind = LValue::Kind::FIELD;
+            lvalue.field = member->getMember();
+            if (member->isCall() && node->getChildCount() > 1) {
+                lvalue.has_field_index = true;
+                lvalue.field_index = lowerExpr(node->getChild(1));
+            }
+            break;
+        }
+        
+        default:
+            break;
+    }
+    
+    if (lvalue.kind == LValue::Kind::INVALID) {
+        errors_.push_back("行 " + std::to_string(node->getLine()) + ": IR 不支持的访问目标");
+    }
+    return lvalue;
+}
+
+IRValue IRBuilder::loadLValue(const LValue& lvalue, int line) {
+    IRInstruction inst;
+    inst.line = line;
+    switch (lvalue.kind) {
+        case LValue::Kind::VARIABLE:
+            return readVariable(lvalue.name, current_);
+        case LValue::Kind::MEMORY:
+            inst.opcode = IROpcode::LOAD;
+            break;
+        case LValue::Kind::FIELD:
+            inst.opcode = IROpcode::LOAD_FIELD;
+            inst.name = lvalue.field;
+            break;
+        default:
+            return IRValue::makeUndef();
+    }
+    inst.symbol = lvalue.name;
+    inst.has_index = lvalue.has_index;
+    if (lvalue.has_index) {
+        inst.operands.push_back(lvalue.index);
+    }
+    inst.has_field_index = lvalue.has_field_index;
+    if (lvalue.has_field_index) {
+        inst.operands.push_back(lvalue.field_index);
+    }
+    return emit(inst, true);
+}
+
+void IRBuilder::storeLValue(const LValue& lvalue, const IRValue& value, int line) {
+    IRInstruction inst;
+    inst.line = line;
+    switch (lvalue.kind) {
+        case LValue::Kind::VARIABLE:
+            writeVariable(lvalue.name, current_, value);
+            return;
+        case LValue::Kind::MEMORY:
+            inst.opcode = IROpcode::STORE;
+            break;
+        case LValue::Kind::FIELD:
+            inst.opcode = IROpcode::STORE_FIELD;
+            inst.name = lvalue.field;
+            break;
+        default:
+            return;
+    }
+    inst.symbol = lvalue.name;
+    inst.has_index = lvalue.has_index;
+    if (lvalue.has_index) {
+        inst.operands.push_back(lvalue.index);
+    }
+    inst.has_field_index = lvalue.has_field_index;
+    if (lvalue.has_field_index) {
+        inst.operands.push_back(lvalue.field_index);
+    }
+    inst.operands.push_back(value);
+    emit(inst, false);
+}
+
+// 构造完成后的清理
+
+void IRBuilder::removeUnreachableBlocks() {
+    auto& blocks = function_->blocks;
+    std::vector<bool> reachable(blocks.size(), false);
+    std::queue<int> work;
+    work.push(0);
+    reachable[0] = true;
+    while (!work.empty()) {
+        int block = work.front();
+        work.pop();
+        for (int succ : blocks[block].succs) {
+            if (!reachable[succ]) {
+                reachable[succ] = true;
+                work.push(succ);
+            }
+        }
+    }
+    
+    // 新编号
+    std::vector<int> new_id(blocks.size(), -1);
+    int count = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (reachable[b]) {
+            new_id[b] = count++;
+        }
+    }
+    if (count == static_cast<int>(blocks.size())) {
+        return;
+    }
+    
+    std::vector<IRBasicBlock> kept;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!reachable[b]) {
+            continue;
+        }
+        IRBasicBlock block = std::move(blocks[b]);
+        block.id = new_id[b];
+        
+        // 删除来自不可达前驱的边和 phi 来源
+        for (auto& inst : block.instructions) {
+            if (inst.opcode != IROpcode::PHI) {
+                continue;
+            }
+            std::vector<IRValue> operands;
+            std::vector<int> targets;
+            for (size_t i = 0; i < inst.targets.size(); ++i) {
+                if (reachable[inst.targets[i]]) {
+                    operands.push_back(inst.operands[i]);
+                    targets.push_back(new_id[inst.targets[i]]);
+                }
+            }
+            inst.operands = operands;
+            inst.targets = targets;
+        }
+        std::vector<int> preds;
+        for (int pred : block.preds) {
+            if (reachable[pred]) {
+                preds.push_back(new_id[pred]);
+            }
+        }
+        block.preds = preds;
+        for (auto& succ : block.succs) {
+            succ = new_id[succ];
+        }
+        if (!block.instructions.empty() && block.instructions.back().isTerminator() &&
+            block.instructions.back().opcode != IROpcode::RET) {
+            for (auto& target : block.instructions.back().targets) {
+                target = new_id[target];
+            }
+        }
+        kept.push_back(std::move(block));
+    }
+    blocks = std::move(kept);
+}
+
+/**
+ * 删除所有来源相同（忽略自身）的 phi，用该来源替换其使用
+ */
+void IRBuilder::removeTrivialPhis() {
+    std::map<int, IRValue> replacement;
+    auto resolve = [&](IRValue value) {
+        while (value.isReg()) {
+            auto it = replacement.find(value.reg);
+            if (it == replacement.end()) {
+                break;
+            }
+            value = it->second;
+        }
+        return value;
+    };
+    
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& block : function_->blocks) {
+            for (auto& inst : block.instructions) {
+                if (inst.opcode != IROpcode::PHI || replacement.count(inst.result)) {
+                    continue;
+                }
+                bool trivial = true;
+                bool has_same = false;
+                IRValue same;
+                for (const auto& operand : inst.operands) {
+                    IRValue value = resolve(operand);
+                    if (value.isReg() && value.reg == inst.result) {
+                        continue;
+                    }
+                    if (!has_same) {
+                        same = value;
+                        has_same = true;
+                    } else if (value != same) {
+                        trivial = false;
+                        break;
+                    }
+                }
+                if (trivial) {
+                    replacement[inst.result] = has_same ? same : IRValue::makeUndef();
+                    changed = true;
+                }
+            }
+        }
+    }
+    
+    for (auto& block : function_->blocks) {
+        auto& instructions = block.instructions;
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(),
+                                          [&](const IRInstruction& inst) {
+                                              return inst.opcode == IROpcode::PHI && replacement.count(inst.result);
+                                          }),
+                           instructions.end());
+        for (auto& inst : instructions) {
+            for (auto& operand : inst.operands) {
+                operand = resolve(operand);
+            }
+        }
+    }
+}
+
+/**
+ * 按指令顺序重新连续编号寄存器
+ */
+void IRBuilder::renumberRegisters() {
+    std::map<int, int> new_reg;
+    int count = 0;
+    for (const auto& block : function_->blocks) {
+        for (const auto& inst : block.instructions) {
+            if (inst.result >= 0) {
+                new_reg[inst.result] = count++;
+            }
+        }
+    }
+    for (auto& block : function_->blocks) {
+        for (auto& inst : block.instructions) {
+            if (inst.result >= 0) {
+                inst.result = new_reg[inst.result];
+            }
+            for (auto& operand : inst.operands) {
+                if (operand.isReg()) {
+                    auto it = new_reg.find(operand.reg);
+                    // 未找到说明引用了已删除的指令，留给验证器报告
+                    operand.reg = it != new_reg.end() ? it->second : count + operand.reg;
+                }
+            }
+        }
+    }
+    function_->register_count = count;
+}
+
+} // namespace capl
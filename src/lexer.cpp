@@ -196,6 +196,31 @@ Token Lexer::nextToken() {
         return Token(TokenType::CHAR, charLiteral, line_, start_column);
     }
     
+    // 处理信号引用 $EngineSpeed 和 $EngineData::EngineSpeed，值不含 $
+    if (current == '$' && position_ + 1 < source_.length() &&
+        (std::isalpha(source_[position_ + 1]) || source_[position_ + 1] == '_')) {
+        std::string name;
+        position_++;
+        column_++;
+        while (position_ < source_.length()) {
+            char c = source_[position_];
+            if (std::isalnum(c) || c == '_') {
+                name += c;
+            } else if (c == ':' && position_ + 2 < source_.length() && source_[position_ + 1] == ':' &&
+                       (std::isalpha(source_[position_ + 2]) || source_[position_ + 2] == '_') &&
+                       name.find(':') == std::string::npos) {
+                name += "::";
+                position_++;
+                column_++;
+            } else {
+                break;
+            }
+            position_++;
+            column_++;
+        }
+        return Token(TokenType::SIGNAL_REF, name, line_, start_column);
+    }
+    
     // 处理单字符 token
     position_++;
     column_++;
@@ -207,6 +232,11 @@ Token Lexer::nextToken() {
                 column_++;
                 return Token(TokenType::INCREMENT, "++", line_, start_column);
             }
+            if (position_ < source_.length() && source_[position_] == '=') {
+                position_++;
+                column_++;
+                return Token(TokenType::PLUS_ASSIGN, "+=", line_, start_column);
+            }
             return Token(TokenType::PLUS, "+", line_, start_column);
         case '-':
             if (position_ < source_.length() && source_[position_] == '-') {
@@ -214,9 +244,19 @@ Token Lexer::nextToken() {
                 column_++;
                 return Token(TokenType::DECREMENT, "--", line_, start_column);
             }
+            if (position_ < source_.length() && source_[position_] == '=') {
+                position_++;
+                column_++;
+                return Token(TokenType::MINUS_ASSIGN, "-=", line_, start_column);
+            }
             return Token(TokenType::MINUS, "-", line_, start_column);
         case '*': return Token(TokenType::MULTIPLY, "*", line_, start_column);
         case '/': return Token(TokenType::DIVIDE, "/", line_, start_column);
+        case '%': return Token(TokenType::MODULO, "%", line_, start_column);
+        case '^': return Token(TokenType::BITWISE_XOR, "^", line_, start_column);
+        case '~': return Token(TokenType::BITWISE_NOT, "~", line_, start_column);
+        case '?': return Token(TokenType::QUESTION, "?", line_, start_column);
+        case ':': return Token(TokenType::COLON, ":", line_, start_column);
         case '=': 
             if (position_ < source_.length() && source_[position_] == '=') {
                 position_++;
@@ -237,6 +277,11 @@ Token Lexer::nextToken() {
                 column_++;
                 return Token(TokenType::LESS_EQUAL, "<=", line_, start_column);
             }
+            if (position_ < source_.length() && source_[position_] == '<') {
+                position_++;
+                column_++;
+                return Token(TokenType::LEFT_SHIFT, "<<", line_, start_column);
+            }
             return Token(TokenType::LESS, "<", line_, start_column);
         case '>':
             if (position_ < source_.length() && source_[position_] == '=') {
@@ -244,6 +289,11 @@ Token Lexer::nextToken() {
                 column_++;
                 return Token(TokenType::GREATER_EQUAL, ">=", line_, start_column);
             }
+            if (position_ < source_.length() && source_[position_] == '>') {
+                position_++;
+                column_++;
+                return Token(TokenType::RIGHT_SHIFT, ">>", line_, start_column);
+            }
             return Token(TokenType::GREATER, ">", line_, start_column);
         case '&':
             if (position_ < source_.length() && source_[position_] == '&') {
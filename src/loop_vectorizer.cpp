@@ -0,0 +1,323 @@
+/**
+ * CAPL 可向量化循环识别实现
+ */
+
+#include "../include/loop_vectorizer.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include "../include/profile_data.h"
+#include <functional>
+#include <set>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 可在向量寄存器中运算的数值类型
+ */
+bool isNumericType(const std::string& type) {
+    static const std::set<std::string> types = {
+        "int", "long", "float", "double", "char", "byte", "word", "dword", "int64", "qword"
+    };
+    return types.count(type) > 0;
+}
+
+bool isIdentifier(const ASTNode* node, const std::string& name) {
+    return node && node->getType() == ASTNodeType::IDENTIFIER &&
+           static_cast<const IdentifierNode*>(node)->getName() == name;
+}
+
+bool constantInt(const ASTNode* node, long long& value) {
+    ConstantValue constant;
+    if (!node || !evaluateConstant(node, constant) || constant.is_float) {
+        return false;
+    }
+    value = constant.int_value;
+    return true;
+}
+
+void collectDecls(const ASTNode* node, std::map<std::string, const ASTNode*>& decls,
+                  std::map<std::string, int>& counts) {
+    if (node->getType() == ASTNodeType::VARIABLE_DECL) {
+        const std::string& name = static_cast<const VariableDeclNode*>(node)->getName();
+        decls[name] = node;
+        counts[name]++;
+    }
+    for (const auto& child : node->getChildren()) {
+        collectDecls(child.get(), decls, counts);
+    }
+}
+
+} // namespace
+
+/**
+ * 构造函数
+ */
+LoopVectorizer::LoopVectorizer() {
+}
+
+/**
+ * 识别程序中的可向量化循环
+ * @param program AST 根节点
+ */
+void LoopVectorizer::analyze(const ASTNode* program) {
+    clear();
+    if (!program) {
+        return;
+    }
+    
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                globals_[static_cast<const VariableDeclNode*>(var.get())->getName()] = var.get();
+            }
+        }
+    }
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::FUNCTION) {
+            analyzeUnit(child.get(), static_cast<const FunctionNode*>(child.get())->getName());
+        } else if (child->getType() != ASTNodeType::BLOCK_STMT && isStatementList(child.get())) {
+            analyzeUnit(child.get(), static_cast<const OnEventNode*>(child.get())->getDisplayName());
+        }
+    }
+}
+
+/**
+ * 清空识别结果
+ */
+void LoopVectorizer::clear() {
+    globals_.clear();
+    locals_.clear();
+    local_counts_.clear();
+    loops_.clear();
+    index_.clear();
+}
+
+/**
+ * 查找 for 语句对应的可向量化循环
+ * @param for_node FOR_STMT 节点
+ * @return 循环信息，不可向量化时返回 nullptr
+ */
+const VectorLoop* LoopVectorizer::findLoop(const ASTNode* for_node) const {
+    auto it = index_.find(for_node);
+    return it != index_.end() ? &loops_[it->second] : nullptr;
+}
+
+void LoopVectorizer::analyzeUnit(const ASTNode* unit, const std::string& unit_name) {
+    locals_.clear();
+    local_counts_.clear();
+    collectDecls(unit, locals_, local_counts_);
+    if (unit->getType() == ASTNodeType::FUNCTION) {
+        for (const auto& param : static_cast<const FunctionNode*>(unit)->getParameters()) {
+            collectDecls(param.get(), locals_, local_counts_);
+        }
+    }
+    visit(unit, unit_name);
+}
+
+void LoopVectorizer::visit(const ASTNode* node, const std::string& unit_name) {
+    if (node->getType() == ASTNodeType::FOR_STMT) {
+        VectorLoop loop;
+        if (matchLoop(node, loop)) {
+            loop.node = node;
+            loop.unit = unit_name;
+            loop.kernel_name = "capl_loop_" + std::to_string(loops_.size() + 1);
+            long long trips = loop.getTripCount();
+            Heat heat = profile_ ? profile_->getHeat(unit_name) : Heat::Unknown;
+            if (heat == Heat::Cold) {
+                loop.unroll = 1;
+                loop.clones = false;
+            } else if (heat == Heat::Hot) {
+                loop.unroll = trips <= kHotFullUnrollLimit ? static_cast<int>(trips) : kHotPartialUnroll;
+                loop.clones = trips >= kCloneThreshold;
+            } else {
+                loop.unroll = trips <= kFullUnrollLimit ? static_cast<int>(trips) : kPartialUnroll;
+                loop.clones = trips >= kCloneThreshold;
+            }
+            index_[node] = loops_.size();
+            loops_.push_back(loop);
+            return;
+        }
+    }
+    for (const auto& child : node->getChildren()) {
+        visit(child.get(), unit_name);
+    }
+}
+
+/**
+ * 匹配计数数组循环
+ * @param for_node FOR_STMT 节点
+ * @param loop 匹配结果
+ * @return 是否可向量化
+ */
+bool LoopVectorizer::matchLoop(const ASTNode* for_node, VectorLoop& loop) const {
+    // 初始化：int i = 常量
+    const ASTNode* init = for_node->getChild(0);
+    if (init->getType() != ASTNodeType::VARIABLE_DECL) {
+        return false;
+    }
+    const VariableDeclNode* var = static_cast<const VariableDeclNode*>(init);
+    if ((var->getVarType() != "int" && var->getVarType() != "long") || var->isArray() ||
+        !constantInt(var->getInitializer(), loop.begin)) {
+        return false;
+    }
+    loop.loop_var = var->getName();
+    
+    // 条件：i < 常量 或 i <= 常量
+    const ASTNode* cond = for_node->getChild(1);
+    if (cond->getType() != ASTNodeType::BINARY_EXPR || !isIdentifier(cond->getChild(0), loop.loop_var) ||
+        !constantInt(cond->getChild(1), loop.end)) {
+        return false;
+    }
+    const std::string& cmp = static_cast<const BinaryExprNode*>(cond)->getOperator();
+    if (cmp == "<=") {
+        loop.end += 1;
+    } else if (cmp != "<") {
+        return false;
+    }
+    if (loop.end <= loop.begin) {
+        return false;
+    }
+    // 16 位 int 的循环变量总小于 32767 以上的边界，递增到上限后回绕，循环不会结束
+    if (var->getVarType() == "int" && loop.end > 32767) {
+        return false;
+    }
+    
+    // 更新：i++、++i 或 i += 1
+    const ASTNode* update = for_node->getChild(2);
+    bool step_one = false;
+    if (update->getType() == ASTNodeType::UNARY_EXPR) {
+        step_one = static_cast<const UnaryExprNode*>(update)->getOperator() == "++" &&
+                   isIdentifier(update->getChild(0), loop.loop_var);
+    } else if (update->getType() == ASTNodeType::ASSIGNMENT_EXPR) {
+        long long step = 0;
+        step_one = static_cast<const AssignmentExprNode*>(update)->getOperator() == "+=" &&
+                   isIdentifier(update->getChild(0), loop.loop_var) &&
+                   constantInt(update->getChild(1), step) && step == 1;
+    }
+    if (!step_one) {
+        return false;
+    }
+    
+    // 循环体：a[i] (op)= 表达式
+    const ASTNode* body = for_node->getChild(3);
+    if (body->getChildCount() == 0) {
+        return false;
+    }
+    std::set<std::string> written;
+    std::vector<const ASTNode*> values;
+    for (const auto& stmt : body->getChildren()) {
+        const ASTNode* assign = stmt->getChild(0);
+        if (stmt->getType() != ASTNodeType::EXPRESSION_STMT || !assign ||
+            assign->getType() != ASTNodeType::ASSIGNMENT_EXPR) {
+            return false;
+        }
+        const std::string& op = static_cast<const AssignmentExprNode*>(assign)->getOperator();
+        if (op != "=" && op != "+=" && op != "-=" && op != "*=" && op != "/=") {
+            return false;
+        }
+        const ASTNode* target = assign->getChild(0);
+        if (target->getType() != ASTNodeType::INDEX_EXPR || target->getChild(0)->getType() != ASTNodeType::IDENTIFIER ||
+            !isIdentifier(target->getChild(1), loop.loop_var)) {
+            return false;
+        }
+        written.insert(static_cast<const IdentifierNode*>(target->getChild(0))->getName());
+        values.push_back(target->getChild(0));
+        values.push_back(assign->getChild(1));
+    }
+    
+    // 操作数：数组或不变标量，被写入的数组只能以 i 为下标读取
+    std::set<std::string> seen;
+    bool ok = true;
+    std::function<void(const ASTNode*, bool)> check = [&](const ASTNode* node, bool array_base) {
+        if (!ok) {
+            return;
+        }
+        switch (node->getType()) {
+            case ASTNodeType::INTEGER_LITERAL:
+            case ASTNodeType::FLOAT_LITERAL:
+            case ASTNodeType::CHAR_LITERAL:
+                return;
+            case ASTNodeType::IDENTIFIER: {
+                const std::string& name = static_cast<const IdentifierNode*>(node)->getName();
+                if (name == loop.loop_var && !array_base) {
+                    return;
+                }
+                auto count = local_counts_.find(name);
+                if (count != local_counts_.end() && count->second > 1) {
+                    ok = false;
+                    return;
+                }
+                auto decl_it = locals_.find(name);
+                if (decl_it == locals_.end()) {
+                    decl_it = globals_.find(name);
+                    if (decl_it == globals_.end()) {
+                        ok = false;
+                        return;
+                    }
+                }
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(decl_it->second);
+                bool is_array = decl->getArraySize() != 0;
+                if (is_array != array_base || !isNumericType(decl->getVarType()) || name == loop.loop_var) {
+                    ok = false;
+                    return;
+                }
+                if (seen.insert(name).second) {
+                    LoopOperand operand;
+                    operand.name = name;
+                    operand.capl_type = decl->getVarType();
+                    operand.is_array = is_array;
+                    operand.global = locals_.count(name) == 0;
+                    operand.written = written.count(name) > 0;
+                    loop.operands.push_back(operand);
+                }
+                return;
+            }
+            case ASTNodeType::INDEX_EXPR: {
+                const ASTNode* base = node->getChild(0);
+                if (base->getType() != ASTNodeType::IDENTIFIER) {
+                    ok = false;
+                    return;
+                }
+                if (written.count(static_cast<const IdentifierNode*>(base)->getName()) &&
+                    !isIdentifier(node->getChild(1), loop.loop_var)) {
+                    ok = false;
+                    return;
+                }
+                check(base, true);
+                check(node->getChild(1), false);
+                return;
+            }
+            case ASTNodeType::BINARY_EXPR: {
+                const std::string& op = static_cast<const BinaryExprNode*>(node)->getOperator();
+                if (op != "+" && op != "-" && op != "*" && op != "/") {
+                    ok = false;
+                    return;
+                }
+                check(node->getChild(0), false);
+                check(node->getChild(1), false);
+                return;
+            }
+            case ASTNodeType::UNARY_EXPR: {
+                const std::string& op = static_cast<const UnaryExprNode*>(node)->getOperator();
+                if (op != "-" && op != "+") {
+                    ok = false;
+                    return;
+                }
+                check(node->getChild(0), false);
+                return;
+            }
+            default:
+                ok = false;
+                return;
+        }
+    };
+    for (size_t i = 0; i < values.size() && ok; ++i) {
+        // 偶数位置为被写入数组的名称
+        check(values[i], i % 2 == 0);
+    }
+    return ok;
+}
+
+} // namespace capl
@@ -4,7 +4,10 @@
  * 提供命令行接口来编译 CAPL 源文件
  */
 
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -32,13 +35,23 @@ void showHelp(const char* program_name) {
     std::cout << "  -I, --include <目录>    添加包含目录\n";
     std::cout << "  -D, --define <宏>       定义预处理宏\n";
     std::cout << "  -O, --optimize <级别>   设置优化级别 (0-3)\n";
-    std::cout << "  -g, --debug             生成调试信息\n";
+    std::cout << "  -j, --jobs <N>          代码生成的线程数 (默认等于 CPU 核数)\n";
+    std::cout << "  -g, --debug             生成调试信息（保留所有数组下标检查）\n";
     std::cout << "  -w, --warnings          显示警告 (默认)\n";
     std::cout << "  -W, --no-warnings       不显示警告\n";
     std::cout << "  -E, --preprocess-only   仅进行预处理\n";
     std::cout << "  -S, --syntax-only       仅进行语法检查\n";
     std::cout << "      --ast-dump          输出抽象语法树\n";
     std::cout << "      --tokens-dump       输出词法分析结果\n";
+    std::cout << "      --cost-report       输出事件处理器开销估算报告\n";
+    std::cout << "      --cost-budget <N>   每个事件处理器的操作数预算，超出时警告 (默认 10000，0 不检查)\n";
+    std::cout << "      --layout-report     输出全局状态内存布局报告\n";
+    std::cout << "      --pass-stats        输出每个优化遍的运行次数、修改数和耗时\n";
+    std::cout << "      --ir-dump           输出 SSA 中间表示\n";
+    std::cout << "      --verify-ir         构造并验证 SSA 中间表示\n";
+    std::cout << "      --profile-generate[=<文件>]  生成插桩程序，退出时把处理器和分支计数写入剖析文件 (默认 capl.profile)\n";
+    std::cout << "      --profile-use <文件>  按剖析文件优化热点和冷处理器\n";
+    std::cout << "      --shards <N>        输出共用头文件和 N 个 .cpp 分片，供下游并行编译\n";
     std::cout << "\n";
     std::cout << "示例:\n";
     std::cout << "  " << program_name << " test.can\n";
@@ -70,6 +83,16 @@ struct CompilerOptions {
     bool syntax_only = false;               // 仅语法检查
     bool dump_ast = false;                  // 输出 AST
     bool dump_tokens = false;               // 输出 Token
+    bool cost_report = false;               // 输出开销报告
+    long long cost_budget = -1;             // 开销预算 (-1 使用默认值)
+    bool layout_report = false;             // 输出状态布局报告
+    bool pass_stats = false;                // 输出优化遍统计
+    bool ir_dump = false;                   // 输出 SSA 中间表示
+    bool verify_ir = false;                 // 验证 SSA 中间表示
+    std::string profile_generate;           // 插桩程序写入的剖析文件
+    std::string profile_use;                // 编译时使用的剖析文件
+    int jobs = 0;                           // 代码生成的线程数 (0 使用 CPU 核数)
+    int shards = 0;                         // 输出的分片数 (0 输出单个文件)
 };
 
 /**
@@ -96,6 +119,25 @@ bool fileExists(const std::string& filepath) {
     return file.good();
 }
 
+/**
+ * 解析整数选项的值，整个参数必须是范围内的十进制整数
+ * @param text 参数文本
+ * @param min 最小值
+ * @param max 最大值
+ * @param value 输出的值
+ * @return 是否有效
+ */
+bool parseInteger(const char* text, long long min, long long max, long long& value) {
+    errno = 0;
+    char* end = nullptr;
+    long long result = std::strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || result < min || result > max) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
 /**
  * 解析命令行参数
  * @param argc 参数数量
@@ -118,13 +160,25 @@ bool parseCommandLine(int argc, char* argv[], CompilerOptions& options) {
         {"syntax-only",     no_argument,       0, 'S'},
         {"ast-dump",        no_argument,       0, 1000},
         {"tokens-dump",     no_argument,       0, 1001},
+        {"cost-report",     no_argument,       0, 1002},
+        {"cost-budget",     required_argument, 0, 1003},
+        {"layout-report",   no_argument,       0, 1004},
+        {"pass-stats",      no_argument,       0, 1005},
+        {"ir-dump",         no_argument,       0, 1006},
+        {"profile-generate", optional_argument, 0, 1007},
+        {"profile-use",     required_argument, 0, 1008},
+        {"jobs",            required_argument, 0, 'j'},
+        {"shards",          required_argument, 0, 1009},
+        {"verify-ir",       no_argument,       0, 1010},
         {0, 0, 0, 0}
     };
     
     int option_index = 0;
     int c;
+    long long value = 0;
+    const long long kIntMax = std::numeric_limits<int>::max();
     
-    while ((c = getopt_long(argc, argv, "hvo:I:D:O:gwWES", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "hvo:I:D:O:gwWESj:", long_options, &option_index)) != -1) {
         switch (c) {
             case 'h':
                 showHelp(argv[0]);
@@ -147,11 +201,11 @@ bool parseCommandLine(int argc, char* argv[], CompilerOptions& options) {
                 break;
                 
             case 'O':
-                options.optimize_level = std::stoi(optarg);
-                if (options.optimize_level < 0 || options.optimize_level > 3) {
+                if (!parseInteger(optarg, 0, 3, value)) {
                     std::cerr << "错误: 优化级别必须在 0-3 之间\n";
                     return false;
                 }
+                options.optimize_level = static_cast<int>(value);
                 break;
                 
             case 'g':
@@ -182,6 +236,57 @@ bool parseCommandLine(int argc, char* argv[], CompilerOptions& options) {
                 options.dump_tokens = true;
                 break;
                 
+            case 1002:  // --cost-report
+                options.cost_report = true;
+                break;
+                
+            case 1003:  // --cost-budget
+                if (!parseInteger(optarg, 0, std::numeric_limits<long long>::max(), options.cost_budget)) {
+                    std::cerr << "错误: 开销预算必须为非负整数\n";
+                    return false;
+                }
+                break;
+                
+            case 1004:  // --layout-report
+                options.layout_report = true;
+                break;
+                
+            case 1005:  // --pass-stats
+                options.pass_stats = true;
+                break;
+                
+            case 1006:  // --ir-dump
+                options.ir_dump = true;
+                break;
+                
+            case 1007:  // --profile-generate
+                options.profile_generate = optarg ? optarg : "capl.profile";
+                break;
+                
+            case 1008:  // --profile-use
+                options.profile_use = optarg;
+                break;
+                
+            case 1009:  // --shards
+                if (!parseInteger(optarg, 1, kIntMax, value)) {
+                    std::cerr << "错误: 分片数必须为正整数\n";
+                    return false;
+                }
+                options.shards = static_cast<int>(value);
+                break;
+                
+            case 1010:  // --verify-ir
+                options.verify_ir = true;
+                break;
+                
+            case 'j':
+                if (!parseInteger(optarg, 1, kIntMax, value)) {
+                    std::cerr << "错误: 线程数必须为正整数\n";
+                    return false;
+                }
+                options.jobs = static_cast<int>(value);
+                break;
+                
             case '?':
                 return false;
                 
@@ -191,6 +296,11 @@ bool parseCommandLine(int argc, char* argv[], CompilerOptions& options) {
         }
     }
     
+    if (!options.profile_generate.empty() && !options.profile_use.empty()) {
+        std::cerr << "错误: --profile-generate 和 --profile-use 不能同时使用\n";
+        return false;
+    }
+    
     // 检查是否提供了输入文件
     if (optind >= argc) {
         std::cerr << "错误: 未指定输入文件\n";
@@ -241,6 +351,20 @@ int main(int argc, char* argv[]) {
     
     // 创建编译器实例
     CAPLCompiler compiler;
+    compiler.setCostReport(options.cost_report);
+    compiler.setLayoutReport(options.layout_report);
+    compiler.setOptimizeLevel(options.optimize_level);
+    compiler.setPassStats(options.pass_stats);
+    compiler.setIRDump(options.ir_dump);
+    compiler.setVerifyIR(options.verify_ir);
+    compiler.setDebug(options.debug);
+    compiler.setProfileGenerate(options.profile_generate);
+    compiler.setProfileUse(options.profile_use);
+    compiler.setJobs(static_cast<unsigned>(options.jobs));
+    compiler.setShards(static_cast<unsigned>(options.shards));
+    if (options.cost_budget >= 0) {
+        compiler.setCostBudget(static_cast<uint64_t>(options.cost_budget));
+    }
     
     try {
         std::cout << "正在编译: " << options.input_file << "\n";
@@ -289,6 +413,12 @@ int main(int argc, char* argv[]) {
                      case capl::TokenType::INT: std::cout << "INT"; break;
                      case capl::TokenType::FLOAT_KW: std::cout << "FLOAT_KW"; break;
                      case capl::TokenType::CHAR_KW: std::cout << "CHAR_KW"; break;
+                     case capl::TokenType::BYTE: std::cout << "BYTE"; break;
+                     case capl::TokenType::WORD: std::cout << "WORD"; break;
+                     case capl::TokenType::DWORD: std::cout << "DWORD"; break;
+                     case capl::TokenType::LONG: std::cout << "LONG"; break;
+                     case capl::TokenType::INT64: std::cout << "INT64"; break;
+                     case capl::TokenType::QWORD: std::cout << "QWORD"; break;
                      case capl::TokenType::IDENTIFIER: std::cout << "IDENTIFIER"; break;
                      case capl::TokenType::INTEGER: std::cout << "INTEGER"; break;
                      case capl::TokenType::FLOAT: std::cout << "FLOAT"; break;
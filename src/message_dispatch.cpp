@@ -0,0 +1,226 @@
+/**
+ * CAPL 报文分派表构造实现
+ */
+
+#include "../include/message_dispatch.h"
+#include "../include/ast.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 不小于 n 的最小 2 的幂
+ */
+size_t nextPowerOfTwo(size_t n) {
+    size_t value = 1;
+    while (value < n) {
+        value <<= 1;
+    }
+    return value;
+}
+
+/**
+ * 每个桶尝试的最大位移数
+ */
+constexpr uint32_t kMaxDisplacement = 1u << 16;
+
+} // namespace
+
+/**
+ * 构造函数
+ */
+MessageDispatch::MessageDispatch()
+    : kind_(DispatchKind::None), table_size_(0), base_(0), bucket_shift_(0), wildcard_(nullptr) {
+}
+
+/**
+ * 为程序中的报文处理器构造分派表
+ * @param program AST 根节点
+ * @param excluded 不需要分派的处理器
+ */
+void MessageDispatch::build(const ASTNode* program, const std::set<const ASTNode*>& excluded) {
+    clear();
+    if (!program) {
+        return;
+    }
+    
+    std::set<uint32_t> seen;
+    for (const auto& child : program->getChildren()) {
+        const ASTNode* handler = child.get();
+        if (handler->getType() != ASTNodeType::ON_MESSAGE || excluded.count(handler) > 0) {
+            continue;
+        }
+        const std::string& name = static_cast<const OnEventNode*>(handler)->getEventName();
+        DispatchEntry entry;
+        entry.handler = handler;
+        if (name == "*") {
+            if (!wildcard_) {
+                wildcard_ = handler;
+            }
+        } else if (handlerMessageId(handler, entry.id) && seen.insert(entry.id).second) {
+            entries_.push_back(entry);
+        }
+    }
+    if (entries_.empty()) {
+        return;
+    }
+    std::sort(entries_.begin(), entries_.end(), [](const DispatchEntry& a, const DispatchEntry& b) {
+        return a.id < b.id;
+    });
+    
+    // 密集的标准帧 ID 直接索引
+    uint32_t lo = entries_.front().id;
+    uint32_t hi = entries_.back().id;
+    size_t span = static_cast<size_t>(hi - lo) + 1;
+    if (hi < kStandardIdLimit && span <= entries_.size() * kDirectMaxSpanPerEntry) {
+        kind_ = DispatchKind::Direct;
+        base_ = lo;
+        table_size_ = span;
+        for (auto& entry : entries_) {
+            entry.slot = entry.id - lo;
+        }
+        return;
+    }
+    
+    // 否则构造完美散列，表项不够时加倍
+    size_t buckets = std::max<size_t>(2, nextPowerOfTwo(entries_.size()) / 2);
+    int bucket_bits = 0;
+    while ((size_t(1) << bucket_bits) < buckets) {
+        ++bucket_bits;
+    }
+    for (size_t slots = nextPowerOfTwo(entries_.size()); slots <= kMaxHashSlots; slots *= 2) {
+        if (buildPerfectHash(slots, bucket_bits)) {
+            kind_ = DispatchKind::PerfectHash;
+            table_size_ = slots;
+            return;
+        }
+    }
+    throw std::runtime_error("无法为报文 ID 构造完美散列");
+}
+
+/**
+ * 按给定的表项数和桶数构造完美散列：从最大的桶开始，为每个桶找到
+ * 使其所有 ID 落在空闲且互不相同的表项中的位移
+ * @param slots 表项数（2 的幂）
+ * @param bucket_bits 桶数的位数
+ * @return 是否成功
+ */
+bool MessageDispatch::buildPerfectHash(size_t slots, int bucket_bits) {
+    bucket_shift_ = 32 - bucket_bits;
+    std::vector<std::vector<size_t>> buckets(size_t(1) << bucket_bits);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        buckets[(entries_[i].id * kBucketMultiplier) >> bucket_shift_].push_back(i);
+    }
+    std::vector<size_t> order(buckets.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+    
+    displacements_.assign(buckets.size(), 0);
+    std::vector<bool> occupied(slots, false);
+    uint32_t mask = static_cast<uint32_t>(slots - 1);
+    for (size_t bucket : order) {
+        const std::vector<size_t>& members = buckets[bucket];
+        if (members.empty()) {
+            break;
+        }
+        bool placed = false;
+        for (uint32_t displacement = 0; displacement < kMaxDisplacement && !placed; ++displacement) {
+            std::vector<size_t> chosen;
+            for (size_t index : members) {
+                size_t slot = mix(entries_[index].id ^ displacement) & mask;
+                if (occupied[slot] || std::find(chosen.begin(), chosen.end(), slot) != chosen.end()) {
+                    break;
+                }
+                chosen.push_back(slot);
+            }
+            if (chosen.size() != members.size()) {
+                continue;
+            }
+            for (size_t i = 0; i < members.size(); ++i) {
+                occupied[chosen[i]] = true;
+                entries_[members[i]].slot = chosen[i];
+            }
+            displacements_[bucket] = displacement;
+            placed = true;
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 清空分派表
+ */
+void MessageDispatch::clear() {
+    kind_ = DispatchKind::None;
+    entries_.clear();
+    table_size_ = 0;
+    base_ = 0;
+    displacements_.clear();
+    bucket_shift_ = 0;
+    wildcard_ = nullptr;
+}
+
+/**
+ * 散列混合函数
+ * @param x 输入
+ * @return 混合后的值
+ */
+uint32_t MessageDispatch::mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * 解析报文处理器的数值 ID
+ * @param text 事件名
+ * @param id 输出的 ID
+ * @return 是否为 32 位以内的数值 ID
+ */
+bool MessageDispatch::parseMessageId(const std::string& text, uint32_t& id) {
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    try {
+        size_t used = 0;
+        unsigned long long value = std::stoull(text, &used, 0);
+        if (used != text.size() || value > 0xFFFFFFFFULL) {
+            return false;
+        }
+        id = static_cast<uint32_t>(value);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+/**
+ * 获取报文处理器的报文 ID
+ * @param handler on message 处理器
+ * @param id 输出的 ID
+ * @return 是否有编译期已知的 ID
+ */
+bool MessageDispatch::handlerMessageId(const ASTNode* handler, uint32_t& id) {
+    const OnEventNode* event = static_cast<const OnEventNode*>(handler);
+    if (event->hasMessageId()) {
+        id = event->getMessageId();
+        return true;
+    }
+    return parseMessageId(event->getEventName(), id);
+}
+
+} // namespace capl
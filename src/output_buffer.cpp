@@ -0,0 +1,184 @@
+/**
+ * 生成代码的输出缓冲区实现
+ */
+
+#include "../include/output_buffer.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace capl {
+
+/**
+ * 构造函数
+ * @param reserve 预留的字节数
+ */
+OutputBuffer::OutputBuffer(size_t reserve) : hex_(false) {
+    data_.reserve(reserve);
+}
+
+/**
+ * 应用 std::hex、std::dec 等进制操纵符
+ */
+OutputBuffer& OutputBuffer::operator<<(std::ios_base& (*manipulator)(std::ios_base&)) {
+    // 在临时流上应用操纵符，只取其进制设置
+    std::ostringstream probe;
+    manipulator(probe);
+    hex_ = (probe.flags() & std::ios_base::basefield) == std::ios_base::hex;
+    return *this;
+}
+
+/**
+ * 获取缩进字符串
+ * @param level 缩进层级
+ * @return 缓存的缩进字符串，引用在缓冲区生命周期内有效
+ */
+const std::string& OutputBuffer::indent(int level) {
+    if (level < 0) {
+        level = 0;
+    }
+    while (indents_.size() <= static_cast<size_t>(level)) {
+        indents_.emplace_back(indents_.size() * kIndentWidth, ' ');
+    }
+    return indents_[level];
+}
+
+void OutputBuffer::appendSigned(long long value) {
+    if (value < 0) {
+        data_ += '-';
+        appendUnsigned(0ULL - static_cast<unsigned long long>(value));
+        return;
+    }
+    appendUnsigned(static_cast<unsigned long long>(value));
+}
+
+void OutputBuffer::appendUnsigned(unsigned long long value) {
+    static const char kDigits[] = "0123456789abcdef";
+    unsigned long long base = hex_ ? 16 : 10;
+    char buffer[32];
+    char* end = buffer + sizeof(buffer);
+    char* begin = end;
+    do {
+        *--begin = kDigits[value % base];
+        value /= base;
+    } while (value != 0);
+    data_.append(begin, end);
+}
+
+/**
+ * 检查文件内容是否与给定内容逐字节相同
+ * @param path 文件路径
+ * @param content 内容
+ * @return 文件存在且内容相同时返回 true
+ */
+bool OutputBuffer::fileMatches(const std::string& path, const std::string& content) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    // 先比较大小，大小相同时再逐块比较内容
+    struct stat info;
+    bool same = ::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+                static_cast<unsigned long long>(info.st_size) == content.size();
+    char chunk[64 * 1024];
+    size_t offset = 0;
+    while (same && offset < content.size()) {
+        ssize_t count = ::read(fd, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0 || offset + static_cast<size_t>(count) > content.size() ||
+            std::memcmp(chunk, content.data() + offset, static_cast<size_t>(count)) != 0) {
+            same = false;
+            break;
+        }
+        offset += static_cast<size_t>(count);
+    }
+    ::close(fd);
+    return same;
+}
+
+/**
+ * 将内容写入文件：先写临时文件，同步到磁盘后再 rename，内容未变化时不写入；
+ * 替换已有文件时保留其权限
+ * @param path 目标文件路径
+ * @param error 失败时输出的错误描述
+ * @return 写入结果
+ */
+WriteResult OutputBuffer::writeToFile(const std::string& path, std::string& error) const {
+    if (fileMatches(path, data_)) {
+        return WriteResult::Unchanged;
+    }
+    
+    // 临时文件与目标在同一目录，rename 才是原子的；带上进程号避免并行编译互相覆盖
+    std::string temp_path = path + ".tmp." + std::to_string(::getpid());
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        error = "无法创建临时文件: " + temp_path + " (" + std::strerror(errno) + ")";
+        return WriteResult::Failed;
+    }
+    
+    // 替换已有文件时保留其权限，新文件按 umask 创建
+    struct stat target;
+    if (::stat(path.c_str(), &target) == 0 && S_ISREG(target.st_mode) &&
+        ::fchmod(fd, target.st_mode & 07777) != 0) {
+        error = "无法设置临时文件权限: " + temp_path + " (" + std::strerror(errno) + ")";
+        ::close(fd);
+        ::unlink(temp_path.c_str());
+        return WriteResult::Failed;
+    }
+    
+    // 一次 write() 写入全部内容，只在被信号打断或部分写入时继续
+    const char* data = data_.data();
+    size_t remaining = data_.size();
+    while (remaining > 0) {
+        ssize_t count = ::write(fd, data, remaining);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            error = "写入临时文件失败: " + temp_path + " (" + std::strerror(errno) + ")";
+            ::close(fd);
+            ::unlink(temp_path.c_str());
+            return WriteResult::Failed;
+        }
+        data += count;
+        remaining -= static_cast<size_t>(count);
+    }
+    
+    // 内容落盘后再 rename，掉电时目标文件要么是旧内容要么是完整的新内容
+    if (::fsync(fd) != 0) {
+        error = "同步临时文件失败: " + temp_path + " (" + std::strerror(errno) + ")";
+        ::close(fd);
+        ::unlink(temp_path.c_str());
+        return WriteResult::Failed;
+    }
+    if (::close(fd) != 0) {
+        error = "关闭临时文件失败: " + temp_path + " (" + std::strerror(errno) + ")";
+        ::unlink(temp_path.c_str());
+        return WriteResult::Failed;
+    }
+    
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        error = "无法替换输出文件: " + path + " (" + std::strerror(errno) + ")";
+        ::unlink(temp_path.c_str());
+        return WriteResult::Failed;
+    }
+    
+    // 同步所在目录，使 rename 本身也持久化；目录无法打开或同步时内容已经完整，不视为失败
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+    return WriteResult::Written;
+}
+
+} // namespace capl
@@ -4,12 +4,15 @@
 
 #include "../include/capl_compiler.h"
 #include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include <cctype>
 #include <iostream>
+#include <set>
 #include <stdexcept>
 
 namespace capl {
 
-Parser::Parser(std::unique_ptr<Lexer> lexer) 
+Parser::Parser(std::unique_ptr<Lexer> lexer)
     : lexer_(std::move(lexer)), has_errors_(false) {
     // 获取第一个 token
     advance();
@@ -21,7 +24,7 @@ Parser::Parser(std::unique_ptr<Lexer> lexer)
  */
 void Parser::reportError(const std::string& message) {
     has_errors_ = true;
-    std::string error_msg = "语法错误 (行 " + std::to_string(current_token_.getLine()) + 
+    std::string error_msg = "语法错误 (行 " + std::to_string(current_token_.getLine()) +
                            ", 列 " + std::to_string(current_token_.getColumn()) + "): " + message;
     errors_.push_back(error_msg);
     std::cerr << error_msg << std::endl;
@@ -37,7 +40,7 @@ bool Parser::expect(TokenType expected_type) {
         advance();
         return true;
     } else {
-        reportError("期望 '" + tokenTypeToString(expected_type) + 
+        reportError("期望 '" + tokenTypeToString(expected_type) +
                    "', 但得到 '" + current_token_.getValue() + "'");
         return false;
     }
@@ -60,6 +63,9 @@ std::string Parser::tokenTypeToString(TokenType type) {
         case TokenType::RIGHT_BRACE: return "}";
         case TokenType::LEFT_PAREN: return "(";
         case TokenType::RIGHT_PAREN: return ")";
+        case TokenType::LEFT_BRACKET: return "[";
+        case TokenType::RIGHT_BRACKET: return "]";
+        case TokenType::COLON: return ":";
         case TokenType::IDENTIFIER: return "标识符";
         case TokenType::INTEGER: return "整数";
         case TokenType::ASSIGN: return "=";
@@ -67,6 +73,49 @@ std::string Parser::tokenTypeToString(TokenType type) {
     }
 }
 
+/**
+ * 检查 token 是否为变量类型关键字
+ */
+bool Parser::isTypeKeyword(TokenType type) const {
+    return type == TokenType::INT ||
+           type == TokenType::FLOAT_KW ||
+           type == TokenType::CHAR_KW ||
+           type == TokenType::BYTE ||
+           type == TokenType::WORD ||
+           type == TokenType::DWORD ||
+           type == TokenType::LONG ||
+           type == TokenType::INT64 ||
+           type == TokenType::QWORD ||
+           type == TokenType::MESSAGE;
+}
+
+/**
+ * 二元操作符优先级，非二元操作符返回 -1
+ */
+int Parser::binaryPrecedence(TokenType type) {
+    switch (type) {
+        case TokenType::LOGICAL_OR:     return 1;
+        case TokenType::LOGICAL_AND:    return 2;
+        case TokenType::BITWISE_OR:     return 3;
+        case TokenType::BITWISE_XOR:    return 4;
+        case TokenType::BITWISE_AND:    return 5;
+        case TokenType::EQUAL:
+        case TokenType::NOT_EQUAL:      return 6;
+        case TokenType::LESS:
+        case TokenType::LESS_EQUAL:
+        case TokenType::GREATER:
+        case TokenType::GREATER_EQUAL:  return 7;
+        case TokenType::LEFT_SHIFT:
+        case TokenType::RIGHT_SHIFT:    return 8;
+        case TokenType::PLUS:
+        case TokenType::MINUS:          return 9;
+        case TokenType::MULTIPLY:
+        case TokenType::DIVIDE:
+        case TokenType::MODULO:         return 10;
+        default:                        return -1;
+    }
+}
+
 std::unique_ptr<ASTNode> Parser::parse() {
     auto result = parseProgram();
     if (has_errors_) {
@@ -76,10 +125,14 @@ std::unique_ptr<ASTNode> Parser::parse() {
 }
 
 std::unique_ptr<ASTNode> Parser::parseProgram() {
-    auto program = std::make_unique<ASTNode>(ASTNodeType::PROGRAM);
+    auto program = std::make_unique<ProgramNode>();
     
     while (current_token_.getType() != TokenType::EOF_TOKEN && !has_errors_) {
         try {
+            if (current_token_.getType() == TokenType::CANDB) {
+                parseDatabaseDecl(program.get());
+                continue;
+            }
             auto stmt = parseTopLevelDeclaration();
             if (stmt) {
                 program->addChild(std::move(stmt));
@@ -105,7 +158,27 @@ std::unique_ptr<ASTNode> Parser::parseProgram() {
 }
 
 /**
- * 解析顶级声明（variables 块、事件处理器等）
+ * 解析 CAN 数据库声明: candb "powertrain.dbc";
+ * @param program 程序节点，数据库路径记录在其中
+ */
+void Parser::parseDatabaseDecl(ProgramNode* program) {
+    // 期望 'candb' 关键字
+    if (!expect(TokenType::CANDB)) {
+        return;
+    }
+    
+    if (current_token_.getType() != TokenType::STRING || current_token_.getValue().empty()) {
+        reportError("期望 CAN 数据库文件路径字符串");
+        return;
+    }
+    program->addDatabase(current_token_.getValue());
+    advance(); // 跳过路径
+    
+    expect(TokenType::SEMICOLON);
+}
+
+/**
+ * 解析顶级声明（variables 块、事件处理器、函数定义）
  */
 std::unique_ptr<ASTNode> Parser::parseTopLevelDeclaration() {
     switch (current_token_.getType()) {
@@ -113,7 +186,15 @@ std::unique_ptr<ASTNode> Parser::parseTopLevelDeclaration() {
             return parseVariablesBlock();
         case TokenType::ON:
             return parseEventHandler();
+        case TokenType::VOID:
+            return parseFunction();
         default:
+            // 函数定义: [function] 返回类型 名称(参数) { ... }
+            if (isTypeKeyword(current_token_.getType()) ||
+                (current_token_.getType() == TokenType::IDENTIFIER &&
+                 current_token_.getValue() == "function")) {
+                return parseFunction();
+            }
             reportError("意外的顶级声明: " + current_token_.getValue());
             // 不要在这里跳过token，让parseProgram来处理
             return nullptr;
@@ -125,6 +206,7 @@ std::unique_ptr<ASTNode> Parser::parseTopLevelDeclaration() {
  */
 std::unique_ptr<ASTNode> Parser::parseVariablesBlock() {
     auto block = std::make_unique<ASTNode>(ASTNodeType::BLOCK_STMT);
+    block->setLine(current_token_.getLine());
     
     // 期望 'variables' 关键字
     if (!expect(TokenType::VARIABLES)) {
@@ -137,15 +219,15 @@ std::unique_ptr<ASTNode> Parser::parseVariablesBlock() {
     }
     
     // 解析变量声明
-    while (current_token_.getType() != TokenType::RIGHT_BRACE && 
+    while (current_token_.getType() != TokenType::RIGHT_BRACE &&
            current_token_.getType() != TokenType::EOF_TOKEN) {
         auto var_decl = parseVariableDeclaration();
         if (var_decl) {
             block->addChild(std::move(var_decl));
         } else {
             // 如果解析失败，跳过当前token直到找到分号或右大括号
-            while (current_token_.getType() != TokenType::SEMICOLON && 
-                   current_token_.getType() != TokenType::RIGHT_BRACE && 
+            while (current_token_.getType() != TokenType::SEMICOLON &&
+                   current_token_.getType() != TokenType::RIGHT_BRACE &&
                    current_token_.getType() != TokenType::EOF_TOKEN) {
                 advance();
             }
@@ -164,84 +246,85 @@ std::unique_ptr<ASTNode> Parser::parseVariablesBlock() {
 }
 
 /**
- * 解析变量声明
+ * 解析变量声明（全局或局部），包括结尾的分号
  */
 std::unique_ptr<ASTNode> Parser::parseVariableDeclaration() {
-    auto var_decl = std::make_unique<ASTNode>(ASTNodeType::VARIABLE_DECL);
-    
-    // 期望类型（int, float, char, message 等）
-    if (current_token_.getType() != TokenType::INT && 
-        current_token_.getType() != TokenType::FLOAT_KW &&
-        current_token_.getType() != TokenType::CHAR_KW &&
-        current_token_.getType() != TokenType::MESSAGE) {
-        reportError("期望变量类型 (int, float, char, message), 但得到 '" + current_token_.getValue() + "'");
+    int line = current_token_.getLine();
+    int column = current_token_.getColumn();
+    
+    // 期望类型（int, float, char, byte, word, dword, long, int64, qword, message）
+    if (!isTypeKeyword(current_token_.getType())) {
+        reportError("期望变量类型 (int, float, char, byte, word, dword, long, int64, qword, message), 但得到 '" + current_token_.getValue() + "'");
         // 跳过错误的token，避免无限循环
         advance();
         return nullptr;
     }
     
+    std::string var_type = current_token_.getValue();
     bool is_message = (current_token_.getType() == TokenType::MESSAGE);
     advance(); // 跳过类型
     
+    std::string message_ref;
     if (is_message) {
         // message 类型的特殊处理: message 0x100 EngineData; 或 message test_msg;
-        // 检查是否有 message ID（可选）
+        // 检查是否有 message ID 或数据库报文名（可选）
         if (current_token_.getType() == TokenType::INTEGER) {
+            message_ref = current_token_.getValue();
             advance(); // 跳过 message ID
         }
+    }
+    
+    // 期望变量名
+    if (current_token_.getType() != TokenType::IDENTIFIER) {
+        reportError(is_message ? "期望 message 名称" : "期望变量名");
+        // 跳过错误的token，避免无限循环
+        advance();
+        return nullptr;
+    }
+    
+    std::string name = current_token_.getValue();
+    advance(); // 跳过变量名
+    
+    // message EngineData msg; —— 第一个标识符是数据库报文名
+    if (is_message && message_ref.empty() && current_token_.getType() == TokenType::IDENTIFIER) {
+        message_ref = name;
+        name = current_token_.getValue();
+        advance();
+    }
+    
+    auto var_decl = std::make_unique<VariableDeclNode>(name, var_type);
+    var_decl->setLine(line);
+    var_decl->setColumn(column);
+    var_decl->setMessageRef(message_ref);
+    
+    // 检查是否是数组声明 [size]
+    if (current_token_.getType() == TokenType::LEFT_BRACKET) {
+        advance(); // 跳过 '['
         
-        // 期望 message 名称
-        if (current_token_.getType() != TokenType::IDENTIFIER) {
-            reportError("期望 message 名称");
+        // 期望数组大小（整数）
+        if (current_token_.getType() == TokenType::INTEGER) {
+            var_decl->setArraySize(static_cast<int>(std::stol(current_token_.getValue(), nullptr, 0)));
+            advance(); // 跳过数组大小
+        } else {
+            reportError("期望数组大小");
             return nullptr;
         }
-        advance(); // 跳过 message 名称
         
-    } else {
-        // 普通类型的处理: int counter = 0; 或 char status[10];
-        // 期望变量名
-        if (current_token_.getType() != TokenType::IDENTIFIER) {
-            reportError("期望变量名");
-            // 跳过错误的token，避免无限循环
-            advance();
+        // 期望 ']'
+        if (!expect(TokenType::RIGHT_BRACKET)) {
             return nullptr;
         }
+    }
+    
+    // 检查是否有初始化（= value）
+    if (!is_message && current_token_.getType() == TokenType::ASSIGN) {
+        advance(); // 跳过 '='
         
-        advance(); // 跳过变量名
-        
-        // 检查是否是数组声明 [size]
-        if (current_token_.getType() == TokenType::LEFT_BRACKET) {
-            advance(); // 跳过 '['
-            
-            // 期望数组大小（整数）
-            if (current_token_.getType() == TokenType::INTEGER) {
-                advance(); // 跳过数组大小
-            } else {
-                reportError("期望数组大小");
-                return nullptr;
-            }
-            
-            // 期望 ']'
-            if (!expect(TokenType::RIGHT_BRACKET)) {
-                return nullptr;
-            }
-        }
-        
-        // 检查是否有初始化（= value）
-        if (current_token_.getType() == TokenType::ASSIGN) {
-            advance(); // 跳过 '='
-            
-            // 期望初始化值（整数、浮点数、字符等）
-            if (current_token_.getType() == TokenType::INTEGER ||
-                current_token_.getType() == TokenType::FLOAT ||
-                current_token_.getType() == TokenType::CHAR ||
-                current_token_.getType() == TokenType::STRING) {
-                advance(); // 跳过初始化值
-            } else {
-                reportError("期望初始化值");
-                return nullptr;
-            }
+        auto init = parseExpression();
+        if (!init) {
+            return nullptr;
         }
+        var_decl->addChild(std::move(init));
     }
     
     // 期望分号
@@ -256,7 +339,7 @@ std::unique_ptr<ASTNode> Parser::parseVariableDeclaration() {
  * 解析事件处理器
  */
 std::unique_ptr<ASTNode> Parser::parseEventHandler() {
-    auto event_handler = std::make_unique<ASTNode>(ASTNodeType::FUNCTION);
+    int line = current_token_.getLine();
     
     // 期望 'on' 关键字
     if (!expect(TokenType::ON)) {
@@ -265,44 +348,61 @@ std::unique_ptr<ASTNode> Parser::parseEventHandler() {
     
     // 解析事件类型
     TokenType event_type = current_token_.getType();
-    if (event_type == TokenType::START ||
-        event_type == TokenType::STOP ||
-        event_type == TokenType::MESSAGE ||
-        event_type == TokenType::TIMER ||
-        event_type == TokenType::KEY) {
-        advance();
-    } else {
-        reportError("期望事件类型 (start, stop, message, timer, key)");
-        return nullptr;
+    ASTNodeType node_type;
+    switch (event_type) {
+        case TokenType::START:   node_type = ASTNodeType::ON_START; break;
+        case TokenType::STOP:    node_type = ASTNodeType::ON_STOP; break;
+        case TokenType::MESSAGE: node_type = ASTNodeType::ON_MESSAGE; break;
+        case TokenType::TIMER:   node_type = ASTNodeType::ON_TIMER; break;
+        case TokenType::KEY:     node_type = ASTNodeType::ON_KEY; break;
+        default:
+            reportError("期望事件类型 (start, stop, message, timer, key)");
+            return nullptr;
     }
+    advance();
     
     // 根据事件类型处理不同的参数
+    std::string event_name;
     if (event_type == TokenType::MESSAGE) {
-        // message 事件可能有 ID 或者消息名称
-        if (current_token_.getType() == TokenType::INTEGER) {
-            advance(); // 跳过消息ID
-        } else if (current_token_.getType() == TokenType::IDENTIFIER) {
-            advance(); // 跳过消息名称
+        // message 事件可能有 ID、消息名称或 '*'
+        if (current_token_.getType() == TokenType::INTEGER ||
+            current_token_.getType() == TokenType::IDENTIFIER) {
+            event_name = current_token_.getValue();
+            advance(); // 跳过消息ID或名称
+        } else {
+            if (current_token_.getType() == TokenType::MULTIPLY) {
+                advance();
+            }
+            event_name = "*";
         }
     } else if (event_type == TokenType::TIMER) {
         // timer 事件需要定时器名称
         if (current_token_.getType() == TokenType::IDENTIFIER) {
+            event_name = current_token_.getValue();
             advance(); // 跳过定时器名称
         }
     } else if (event_type == TokenType::KEY) {
         // key 事件需要按键字符
-        if (current_token_.getType() == TokenType::CHAR) {
+        if (current_token_.getType() == TokenType::CHAR ||
+            current_token_.getType() == TokenType::IDENTIFIER) {
+            event_name = current_token_.getValue();
             advance(); // 跳过按键字符
+        } else if (current_token_.getType() == TokenType::MULTIPLY) {
+            event_name = "*";
+            advance();
         }
     }
     
+    auto event_handler = std::make_unique<OnEventNode>(node_type, event_name);
+    event_handler->setLine(line);
+    
     // 期望左大括号
     if (!expect(TokenType::LEFT_BRACE)) {
         return nullptr;
     }
     
     // 解析语句块
-    while (current_token_.getType() != TokenType::RIGHT_BRACE && 
+    while (current_token_.getType() != TokenType::RIGHT_BRACE &&
            current_token_.getType() != TokenType::EOF_TOKEN) {
         auto stmt = parseStatement();
         if (stmt) {
@@ -310,7 +410,7 @@ std::unique_ptr<ASTNode> Parser::parseEventHandler() {
         } else {
             // 如果parseStatement返回nullptr，但不是因为遇到右大括号或EOF，
             // 说明有错误，需要跳过当前token避免无限循环
-            if (current_token_.getType() != TokenType::RIGHT_BRACE && 
+            if (current_token_.getType() != TokenType::RIGHT_BRACE &&
                 current_token_.getType() != TokenType::EOF_TOKEN) {
                 advance();
             }
@@ -325,27 +425,216 @@ std::unique_ptr<ASTNode> Parser::parseEventHandler() {
     return event_handler;
 }
 
+/**
+ * 解析函数定义: [function] 返回类型 名称(参数列表) { ... }
+ */
 std::unique_ptr<ASTNode> Parser::parseFunction() {
-    // 简单的函数解析实现
-    auto func = std::make_unique<ASTNode>(ASTNodeType::FUNCTION);
+    int line = current_token_.getLine();
+    
+    // 可选的 'function' 前缀
+    if (current_token_.getType() == TokenType::IDENTIFIER &&
+        current_token_.getValue() == "function") {
+        advance();
+    }
+    
+    // 返回类型
+    if (current_token_.getType() != TokenType::VOID && !isTypeKeyword(current_token_.getType())) {
+        reportError("期望函数返回类型, 但得到 '" + current_token_.getValue() + "'");
+        return nullptr;
+    }
+    std::string return_type = current_token_.getValue();
+    advance();
+    
+    // 函数名
+    if (current_token_.getType() != TokenType::IDENTIFIER) {
+        reportError("期望函数名");
+        return nullptr;
+    }
+    auto func = std::make_unique<FunctionNode>(current_token_.getValue(), return_type);
+    func->setLine(line);
+    advance();
+    
+    if (!expect(TokenType::LEFT_PAREN)) {
+        return nullptr;
+    }
+    
+    // 参数列表，允许 (void)
+    if (current_token_.getType() == TokenType::VOID) {
+        advance();
+    }
+    while (current_token_.getType() != TokenType::RIGHT_PAREN &&
+           current_token_.getType() != TokenType::EOF_TOKEN) {
+        if (!isTypeKeyword(current_token_.getType())) {
+            reportError("期望参数类型, 但得到 '" + current_token_.getValue() + "'");
+            return nullptr;
+        }
+        std::string param_type = current_token_.getValue();
+        advance();
+        
+        if (current_token_.getType() != TokenType::IDENTIFIER) {
+            reportError("期望参数名");
+            return nullptr;
+        }
+        auto param = std::make_unique<VariableDeclNode>(current_token_.getValue(), param_type);
+        param->setLine(current_token_.getLine());
+        advance();
+        
+        // 数组参数: int values[]
+        if (current_token_.getType() == TokenType::LEFT_BRACKET) {
+            advance();
+            if (!expect(TokenType::RIGHT_BRACKET)) {
+                return nullptr;
+            }
+            param->setArraySize(-1);
+        }
+        func->addParameter(std::move(param));
+        
+        if (current_token_.getType() == TokenType::COMMA) {
+            advance();
+        } else {
+            break;
+        }
+    }
+    
+    if (!expect(TokenType::RIGHT_PAREN)) {
+        return nullptr;
+    }
+    
+    // 期望左大括号
+    if (!expect(TokenType::LEFT_BRACE)) {
+        return nullptr;
+    }
+    
+    // 解析函数体
+    while (current_token_.getType() != TokenType::RIGHT_BRACE &&
+           current_token_.getType() != TokenType::EOF_TOKEN) {
+        auto stmt = parseStatement();
+        if (stmt) {
+            func->addChild(std::move(stmt));
+        } else if (current_token_.getType() != TokenType::RIGHT_BRACE &&
+                   current_token_.getType() != TokenType::EOF_TOKEN) {
+            advance();
+        }
+    }
+    
+    // 期望右大括号
+    if (!expect(TokenType::RIGHT_BRACE)) {
+        return nullptr;
+    }
+    
     return func;
 }
 
+/**
+ * 解析 { ... } 代码块
+ */
+std::unique_ptr<ASTNode> Parser::parseBlock() {
+    auto block = std::make_unique<ASTNode>(ASTNodeType::BLOCK_STMT);
+    block->setLine(current_token_.getLine());
+    
+    // 期望左大括号
+    if (!expect(TokenType::LEFT_BRACE)) {
+        return nullptr;
+    }
+    
+    // 解析语句块
+    while (current_token_.getType() != TokenType::RIGHT_BRACE &&
+           current_token_.getType() != TokenType::EOF_TOKEN) {
+        auto stmt = parseStatement();
+        if (stmt) {
+            block->addChild(std::move(stmt));
+        } else {
+            // 如果parseStatement返回nullptr，但不是因为遇到右大括号或EOF，
+            // 说明有错误，需要跳过当前token避免无限循环
+            if (current_token_.getType() != TokenType::RIGHT_BRACE &&
+                current_token_.getType() != TokenType::EOF_TOKEN) {
+                advance();
+            }
+        }
+    }
+    
+    // 期望右大括号
+    if (!expect(TokenType::RIGHT_BRACE)) {
+        return nullptr;
+    }
+    
+    return block;
+}
+
+/**
+ * 解析控制语句的主体：代码块或单条语句，统一包装为 BLOCK_STMT
+ */
+std::unique_ptr<ASTNode> Parser::parseBody() {
+    if (current_token_.getType() == TokenType::LEFT_BRACE) {
+        return parseBlock();
+    }
+    
+    auto block = std::make_unique<ASTNode>(ASTNodeType::BLOCK_STMT);
+    block->setLine(current_token_.getLine());
+    auto stmt = parseStatement();
+    if (!stmt) {
+        return nullptr;
+    }
+    block->addChild(std::move(stmt));
+    return block;
+}
+
 std::unique_ptr<ASTNode> Parser::parseStatement() {
+    int line = current_token_.getLine();
+    
     switch (current_token_.getType()) {
-        case TokenType::IDENTIFIER:
-            return parseAssignmentOrCall();
         case TokenType::IF:
             return parseIfStatement();
         case TokenType::WHILE:
             return parseWhileStatement();
         case TokenType::FOR:
             return parseForStatement();
+        case TokenType::SWITCH:
+            return parseSwitchStatement();
+        case TokenType::RETURN:
+            return parseReturnStatement();
+        case TokenType::LEFT_BRACE:
+            return parseBlock();
+        case TokenType::BREAK:
+        case TokenType::CONTINUE: {
+            auto stmt = std::make_unique<ASTNode>(current_token_.getType() == TokenType::BREAK ?
+                                                  ASTNodeType::BREAK_STMT : ASTNodeType::CONTINUE_STMT);
+            stmt->setLine(line);
+            advance();
+            if (!expect(TokenType::SEMICOLON)) {
+                return nullptr;
+            }
+            return stmt;
+        }
+        case TokenType::SEMICOLON: {
+            // 空语句
+            auto stmt = std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT);
+            stmt->setLine(line);
+            advance();
+            return stmt;
+        }
         case TokenType::RIGHT_BRACE:
         case TokenType::EOF_TOKEN:
             // 这些不是语句，而是语句块的结束标志
             return nullptr;
+        case TokenType::IDENTIFIER:
+        case TokenType::SIGNAL_REF:
+        case TokenType::INTEGER:
+        case TokenType::FLOAT:
+        case TokenType::STRING:
+        case TokenType::CHAR:
+        case TokenType::LEFT_PAREN:
+        case TokenType::INCREMENT:
+        case TokenType::DECREMENT:
+        case TokenType::MINUS:
+        case TokenType::LOGICAL_NOT:
+        case TokenType::BITWISE_NOT:
+            return parseExpressionStatement();
         default:
+            // 局部变量声明
+            if (isTypeKeyword(current_token_.getType())) {
+                return parseVariableDeclaration();
+            }
             reportError("意外的语句: " + current_token_.getValue());
             advance(); // 跳过错误的 token
             return nullptr;
@@ -353,70 +642,20 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
 }
 
 /**
- * 解析赋值语句或函数调用
+ * 解析表达式语句（赋值、函数调用、自增自减等）
  */
-std::unique_ptr<ASTNode> Parser::parseAssignmentOrCall() {
+std::unique_ptr<ASTNode> Parser::parseExpressionStatement() {
     auto stmt = std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT);
+    stmt->setLine(current_token_.getLine());
     
-    // 期望标识符
-    if (current_token_.getType() != TokenType::IDENTIFIER) {
-        reportError("期望标识符");
+    auto expr = parseExpression();
+    if (!expr) {
         return nullptr;
     }
+    stmt->addChild(std::move(expr));
     
-    advance(); // 跳过标识符
-    
-    if (current_token_.getType() == TokenType::ASSIGN) {
-        // 赋值语句
-        advance(); // 跳过 =
-        
-        // 解析表达式
-        auto expr = parseExpression();
-        if (!expr) {
-            return nullptr;
-        }
-        
-        // 期望分号
-        if (!expect(TokenType::SEMICOLON)) {
-            return nullptr;
-        }
-    } else if (current_token_.getType() == TokenType::LEFT_PAREN) {
-        // 函数调用
-        advance(); // 跳过 (
-        
-        // 解析参数（简化处理）
-        while (current_token_.getType() != TokenType::RIGHT_PAREN && 
-               current_token_.getType() != TokenType::EOF_TOKEN) {
-            advance();
-        }
-        
-        // 期望右括号
-        if (!expect(TokenType::RIGHT_PAREN)) {
-            return nullptr;
-        }
-        
-        // 期望分号
-        if (!expect(TokenType::SEMICOLON)) {
-            return nullptr;
-        }
-    } else if (current_token_.getType() == TokenType::INCREMENT) {
-        // 后置自增操作符
-        advance(); // 跳过 ++
-        
-        // 期望分号
-        if (!expect(TokenType::SEMICOLON)) {
-            return nullptr;
-        }
-    } else if (current_token_.getType() == TokenType::DECREMENT) {
-        // 后置自减操作符
-        advance(); // 跳过 --
-        
-        // 期望分号
-        if (!expect(TokenType::SEMICOLON)) {
-            return nullptr;
-        }
-    } else {
-        reportError("期望 '=' 或 '(' 在标识符后");
+    // 期望分号
+    if (!expect(TokenType::SEMICOLON)) {
         return nullptr;
     }
     
@@ -427,7 +666,8 @@ std::unique_ptr<ASTNode> Parser::parseAssignmentOrCall() {
  * 解析 if 语句
  */
 std::unique_ptr<ASTNode> Parser::parseIfStatement() {
-    auto if_stmt = std::make_unique<ASTNode>(ASTNodeType::IF_STMT);
+    auto if_stmt = std::make_unique<IfStmtNode>();
+    if_stmt->setLine(current_token_.getLine());
     
     // 期望 'if' 关键字
     if (!expect(TokenType::IF)) {
@@ -444,67 +684,29 @@ std::unique_ptr<ASTNode> Parser::parseIfStatement() {
     if (!condition) {
         return nullptr;
     }
+    if_stmt->addChild(std::move(condition));
     
     // 期望右括号
     if (!expect(TokenType::RIGHT_PAREN)) {
         return nullptr;
     }
     
-    // 期望左大括号
-    if (!expect(TokenType::LEFT_BRACE)) {
-        return nullptr;
-    }
-    
-    // 解析语句块
-    while (current_token_.getType() != TokenType::RIGHT_BRACE && 
-           current_token_.getType() != TokenType::EOF_TOKEN) {
-        auto stmt = parseStatement();
-        if (stmt) {
-            if_stmt->addChild(std::move(stmt));
-        } else {
-            // 如果parseStatement返回nullptr，但不是因为遇到右大括号或EOF，
-            // 说明有错误，需要跳过当前token避免无限循环
-            if (current_token_.getType() != TokenType::RIGHT_BRACE && 
-                current_token_.getType() != TokenType::EOF_TOKEN) {
-                advance();
-            }
-        }
-    }
-    
-    // 期望右大括号
-    if (!expect(TokenType::RIGHT_BRACE)) {
+    // 解析 then 分支
+    auto then_body = parseBody();
+    if (!then_body) {
         return nullptr;
     }
+    if_stmt->addChild(std::move(then_body));
     
     // 检查是否有 else 子句
     if (current_token_.getType() == TokenType::ELSE) {
         advance(); // 跳过 'else'
         
-        // 期望左大括号
-        if (!expect(TokenType::LEFT_BRACE)) {
-            return nullptr;
-        }
-        
-        // 解析 else 语句块
-        while (current_token_.getType() != TokenType::RIGHT_BRACE && 
-               current_token_.getType() != TokenType::EOF_TOKEN) {
-            auto stmt = parseStatement();
-            if (stmt) {
-                if_stmt->addChild(std::move(stmt));
-            } else {
-                // 如果parseStatement返回nullptr，但不是因为遇到右大括号或EOF，
-                // 说明有错误，需要跳过当前token避免无限循环
-                if (current_token_.getType() != TokenType::RIGHT_BRACE && 
-                    current_token_.getType() != TokenType::EOF_TOKEN) {
-                    advance();
-                }
-            }
-        }
-        
-        // 期望右大括号
-        if (!expect(TokenType::RIGHT_BRACE)) {
+        auto else_body = parseBody();
+        if (!else_body) {
             return nullptr;
         }
+        if_stmt->addChild(std::move(else_body));
     }
     
     return if_stmt;
@@ -515,6 +717,7 @@ std::unique_ptr<ASTNode> Parser::parseIfStatement() {
  */
 std::unique_ptr<ASTNode> Parser::parseWhileStatement() {
     auto while_stmt = std::make_unique<ASTNode>(ASTNodeType::WHILE_STMT);
+    while_stmt->setLine(current_token_.getLine());
     
     // 期望 'while' 关键字
     if (!expect(TokenType::WHILE)) {
@@ -531,31 +734,109 @@ std::unique_ptr<ASTNode> Parser::parseWhileStatement() {
     if (!condition) {
         return nullptr;
     }
+    while_stmt->addChild(std::move(condition));
     
     // 期望右括号
     if (!expect(TokenType::RIGHT_PAREN)) {
         return nullptr;
     }
     
-    // 期望左大括号
-    if (!expect(TokenType::LEFT_BRACE)) {
+    // 解析循环体
+    auto body = parseBody();
+    if (!body) {
         return nullptr;
     }
+    while_stmt->addChild(std::move(body));
     
-    // 解析语句块
-    while (current_token_.getType() != TokenType::RIGHT_BRACE && 
+    return while_stmt;
+}
+
+/**
+ * 解析 switch 语句：每个 case/default 标签到下一个标签之间的语句组成一个 CASE_STMT
+ */
+std::unique_ptr<ASTNode> Parser::parseSwitchStatement() {
+    auto switch_stmt = std::make_unique<ASTNode>(ASTNodeType::SWITCH_STMT);
+    switch_stmt->setLine(current_token_.getLine());
+    
+    // 期望 'switch' 关键字
+    if (!expect(TokenType::SWITCH)) {
+        return nullptr;
+    }
+    
+    // 期望左括号
+    if (!expect(TokenType::LEFT_PAREN)) {
+        return nullptr;
+    }
+    
+    // 解析判别表达式
+    auto subject = parseExpression();
+    if (!subject) {
+        return nullptr;
+    }
+    switch_stmt->addChild(std::move(subject));
+    
+    // 期望右括号和左大括号
+    if (!expect(TokenType::RIGHT_PAREN) || !expect(TokenType::LEFT_BRACE)) {
+        return nullptr;
+    }
+    
+    std::set<long long> labels;
+    bool has_default = false;
+    while (current_token_.getType() != TokenType::RIGHT_BRACE &&
            current_token_.getType() != TokenType::EOF_TOKEN) {
-        auto stmt = parseStatement();
-        if (stmt) {
-            while_stmt->addChild(std::move(stmt));
+        auto case_stmt = std::make_unique<ASTNode>(ASTNodeType::CASE_STMT);
+        case_stmt->setLine(current_token_.getLine());
+        
+        if (current_token_.getType() == TokenType::CASE) {
+            advance(); // 跳过 'case'
+            
+            // 标签必须是编译期可求值的整数
+            auto label = parseExpression();
+            if (!label) {
+                return nullptr;
+            }
+            ConstantValue value;
+            if (!evaluateConstant(label.get(), value) || value.is_float) {
+                reportError("case 标签必须是整数常量");
+                return nullptr;
+            }
+            if (!labels.insert(value.int_value).second) {
+                reportError("重复的 case 标签: " + std::to_string(value.int_value));
+            }
+            case_stmt->addChild(std::move(label));
+        } else if (current_token_.getType() == TokenType::DEFAULT) {
+            if (has_default) {
+                reportError("switch 语句中有多个 default 标签");
+            }
+            has_default = true;
+            advance(); // 跳过 'default'
         } else {
-            // 如果parseStatement返回nullptr，但不是因为遇到右大括号或EOF，
-            // 说明有错误，需要跳过当前token避免无限循环
-            if (current_token_.getType() != TokenType::RIGHT_BRACE && 
-                current_token_.getType() != TokenType::EOF_TOKEN) {
+            reportError("switch 语句中期望 case 或 default, 但得到 '" + current_token_.getValue() + "'");
+            return nullptr;
+        }
+        
+        // 期望冒号
+        if (!expect(TokenType::COLON)) {
+            return nullptr;
+        }
+        
+        // 标签之后直到下一个标签的语句
+        auto body = std::make_unique<ASTNode>(ASTNodeType::BLOCK_STMT);
+        body->setLine(current_token_.getLine());
+        while (current_token_.getType() != TokenType::CASE &&
+               current_token_.getType() != TokenType::DEFAULT &&
+               current_token_.getType() != TokenType::RIGHT_BRACE &&
+               current_token_.getType() != TokenType::EOF_TOKEN) {
+            auto stmt = parseStatement();
+            if (stmt) {
+                body->addChild(std::move(stmt));
+            } else if (current_token_.getType() != TokenType::RIGHT_BRACE &&
+                       current_token_.getType() != TokenType::EOF_TOKEN) {
                 advance();
             }
         }
+        case_stmt->addChild(std::move(body));
+        switch_stmt->addChild(std::move(case_stmt));
     }
     
     // 期望右大括号
@@ -563,7 +844,7 @@ std::unique_ptr<ASTNode> Parser::parseWhileStatement() {
         return nullptr;
     }
     
-    return while_stmt;
+    return switch_stmt;
 }
 
 /**
@@ -571,6 +852,7 @@ std::unique_ptr<ASTNode> Parser::parseWhileStatement() {
  */
 std::unique_ptr<ASTNode> Parser::parseForStatement() {
     auto for_stmt = std::make_unique<ASTNode>(ASTNodeType::FOR_STMT);
+    for_stmt->setLine(current_token_.getLine());
     
     // 期望 'for' 关键字
     if (!expect(TokenType::FOR)) {
@@ -582,89 +864,361 @@ std::unique_ptr<ASTNode> Parser::parseForStatement() {
         return nullptr;
     }
     
-    // 简化处理：跳过 for 循环的三个部分
-    int semicolon_count = 0;
-    while (current_token_.getType() != TokenType::RIGHT_PAREN && 
-           current_token_.getType() != TokenType::EOF_TOKEN) {
-        if (current_token_.getType() == TokenType::SEMICOLON) {
-            semicolon_count++;
-        }
+    // 初始化部分: 变量声明、表达式或空
+    std::unique_ptr<ASTNode> init;
+    if (isTypeKeyword(current_token_.getType())) {
+        init = parseVariableDeclaration();
+    } else if (current_token_.getType() == TokenType::SEMICOLON) {
+        init = std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT);
         advance();
+    } else {
+        init = parseExpressionStatement();
     }
+    if (!init) {
+        return nullptr;
+    }
+    for_stmt->addChild(std::move(init));
     
-    if (semicolon_count != 2) {
+    // 条件部分
+    if (current_token_.getType() == TokenType::SEMICOLON) {
+        for_stmt->addChild(std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT));
+    } else {
+        auto condition = parseExpression();
+        if (!condition) {
+            return nullptr;
+        }
+        for_stmt->addChild(std::move(condition));
+    }
+    if (!expect(TokenType::SEMICOLON)) {
         reportError("for 循环应该有两个分号");
         return nullptr;
     }
     
+    // 更新部分
+    if (current_token_.getType() == TokenType::RIGHT_PAREN) {
+        for_stmt->addChild(std::make_unique<ASTNode>(ASTNodeType::EXPRESSION_STMT));
+    } else {
+        auto update = parseExpression();
+        if (!update) {
+            return nullptr;
+        }
+        for_stmt->addChild(std::move(update));
+    }
+    
     // 期望右括号
     if (!expect(TokenType::RIGHT_PAREN)) {
         return nullptr;
     }
     
-    // 期望左大括号
-    if (!expect(TokenType::LEFT_BRACE)) {
+    // 解析循环体
+    auto body = parseBody();
+    if (!body) {
         return nullptr;
     }
+    for_stmt->addChild(std::move(body));
     
-    // 解析语句块
-    while (current_token_.getType() != TokenType::RIGHT_BRACE && 
-           current_token_.getType() != TokenType::EOF_TOKEN) {
-        auto stmt = parseStatement();
-        if (stmt) {
-            for_stmt->addChild(std::move(stmt));
+    return for_stmt;
+}
+
+/**
+ * 解析 return 语句
+ */
+std::unique_ptr<ASTNode> Parser::parseReturnStatement() {
+    auto return_stmt = std::make_unique<ASTNode>(ASTNodeType::RETURN_STMT);
+    return_stmt->setLine(current_token_.getLine());
+    
+    if (!expect(TokenType::RETURN)) {
+        return nullptr;
+    }
+    
+    if (current_token_.getType() != TokenType::SEMICOLON) {
+        auto value = parseExpression();
+        if (!value) {
+            return nullptr;
         }
+        return_stmt->addChild(std::move(value));
     }
     
-    // 期望右大括号
-    if (!expect(TokenType::RIGHT_BRACE)) {
+    if (!expect(TokenType::SEMICOLON)) {
         return nullptr;
     }
     
-    return for_stmt;
+    return return_stmt;
 }
 
+/**
+ * 解析表达式（赋值表达式，右结合）
+ */
 std::unique_ptr<ASTNode> Parser::parseExpression() {
-    // 简单的表达式解析实现
-    auto expr = std::make_unique<ASTNode>(ASTNodeType::BINARY_EXPR);
-    
-    // 至少需要一个操作数
-    if (current_token_.getType() == TokenType::IDENTIFIER ||
-        current_token_.getType() == TokenType::INTEGER ||
-        current_token_.getType() == TokenType::FLOAT ||
-        current_token_.getType() == TokenType::CHAR) {
-        advance();
-    } else {
-        reportError("期望表达式");
+    auto target = parseConditional();
+    if (!target) {
         return nullptr;
     }
     
-    // 可选的操作符和第二个操作数
-    if (current_token_.getType() == TokenType::PLUS ||
-        current_token_.getType() == TokenType::MINUS ||
-        current_token_.getType() == TokenType::MULTIPLY ||
-        current_token_.getType() == TokenType::DIVIDE ||
-        current_token_.getType() == TokenType::EQUAL ||
-        current_token_.getType() == TokenType::NOT_EQUAL ||
-        current_token_.getType() == TokenType::LESS ||
-        current_token_.getType() == TokenType::GREATER ||
-        current_token_.getType() == TokenType::LESS_EQUAL ||
-        current_token_.getType() == TokenType::GREATER_EQUAL) {
+    TokenType type = current_token_.getType();
+    if (type == TokenType::ASSIGN ||
+        type == TokenType::PLUS_ASSIGN ||
+        type == TokenType::MINUS_ASSIGN) {
+        auto assign = std::make_unique<AssignmentExprNode>(current_token_.getValue());
+        assign->setLine(current_token_.getLine());
+        advance(); // 跳过赋值操作符
+        
+        auto value = parseExpression();
+        if (!value) {
+            return nullptr;
+        }
+        assign->addChild(std::move(target));
+        assign->addChild(std::move(value));
+        return assign;
+    }
+    
+    return target;
+}
+
+/**
+ * 解析条件表达式 (cond ? a : b)
+ */
+std::unique_ptr<ASTNode> Parser::parseConditional() {
+    auto condition = parseBinary(1);
+    if (!condition || current_token_.getType() != TokenType::QUESTION) {
+        return condition;
+    }
+    
+    auto cond_expr = std::make_unique<ASTNode>(ASTNodeType::CONDITIONAL_EXPR);
+    cond_expr->setLine(current_token_.getLine());
+    advance(); // 跳过 '?'
+    
+    auto true_value = parseExpression();
+    if (!true_value || !expect(TokenType::COLON)) {
+        return nullptr;
+    }
+    auto false_value = parseConditional();
+    if (!false_value) {
+        return nullptr;
+    }
+    
+    cond_expr->addChild(std::move(condition));
+    cond_expr->addChild(std::move(true_value));
+    cond_expr->addChild(std::move(false_value));
+    return cond_expr;
+}
+
+/**
+ * 按优先级解析二元表达式（左结合）
+ * @param min_precedence 最低优先级
+ */
+std::unique_ptr<ASTNode> Parser::parseBinary(int min_precedence) {
+    auto left = parseUnary();
+    if (!left) {
+        return nullptr;
+    }
+    
+    while (true) {
+        int precedence = binaryPrecedence(current_token_.getType());
+        if (precedence < min_precedence) {
+            break;
+        }
+        
+        auto binary = std::make_unique<BinaryExprNode>(current_token_.getValue());
+        binary->setLine(current_token_.getLine());
         advance(); // 跳过操作符
         
-        // 期望第二个操作数
-        if (current_token_.getType() == TokenType::IDENTIFIER ||
-            current_token_.getType() == TokenType::INTEGER ||
-            current_token_.getType() == TokenType::FLOAT ||
-            current_token_.getType() == TokenType::CHAR) {
-            advance();
-        } else {
+        auto right = parseBinary(precedence + 1);
+        if (!right) {
             reportError("期望表达式的右操作数");
             return nullptr;
         }
+        
+        binary->addChild(std::move(left));
+        binary->addChild(std::move(right));
+        left = std::move(binary);
+    }
+    
+    return left;
+}
+
+/**
+ * 解析一元表达式 (-x, !x, ~x, ++x, --x)
+ */
+std::unique_ptr<ASTNode> Parser::parseUnary() {
+    TokenType type = current_token_.getType();
+    if (type == TokenType::MINUS ||
+        type == TokenType::LOGICAL_NOT ||
+        type == TokenType::BITWISE_NOT ||
+        type == TokenType::INCREMENT ||
+        type == TokenType::DECREMENT) {
+        auto unary = std::make_unique<UnaryExprNode>(current_token_.getValue());
+        unary->setLine(current_token_.getLine());
+        advance(); // 跳过操作符
+        
+        auto operand = parseUnary();
+        if (!operand) {
+            return nullptr;
+        }
+        unary->addChild(std::move(operand));
+        return unary;
+    }
+    
+    auto primary = parsePrimary();
+    if (!primary) {
+        return nullptr;
+    }
+    return parsePostfix(std::move(primary));
+}
+
+/**
+ * 解析后缀操作：下标、成员访问、成员调用、后置自增自减
+ */
+std::unique_ptr<ASTNode> Parser::parsePostfix(std::unique_ptr<ASTNode> expr) {
+    while (true) {
+        switch (current_token_.getType()) {
+            case TokenType::LEFT_BRACKET: {
+                auto index_expr = std::make_unique<ASTNode>(ASTNodeType::INDEX_EXPR);
+                index_expr->setLine(current_token_.getLine());
+                advance(); // 跳过 '['
+                
+                auto index = parseExpression();
+                if (!index || !expect(TokenType::RIGHT_BRACKET)) {
+                    return nullptr;
+                }
+                index_expr->addChild(std::move(expr));
+                index_expr->addChild(std::move(index));
+                expr = std::move(index_expr);
+                break;
+            }
+            case TokenType::DOT: {
+                advance(); // 跳过 '.'
+                
+                // 成员名可以与关键字同名，例如 this.byte(0)
+                const std::string& member = current_token_.getValue();
+                if (member.empty() || !(std::isalpha(static_cast<unsigned char>(member[0])) || member[0] == '_')) {
+                    reportError("期望成员名, 但得到 '" + member + "'");
+                    return nullptr;
+                }
+                int line = current_token_.getLine();
+                std::string member_name = member;
+                advance();
+                
+                bool is_call = (current_token_.getType() == TokenType::LEFT_PAREN);
+                auto member_expr = std::make_unique<MemberExprNode>(member_name, is_call);
+                member_expr->setLine(line);
+                member_expr->addChild(std::move(expr));
+                
+                if (is_call) {
+                    advance(); // 跳过 '('
+                    while (current_token_.getType() != TokenType::RIGHT_PAREN &&
+                           current_token_.getType() != TokenType::EOF_TOKEN) {
+                        auto arg = parseExpression();
+                        if (!arg) {
+                            return nullptr;
+                        }
+                        member_expr->addChild(std::move(arg));
+                        if (current_token_.getType() == TokenType::COMMA) {
+                            advance();
+                        } else {
+                            break;
+                        }
+                    }
+                    if (!expect(TokenType::RIGHT_PAREN)) {
+                        return nullptr;
+                    }
+                }
+                expr = std::move(member_expr);
+                break;
+            }
+            case TokenType::INCREMENT:
+            case TokenType::DECREMENT: {
+                auto unary = std::make_unique<UnaryExprNode>(current_token_.getValue(), true);
+                unary->setLine(current_token_.getLine());
+                advance(); // 跳过 ++ 或 --
+                unary->addChild(std::move(expr));
+                expr = std::move(unary);
+                break;
+            }
+            default:
+                return expr;
+        }
+    }
+}
+
+/**
+ * 解析基本表达式：字面量、标识符、函数调用、括号表达式
+ */
+std::unique_ptr<ASTNode> Parser::parsePrimary() {
+    int line = current_token_.getLine();
+    int column = current_token_.getColumn();
+    std::unique_ptr<ASTNode> node;
+    
+    switch (current_token_.getType()) {
+        case TokenType::INTEGER:
+            node = std::make_unique<LiteralNode>(ASTNodeType::INTEGER_LITERAL, current_token_.getValue());
+            advance();
+            break;
+        case TokenType::FLOAT:
+            node = std::make_unique<LiteralNode>(ASTNodeType::FLOAT_LITERAL, current_token_.getValue());
+            advance();
+            break;
+        case TokenType::STRING:
+            node = std::make_unique<LiteralNode>(ASTNodeType::STRING_LITERAL, current_token_.getValue());
+            advance();
+            break;
+        case TokenType::CHAR:
+            node = std::make_unique<LiteralNode>(ASTNodeType::CHAR_LITERAL, current_token_.getValue());
+            advance();
+            break;
+        case TokenType::IDENTIFIER: {
+            std::string name = current_token_.getValue();
+            advance();
+            
+            if (current_token_.getType() == TokenType::LEFT_PAREN) {
+                // 函数调用
+                auto call = std::make_unique<CallExprNode>(name);
+                advance(); // 跳过 (
+                
+                while (current_token_.getType() != TokenType::RIGHT_PAREN &&
+                       current_token_.getType() != TokenType::EOF_TOKEN) {
+                    auto arg = parseExpression();
+                    if (!arg) {
+                        return nullptr;
+                    }
+                    call->addChild(std::move(arg));
+                    if (current_token_.getType() == TokenType::COMMA) {
+                        advance();
+                    } else {
+                        break;
+                    }
+                }
+                
+                // 期望右括号
+                if (!expect(TokenType::RIGHT_PAREN)) {
+                    return nullptr;
+                }
+                node = std::move(call);
+            } else {
+                node = std::make_unique<IdentifierNode>(name);
+            }
+            break;
+        }
+        case TokenType::SIGNAL_REF:
+            node = std::make_unique<SignalAccessNode>(current_token_.getValue());
+            advance();
+            break;
+        case TokenType::LEFT_PAREN: {
+            advance(); // 跳过 (
+            auto inner = parseExpression();
+            if (!inner || !expect(TokenType::RIGHT_PAREN)) {
+                return nullptr;
+            }
+            return inner;
+        }
+        default:
+            reportError("期望表达式");
+            return nullptr;
     }
     
-    return expr;
+    node->setLine(line);
+    node->setColumn(column);
+    return node;
 }
 
 /**
@@ -674,4 +1228,4 @@ const std::vector<std::string>& Parser::getErrors() const {
     return errors_;
 }
 
-} // namespace capl
\ No newline at end of file
+} // namespace capl
@@ -0,0 +1,156 @@
+/**
+ * CAPL 优化遍管理器实现
+ */
+
+#include "../include/pass_manager.h"
+#include "../include/passes.h"
+#include "../include/constant_folding.h"
+#include "../include/dead_code_elimination.h"
+#include "../include/inliner.h"
+#include "../include/field_cse.h"
+#include <chrono>
+#include <iomanip>
+
+namespace capl {
+
+/**
+ * 构造函数
+ * @param optimize_level 优化级别 (0-3)
+ */
+PassManager::PassManager(int optimize_level) : optimize_level_(optimize_level) {
+}
+
+/**
+ * 按优化级别注册内置优化遍
+ */
+void PassManager::buildPipeline() {
+    if (optimize_level_ >= 1) {
+        addPass(std::make_unique<UnreachableCodePass>());
+        addPass(std::make_unique<InlinerPass>(InlinerPass::thresholdFor(optimize_level_), profile_));
+        addPass(std::make_unique<ConstantFoldingPass>());
+    }
+    if (optimize_level_ >= 2) {
+        addPass(std::make_unique<StartPrefixPass>());
+        
+        std::vector<std::unique_ptr<Pass>> propagation;
+        propagation.push_back(std::make_unique<ConstantPropagationPass>());
+        propagation.push_back(std::make_unique<ConstantFoldingPass>());
+        propagation.push_back(std::make_unique<DeadCodeEliminationPass>());
+        addFixedPointGroup(std::move(propagation));
+        
+        addPass(std::make_unique<FieldCSEPass>());
+    }
+}
+
+/**
+ * 添加只运行一次的遍
+ * @param pass 优化遍
+ */
+void PassManager::addPass(std::unique_ptr<Pass> pass) {
+    std::vector<std::unique_ptr<Pass>> passes;
+    passes.push_back(std::move(pass));
+    stages_.emplace_back();
+    Stage& stage = stages_.back();
+    stage.passes = std::move(passes);
+    stage.fixed_point = false;
+    stage.stat_indices.push_back(stats_.size());
+    stats_.push_back(PassStats{stage.passes.back()->getName(), 0, 0, 0.0});
+}
+
+/**
+ * 添加一组反复运行直到不再修改程序的遍
+ * @param passes 优化遍列表
+ */
+void PassManager::addFixedPointGroup(std::vector<std::unique_ptr<Pass>> passes) {
+    stages_.emplace_back();
+    Stage& stage = stages_.back();
+    stage.fixed_point = true;
+    for (auto& pass : passes) {
+        stage.stat_indices.push_back(stats_.size());
+        stats_.push_back(PassStats{pass->getName(), 0, 0, 0.0});
+        stage.passes.push_back(std::move(pass));
+    }
+}
+
+/**
+ * 运行所有已注册的遍
+ * @param program AST 根节点
+ * @return 总修改次数
+ */
+int PassManager::run(ASTNode* program) {
+    int total = 0;
+    for (auto& stage : stages_) {
+        if (!stage.fixed_point) {
+            total += runOnce(stage, program);
+            continue;
+        }
+        
+        for (int iteration = 0; iteration < kMaxIterations; ++iteration) {
+            int changes = runOnce(stage, program);
+            total += changes;
+            ++iterations_;
+            if (changes == 0) {
+                break;
+            }
+        }
+    }
+    return total;
+}
+
+int PassManager::runOnce(Stage& stage, ASTNode* program) {
+    int changes = 0;
+    for (size_t i = 0; i < stage.passes.size(); ++i) {
+        PassStats& stats = stats_[stage.stat_indices[i]];
+        
+        auto start = std::chrono::steady_clock::now();
+        int pass_changes = stage.passes[i]->run(program);
+        auto end = std::chrono::steady_clock::now();
+        
+        stats.runs++;
+        stats.changes += pass_changes;
+        stats.time_ms += std::chrono::duration<double, std::milli>(end - start).count();
+        changes += pass_changes;
+    }
+    return changes;
+}
+
+/**
+ * 输出统计报告
+ * @param out 输出流
+ */
+void PassManager::printStats(std::ostream& out) const {
+    out << "优化遍统计 (-O" << optimize_level_ << ")\n";
+    if (stats_.empty()) {
+        out << "  (该优化级别未启用优化遍)\n";
+        return;
+    }
+    
+    out << "  遍                       运行    修改      耗时(ms)\n";
+    int total_changes = 0;
+    double total_time = 0.0;
+    for (const auto& stats : stats_) {
+        out << "  " << std::left << std::setw(22) << stats.name << std::right
+            << std::setw(8) << stats.runs
+            << std::setw(8) << stats.changes
+            << std::setw(14) << std::fixed << std::setprecision(3) << stats.time_ms << "\n";
+        total_changes += stats.changes;
+        total_time += stats.time_ms;
+    }
+    out << "总计: " << stats_.size() << " 个遍, " << total_changes << " 处修改, "
+        << std::fixed << std::setprecision(3) << total_time << " ms";
+    if (iterations_ > 0) {
+        out << ", 不动点迭代 " << iterations_ << " 轮";
+    }
+    out << "\n";
+    out << std::defaultfloat;
+    
+    for (const auto& stage : stages_) {
+        for (const auto& pass : stage.passes) {
+            for (const auto& decision : pass->getDecisions()) {
+                out << "  [" << pass->getName() << "] " << decision << "\n";
+            }
+        }
+    }
+}
+
+} // namespace capl
@@ -0,0 +1,56 @@
+/**
+ * CAPL 内置优化遍实现
+ */
+
+#include "../include/passes.h"
+#include "../include/ast.h"
+
+namespace capl {
+
+namespace {
+
+/**
+ * 语句之后的同级语句是否不可达
+ */
+bool isTerminator(const ASTNode* node) {
+    return node->getType() == ASTNodeType::RETURN_STMT ||
+           node->getType() == ASTNodeType::BREAK_STMT ||
+           node->getType() == ASTNodeType::CONTINUE_STMT;
+}
+
+} // namespace
+
+/**
+ * 删除不可达语句
+ * @param program AST 根节点
+ * @return 删除的语句数
+ */
+int UnreachableCodePass::run(ASTNode* program) {
+    return simplify(program);
+}
+
+int UnreachableCodePass::simplify(ASTNode* node) {
+    if (!node) {
+        return 0;
+    }
+    
+    int changes = 0;
+    if (isStatementList(node)) {
+        for (size_t i = 0; i < node->getChildCount(); ++i) {
+            if (isTerminator(node->getChild(i))) {
+                while (node->getChildCount() > i + 1) {
+                    node->removeChild(i + 1);
+                    ++changes;
+                }
+                break;
+            }
+        }
+    }
+    
+    for (const auto& child : node->getChildren()) {
+        changes += simplify(child.get());
+    }
+    return changes;
+}
+
+} // namespace capl
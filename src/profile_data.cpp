@@ -0,0 +1,233 @@
+/**
+ * CAPL 运行剖析数据实现
+ */
+
+#include "../include/profile_data.h"
+#include "../include/ast.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace capl {
+
+/**
+ * 构造函数
+ */
+ProfileData::ProfileData() {
+}
+
+/**
+ * 读入剖析文件
+ * @param path 文件路径
+ * @param error 失败原因
+ * @return 是否成功
+ */
+bool ProfileData::load(const std::string& path, std::string& error) {
+    clear();
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = "无法打开剖析文件: " + path;
+        return false;
+    }
+    
+    std::string line;
+    int line_number = 0;
+    std::set<std::string> keys;
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        
+        // 最后一个字段是次数，前面是键
+        size_t space = line.find_last_of(' ');
+        unsigned long long count = 0;
+        std::string key = space == std::string::npos ? "" : line.substr(0, space);
+        std::istringstream count_stream(space == std::string::npos ? "" : line.substr(space + 1));
+        if (!(count_stream >> count)) {
+            error = path + ":" + std::to_string(line_number) + ": 无法解析计数";
+            return false;
+        }
+        if (!keys.insert(key).second) {
+            error = path + ":" + std::to_string(line_number) + ": 重复的剖析记录: " + key;
+            return false;
+        }
+        
+        std::istringstream key_stream(key);
+        std::string kind;
+        key_stream >> kind;
+        if (kind == "handler") {
+            std::string handler;
+            std::getline(key_stream >> std::ws, handler);
+            handlers_[handler] = count;
+            continue;
+        }
+        // branch 名称 taken|not_taken，名称为处理器或函数加 " #序号"
+        std::string rest;
+        std::getline(key_stream >> std::ws, rest);
+        size_t side_space = rest.find_last_of(' ');
+        std::string name = side_space == std::string::npos ? "" : rest.substr(0, side_space);
+        std::string side = side_space == std::string::npos ? "" : rest.substr(side_space + 1);
+        if (kind == "branch" && name.find(" #") != std::string::npos && (side == "taken" || side == "not_taken")) {
+            BranchProfile& branch = branches_[name];
+            (side == "taken" ? branch.taken : branch.not_taken) = count;
+            continue;
+        }
+        error = path + ":" + std::to_string(line_number) + ": 未知的剖析记录: " + key;
+        return false;
+    }
+    
+    classify();
+    return true;
+}
+
+/**
+ * 清空剖析数据
+ */
+void ProfileData::clear() {
+    handlers_.clear();
+    branches_.clear();
+    hot_.clear();
+}
+
+/**
+ * 按执行次数从多到少累加，覆盖总次数 kHotFraction 的处理器为热点
+ */
+void ProfileData::classify() {
+    std::vector<std::pair<unsigned long long, std::string>> sorted;
+    unsigned long long total = 0;
+    for (const auto& entry : handlers_) {
+        sorted.emplace_back(entry.second, entry.first);
+        total += entry.second;
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    
+    unsigned long long covered = 0;
+    for (const auto& entry : sorted) {
+        if (entry.first == 0 || covered >= total * kHotFraction) {
+            break;
+        }
+        hot_.insert(entry.second);
+        covered += entry.first;
+    }
+}
+
+/**
+ * 获取处理器的执行次数
+ * @param handler 处理器显示名
+ * @return 执行次数，没有数据时为 0
+ */
+unsigned long long ProfileData::getHandlerCount(const std::string& handler) const {
+    auto it = handlers_.find(handler);
+    return it != handlers_.end() ? it->second : 0;
+}
+
+/**
+ * 获取处理器的执行频率分类
+ * @param handler 处理器显示名
+ * @return 频率分类
+ */
+Heat ProfileData::getHeat(const std::string& handler) const {
+    auto it = handlers_.find(handler);
+    if (it == handlers_.end()) {
+        return Heat::Unknown;
+    }
+    if (it->second == 0) {
+        return Heat::Cold;
+    }
+    return hot_.count(handler) ? Heat::Hot : Heat::Warm;
+}
+
+/**
+ * 查找 if 语句的分支计数
+ * @param branch if 语句的名称
+ * @return 分支计数，没有数据时返回 nullptr
+ */
+const BranchProfile* ProfileData::findBranch(const std::string& branch) const {
+    auto it = branches_.find(branch);
+    return it != branches_.end() ? &it->second : nullptr;
+}
+
+/**
+ * 获取 if 语句偏向的分支
+ * @param branch if 语句的名称
+ * @return 1 表示条件多为真，-1 表示多为假，0 表示没有明显偏向或没有数据
+ */
+int ProfileData::getBranchBias(const std::string& branch) const {
+    const BranchProfile* profile = findBranch(branch);
+    if (!profile) {
+        return 0;
+    }
+    double total = static_cast<double>(profile->taken) + static_cast<double>(profile->not_taken);
+    if (total == 0.0) {
+        return 0;
+    }
+    if (profile->taken >= total * kBiasedBranch) {
+        return 1;
+    }
+    if (profile->not_taken >= total * kBiasedBranch) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 获取各分类的处理器数量
+ * @param heat 频率分类
+ */
+int ProfileData::countHandlers(Heat heat) const {
+    int count = 0;
+    for (const auto& entry : handlers_) {
+        count += getHeat(entry.first) == heat ? 1 : 0;
+    }
+    return count;
+}
+
+namespace {
+
+/**
+ * 按先序为一个处理器或函数中的 if 语句编号
+ * @param node 当前节点
+ * @param unit 所在处理器的显示名或函数名
+ * @param ordinal 已编号的 if 语句数
+ */
+void nameBranches(ASTNode* node, const std::string& unit, int& ordinal) {
+    if (node->getType() == ASTNodeType::IF_STMT) {
+        static_cast<IfStmtNode*>(node)->setBranchName(unit + " #" + std::to_string(++ordinal));
+    }
+    for (const auto& child : node->getChildren()) {
+        nameBranches(child.get(), unit, ordinal);
+    }
+}
+
+} // namespace
+
+/**
+ * 在任何优化遍之前为程序中的 if 语句命名剖析键
+ * @param program 程序根节点
+ */
+void assignBranchNames(ASTNode* program) {
+    for (const auto& child : program->getChildren()) {
+        std::string unit;
+        switch (child->getType()) {
+            case ASTNodeType::ON_START:
+            case ASTNodeType::ON_MESSAGE:
+            case ASTNodeType::ON_TIMER:
+            case ASTNodeType::ON_KEY:
+            case ASTNodeType::ON_STOP:
+                unit = static_cast<const OnEventNode*>(child.get())->getDisplayName();
+                break;
+            case ASTNodeType::FUNCTION:
+                unit = static_cast<const FunctionNode*>(child.get())->getName();
+                break;
+            default:
+                continue;
+        }
+        int ordinal = 0;
+        nameBranches(child.get(), unit, ordinal);
+    }
+}
+
+} // namespace capl
@@ -19,6 +19,27 @@ bool SemanticAnalyzer::analyze(const std::unique_ptr<ASTNode>& ast) {
         return false;
     }
     
+    // 预先登记 CAPL 内置函数和隐式符号
+    static const char* const builtins[] = {
+        "write", "output", "setTimer", "cancelTimer", "timeNow", "this"
+    };
+    for (const char* name : builtins) {
+        symbol_table_->addSymbol(Symbol(name, SymbolType::FUNCTION, "builtin"));
+    }
+    
+    // 预先登记定时器和用户函数，允许先使用后定义
+    for (const auto& child : ast->getChildren()) {
+        if (child->getType() == ASTNodeType::ON_TIMER) {
+            const OnEventNode* timerNode = static_cast<const OnEventNode*>(child.get());
+            symbol_table_->addSymbol(Symbol(timerNode->getEventName(), SymbolType::VARIABLE, "timer",
+                                            timerNode->getLine()));
+        } else if (child->getType() == ASTNodeType::FUNCTION) {
+            const FunctionNode* funcNode = static_cast<const FunctionNode*>(child.get());
+            symbol_table_->addSymbol(Symbol(funcNode->getName(), SymbolType::FUNCTION, funcNode->getReturnType(),
+                                            funcNode->getLine()));
+        }
+    }
+    
     // 使用 lambda 函数进行递归分析
     std::function<void(const ASTNode*)> analyzeNode = 
         [&](const ASTNode* node) {
@@ -31,6 +52,12 @@ bool SemanticAnalyzer::analyze(const std::unique_ptr<ASTNode>& ast) {
                     if (funcNode) {
                         Symbol func_symbol(funcNode->getName(), SymbolType::FUNCTION, funcNode->getReturnType());
                         symbol_table_->addSymbol(func_symbol);
+                        
+                        for (const auto& param : funcNode->getParameters()) {
+                            const VariableDeclNode* paramNode = static_cast<const VariableDeclNode*>(param.get());
+                            symbol_table_->addSymbol(Symbol(paramNode->getName(), SymbolType::PARAMETER,
+                                                            paramNode->getVarType(), paramNode->getLine()));
+                        }
                     }
                     break;
                 }
@@ -38,8 +65,14 @@ bool SemanticAnalyzer::analyze(const std::unique_ptr<ASTNode>& ast) {
                     // 对于变量声明节点，尝试转换为 VariableDeclNode
                     const VariableDeclNode* varNode = dynamic_cast<const VariableDeclNode*>(node);
                     if (varNode) {
-                        Symbol var_symbol(varNode->getName(), SymbolType::VARIABLE, varNode->getVarType());
+                        // 先分析初始化表达式，再登记变量本身
+                        for (const auto& child : node->getChildren()) {
+                            analyzeNode(child.get());
+                        }
+                        Symbol var_symbol(varNode->getName(), SymbolType::VARIABLE, varNode->getVarType(),
+                                          varNode->getLine(), varNode->getColumn());
                         symbol_table_->addSymbol(var_symbol);
+                        return;
                     }
                     break;
                 }
@@ -0,0 +1,380 @@
+/**
+ * CAPL 全局状态内存布局实现
+ */
+
+#include "../include/state_layout.h"
+#include "../include/ast.h"
+#include "../include/integer_narrowing.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace capl {
+
+namespace {
+
+size_t alignUp(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+/**
+ * 名称是否为作用域中声明的局部变量（形参或已声明的局部变量）
+ */
+bool isLocal(const std::vector<std::set<std::string>>& scopes, const std::string& name) {
+    for (const auto& scope : scopes) {
+        if (scope.count(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 收集 $信号 读取的报文，按报文 ID 排序
+ */
+void collectSignalFrames(const ASTNode* node, std::map<uint32_t, const SignalInfo*>& frames) {
+    if (node->getType() == ASTNodeType::SIGNAL_ACCESS) {
+        const SignalAccessNode* signal = static_cast<const SignalAccessNode*>(node);
+        if (signal->isResolved()) {
+            frames.emplace(signal->getInfo().message_id, &signal->getInfo());
+        }
+    }
+    for (const auto& child : node->getChildren()) {
+        collectSignalFrames(child.get(), frames);
+    }
+}
+
+} // namespace
+
+/**
+ * 构造函数
+ */
+StateLayout::StateLayout() : total_size_(0), group_count_(0) {
+}
+
+/**
+ * CAPL 类型对应的 C++ 类型
+ */
+std::string StateLayout::cppType(const std::string& capl_type) {
+    if (capl_type == "float") {
+        return "double";    // CAPL 的 float 为 64 位浮点数
+    }
+    if (capl_type == "message") {
+        return "Message";
+    }
+    // CAPL 整数类型宽度固定，用定宽类型保证回绕语义（int 为 16 位）
+    static const std::map<std::string, std::string> integer_types = {
+        {"byte", "uint8_t"}, {"int", "int16_t"}, {"word", "uint16_t"}, {"dword", "uint32_t"},
+        {"long", "int32_t"}, {"int64", "int64_t"}, {"qword", "uint64_t"}
+    };
+    auto it = integer_types.find(capl_type);
+    return it != integer_types.end() ? it->second : capl_type;
+}
+
+/**
+ * CAPL 类型（标量）的大小和对齐
+ */
+void StateLayout::scalarSizeAlign(const std::string& capl_type, size_t& size, size_t& align) {
+    if (capl_type == "char" || capl_type == "byte") {
+        size = align = 1;
+    } else if (capl_type == "int" || capl_type == "word") {
+        size = align = 2;
+    } else if (capl_type == "float" || capl_type == "int64" || capl_type == "qword") {
+        size = align = 8;
+    } else if (capl_type == "message") {
+        size = 16;          // 与生成代码中的 Message 结构体一致
+        align = 4;
+    } else {
+        size = align = 4;   // long、dword
+    }
+}
+
+/**
+ * 根据程序计算布局
+ * @param program AST 根节点
+ * @param narrowing 整数存储宽度收窄结果，为 nullptr 时按声明类型存储
+ */
+void StateLayout::compute(const ASTNode* program, const IntegerNarrowing* narrowing) {
+    fields_.clear();
+    total_size_ = 0;
+    group_count_ = 0;
+    
+    if (!program) {
+        return;
+    }
+    
+    // 1. 收集全局变量
+    std::set<std::string> globals;
+    std::map<std::string, const FunctionNode*> functions;
+    for (const auto& child : program->getChildren()) {
+        if (child->getType() == ASTNodeType::BLOCK_STMT) {
+            for (const auto& var : child->getChildren()) {
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(var.get());
+                StateField field;
+                field.name = decl->getName();
+                field.capl_type = decl->getVarType();
+                field.cpp_type = cppType(decl->getVarType());
+                field.array_size = decl->getArraySize();
+                scalarSizeAlign(field.capl_type, field.size, field.align);
+                const NarrowedVariable* narrowed = narrowing ? narrowing->findVariable(field.name) : nullptr;
+                if (narrowed) {
+                    field.cpp_type = narrowed->cpp_type;
+                    field.size = field.align = narrowed->size;
+                }
+                if (field.array_size > 0) {
+                    field.size *= static_cast<size_t>(field.array_size);
+                }
+                field.decl_order = static_cast<int>(fields_.size());
+                field.decl = decl;
+                fields_.push_back(field);
+                globals.insert(field.name);
+            }
+        } else if (child->getType() == ASTNodeType::FUNCTION) {
+            const FunctionNode* func = static_cast<const FunctionNode*>(child.get());
+            functions[func->getName()] = func;
+        }
+    }
+    
+    // 2. 分析每个事件处理器写入的全局变量（经由用户函数的写入计入调用者）
+    std::map<std::string, std::set<std::string>> function_writes;
+    std::set<std::string> in_progress;
+    
+    // scopes 为各层作用域中已声明的局部变量，局部变量只在声明之后、所在代码块之内遮蔽全局变量
+    std::function<void(const ASTNode*, std::vector<std::set<std::string>>&, std::set<std::string>&)> collectWrites =
+        [&](const ASTNode* node, std::vector<std::set<std::string>>& scopes, std::set<std::string>& writes) {
+            if (!node) {
+                return;
+            }
+            
+            if (node->getType() == ASTNodeType::BLOCK_STMT || node->getType() == ASTNodeType::FOR_STMT) {
+                scopes.emplace_back();
+                for (const auto& child : node->getChildren()) {
+                    collectWrites(child.get(), scopes, writes);
+                }
+                scopes.pop_back();
+                return;
+            }
+            if (node->getType() == ASTNodeType::VARIABLE_DECL) {
+                const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+                collectWrites(decl->getInitializer(), scopes, writes);
+                scopes.back().insert(decl->getName());
+                return;
+            }
+            
+            std::string target;
+            if (node->getType() == ASTNodeType::ASSIGNMENT_EXPR) {
+                target = getRootVariable(node->getChild(0));
+            } else if (node->getType() == ASTNodeType::UNARY_EXPR) {
+                const std::string& op = static_cast<const UnaryExprNode*>(node)->getOperator();
+                if (op == "++" || op == "--") {
+                    target = getRootVariable(node->getChild(0));
+                }
+            } else if (node->getType() == ASTNodeType::CALL_EXPR) {
+                const std::string& callee = static_cast<const CallExprNode*>(node)->getFunctionName();
+                auto it = functions.find(callee);
+                if (it != functions.end() && !in_progress.count(callee)) {
+                    if (!function_writes.count(callee)) {
+                        in_progress.insert(callee);
+                        std::vector<std::set<std::string>> callee_scopes(1);
+                        for (const auto& param : it->second->getParameters()) {
+                            callee_scopes.back().insert(static_cast<const VariableDeclNode*>(param.get())->getName());
+                        }
+                        std::set<std::string> callee_writes;
+                        for (const auto& stmt : it->second->getChildren()) {
+                            collectWrites(stmt.get(), callee_scopes, callee_writes);
+                        }
+                        function_writes[callee] = callee_writes;
+                        in_progress.erase(callee);
+                    }
+                    writes.insert(function_writes[callee].begin(), function_writes[callee].end());
+                }
+            }
+            
+            if (!target.empty() && globals.count(target) && !isLocal(scopes, target)) {
+                writes.insert(target);
+            }
+            
+            for (const auto& child : node->getChildren()) {
+                collectWrites(child.get(), scopes, writes);
+            }
+        };
+    
+    std::map<std::string, std::vector<std::string>> writers;
+    for (const auto& child : program->getChildren()) {
+        switch (child->getType()) {
+            case ASTNodeType::ON_START:
+            case ASTNodeType::ON_STOP:
+            case ASTNodeType::ON_MESSAGE:
+            case ASTNodeType::ON_TIMER:
+            case ASTNodeType::ON_KEY: {
+                const OnEventNode* handler = static_cast<const OnEventNode*>(child.get());
+                std::vector<std::set<std::string>> scopes(1);
+                std::set<std::string> writes;
+                for (const auto& stmt : handler->getChildren()) {
+                    collectWrites(stmt.get(), scopes, writes);
+                }
+                for (const auto& name : writes) {
+                    writers[name].push_back(handler->getDisplayName());
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    
+    // 3. 写入者集合相同的变量分为一组，每组独占缓存行
+    std::map<std::string, int> group_of_key;
+    for (auto& field : fields_) {
+        field.writers = writers[field.name];
+        std::string key;
+        for (const auto& writer : field.writers) {
+            key += writer + "\n";
+        }
+        auto it = group_of_key.find(key);
+        if (it == group_of_key.end()) {
+            it = group_of_key.emplace(key, group_count_++).first;
+        }
+        field.group = it->second;
+    }
+    
+    // 4. 组按首次声明顺序排列，组内按对齐降序排列以减少填充
+    std::stable_sort(fields_.begin(), fields_.end(), [](const StateField& a, const StateField& b) {
+        if (a.group != b.group) {
+            return a.group < b.group;
+        }
+        return a.align > b.align;
+    });
+    
+    // 5. 计算偏移
+    size_t offset = 0;
+    int current_group = -1;
+    for (auto& field : fields_) {
+        if (field.group != current_group) {
+            offset = alignUp(offset, kCacheLineSize);
+            current_group = field.group;
+        }
+        offset = alignUp(offset, field.align);
+        field.offset = offset;
+        offset += field.size;
+    }
+    total_size_ = fields_.empty() ? 0 : alignUp(offset, kCacheLineSize);
+}
+
+/**
+ * 追加运行时状态
+ * @param program AST 根节点
+ * @param timer_count 定时器数
+ */
+void StateLayout::addRuntimeState(const ASTNode* program, size_t timer_count) {
+    if (timer_count > 0) {
+        addRuntimeField("timers", "TimerSlot", static_cast<int>(timer_count), 16 * timer_count, 8, "");
+        addRuntimeField("now_ms", "long long", 0, 8, 8, "0");
+    }
+    if (!program) {
+        return;
+    }
+    std::map<uint32_t, const SignalInfo*> frames;
+    collectSignalFrames(program, frames);
+    for (const auto& frame : frames) {
+        char initializer[64];
+        std::snprintf(initializer, sizeof(initializer), "{0x%x, %d, 0, 0, 0, {0}}",
+                      frame.first, frame.second->message_dlc);
+        size_t size = 0;
+        size_t align = 0;
+        scalarSizeAlign("message", size, align);
+        addRuntimeField("capl_rx_" + frame.second->message, "Message", 0, size, align, initializer);
+    }
+}
+
+/**
+ * 追加运行时状态字段
+ */
+void StateLayout::addRuntimeField(const std::string& name, const std::string& cpp_type, int array_size,
+                                  size_t size, size_t align, const std::string& initializer) {
+    StateField field;
+    field.name = name;
+    field.cpp_type = cpp_type;
+    field.array_size = array_size;
+    field.size = size;
+    field.align = align;
+    field.decl_order = static_cast<int>(fields_.size());
+    field.runtime = true;
+    field.initializer = initializer;
+    
+    // 第一个运行时字段开始新的缓存行组
+    size_t offset = 0;
+    if (fields_.empty() || !fields_.back().runtime) {
+        field.group = group_count_++;
+        offset = alignUp(total_size_, kCacheLineSize);
+    } else {
+        field.group = fields_.back().group;
+        offset = fields_.back().offset + fields_.back().size;
+    }
+    field.offset = alignUp(offset, align);
+    fields_.push_back(field);
+    total_size_ = alignUp(field.offset + field.size, kCacheLineSize);
+}
+
+/**
+ * 查找字段
+ */
+const StateField* StateLayout::findField(const std::string& name) const {
+    for (const auto& field : fields_) {
+        if (field.name == name) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * 填充字节数
+ */
+size_t StateLayout::getPaddingBytes() const {
+    size_t used = 0;
+    for (const auto& field : fields_) {
+        used += field.size;
+    }
+    return total_size_ - used;
+}
+
+/**
+ * 输出布局报告
+ */
+void StateLayout::printReport(std::ostream& out) const {
+    out << "全局状态布局报告 (struct " << kStructName << ", " << kCacheLineSize << " 字节缓存行)\n";
+    out << "      偏移      大小  对齐  组  变量\n";
+    
+    for (const auto& field : fields_) {
+        std::string decl = field.cpp_type + " " + field.name;
+        if (field.array_size > 0) {
+            decl += "[" + std::to_string(field.array_size) + "]";
+        }
+        out << std::setw(10) << field.offset
+            << std::setw(10) << field.size
+            << std::setw(6) << field.align
+            << std::setw(4) << field.group
+            << "  " << decl;
+        if (field.runtime) {
+            out << "  (运行时)";
+        } else if (field.writers.empty()) {
+            out << "  (只读)";
+        } else {
+            out << "  写入者: ";
+            for (size_t i = 0; i < field.writers.size(); ++i) {
+                out << (i > 0 ? ", " : "") << field.writers[i];
+            }
+        }
+        out << "\n";
+    }
+    
+    out << "总计: " << total_size_ << " 字节, 填充 " << getPaddingBytes() << " 字节, "
+        << group_count_ << " 个缓存行组, " << total_size_ / kCacheLineSize << " 个缓存行\n";
+}
+
+} // namespace capl
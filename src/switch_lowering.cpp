@@ -0,0 +1,139 @@
+/**
+ * CAPL switch 语句的分派方式选择实现
+ */
+
+#include "../include/switch_lowering.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include <algorithm>
+
+namespace capl {
+
+/**
+ * 为程序中所有 switch 语句选择分派方式
+ * @param program AST 根节点
+ */
+void SwitchLowering::analyze(const ASTNode* program) {
+    clear();
+    if (program) {
+        collect(program);
+    }
+}
+
+void SwitchLowering::collect(const ASTNode* node) {
+    if (node->getType() == ASTNodeType::SWITCH_STMT) {
+        index_[node] = plans_.size();
+        plans_.push_back(plan(node));
+        plans_.back().id = index_[node];
+    }
+    for (const auto& child : node->getChildren()) {
+        collect(child.get());
+    }
+}
+
+/**
+ * 清空分析结果
+ */
+void SwitchLowering::clear() {
+    plans_.clear();
+    index_.clear();
+}
+
+/**
+ * 查找 switch 语句的分派方式
+ * @param node SWITCH_STMT 节点
+ * @return 分派方式，不存在时返回 nullptr
+ */
+const SwitchPlan* SwitchLowering::findPlan(const ASTNode* node) const {
+    auto it = index_.find(node);
+    return it != index_.end() ? &plans_[it->second] : nullptr;
+}
+
+/**
+ * 统计使用某种分派方式的 switch 数量
+ * @param kind 分派方式
+ */
+int SwitchLowering::countKind(SwitchKind kind) const {
+    int count = 0;
+    for (const auto& plan : plans_) {
+        count += plan.kind == kind ? 1 : 0;
+    }
+    return count;
+}
+
+/**
+ * 为一个 switch 语句选择分派方式
+ * @param node SWITCH_STMT 节点
+ * @return 分派方式
+ */
+SwitchPlan SwitchLowering::plan(const ASTNode* node) {
+    SwitchPlan plan;
+    plan.node = node;
+    size_t case_count = node->getChildCount() - 1;
+    
+    // 语句为空的 case 贯穿到下一个 case，直接跳到之后第一个有语句的 case
+    std::vector<size_t> resolved(case_count);
+    for (size_t i = case_count; i-- > 0;) {
+        const ASTNode* case_stmt = node->getChild(i + 1);
+        bool empty = case_stmt->getChild(case_stmt->getChildCount() - 1)->getChildCount() == 0;
+        resolved[i] = empty && i + 1 < case_count ? resolved[i + 1] : i;
+    }
+    for (size_t i = 0; i < case_count; ++i) {
+        SwitchCase entry;
+        entry.target = resolved[i];
+        if (caseValue(node->getChild(i + 1), entry.value)) {
+            plan.cases.push_back(entry);
+        } else if (plan.default_target < 0) {
+            plan.default_target = static_cast<int>(resolved[i]);
+        }
+    }
+    std::sort(plan.cases.begin(), plan.cases.end(), [](const SwitchCase& a, const SwitchCase& b) {
+        return a.value < b.value;
+    });
+    if (plan.cases.empty()) {
+        return plan;
+    }
+    
+    // 按无符号差计算跨度，避免有符号溢出
+    plan.min_value = plan.cases.front().value;
+    uint64_t range = static_cast<uint64_t>(plan.cases.back().value) - static_cast<uint64_t>(plan.min_value);
+    plan.span = range + 1;
+    
+    std::map<size_t, uint64_t> masks;
+    if (range < kBitTestWidth) {
+        for (const auto& entry : plan.cases) {
+            masks[entry.target] |= uint64_t(1) << (static_cast<uint64_t>(entry.value) - static_cast<uint64_t>(plan.min_value));
+        }
+    }
+    if (range < kBitTestWidth && masks.size() <= kMaxBitTestTargets) {
+        plan.kind = SwitchKind::BitTest;
+        for (const auto& entry : masks) {
+            plan.masks.push_back({entry.first, entry.second});
+        }
+    } else if (plan.cases.size() >= kMinJumpTableCases && range < plan.cases.size() * 100 / kMinJumpTableDensity) {
+        plan.kind = SwitchKind::JumpTable;
+    } else {
+        plan.kind = SwitchKind::BinarySearch;
+    }
+    return plan;
+}
+
+/**
+ * 获取 case 标签的值
+ * @param case_stmt CASE_STMT 节点
+ * @param value 输出的标签值
+ * @return 是否为带整数常量标签的 case（default 返回 false）
+ */
+bool SwitchLowering::caseValue(const ASTNode* case_stmt, long long& value) {
+    if (!case_stmt || case_stmt->getChildCount() < 2) {
+        return false;
+    }
+    ConstantValue constant;
+    if (!evaluateConstant(case_stmt->getChild(0), constant) || constant.is_float) {
+        return false;
+    }
+    value = constant.int_value;
+    return true;
+}
+
+} // namespace capl
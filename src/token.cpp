@@ -66,6 +66,8 @@ void KeywordMap::initializeKeywords() {
     keywords_["word"] = TokenType::WORD;
     keywords_["dword"] = TokenType::DWORD;
     keywords_["long"] = TokenType::LONG;
+    keywords_["int64"] = TokenType::INT64;
+    keywords_["qword"] = TokenType::QWORD;
     keywords_["can"] = TokenType::CAN;
     keywords_["candb"] = TokenType::CANDB;
     keywords_["signal"] = TokenType::SIGNAL;
@@ -118,11 +120,14 @@ std::string tokenTypeToString(TokenType type) {
         case TokenType::WORD: return "WORD";
         case TokenType::DWORD: return "DWORD";
         case TokenType::LONG: return "LONG";
+        case TokenType::INT64: return "INT64";
+        case TokenType::QWORD: return "QWORD";
         case TokenType::CAN: return "CAN";
         case TokenType::CANDB: return "CANDB";
         case TokenType::SIGNAL: return "SIGNAL";
         case TokenType::ENVVAR: return "ENVVAR";
         case TokenType::SYSVAR: return "SYSVAR";
+        case TokenType::SIGNAL_REF: return "SIGNAL_REF";
         case TokenType::ASSIGN: return "ASSIGN";
         case TokenType::PLUS: return "PLUS";
         case TokenType::MINUS: return "MINUS";
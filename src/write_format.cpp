@@ -0,0 +1,663 @@
+/**
+ * write() 格式字符串的编译期特化实现
+ */
+
+#include "../include/write_format.h"
+#include "../include/ast.h"
+#include "../include/constant_folding.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <set>
+
+namespace capl {
+
+namespace {
+
+/**
+ * 表达式的类型和整数位宽
+ */
+struct ValueInfo {
+    FormatValueType type = FormatValueType::Unknown;
+    int bits = 32;
+    
+    static ValueInfo make(FormatValueType type, int bits = 32) {
+        ValueInfo info;
+        info.type = type;
+        info.bits = bits;
+        return info;
+    }
+    
+    bool isInteger() const { return type == FormatValueType::Integer || type == FormatValueType::Unsigned; }
+};
+
+/**
+ * 变量的声明类型
+ */
+struct VariableType {
+    std::string capl_type;
+    bool is_array = false;
+};
+
+/**
+ * CAPL 标量类型的值类型
+ */
+ValueInfo scalarType(const std::string& capl_type) {
+    if (capl_type == "int") {
+        return ValueInfo::make(FormatValueType::Integer, 16);
+    }
+    if (capl_type == "long") {
+        return ValueInfo::make(FormatValueType::Integer, 32);
+    }
+    if (capl_type == "int64") {
+        return ValueInfo::make(FormatValueType::Integer, 64);
+    }
+    if (capl_type == "char") {
+        return ValueInfo::make(FormatValueType::Integer, 8);
+    }
+    if (capl_type == "byte") {
+        return ValueInfo::make(FormatValueType::Unsigned, 8);
+    }
+    if (capl_type == "word") {
+        return ValueInfo::make(FormatValueType::Unsigned, 16);
+    }
+    if (capl_type == "dword") {
+        return ValueInfo::make(FormatValueType::Unsigned, 32);
+    }
+    if (capl_type == "qword") {
+        return ValueInfo::make(FormatValueType::Unsigned, 64);
+    }
+    if (capl_type == "float" || capl_type == "double") {
+        return ValueInfo::make(FormatValueType::Float);
+    }
+    if (capl_type == "message") {
+        return ValueInfo::make(FormatValueType::Message);
+    }
+    return ValueInfo();
+}
+
+/**
+ * 信号的物理值类型：factor 和 offset 都是整数时为整数
+ */
+ValueInfo signalType(const SignalInfo& info) {
+    auto isInteger = [](double value) {
+        return value > -9007199254740992.0 && value < 9007199254740992.0 &&
+               value == static_cast<double>(static_cast<long long>(value));
+    };
+    if (isInteger(info.factor) && isInteger(info.offset)) {
+        return ValueInfo::make(FormatValueType::Integer, 64);
+    }
+    return ValueInfo::make(FormatValueType::Float);
+}
+
+/**
+ * 值类型的名称（用于错误信息）
+ */
+const char* typeName(FormatValueType type) {
+    switch (type) {
+        case FormatValueType::Integer:
+        case FormatValueType::Unsigned:
+            return "整数";
+        case FormatValueType::Float:
+            return "浮点数";
+        case FormatValueType::String:
+            return "字符串";
+        case FormatValueType::Message:
+            return "报文";
+        default:
+            return "未知类型";
+    }
+}
+
+/**
+ * 按 C 的规则格式化一个常量，结果与运行时格式化相同
+ */
+std::string formatConstant(const FormatSegment& segment, const ConstantValue& value) {
+    std::string spec = "%";
+    if (segment.flags & WriteFormats::kLeft) {
+        spec += '-';
+    }
+    if (segment.flags & WriteFormats::kPlus) {
+        spec += '+';
+    }
+    if (segment.flags & WriteFormats::kSpace) {
+        spec += ' ';
+    }
+    if (segment.flags & WriteFormats::kAlternate) {
+        spec += '#';
+    }
+    if (segment.flags & WriteFormats::kZero) {
+        spec += '0';
+    }
+    if (segment.width > 0) {
+        spec += std::to_string(segment.width);
+    }
+    if (segment.precision >= 0) {
+        spec += "." + std::to_string(segment.precision);
+    }
+    
+    std::vector<char> buffer(WriteFormats::kLineCapacity + 1);
+    int length = 0;
+    if (segment.kind == FormatSegment::Kind::Float) {
+        double number = value.is_float ? value.float_value : static_cast<double>(value.int_value);
+        length = std::snprintf(buffer.data(), buffer.size(), (spec + segment.conversion).c_str(), number);
+    } else if (segment.kind == FormatSegment::Kind::Char) {
+        length = std::snprintf(buffer.data(), buffer.size(), (spec + 'c').c_str(),
+                               static_cast<int>(static_cast<char>(value.int_value)));
+    } else {
+        // 按转换的位宽截断后以 64 位格式化
+        unsigned long long bits = static_cast<unsigned long long>(value.int_value);
+        if (segment.bits < 64) {
+            bits &= (1ULL << segment.bits) - 1;
+        }
+        spec += "ll";
+        spec += segment.conversion;
+        if (segment.is_signed) {
+            long long number = static_cast<long long>(bits);
+            if (segment.bits < 64 && (bits >> (segment.bits - 1)) & 1) {
+                number = static_cast<long long>(bits | ~((1ULL << segment.bits) - 1));
+            }
+            length = std::snprintf(buffer.data(), buffer.size(), spec.c_str(), number);
+        } else {
+            length = std::snprintf(buffer.data(), buffer.size(), spec.c_str(), bits);
+        }
+    }
+    length = std::min(std::max(length, 0), static_cast<int>(WriteFormats::kLineCapacity));
+    return std::string(buffer.data(), static_cast<size_t>(length));
+}
+
+/**
+ * 为 write 调用生成格式化方式的遍历：按处理器和函数记录变量的声明类型
+ */
+class FormatAnalyzer {
+public:
+    FormatAnalyzer(std::map<const ASTNode*, FormatPlan>& plans, std::vector<std::string>* errors)
+        : plans_(plans), errors_(errors) {}
+    
+    void run(const ASTNode* program) {
+        for (const auto& child : program->getChildren()) {
+            if (child->getType() == ASTNodeType::BLOCK_STMT) {
+                for (const auto& var : child->getChildren()) {
+                    declare(var.get(), globals_);
+                }
+            } else if (child->getType() == ASTNodeType::FUNCTION) {
+                const FunctionNode* func = static_cast<const FunctionNode*>(child.get());
+                functions_[func->getName()] = func->getReturnType();
+            }
+        }
+        for (const auto& child : program->getChildren()) {
+            if (child->getType() == ASTNodeType::BLOCK_STMT) {
+                continue;
+            }
+            // 处理器和函数内的局部变量和参数（不区分块作用域，与代码生成一致）
+            locals_.clear();
+            if (child->getType() == ASTNodeType::FUNCTION) {
+                for (const auto& param : static_cast<const FunctionNode*>(child.get())->getParameters()) {
+                    declare(param.get(), locals_);
+                }
+            }
+            collectLocals(child.get());
+            visit(child.get());
+        }
+    }
+
+private:
+    void declare(const ASTNode* node, std::map<std::string, VariableType>& scope) {
+        if (node->getType() != ASTNodeType::VARIABLE_DECL) {
+            return;
+        }
+        const VariableDeclNode* decl = static_cast<const VariableDeclNode*>(node);
+        VariableType type;
+        type.capl_type = decl->getVarType();
+        type.is_array = decl->getArraySize() != 0;
+        scope[decl->getName()] = type;
+    }
+    
+    void collectLocals(const ASTNode* node) {
+        declare(node, locals_);
+        for (const auto& child : node->getChildren()) {
+            collectLocals(child.get());
+        }
+    }
+    
+    const VariableType* findVariable(const std::string& name) const {
+        auto it = locals_.find(name);
+        if (it != locals_.end()) {
+            return &it->second;
+        }
+        it = globals_.find(name);
+        return it != globals_.end() ? &it->second : nullptr;
+    }
+    
+    void error(const ASTNode* node, const std::string& message) {
+        if (errors_) {
+            errors_->push_back("行 " + std::to_string(node->getLine()) + ": " + message);
+        }
+    }
+    
+    void visit(const ASTNode* node) {
+        if (node->getType() == ASTNodeType::CALL_EXPR &&
+            static_cast<const CallExprNode*>(node)->getFunctionName() == "write" && node->getChildCount() > 0) {
+            planWrite(node);
+        }
+        for (const auto& child : node->getChildren()) {
+            visit(child.get());
+        }
+    }
+    
+    /**
+     * 推断表达式的值类型
+     */
+    ValueInfo typeOf(const ASTNode* expr) const {
+        if (!expr) {
+            return ValueInfo();
+        }
+        switch (expr->getType()) {
+            case ASTNodeType::INTEGER_LITERAL:
+            case ASTNodeType::CHAR_LITERAL:
+            case ASTNodeType::BOOLEAN_LITERAL:
+                return ValueInfo::make(FormatValueType::Integer);
+            case ASTNodeType::FLOAT_LITERAL:
+                return ValueInfo::make(FormatValueType::Float);
+            case ASTNodeType::STRING_LITERAL:
+                return ValueInfo::make(FormatValueType::String);
+            case ASTNodeType::IDENTIFIER: {
+                const std::string& name = static_cast<const IdentifierNode*>(expr)->getName();
+                if (name == "this") {
+                    return ValueInfo::make(FormatValueType::Message);
+                }
+                const VariableType* variable = findVariable(name);
+                if (!variable) {
+                    return ValueInfo();
+                }
+                if (variable->is_array) {
+                    return variable->capl_type == "char" ? ValueInfo::make(FormatValueType::String) : ValueInfo();
+                }
+                return scalarType(variable->capl_type);
+            }
+            case ASTNodeType::INDEX_EXPR: {
+                const ASTNode* base = expr->getChild(0);
+                if (base->getType() == ASTNodeType::IDENTIFIER) {
+                    const VariableType* variable =
+                        findVariable(static_cast<const IdentifierNode*>(base)->getName());
+                    return variable && variable->is_array ? scalarType(variable->capl_type) : ValueInfo();
+                }
+                if (base->getType() == ASTNodeType::MEMBER_EXPR &&
+                    static_cast<const MemberExprNode*>(base)->getMember() == "data") {
+                    return ValueInfo::make(FormatValueType::Unsigned, 8);
+                }
+                return ValueInfo();
+            }
+            case ASTNodeType::MEMBER_EXPR: {
+                const MemberExprNode* member = static_cast<const MemberExprNode*>(expr);
+                if (member->getSignal()) {
+                    return signalType(*member->getSignal());
+                }
+                if (member->getMember() == "id") {
+                    return ValueInfo::make(FormatValueType::Unsigned, 32);
+                }
+                if (member->getMember() == "byte" || member->getMember() == "dlc" ||
+                    member->getMember() == "channel" || member->getMember() == "dir") {
+                    return ValueInfo::make(FormatValueType::Unsigned, 8);
+                }
+                return ValueInfo();
+            }
+            case ASTNodeType::SIGNAL_ACCESS: {
+                const SignalAccessNode* signal = static_cast<const SignalAccessNode*>(expr);
+                return signal->isResolved() ? signalType(signal->getInfo()) : ValueInfo();
+            }
+            case ASTNodeType::BINARY_EXPR: {
+                static const std::set<std::string> boolean_ops = {"==", "!=", "<", "<=", ">", ">=", "&&", "||"};
+                if (boolean_ops.count(static_cast<const BinaryExprNode*>(expr)->getOperator())) {
+                    return ValueInfo::make(FormatValueType::Integer);
+                }
+                ValueInfo left = typeOf(expr->getChild(0));
+                ValueInfo right = typeOf(expr->getChild(1));
+                if (left.type == FormatValueType::Float || right.type == FormatValueType::Float) {
+                    return left.isInteger() || right.isInteger() || left.type == right.type
+                               ? ValueInfo::make(FormatValueType::Float) : ValueInfo();
+                }
+                if (!left.isInteger() || !right.isInteger()) {
+                    return ValueInfo();
+                }
+                // 整数提升：不足 32 位的提升为 int
+                int bits = std::max(32, std::max(left.bits, right.bits));
+                bool is_unsigned = (left.type == FormatValueType::Unsigned && left.bits == bits) ||
+                                   (right.type == FormatValueType::Unsigned && right.bits == bits);
+                return ValueInfo::make(is_unsigned ? FormatValueType::Unsigned : FormatValueType::Integer, bits);
+            }
+            case ASTNodeType::UNARY_EXPR:
+                if (static_cast<const UnaryExprNode*>(expr)->getOperator() == "!") {
+                    return ValueInfo::make(FormatValueType::Integer);
+                }
+                return typeOf(expr->getChild(0));
+            case ASTNodeType::ASSIGNMENT_EXPR:
+                return typeOf(expr->getChild(0));
+            case ASTNodeType::CONDITIONAL_EXPR: {
+                ValueInfo left = typeOf(expr->getChild(1));
+                ValueInfo right = typeOf(expr->getChild(2));
+                if (left.type == right.type) {
+                    return ValueInfo::make(left.type, std::max(left.bits, right.bits));
+                }
+                if ((left.type == FormatValueType::Float && right.isInteger()) ||
+                    (right.type == FormatValueType::Float && left.isInteger())) {
+                    return ValueInfo::make(FormatValueType::Float);
+                }
+                return ValueInfo();
+            }
+            case ASTNodeType::CALL_EXPR: {
+                auto it = functions_.find(static_cast<const CallExprNode*>(expr)->getFunctionName());
+                return it != functions_.end() ? scalarType(it->second) : ValueInfo();
+            }
+            default:
+                return ValueInfo();
+        }
+    }
+    
+    /**
+     * 检查实参类型与转换是否相符
+     */
+    bool checkArgument(const ASTNode* call, const FormatSegment& segment, const ValueInfo& value, size_t position) {
+        bool matches = true;
+        switch (segment.kind) {
+            case FormatSegment::Kind::Integer:
+            case FormatSegment::Kind::Char:
+                matches = value.isInteger() || value.type == FormatValueType::Unknown;
+                break;
+            case FormatSegment::Kind::Float:
+                matches = value.type == FormatValueType::Float || value.type == FormatValueType::Unknown;
+                break;
+            case FormatSegment::Kind::String:
+                matches = value.type == FormatValueType::String || value.type == FormatValueType::Unknown;
+                break;
+            default:
+                break;
+        }
+        if (!matches) {
+            const char* expected = segment.kind == FormatSegment::Kind::Float    ? "浮点数"
+                                   : segment.kind == FormatSegment::Kind::String ? "字符串"
+                                                                                 : "整数";
+            error(call, std::string("write 格式 %") + segment.conversion + " 需要" + expected + "，第 " +
+                            std::to_string(position) + " 个实参为" + typeName(value.type));
+        }
+        return matches;
+    }
+    
+    void planWrite(const ASTNode* call) {
+        const ASTNode* format = call->getChild(0);
+        if (format->getType() != ASTNodeType::STRING_LITERAL) {
+            return;     // 格式字符串不是常量，运行时格式化
+        }
+        const std::string& text = static_cast<const LiteralNode*>(format)->getValue();
+        if (call->getChildCount() == 1 && text.find('%') == std::string::npos) {
+            return;     // 普通文本直接输出
+        }
+        
+        std::vector<FormatSegment> parsed;
+        std::string parse_error;
+        if (!WriteFormats::parse(text, parsed, parse_error)) {
+            error(call, "write 的格式字符串" + parse_error);
+            return;
+        }
+        FormatPlan plan;
+        plan.call = call;
+        size_t args = 0;
+        bool runtime = false;
+        for (const FormatSegment& segment : parsed) {
+            if (segment.kind != FormatSegment::Kind::Text) {
+                ++plan.conversions;
+                args = segment.arg;
+                runtime = runtime || segment.star_width || segment.star_precision;
+            }
+        }
+        if (args != call->getChildCount() - 1) {
+            error(call, "write 的格式字符串" + (args == plan.conversions
+                                                   ? "有 " + std::to_string(plan.conversions) + " 个转换"
+                                                   : "需要 " + std::to_string(args) + " 个实参（含 * 宽度或精度）") +
+                            "，但有 " + std::to_string(call->getChildCount() - 1) + " 个实参");
+            return;
+        }
+        if (runtime) {
+            return;     // * 宽度或精度由实参给出，运行时格式化
+        }
+        
+        bool valid = true;
+        for (FormatSegment segment : parsed) {
+            if (segment.kind == FormatSegment::Kind::Text) {
+                appendText(plan, segment.text);
+                continue;
+            }
+            const ASTNode* arg = call->getChild(segment.arg);
+            ValueInfo value = typeOf(arg);
+            if (!checkArgument(call, segment, value, segment.arg)) {
+                valid = false;
+                continue;
+            }
+            // 未写长度修饰时按实参的位宽格式化
+            if (segment.kind == FormatSegment::Kind::Integer && segment.bits == 0) {
+                segment.bits = value.isInteger() && value.bits == 64 ? 64 : 32;
+            }
+            
+            // 常量实参在编译期格式化
+            ConstantValue constant;
+            if (arg->getType() == ASTNodeType::STRING_LITERAL && segment.kind == FormatSegment::Kind::String) {
+                std::vector<char> buffer(WriteFormats::kLineCapacity + 1);
+                std::string spec = std::string("%") + (segment.flags & WriteFormats::kLeft ? "-" : "") + "*.*s";
+                const std::string& value_text = static_cast<const LiteralNode*>(arg)->getValue();
+                int length = std::snprintf(buffer.data(), buffer.size(), spec.c_str(), segment.width,
+                                           segment.precision >= 0 ? segment.precision
+                                                                  : static_cast<int>(value_text.size()),
+                                           value_text.c_str());
+                length = std::min(std::max(length, 0), static_cast<int>(WriteFormats::kLineCapacity));
+                appendText(plan, std::string(buffer.data(), static_cast<size_t>(length)));
+                continue;
+            }
+            if (segment.kind != FormatSegment::Kind::String && evaluateConstant(arg, constant) &&
+                constant.is_float == (segment.kind == FormatSegment::Kind::Float)) {
+                appendText(plan, formatConstant(segment, constant));
+                continue;
+            }
+            plan.segments.push_back(segment);
+        }
+        if (valid) {
+            plans_[call] = plan;
+        }
+    }
+    
+    /**
+     * 追加文本段，与前一个文本段合并
+     */
+    static void appendText(FormatPlan& plan, const std::string& text) {
+        if (text.empty()) {
+            return;
+        }
+        if (!plan.segments.empty() && plan.segments.back().kind == FormatSegment::Kind::Text) {
+            plan.segments.back().text += text;
+            return;
+        }
+        FormatSegment segment;
+        segment.text = text;
+        plan.segments.push_back(segment);
+    }
+    
+    std::map<const ASTNode*, FormatPlan>& plans_;       // 输出的格式化方式
+    std::vector<std::string>* errors_;                  // 输出的错误
+    std::map<std::string, VariableType> globals_;       // 全局变量
+    std::map<std::string, VariableType> locals_;        // 当前处理器或函数的局部变量和参数
+    std::map<std::string, std::string> functions_;      // 用户函数的返回类型
+};
+
+} // namespace
+
+/**
+ * 为程序中格式字符串为常量的 write 调用生成格式化方式
+ * @param program AST 根节点
+ * @param errors 输出的错误，为 nullptr 时不检查
+ */
+void WriteFormats::analyze(const ASTNode* program, std::vector<std::string>* errors) {
+    plans_.clear();
+    if (!program) {
+        return;
+    }
+    FormatAnalyzer analyzer(plans_, errors);
+    analyzer.run(program);
+}
+
+/**
+ * 清空分析结果
+ */
+void WriteFormats::clear() {
+    plans_.clear();
+}
+
+/**
+ * 查找 write 调用的格式化方式
+ * @param call CALL_EXPR 节点
+ * @return 格式化方式，不存在时返回 nullptr
+ */
+const FormatPlan* WriteFormats::findPlan(const ASTNode* call) const {
+    auto it = plans_.find(call);
+    return it != plans_.end() ? &it->second : nullptr;
+}
+
+/**
+ * 解析格式字符串：%[标志][宽度][.精度][长度]转换，长度修饰 hh/h/l/ll/I64 决定整数的位宽
+ * @param format 格式字符串
+ * @param segments 输出的各段
+ * @param error 失败原因
+ * @return 是否成功
+ */
+bool WriteFormats::parse(const std::string& format, std::vector<FormatSegment>& segments, std::string& error) {
+    segments.clear();
+    std::string text;
+    size_t arg = 0;
+    size_t i = 0;
+    auto flushText = [&]() {
+        if (!text.empty()) {
+            FormatSegment segment;
+            segment.text = text;
+            segments.push_back(segment);
+            text.clear();
+        }
+    };
+    
+    while (i < format.size()) {
+        char c = format[i++];
+        if (c != '%') {
+            text += c;
+            continue;
+        }
+        if (i < format.size() && format[i] == '%') {
+            text += '%';
+            ++i;
+            continue;
+        }
+        
+        FormatSegment segment;
+        for (; i < format.size(); ++i) {
+            char flag = format[i];
+            if (flag == '-') {
+                segment.flags |= kLeft;
+            } else if (flag == '0') {
+                segment.flags |= kZero;
+            } else if (flag == '+') {
+                segment.flags |= kPlus;
+            } else if (flag == ' ') {
+                segment.flags |= kSpace;
+            } else if (flag == '#') {
+                segment.flags |= kAlternate;
+            } else {
+                break;
+            }
+        }
+        if (i < format.size() && format[i] == '*') {
+            segment.star_width = true;
+            ++arg;
+            ++i;
+        }
+        while (i < format.size() && format[i] >= '0' && format[i] <= '9') {
+            segment.width = std::min(segment.width * 10 + (format[i++] - '0'), static_cast<int>(kLineCapacity));
+        }
+        if (i < format.size() && format[i] == '.') {
+            ++i;
+            segment.precision = 0;
+            if (i < format.size() && format[i] == '*') {
+                segment.star_precision = true;
+                ++arg;
+                ++i;
+            }
+            while (i < format.size() && format[i] >= '0' && format[i] <= '9') {
+                segment.precision =
+                    std::min(segment.precision * 10 + (format[i++] - '0'), static_cast<int>(kLineCapacity));
+            }
+        }
+        
+        // 长度修饰，0 表示按实参决定
+        segment.bits = 0;
+        if (format.compare(i, 3, "I64") == 0) {
+            segment.bits = 64;
+            i += 3;
+        } else if (format.compare(i, 2, "ll") == 0) {
+            segment.bits = 64;
+            i += 2;
+        } else if (format.compare(i, 2, "hh") == 0) {
+            segment.bits = 8;
+            i += 2;
+        } else if (i < format.size() && format[i] == 'h') {
+            segment.bits = 16;
+            ++i;
+        } else if (i < format.size() && format[i] == 'l') {
+            segment.bits = 32;      // CAPL 的 long 为 32 位
+            ++i;
+        }
+        
+        if (i >= format.size()) {
+            error = "以不完整的转换结尾";
+            return false;
+        }
+        segment.conversion = format[i++];
+        switch (segment.conversion) {
+            case 'd':
+            case 'i':
+                segment.kind = FormatSegment::Kind::Integer;
+                segment.is_signed = true;
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                segment.kind = FormatSegment::Kind::Integer;
+                segment.is_signed = false;
+                break;
+            case 'c':
+                segment.kind = FormatSegment::Kind::Char;
+                break;
+            case 's':
+                segment.kind = FormatSegment::Kind::String;
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+                segment.kind = FormatSegment::Kind::Float;
+                break;
+            default:
+                error = std::string("中有不支持的转换 %") + segment.conversion;
+                return false;
+        }
+        if (segment.kind != FormatSegment::Kind::Integer && segment.bits != 0 &&
+            !(segment.kind == FormatSegment::Kind::Float && segment.bits == 32)) {
+            error = std::string("中的长度修饰不能用于 %") + segment.conversion;
+            return false;
+        }
+        flushText();
+        segment.arg = ++arg;
+        segments.push_back(segment);
+    }
+    flushText();
+    return true;
+}
+
+} // namespace capl
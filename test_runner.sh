@@ -100,9 +100,88 @@ duration=$(echo "$end_time - $start_time" | bc)
 echo "编译时间: ${duration}s"
 
 echo ""
-echo "8. 清理测试文件"
+echo "8. 分析报告测试"
 echo "----------------------------------------"
-rm -f test_auto.cbf example_auto.cbf complex_auto.cbf perf_auto.cbf
+run_test "开销报告输出" "./bin/capl_compiler --cost-report ./examples/performance_test.capl -o perf_auto.cbf | grep -q '100  on start'" 0
+run_test "开销预算警告" "./bin/capl_compiler --cost-budget 400 ./examples/performance_test.capl -o perf_auto.cbf | grep -q '超出预算'" 0
+run_test "状态布局报告" "./bin/capl_compiler --layout-report ./examples/performance_test.capl -o perf_auto.cbf | grep -q '总计: 1792 字节'" 0
+run_test "状态结构体生成" "grep -q 'static_assert(sizeof(CaplState) == 1792' perf_auto.cbf" 0
+run_test "步长方向与终值相反的循环无常量边界" "./bin/capl_compiler --cost-report ./examples/trip_count_test.capl -o perf_auto.cbf > opt_trip.txt && grep -c '^ *704  *100  *100  on key .* \\[1 个循环无常量边界\\]' opt_trip.txt | grep -qx 2 && grep -q \"^ *4  *0  *0  on key 'd'\" opt_trip.txt && grep -q \"^ *4  *0  *0  on key 'e'\" opt_trip.txt" 0
+
+echo ""
+echo "9. 优化测试"
+echo "----------------------------------------"
+run_test "-O0 不运行优化遍" "./bin/capl_compiler -O0 --pass-stats ./examples/optimization_test.capl -o opt_auto.cbf | grep -q '未启用优化遍'" 0
+run_test "不可达代码删除" "./bin/capl_compiler -O1 --pass-stats ./examples/optimization_test.capl -o opt_auto.cbf | grep -q 'unreachable-code  *1  *3 '" 0
+run_test "on start 前缀求值" "./bin/capl_compiler -O2 --pass-stats ./examples/optimization_test.capl -o opt_auto.cbf | grep -q 'start-prefix  *1  *3 '" 0
+run_test "常量传播和折叠" "grep -q 'g_state.counter += 2;' opt_auto.cbf" 0
+run_test "死代码消除统计" "./bin/capl_compiler -O2 --pass-stats ./examples/optimization_test.capl -o opt_auto.cbf | grep -q 'dce  *2  *12 '" 0
+run_test "删除未使用的变量和函数" "! grep -qE 'twice|ticks|shown = 0' opt_auto.cbf" 0
+run_test "报文字段读取缓存" "./bin/capl_compiler -O2 --pass-stats ./examples/optimization_test.capl -o opt_auto.cbf | grep -q 'field-cse  *1  *3 ' && grep -q 'uint8_t this_data0 = this_msg.byte(0);' opt_auto.cbf" 0
+run_test "字段写入使缓存失效" "[ \$(grep -c 'this_msg.byte(1)' opt_auto.cbf) -eq 3 ]" 0
+run_test "小函数内联" "./bin/capl_compiler -O2 --pass-stats ./examples/optimization_test.capl -o opt_auto.cbf | grep -q '内联 clamp -> on timer tick'" 0
+run_test "按优化级别的内联阈值" "./bin/capl_compiler -O1 --pass-stats ./examples/performance_test.capl -o opt_auto.cbf | grep -q '不内联 calculate_average: 大小 36 超过阈值 16'" 0
+run_test "循环提取为向量化内核" "./bin/capl_compiler -O2 ./examples/performance_test.capl -o opt_auto.cbf | grep -q '4 个提取为内核函数, 其中 1 个生成 AVX2/SSE2 版本'" 0
+run_test "小循环完全展开" "grep -A1 'capl_loop_2(double\* __restrict data_array)' opt_auto.cbf | grep -q 'pragma GCC unroll 10'" 0
+run_test "省略证明安全的下标检查" "./bin/capl_compiler -O2 ./examples/performance_test.capl -o opt_auto.cbf | grep -q '7 处证明不会越界已省略, 保留 0 处' && ! grep -q 'capl_check_index(' opt_auto.cbf" 0
+run_test "删除内联后结果不被使用的循环" "./bin/capl_compiler -O2 ./examples/performance_test.capl -o opt_auto.cbf && ! grep -q 'calculate_average' opt_auto.cbf" 0
+run_test "调试构建保留下标检查" "./bin/capl_compiler -g -O2 ./examples/performance_test.capl -o opt_auto.cbf | grep -q '全部保留' && grep -q 'capl_check_index(i, 100, \"data_array\", 15)' opt_auto.cbf" 0
+run_test "整数类型回绕语义" "./bin/capl_compiler -O2 ./examples/integer_types_test.capl -o opt_auto.cbf > /dev/null && grep -q 'uint8_t sequence = 0;' opt_auto.cbf && grep -q 'uint64_t mask' opt_auto.cbf" 0
+run_test "全局整数存储收窄" "./bin/capl_compiler -O2 ./examples/integer_types_test.capl -o opt_auto.cbf | grep -q '4 个全局变量, 节省 292 字节' && grep -q 'uint8_t samples\\[256\\];' opt_auto.cbf && grep -q 'int16_t speed_table\\[64\\];' opt_auto.cbf" 0
+run_test "有符号整数溢出回绕" "./bin/capl_compiler -O2 ./examples/integer_wrap_test.capl -o opt_wrap.cbf > /dev/null && grep -q 'capl_mul(g_state.product, 65536)' opt_wrap.cbf && g++ -std=c++17 -fsanitize=undefined -fno-sanitize-recover=undefined -Iruntime -x c++ opt_wrap.cbf -x none lib/libcapl_rt.a -o opt_wrap && ./opt_wrap | tr '\\n' '|' | grep -qx 'counter=-32768 total=-2147483648 product=0 lowest=-2147483648|big=-9223372036854775808 total=2147483647|'" 0
+run_test "网关路由表" "./bin/capl_compiler -O1 ./examples/gateway_test.capl -o opt_auto.cbf | grep -q '4 个纯转发处理器编译为路由表 (5 条路由)' && grep -q '{0x101, 0x501, -1},' opt_auto.cbf" 0
+run_test "-O0 不编译网关路由" "./bin/capl_compiler -O0 ./examples/gateway_test.capl -o opt_auto.cbf > /dev/null && ! grep -q 'capl_routes' opt_auto.cbf && [ \$(grep -c 'void onMessage' opt_auto.cbf) -eq 5 ]" 0
+run_test "网关路由转发的输出与 -O0 相同" "./bin/capl_compiler -O0 ./examples/gateway_test.capl -o opt_driver.cbf > /dev/null && g++ -std=c++17 -Iruntime -DCAPL_NO_MAIN -x c++ opt_driver.cbf -x none examples/node_driver.cpp lib/libcapl_rt.a -o opt_driver && ./opt_driver 100 101 200 7DF 300 > opt_gateway.txt && ./bin/capl_compiler -O2 ./examples/gateway_test.capl -o opt_driver.cbf > /dev/null && g++ -std=c++17 -Iruntime -DCAPL_NO_MAIN -x c++ opt_driver.cbf -x none examples/node_driver.cpp lib/libcapl_rt.a -o opt_driver && ./opt_driver 100 101 200 7DF 300 | cmp -s - opt_gateway.txt && grep -qx '输出报文: 0x501' opt_gateway.txt" 0
+run_test "剖析插桩" "./bin/capl_compiler -O2 --profile-generate=capl.profile ./examples/profile_test.capl -o opt_auto.cbf | grep -q '剖析插桩: 8 个计数器' && grep -q '\"branch on message 0x100 #1 not_taken\",' opt_auto.cbf && [ \$(grep -c '\"branch smooth #1 taken\",' opt_auto.cbf) -eq 1 ]" 0
+run_test "剖析文件的键唯一，重复的记录被拒绝" "./bin/capl_compiler -O2 --profile-generate=opt_profile.profile ./examples/profile_test.capl -o opt_profile.cbf > /dev/null && g++ -std=c++17 -Iruntime -x c++ opt_profile.cbf -x none lib/libcapl_rt.a -o opt_profile && ./opt_profile && ./bin/capl_compiler -O2 --profile-use=opt_profile.profile ./examples/profile_test.capl -o opt_profile.cbf | grep -q '剖析数据: .* 2 个分支' && tail -n 1 opt_profile.profile >> opt_profile.profile && ./bin/capl_compiler -O2 --profile-use=opt_profile.profile ./examples/profile_test.capl -o opt_profile.cbf 2>&1 | grep -q 'opt_profile.profile:9: 重复的剖析记录: handler on message 0x7FF'" 0
+run_test "插桩和读入时内联不同，分支提示仍对应源 if 语句" "./bin/capl_compiler -O2 --pass-stats --profile-generate=opt_profile.profile ./examples/profile_inline_test.capl -o opt_profile.cbf | grep -q '不内联 filt' && g++ -std=c++17 -Iruntime -DCAPL_NO_MAIN -x c++ opt_profile.cbf -x none examples/node_driver.cpp lib/libcapl_rt.a -o opt_profile && ./opt_profile \$(for i in \$(seq 50); do echo 100:10,0,0,0,0,0,0,0; done) 100:10 > /dev/null && ./bin/capl_compiler -O2 --pass-stats --profile-use=opt_profile.profile ./examples/profile_inline_test.capl -o opt_profile.cbf | grep -q '内联 filt -> on message 0x100' && grep -q '__builtin_expect(!!(this_msg.dlc == 8), 1)' opt_profile.cbf && grep -q '__builtin_expect(!!(filt_r > 250), 0)' opt_profile.cbf" 0
+run_test "剖析引导优化" "./bin/capl_compiler -O2 --pass-stats --profile-use=./examples/profile_test.profile ./examples/profile_test.capl -o opt_auto.cbf | grep -q '不内联 smooth: 调用者是冷处理器' && grep -q '\\[\\[gnu::hot\\]\\] void onMessage' opt_auto.cbf && grep -q '#pragma GCC unroll 32' opt_auto.cbf && grep -q '__builtin_expect(!!(this_msg.dlc == 8), 1)' opt_auto.cbf" 0
+run_test "直接索引分派表" "./bin/capl_compiler -O1 ./examples/performance_test.capl -o opt_auto.cbf | grep -q '报文分派: 5 个 ID, 直接索引表 (5 项)' && grep -q 'capl_message_table\\[index\\](msg);' opt_auto.cbf" 0
+run_test "完美散列分派表" "./bin/capl_compiler -O2 ./examples/dispatch_test.capl -o opt_auto.cbf | grep -q '报文分派: 6 个 ID, 完美散列表 (8 项, 4 个桶)' && grep -q '{0x18fef100, onMessage_0x18FEF100},' opt_auto.cbf && grep -q 'onMessage_any(msg);' opt_auto.cbf" 0
+run_test "定时器整数 ID" "./bin/capl_compiler -O1 ./examples/performance_test.capl -o opt_auto.cbf | grep -q '定时器和按键: 3 个定时器 ID, 1 个按键处理器' && grep -q 'setTimer(capl_timer_perf_timer1, 100);' opt_auto.cbf && grep -q 'capl_timer_handlers\\[timer\\]();' opt_auto.cbf" 0
+run_test "按键处理器数组" "./bin/capl_compiler -O1 ./examples/example.capl -o opt_auto.cbf > /dev/null && grep -q 'table.handlers\\[97\\] = onKey_a;' opt_auto.cbf && grep -q 'capl_key_table.handlers\\[key\\]();' opt_auto.cbf" 0
+run_test "switch 跳转表" "./bin/capl_compiler -O2 ./examples/switch_test.capl -o opt_auto.cbf | grep -q 'switch 分派: 3 个 switch, 1 个跳转表, 1 个二分查找, 1 个位测试' && grep -q 'goto \\*(capl_switch0_offset < 6 ? capl_switch0_table\\[capl_switch0_offset\\]' opt_auto.cbf" 0
+run_test "switch 二分查找和位测试" "./bin/capl_compiler -O2 ./examples/switch_test.capl -o opt_auto.cbf > /dev/null && grep -q 'std::lower_bound(capl_switch1_values' opt_auto.cbf && grep -q 'if (capl_switch2_bit & 0x154ULL) goto capl_switch2_case4;' opt_auto.cbf" 0
+run_test "合并相同的事件处理器" "./bin/capl_compiler -O1 ./examples/performance_test.capl -o opt_auto.cbf | grep -q '4 个处理器共用' && [ \$(grep -c 'void onMessage_' opt_auto.cbf) -eq 1 ]" 0
+run_test "-O0 不合并事件处理器" "./bin/capl_compiler -O0 ./examples/performance_test.capl -o opt_auto.cbf > /dev/null && [ \$(grep -c 'void onMessage_' opt_auto.cbf) -eq 5 ]" 0
+run_test "SSA 中间表示输出" "./bin/capl_compiler --ir-dump ./examples/performance_test.capl -o opt_auto.cbf | grep -q 'phi \\[0, bb0\\]'" 0
+run_test "SSA 中间表示验证" "./bin/capl_compiler -O2 --verify-ir ./examples/complex_test.capl -o opt_auto.cbf | grep -q '^中间表示: .* 个函数通过验证' && ! ./bin/capl_compiler -O2 ./examples/complex_test.capl -o opt_auto.cbf | grep -q '^中间表示'" 0
+run_test "内容未变化时不重写" "./bin/capl_compiler -O1 ./examples/performance_test.capl -o opt_auto.cbf > /dev/null && before=\$(stat -c %y opt_auto.cbf) && ./bin/capl_compiler -O1 ./examples/performance_test.capl -o opt_auto.cbf | grep -q '内容未变化，未重写文件' && [ \"\$(stat -c %y opt_auto.cbf)\" = \"\$before\" ]" 0
+run_test "替换输出文件保留权限" "./bin/capl_compiler -O0 ./examples/simple_test.capl -o opt_auto.cbf > /dev/null && chmod 750 opt_auto.cbf && ./bin/capl_compiler -O1 ./examples/performance_test.capl -o opt_auto.cbf > /dev/null && [ \"\$(stat -c %a opt_auto.cbf)\" = 750 ] && ! ls opt_auto.cbf.tmp.* > /dev/null 2>&1" 0
+run_test "内容变化时替换输出文件" "./bin/capl_compiler -O0 ./examples/performance_test.capl -o opt_auto.cbf | grep -q '代码生成成功: opt_auto.cbf\$' && [ \$(grep -c 'void onMessage_' opt_auto.cbf) -eq 5 ] && ! ls opt_auto.cbf.tmp.* > /dev/null 2>&1" 0
+run_test "多线程代码生成确定性" "./bin/capl_compiler -O2 -j 1 ./examples/complex_test.capl -o opt_auto.cbf > /dev/null && ./bin/capl_compiler -O2 -j 8 ./examples/complex_test.capl -o opt_parallel.cbf > /dev/null && cmp -s opt_auto.cbf opt_parallel.cbf && ./bin/capl_compiler -O2 -j 1 ./examples/switch_test.capl -o opt_auto.cbf > /dev/null && ./bin/capl_compiler -O2 --jobs=8 ./examples/switch_test.capl -o opt_parallel.cbf > /dev/null && cmp -s opt_auto.cbf opt_parallel.cbf" 0
+run_test "拒绝非正的线程数" "./bin/capl_compiler -j 0 ./examples/simple_test.capl -o opt_parallel.cbf" 1
+run_test "分片输出" "./bin/capl_compiler -O1 --shards=3 ./examples/performance_test.capl -o opt_shard.cbf | grep -q '分片输出: 3 个分片 (处理器和函数数/字节: 0/' && grep -q '^inline CaplState g_state;' opt_shard.h && grep -q '^#include \"opt_shard.h\"' opt_shard_2.cbf && grep -q '^int main()' opt_shard_0.cbf" 0
+run_test "分片结果确定" "./bin/capl_compiler -O2 -j 8 --shards=3 ./examples/complex_test.capl -o opt_shard.cbf > /dev/null && ./bin/capl_compiler -O2 -j 1 --shards=3 ./examples/complex_test.capl -o opt_shard.cbf | grep -q '4 个文件内容未变化，未重写'" 0
+run_test "非数字的选项值" "./bin/capl_compiler --shards abc ./examples/simple_test.capl -o opt_shard.cbf 2>&1 | grep -q '分片数必须为正整数' && ./bin/capl_compiler --cost-budget 1e3 ./examples/simple_test.capl -o opt_shard.cbf 2>&1 | grep -q '开销预算必须为非负整数'" 0
+run_test "分片数不超过单元数" "rm -f opt_shard* && ./bin/capl_compiler -O1 --shards=64 ./examples/simple_test.capl -o opt_shard.cbf | grep -q '分片输出: 1 个分片' && test -e opt_shard_0.cbf && ! test -e opt_shard_1.cbf" 0
+run_test "运行时库头文件" "./bin/capl_compiler -O2 ./examples/performance_test.capl -o opt_rt.cbf > /dev/null && grep -q '^#include \"capl_rt.h\"' opt_rt.cbf && ! grep -q 'iostream\\|namespace capl_runtime {' opt_rt.cbf" 0
+run_test "链接运行时库" "g++ -std=c++17 -Iruntime -x c++ opt_rt.cbf -x none lib/libcapl_rt.a -o opt_rt && ./opt_rt | grep -q 'Performance test started'" 0
+run_test "CAN 数据库" "rm -f powertrain.dbc.idx && ./bin/capl_compiler ./examples/dbc_test.capl -o opt_dbc.cbf | grep -q '已解析, 写入索引缓存 powertrain.dbc.idx' && ./bin/capl_compiler ./examples/dbc_test.capl -o opt_dbc.cbf | grep '从索引缓存加载' > /dev/null && ! test -e examples/powertrain.dbc.idx && grep -q 'case 0x100: g_state.capl_rx_EngineData = msg' opt_dbc.cbf" 0
+run_test "信号访问器" "grep -q 'Signal<15, 16, kMotorola, kUnsigned>::set(g_state.tx_status, 1500)' opt_dbc.cbf && grep -q 'Message limited = {0x100, 8' opt_dbc.cbf" 0
+run_test "信号访问器代码可运行" "g++ -std=c++17 -Iruntime -x c++ opt_dbc.cbf -x none lib/libcapl_rt.a -o opt_dbc && ./opt_dbc | grep -q 'DBC test started'" 0
+run_test "write 格式展开" "./bin/capl_compiler ./examples/test.can -o opt_fmt.cbf && grep -q 'WriteLine().text(\"引擎转速: \", 14).dec(static_cast<int32_t>(rpm))' opt_fmt.cbf && g++ -std=c++17 -Iruntime -x c++ opt_fmt.cbf -x none lib/libcapl_rt.a -o opt_fmt" 0
+run_test "write 格式类型检查" "./bin/capl_compiler -S ./examples/format_error_test.capl" 1
+run_test "write 运行时格式化" "./bin/capl_compiler -O2 ./examples/write_runtime_test.capl -o opt_fmt.cbf && grep -q 'write(g_state.fmt, 42, 100000);' opt_fmt.cbf && grep -q 'write(\"\\[%\\*d\\]\", 6, 42);' opt_fmt.cbf && g++ -std=c++17 -Iruntime -x c++ opt_fmt.cbf -x none lib/libcapl_rt.a -o opt_fmt && ./opt_fmt | tr '\\n' '|' | grep -qx 'value=42, total=100000|\\[    42\\]|\\[3.14    \\]|\\[abc\\]|\\[  5000000000\\]|value=42|'" 0
+run_test "状态快照和恢复" "grep -q 'alignas(64) TimerSlot timers\\[3\\];' opt_rt.cbf && grep -q 'memcpy(&g_state, buffer, sizeof(CaplState));' opt_rt.cbf" 0
+run_test "报文缓存在状态结构体中" "grep -q '    alignas(64) Message capl_rx_EngineData = {0x100, 8, 0, 0, 0, {0}};' opt_dbc.cbf && grep -q 'static_assert(__is_trivially_copyable(CaplState)' opt_dbc.cbf" 0
+run_test "CAN 数据库符号错误" "./bin/capl_compiler -S ./examples/dbc_error_test.capl" 1
+run_test "重复或无法解析的报文处理器" "./bin/capl_compiler -S ./examples/duplicate_handler_test.capl > opt_dup.txt 2>&1; test \$? -ne 0 && grep -q '行 13: on message 256 与行 8 的 on message 0x100 处理同一报文 0x100' opt_dup.txt && grep -q '行 22: on message 0x200 与行 18 的 on message Status 处理同一报文 0x200' opt_dup.txt && grep -q '行 27: 未知的报文名 EngineData：没有用 candb 声明 CAN 数据库' opt_dup.txt" 0
+run_test "message 变量名声明的处理器" "./bin/capl_compiler -O2 ./examples/test.can -o opt_driver.cbf > /dev/null && g++ -std=c++17 -Iruntime -DCAPL_NO_MAIN -x c++ opt_driver.cbf -x none examples/node_driver.cpp lib/libcapl_rt.a -o opt_driver && ./opt_driver 100:10,27,5A 200:3C,0 | grep -q '当前车速: 60 km/h' && ./opt_driver 100:10,27,5A | grep -q '引擎转速: 10000 RPM'" 0
+run_test "内层局部变量遮蔽全局变量" "./bin/capl_compiler -O0 ./examples/shadow_test.capl -o opt_shadow.cbf && g++ -std=c++17 -Iruntime -x c++ opt_shadow.cbf -x none lib/libcapl_rt.a -o opt_shadow && ./opt_shadow | grep -qx 'g=5'" 0
+run_test "常量传播不混淆同名的局部和全局变量" "./bin/capl_compiler -O2 ./examples/shadow_test.capl -o opt_shadow.cbf && g++ -std=c++17 -Iruntime -x c++ opt_shadow.cbf -x none lib/libcapl_rt.a -o opt_shadow && ./opt_shadow | grep -qx 'g=5'" 0
+run_test "同名局部变量不改变布局的写入者分组" "./bin/capl_compiler --layout-report ./examples/shadow_test.capl -o opt_shadow.cbf > opt_layout.txt && grep -q 'int16_t g  写入者: on start\$' opt_layout.txt && grep -q \"int16_t h  写入者: on key 'h'\$\" opt_layout.txt" 0
+run_test "死代码消除按块作用域区分同名变量" "./bin/capl_compiler -O2 ./examples/dce_shadow_test.capl -o opt_shadow.cbf && ! grep -q 'unused = 4' opt_shadow.cbf && g++ -std=c++17 -Iruntime -x c++ opt_shadow.cbf -x none lib/libcapl_rt.a -o opt_shadow && ./opt_shadow | tr '\\n' ' ' | grep -qx 'g=1 inner=3 unused=5 g=2 '" 0
+run_test "on start 以局部变量声明开头时的前缀求值" "./bin/capl_compiler -O2 --pass-stats ./examples/start_prefix_test.capl -o opt_prefix.cbf | grep -q 'start-prefix  *1  *2 ' && grep -q 'int16_t b = 7;' opt_prefix.cbf && g++ -std=c++17 -Iruntime -x c++ opt_prefix.cbf -x none lib/libcapl_rt.a -o opt_prefix && ./opt_prefix | grep -qx 'b=10 scale=3.5'" 0
+run_test "内联不留下空代码块和未使用的临时变量" "./bin/capl_compiler -O1 ./examples/inline_cleanup_test.capl -o opt_inline.cbf > /dev/null && grep -qx '    count();' opt_inline.cbf && [ \$(grep -c 'int16_t twice_' opt_inline.cbf) -eq 1 ] && ! grep -q '_result' opt_inline.cbf && grep -q 'g_state.total = clampv_hi;' opt_inline.cbf && ! grep -A1 -x '    {' opt_inline.cbf | grep -qx '    }' && g++ -std=c++17 -Iruntime -x c++ opt_inline.cbf -x none lib/libcapl_rt.a -o opt_inline && ./opt_inline | tr '\\n' ' ' | grep -qx 'total=6 calls=1 clamped=50 '" 0
+run_test "-O2 内联后展开不声明变量的代码块" "./bin/capl_compiler -O2 ./examples/inline_cleanup_test.capl -o opt_inline.cbf > /dev/null && grep -qx '    g_state.total = 6;' opt_inline.cbf && g++ -std=c++17 -Iruntime -x c++ opt_inline.cbf -x none lib/libcapl_rt.a -o opt_inline && ./opt_inline | grep -qx 'total=6 calls=1'" 0
+run_test "外部驱动分派报文" "./bin/capl_compiler -O2 ./examples/dispatch_test.capl -o opt_driver.cbf > /dev/null && g++ -std=c++17 -Iruntime -DCAPL_NO_MAIN -x c++ opt_driver.cbf -x none examples/node_driver.cpp lib/libcapl_rt.a -o opt_driver && ./opt_driver 0C0:12,34 18FEF100:00,00,64 123 | tr '\\n' ' ' | grep -qx '输出: 4660 输出: 100 输出: 0 输出: 1 '" 0
+run_test "外部驱动推进定时器和分派按键" "./bin/capl_compiler -O2 ./examples/test.can -o opt_driver.cbf > /dev/null && g++ -std=c++17 -Iruntime -DCAPL_NO_MAIN -x c++ opt_driver.cbf -x none examples/node_driver.cpp lib/libcapl_rt.a -o opt_driver && ./opt_driver t1000 t999 kr t1 | tr '\\n' '|' | grep -qx 'CAPL 测试程序启动|心跳 - 已处理 0 条消息|重置计数器|心跳 - 已处理 0 条消息|CAPL 测试程序停止|'" 0
+
+echo ""
+echo "10. 清理测试文件"
+echo "----------------------------------------"
+rm -f test_auto.cbf example_auto.cbf complex_auto.cbf perf_auto.cbf opt_auto.cbf opt_parallel.cbf opt_shard* opt_rt.cbf opt_rt opt_dbc.cbf opt_dbc opt_fmt.cbf opt_fmt opt_shadow.cbf opt_shadow opt_prefix.cbf opt_prefix opt_driver.cbf opt_driver opt_gateway.txt opt_profile.cbf opt_profile opt_profile.profile opt_inline.cbf opt_inline opt_dup.txt opt_trip.txt opt_wrap.cbf opt_wrap opt_layout.txt powertrain.dbc.idx
 rm -f test_auto_ast.txt test_auto_tokens.txt
 echo "✓ 测试文件清理完成"
 